@@ -0,0 +1,117 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <random.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <memory>
+#include <vector>
+
+/* Proof-of-stake entries in the synthetic block tree, more than the recent signature cache can hold */
+static const int BLOCK_SIG_TREE_SIZE = 50000;
+
+static std::unique_ptr<CBlockTreeDB> g_bench_blocktree;
+
+static bool ReadBenchBlockSig(const uint256& hash, std::vector<unsigned char>& vchBlockSig)
+{
+    return g_bench_blocktree->ReadBlockSig(hash, vchBlockSig);
+}
+
+struct BlockSigTree {
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> entries;
+
+    BlockSigTree() : hashes(BLOCK_SIG_TREE_SIZE), entries(BLOCK_SIG_TREE_SIZE)
+    {
+        g_bench_blocktree = std::make_unique<CBlockTreeDB>(8 << 20, true, true);
+        FastRandomContext rng(true);
+        std::vector<const CBlockIndex*> blockinfo;
+        blockinfo.reserve(BLOCK_SIG_TREE_SIZE);
+        for (int i = 0; i < BLOCK_SIG_TREE_SIZE; ++i) {
+            CBlockIndex& index = entries[i];
+            hashes[i] = rng.rand256();
+            index.phashBlock = &hashes[i];
+            index.pprev = i == 0 ? nullptr : &entries[i - 1];
+            index.nHeight = i;
+            index.nVersion = CBlockHeader::POSV2_BITS;
+            index.hashMerkleRoot = rng.rand256();
+            index.nTime = 1600000000 + 60 * i;
+            index.nBits = 0x1d00ffff;
+            index.SetProofOfStake();
+            index.posStakeHash = rng.rand256();
+            index.posStakeN = rng.randrange(4);
+            index.pvchBlockSig = std::make_shared<const std::vector<unsigned char>>(rng.randbytes(72));
+            blockinfo.push_back(&index);
+        }
+        bool ret = g_bench_blocktree->WriteBatchSync({}, 0, blockinfo);
+        assert(ret);
+        SetBlockSigLoader(ReadBenchBlockSig);
+    }
+
+    ~BlockSigTree()
+    {
+        SetBlockSigLoader(nullptr);
+        g_bench_blocktree.reset();
+    }
+};
+
+/* Build one getheaders reply the way net_processing does: headers under cs_main, missing signatures after */
+static void ServeHeaders(const std::vector<CBlockIndex>& entries, int nStart)
+{
+    std::vector<CBlock> vHeaders;
+    std::vector<std::pair<size_t, uint256>> vMissingSigs;
+    for (int i = nStart; i < nStart + (int)MAX_HEADERS_RESULTS && i < (int)entries.size(); ++i) {
+        vHeaders.push_back(entries[i].GetBlockHeader(/* fLoadSig */ false));
+        if (entries[i].IsProofOfStake() && vHeaders.back().vchBlockSig.empty()) {
+            vMissingSigs.emplace_back(vHeaders.size() - 1, entries[i].GetBlockHash());
+        }
+    }
+    for (const auto& missing : vMissingSigs) {
+        bool ret = LoadBlockSig(missing.second, vHeaders[missing.first].vchBlockSig);
+        assert(ret);
+    }
+    assert(vHeaders.back().vchBlockSig.size() == 72);
+}
+
+/* Signatures kept in every CBlockIndex, how headers were served before they were released */
+static void GetHeaders_SigsInMemory(benchmark::Bench& bench)
+{
+    BlockSigTree tree;
+    bench.batch(MAX_HEADERS_RESULTS).unit("header").run([&] {
+        ServeHeaders(tree.entries, BLOCK_SIG_TREE_SIZE - MAX_HEADERS_RESULTS);
+    });
+}
+
+/* Signatures released at the tip, a synced peer asking for the last headers hits the recent signature cache */
+static void GetHeaders_SigsCached(benchmark::Bench& bench)
+{
+    BlockSigTree tree;
+    for (auto& index : tree.entries) {
+        index.ReleaseBlockSig();
+    }
+    bench.batch(MAX_HEADERS_RESULTS).unit("header").run([&] {
+        ServeHeaders(tree.entries, BLOCK_SIG_TREE_SIZE - MAX_HEADERS_RESULTS);
+    });
+}
+
+/* Signatures released long ago, a syncing peer walks the chain and every signature is read from the DB */
+static void GetHeaders_SigsFromDB(benchmark::Bench& bench)
+{
+    BlockSigTree tree;
+    for (auto& index : tree.entries) {
+        index.pvchBlockSig.reset();
+    }
+    int nStart = 0;
+    bench.batch(MAX_HEADERS_RESULTS).unit("header").run([&] {
+        ServeHeaders(tree.entries, nStart);
+        nStart = (nStart + MAX_HEADERS_RESULTS) % (BLOCK_SIG_TREE_SIZE - MAX_HEADERS_RESULTS);
+    });
+}
+
+BENCHMARK(GetHeaders_SigsInMemory);
+BENCHMARK(GetHeaders_SigsCached);
+BENCHMARK(GetHeaders_SigsFromDB);
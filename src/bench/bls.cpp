@@ -299,7 +299,7 @@ static void BLS_Verify_Batched(benchmark::Bench& bench)
     });
 }
 
-static void BLS_Verify_BatchedParallel(benchmark::Bench& bench)
+static void RunVerifyBatchedParallel(benchmark::Bench& bench, int workerCount)
 {
     BLSPublicKeyVector pubKeys;
     BLSSecretKeyVector secKeys;
@@ -316,7 +316,7 @@ static void BLS_Verify_BatchedParallel(benchmark::Bench& bench)
     };
 
     CBLSWorker blsWorker;
-    blsWorker.Start();
+    blsWorker.Start(workerCount);
 
     // Benchmark.
     bench.minEpochIterations(1000).run([&] {
@@ -353,6 +353,18 @@ static void BLS_Verify_BatchedParallel(benchmark::Bench& bench)
     blsWorker.Stop();
 }
 
+static void BLS_Verify_BatchedParallel(benchmark::Bench& bench)
+{
+    RunVerifyBatchedParallel(bench, 0);
+}
+
+// Scaling of the batched signature verification with the number of worker threads
+static void BLS_Verify_BatchedParallel_Threads1(benchmark::Bench& bench) { RunVerifyBatchedParallel(bench, 1); }
+static void BLS_Verify_BatchedParallel_Threads2(benchmark::Bench& bench) { RunVerifyBatchedParallel(bench, 2); }
+static void BLS_Verify_BatchedParallel_Threads4(benchmark::Bench& bench) { RunVerifyBatchedParallel(bench, 4); }
+static void BLS_Verify_BatchedParallel_Threads8(benchmark::Bench& bench) { RunVerifyBatchedParallel(bench, 8); }
+static void BLS_Verify_BatchedParallel_Threads16(benchmark::Bench& bench) { RunVerifyBatchedParallel(bench, 16); }
+
 BENCHMARK(BLS_PubKeyAggregate_Normal)
 BENCHMARK(BLS_SecKeyAggregate_Normal)
 BENCHMARK(BLS_SignatureAggregate_Normal)
@@ -367,3 +379,8 @@ BENCHMARK(BLS_Verify_LargeAggregatedBlock1000)
 BENCHMARK(BLS_Verify_LargeAggregatedBlock1000PreVerified)
 BENCHMARK(BLS_Verify_Batched)
 BENCHMARK(BLS_Verify_BatchedParallel)
+BENCHMARK(BLS_Verify_BatchedParallel_Threads1)
+BENCHMARK(BLS_Verify_BatchedParallel_Threads2)
+BENCHMARK(BLS_Verify_BatchedParallel_Threads4)
+BENCHMARK(BLS_Verify_BatchedParallel_Threads8)
+BENCHMARK(BLS_Verify_BatchedParallel_Threads16)
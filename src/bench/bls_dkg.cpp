@@ -54,7 +54,7 @@ private:
     }
 
 public:
-    explicit DKG(int quorumSize)
+    explicit DKG(int quorumSize, int workerCount = 0)
     {
         members.reserve(quorumSize);
         ids.reserve(quorumSize);
@@ -66,7 +66,7 @@ public:
             ids.emplace_back(id);
         }
 
-        blsWorker.Start();
+        blsWorker.Start(workerCount);
         for (int i = 0; i < quorumSize; i++) {
             blsWorker.GenerateContributions(quorumSize / 2 + 1, ids, members[i].vvec, members[i].skShares);
         }
@@ -76,12 +76,12 @@ public:
         blsWorker.Stop();
     }
 
-    void Bench_BuildQuorumVerificationVectors(benchmark::Bench& bench, uint32_t epoch_iters)
+    void Bench_BuildQuorumVerificationVectors(benchmark::Bench& bench, uint32_t epoch_iters, bool parallel = false)
     {
         ReceiveVvecs();
 
         bench.minEpochIterations(epoch_iters).run([&] {
-            quorumVvec = blsWorker.BuildQuorumVerificationVector(receivedVvecs, 0, 0, false);
+            quorumVvec = blsWorker.BuildQuorumVerificationVector(receivedVvecs, 0, 0, parallel);
         });
     }
 
@@ -165,6 +165,25 @@ static void BLSDKG_InitDKG(benchmark::Bench& bench, uint32_t epoch_iters, int qu
     } \
     BENCHMARK(BLSDKG_VerifyContributionShares_##name##_##quorumSize)
 
+// Scaling of the parallel DKG work with the number of worker threads
+#define BENCH_BuildQuorumVerificationVectorsThreads(quorumSize, workerCount, epoch_iters) \
+    static void BLSDKG_BuildQuorumVerificationVectors_parallel_##quorumSize##_threads_##workerCount(benchmark::Bench& bench) \
+    { \
+        std::unique_ptr<DKG> ptr = std::make_unique<DKG>(quorumSize, workerCount); \
+        ptr->Bench_BuildQuorumVerificationVectors(bench, epoch_iters, true); \
+        ptr.reset(); \
+    } \
+    BENCHMARK(BLSDKG_BuildQuorumVerificationVectors_parallel_##quorumSize##_threads_##workerCount)
+
+#define BENCH_VerifyContributionSharesThreads(quorumSize, workerCount, epoch_iters) \
+    static void BLSDKG_VerifyContributionShares_aggregated_##quorumSize##_threads_##workerCount(benchmark::Bench& bench) \
+    { \
+      std::unique_ptr<DKG> ptr = std::make_unique<DKG>(quorumSize, workerCount); \
+      ptr->Bench_VerifyContributionShares(bench, 5, true, epoch_iters); \
+      ptr.reset(); \
+    } \
+    BENCHMARK(BLSDKG_VerifyContributionShares_aggregated_##quorumSize##_threads_##workerCount)
+
 BENCH_GenerateContributions(simple, 10, 50);
 BENCH_GenerateContributions(simple, 50, 5);
 
@@ -182,3 +201,15 @@ BENCH_VerifyContributionShares(simple, 400, 5, false, 1)
 BENCH_VerifyContributionShares(aggregated, 10, 5, true, 100)
 BENCH_VerifyContributionShares(aggregated, 100, 5, true, 10)
 BENCH_VerifyContributionShares(aggregated, 400, 5, true, 1)
+
+BENCH_BuildQuorumVerificationVectorsThreads(400, 1, 1)
+BENCH_BuildQuorumVerificationVectorsThreads(400, 2, 1)
+BENCH_BuildQuorumVerificationVectorsThreads(400, 4, 1)
+BENCH_BuildQuorumVerificationVectorsThreads(400, 8, 1)
+BENCH_BuildQuorumVerificationVectorsThreads(400, 16, 1)
+
+BENCH_VerifyContributionSharesThreads(100, 1, 10)
+BENCH_VerifyContributionSharesThreads(100, 2, 10)
+BENCH_VerifyContributionSharesThreads(100, 4, 10)
+BENCH_VerifyContributionSharesThreads(100, 8, 10)
+BENCH_VerifyContributionSharesThreads(100, 16, 10)
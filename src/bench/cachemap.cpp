@@ -0,0 +1,119 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <cachemap.h>
+#include <flatcachemap.h>
+#include <memusage.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <ostream>
+#include <vector>
+
+/* Governance keeps vote hashes mapped to object pointers */
+using OldCache = CacheMap<uint256, int64_t>;
+using FlatCache = FlatCacheMap<uint256, int64_t>;
+
+static const size_t CACHE_ITEMS = 10000;
+
+static std::vector<uint256> MakeKeys(size_t nCount)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> vKeys;
+    vKeys.reserve(nCount);
+    for (size_t i = 0; i < nCount; ++i) {
+        vKeys.push_back(rng.rand256());
+    }
+    return vKeys;
+}
+
+template<typename Cache>
+static void Fill(Cache& cache, const std::vector<uint256>& vKeys, size_t nBegin, size_t nEnd)
+{
+    for (size_t i = nBegin; i < nEnd; ++i) {
+        cache.Insert(vKeys[i], (int64_t)i);
+    }
+}
+
+static size_t OldCacheMemoryPerItem()
+{
+    // One list node holding the item, one map node holding the key and the list iterator
+    return memusage::MallocUsage(sizeof(OldCache::item_t) + 2 * sizeof(void*)) +
+           memusage::MallocUsage(sizeof(memusage::stl_tree_node<std::pair<const uint256, OldCache::list_it>>));
+}
+
+template<typename Cache>
+static void CacheInsert(benchmark::Bench& bench)
+{
+    const std::vector<uint256> vKeys = MakeKeys(CACHE_ITEMS);
+    bench.batch(CACHE_ITEMS).unit("item").run([&] {
+        Cache cache(CACHE_ITEMS);
+        Fill(cache, vKeys, 0, CACHE_ITEMS);
+        assert(cache.GetSize() == CACHE_ITEMS);
+    });
+}
+
+template<typename Cache>
+static void CacheLookup(benchmark::Bench& bench)
+{
+    // Half of the lookups hit
+    const std::vector<uint256> vKeys = MakeKeys(CACHE_ITEMS * 2);
+    Cache cache(CACHE_ITEMS);
+    for (size_t i = 0; i < CACHE_ITEMS * 2; i += 2) {
+        cache.Insert(vKeys[i], (int64_t)i);
+    }
+    bench.batch(CACHE_ITEMS * 2).unit("lookup").run([&] {
+        size_t nHits = 0;
+        for (const uint256& key : vKeys) {
+            nHits += cache.HasKey(key);
+        }
+        assert(nHits == CACHE_ITEMS);
+    });
+}
+
+template<typename Cache>
+static void CacheEvict(benchmark::Bench& bench)
+{
+    // Every insert into the full cache drops the oldest item
+    const std::vector<uint256> vKeys = MakeKeys(CACHE_ITEMS * 2);
+    Cache cache(CACHE_ITEMS);
+    Fill(cache, vKeys, 0, CACHE_ITEMS);
+    size_t nNext = CACHE_ITEMS;
+    bench.batch(CACHE_ITEMS).unit("item").run([&] {
+        Fill(cache, vKeys, nNext, nNext + CACHE_ITEMS);
+        nNext = nNext == CACHE_ITEMS ? 0 : CACHE_ITEMS;
+    });
+}
+
+static void CacheMap_Insert(benchmark::Bench& bench)
+{
+    if (bench.output()) {
+        *bench.output() << "CacheMap<uint256, int64_t>: " << OldCacheMemoryPerItem() << " bytes per item" << std::endl;
+    }
+    CacheInsert<OldCache>(bench);
+}
+
+static void FlatCacheMap_Insert(benchmark::Bench& bench)
+{
+    if (bench.output()) {
+        FlatCache cache(CACHE_ITEMS);
+        Fill(cache, MakeKeys(CACHE_ITEMS), 0, CACHE_ITEMS);
+        *bench.output() << "FlatCacheMap<uint256, int64_t>: " << cache.DynamicMemoryUsage() / cache.GetSize() << " bytes per item" << std::endl;
+    }
+    CacheInsert<FlatCache>(bench);
+}
+
+static void CacheMap_Lookup(benchmark::Bench& bench) { CacheLookup<OldCache>(bench); }
+static void FlatCacheMap_Lookup(benchmark::Bench& bench) { CacheLookup<FlatCache>(bench); }
+static void CacheMap_Evict(benchmark::Bench& bench) { CacheEvict<OldCache>(bench); }
+static void FlatCacheMap_Evict(benchmark::Bench& bench) { CacheEvict<FlatCache>(bench); }
+
+BENCHMARK(CacheMap_Insert);
+BENCHMARK(FlatCacheMap_Insert);
+BENCHMARK(CacheMap_Lookup);
+BENCHMARK(FlatCacheMap_Lookup);
+BENCHMARK(CacheMap_Evict);
+BENCHMARK(FlatCacheMap_Evict);
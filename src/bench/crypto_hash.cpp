@@ -6,6 +6,7 @@
 
 #include <bench/bench.h>
 #include <crypto/ripemd160.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha3.h>
@@ -179,6 +180,35 @@ static void FastRandom_1bit(benchmark::Bench& bench)
     });
 }
 
+/* Hash 8 legacy 80-byte headers per iteration with scrypt, limited to the given lane count */
+static void HASH_Scrypt_Nway(benchmark::Bench& bench, size_t lanes)
+{
+    ScryptAutoDetect();
+    std::vector<char> in(8 * 80, 0);
+    std::vector<char> out(8 * 32);
+    for (size_t i = 0; i < 8; i++) {
+        in[i * 80] = (char)i;
+    }
+    bench.batch(8).unit("hash").run([&] {
+        scrypt_1024_1_1_256_batch(in.data(), out.data(), 8, lanes);
+    });
+}
+
+static void HASH_Scrypt_1way(benchmark::Bench& bench)
+{
+    HASH_Scrypt_Nway(bench, 1);
+}
+
+static void HASH_Scrypt_4way(benchmark::Bench& bench)
+{
+    HASH_Scrypt_Nway(bench, 4);
+}
+
+static void HASH_Scrypt_8way(benchmark::Bench& bench)
+{
+    HASH_Scrypt_Nway(bench, 8);
+}
+
 BENCHMARK(HASH_1MB_DSHA256);
 BENCHMARK(HASH_1MB_RIPEMD160);
 BENCHMARK(HASH_1MB_SHA1);
@@ -198,5 +228,9 @@ BENCHMARK(HASH_SipHash_32b);
 
 BENCHMARK(HASH_SHA256D64_1024);
 
+BENCHMARK(HASH_Scrypt_1way);
+BENCHMARK(HASH_Scrypt_4way);
+BENCHMARK(HASH_Scrypt_8way);
+
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
@@ -0,0 +1,127 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <evo/deterministicmns.h>
+#include <evo/evodb.h>
+#include <random.h>
+
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Historical list queries (e.g. "protx diff", "quorum info") on a chain of two snapshot periods */
+static const int CHAIN_HEIGHT = 2 * 576;
+static const int MN_COUNT = 400;
+static const int QUERY_COUNT = 20;
+
+// same keys as in evo/deterministicmns.cpp
+static const std::string DB_LIST_SNAPSHOT = "dmn_S";
+static const std::string DB_LIST_DIFF = "dmn_D";
+
+namespace {
+struct MNListChain {
+    CEvoDB evoDb{1 << 20, true, true};
+    std::vector<uint256> vecHashes;
+    std::vector<std::unique_ptr<CBlockIndex>> vecBlocks;
+
+    static CDeterministicMNCPtr MakeDeterministicMN(FastRandomContext& rng, uint64_t internalId)
+    {
+        auto dmn = std::make_shared<CDeterministicMN>(internalId);
+        dmn->proTxHash = rng.rand256();
+        dmn->collateralOutpoint = COutPoint(rng.rand256(), 0);
+        auto state = std::make_shared<CDeterministicMNState>();
+        state->keyIDOwner = CKeyID(uint160(rng.randbytes(20)));
+        state->keyIDVoting = state->keyIDOwner;
+        state->scriptPayout = CScript() << OP_TRUE;
+        dmn->pdmnState = state;
+        return dmn;
+    }
+
+    MNListChain()
+    {
+        FastRandomContext rng(true);
+        vecHashes.reserve(CHAIN_HEIGHT);
+        uint64_t nextInternalId = 0;
+
+        auto dbTx = evoDb.BeginTransaction();
+        CDeterministicMNList mnList;
+        for (int nHeight = 0; nHeight < CHAIN_HEIGHT; nHeight++) {
+            vecHashes.emplace_back(rng.rand256());
+            vecBlocks.emplace_back(std::make_unique<CBlockIndex>());
+            CBlockIndex* pindex = vecBlocks.back().get();
+            pindex->phashBlock = &vecHashes.back();
+            pindex->nHeight = nHeight;
+            pindex->pprev = nHeight > 0 ? vecBlocks[nHeight - 1].get() : nullptr;
+
+            CDeterministicMNList newList = mnList;
+            newList.SetBlockHash(vecHashes.back());
+            newList.SetHeight(nHeight);
+            if (nHeight == 0) {
+                for (int i = 0; i < MN_COUNT; i++) {
+                    newList.AddMN(MakeDeterministicMN(rng, nextInternalId++));
+                }
+                evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), newList);
+            } else {
+                // a few PoSe penalty changes per block and a registration every now and then
+                std::vector<CDeterministicMNCPtr> vecMNs;
+                newList.ForEachMNShared(false, [&vecMNs](const CDeterministicMNCPtr& dmn) { vecMNs.emplace_back(dmn); });
+                for (int i = 0; i < 3; i++) {
+                    const auto& dmn = vecMNs[rng.randrange(vecMNs.size())];
+                    auto newState = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
+                    newState->nPoSePenalty++;
+                    newList.UpdateMN(*dmn, newState);
+                }
+                if (rng.randrange(10) == 0) {
+                    newList.AddMN(MakeDeterministicMN(rng, nextInternalId++));
+                }
+                evoDb.Write(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), mnList.BuildDiff(newList));
+                if (nHeight % 576 == 0) {
+                    evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), newList);
+                }
+            }
+            mnList = newList;
+        }
+        dbTx->Commit();
+        bool fOk = evoDb.CommitRootTransaction();
+        assert(fOk);
+    }
+
+    void Query(CDeterministicMNManager& mnman, FastRandomContext& rng) const
+    {
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            const CBlockIndex* pindex = vecBlocks[rng.randrange(CHAIN_HEIGHT)].get();
+            auto mnList = mnman.GetListForBlock(pindex);
+            assert(mnList.GetBlockHash() == pindex->GetBlockHash());
+        }
+    }
+};
+} // namespace
+
+// Nothing cached yet, every query reads and deserializes the diffs since the last snapshot
+static void DeterministicMNList_RandomHeightCold(benchmark::Bench& bench)
+{
+    MNListChain chain;
+    FastRandomContext rng(true);
+    bench.batch(QUERY_COUNT).unit("query").run([&] {
+        CDeterministicMNManager mnman(chain.evoDb);
+        chain.Query(mnman, rng);
+    });
+}
+
+// All diffs cached, queries replay from the nearest cached list
+static void DeterministicMNList_RandomHeightWarm(benchmark::Bench& bench)
+{
+    MNListChain chain;
+    CDeterministicMNManager mnman(chain.evoDb);
+    FastRandomContext rng(true);
+    bench.batch(QUERY_COUNT).unit("query").run([&] {
+        chain.Query(mnman, rng);
+    });
+}
+
+BENCHMARK(DeterministicMNList_RandomHeightCold);
+BENCHMARK(DeterministicMNList_RandomHeightWarm);
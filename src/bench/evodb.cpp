@@ -0,0 +1,77 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat/endian.h>
+#include <evo/evodb.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+/* What the evo layer writes while connecting blocks during a reindex */
+static const int BLOCK_COUNT = 576;              // one MN list snapshot period
+static const int QUORUM_INTERVAL = 24;           // a mined commitment every 24 blocks
+static const int ROOT_COMMIT_INTERVAL = 100;     // how often the chainstate flush writes the evodb batch
+static const size_t DIFF_SIZE = 300;             // a few MN state changes
+static const size_t SNAPSHOT_SIZE = 400 * 250;   // ~400 masternodes
+static const size_t COMMITMENT_SIZE = 420;
+
+static void ReplayBlocks(CEvoDB& evoDb, FastRandomContext& rng, std::vector<uint256>& vBlockHashes)
+{
+    for (int i = 0; i < BLOCK_COUNT; i++) {
+        const int nHeight = (int)vBlockHashes.size();
+        const uint256 blockHash = rng.rand256();
+
+        auto dbTx = evoDb.BeginTransaction();
+        {
+            LOCK(evoDb.cs);
+            // ProcessBlock reads the previous block's list before writing the new diff
+            if (nHeight > 0) {
+                std::vector<unsigned char> vPrevDiff;
+                bool fFound = evoDb.GetCurTransaction().Read(std::make_pair(std::string("dmn_D"), vBlockHashes.back()), vPrevDiff);
+                assert(fFound);
+            }
+            evoDb.GetCurTransaction().Write(std::make_pair(std::string("dmn_D"), blockHash), rng.randbytes(DIFF_SIZE));
+            if (nHeight % BLOCK_COUNT == 0) {
+                evoDb.GetCurTransaction().Write(std::make_pair(std::string("dmn_S"), blockHash), rng.randbytes(SNAPSHOT_SIZE));
+            }
+            if (nHeight % QUORUM_INTERVAL == 0) {
+                const auto llmqType = (uint8_t)(nHeight / QUORUM_INTERVAL % 2);
+                const uint256 quorumHash = rng.rand256();
+                evoDb.GetCurTransaction().Write(std::make_pair(std::string("q_mc"), std::make_pair(llmqType, quorumHash)), std::make_pair(rng.randbytes(COMMITMENT_SIZE), blockHash));
+                evoDb.GetCurTransaction().Write(std::make_tuple(std::string("q_mcih"), llmqType, htobe32(~(uint32_t)nHeight)), quorumHash);
+                // the previous commitment of the same type drops out of the index
+                if (nHeight >= 2 * QUORUM_INTERVAL) {
+                    evoDb.GetCurTransaction().Erase(std::make_tuple(std::string("q_mcih"), llmqType, htobe32(~(uint32_t)(nHeight - 2 * QUORUM_INTERVAL))));
+                }
+            }
+            evoDb.GetCurTransaction().Write(EVODB_BEST_BLOCK, blockHash);
+        }
+        dbTx->Commit();
+        vBlockHashes.emplace_back(blockHash);
+
+        if (nHeight % ROOT_COMMIT_INTERVAL == 0) {
+            bool fOk = evoDb.CommitRootTransaction();
+            assert(fOk);
+        }
+    }
+}
+
+static void EvoDB_ReplayBlocks(benchmark::Bench& bench)
+{
+    CEvoDB evoDb(1 << 20, true, true);
+    FastRandomContext rng(true);
+    std::vector<uint256> vBlockHashes;
+
+    bench.batch(BLOCK_COUNT).unit("block").run([&] {
+        ReplayBlocks(evoDb, rng, vBlockHashes);
+    });
+    bool fOk = evoDb.CommitRootTransaction();
+    assert(fOk);
+}
+
+BENCHMARK(EvoDB_ReplayBlocks);
@@ -0,0 +1,94 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bls/bls.h>
+#include <governance/governance.h>
+#include <governance/vote.h>
+#include <random.h>
+
+#include <cassert>
+#include <set>
+#include <vector>
+
+/* Trigger votes from many masternodes arriving from a few peers, like after mnsync */
+static const size_t VOTE_COUNT = 256;
+static const size_t PEER_COUNT = 8;
+
+namespace {
+struct VoteVectors {
+    std::vector<CGovernanceVote> votes;
+    std::vector<CBLSPublicKey> pubKeys;
+
+    explicit VoteVectors(size_t nInvalid)
+    {
+        const uint256 nParentHash = GetRandHash();
+        votes.reserve(VOTE_COUNT);
+        pubKeys.reserve(VOTE_COUNT);
+        for (size_t i = 0; i < VOTE_COUNT; ++i) {
+            CBLSSecretKey secKey;
+            secKey.MakeNewKey();
+            CGovernanceVote vote(COutPoint(GetRandHash(), 0), nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+            vote.SetTime(1000 + i);
+            if (i < nInvalid) {
+                CBLSSecretKey otherKey;
+                otherKey.MakeNewKey();
+                vote.Sign(otherKey);
+            } else {
+                vote.Sign(secKey);
+            }
+            votes.push_back(vote);
+            pubKeys.push_back(secKey.GetPublicKey());
+        }
+    }
+
+    std::vector<CGovernanceManager::vote_sig_check_t> GetChecks() const
+    {
+        std::vector<CGovernanceManager::vote_sig_check_t> vecChecks;
+        for (size_t i = 0; i < votes.size(); ++i) {
+            vecChecks.push_back({NodeId(i % PEER_COUNT), &votes[i], pubKeys[i]});
+        }
+        return vecChecks;
+    }
+};
+} // namespace
+
+// What the message handler did for every vote before
+static void GovernanceVote_VerifySingle(benchmark::Bench& bench)
+{
+    const VoteVectors vectors(0);
+    bench.batch(VOTE_COUNT).unit("vote").run([&] {
+        for (size_t i = 0; i < VOTE_COUNT; ++i) {
+            bool fValid = vectors.votes[i].CheckSignature(vectors.pubKeys[i]);
+            assert(fValid);
+        }
+    });
+}
+
+static void GovernanceVote_VerifyBatched(benchmark::Bench& bench)
+{
+    const VoteVectors vectors(0);
+    const auto vecChecks = vectors.GetChecks();
+    bench.batch(VOTE_COUNT).unit("vote").run([&] {
+        std::set<NodeId> setBadSources;
+        bool fAllValid = CGovernanceManager::VerifyVoteSignatures(vecChecks, setBadSources).empty();
+        assert(fAllValid);
+    });
+}
+
+// A single bad vote makes its batch fall back to per peer and then per vote verification
+static void GovernanceVote_VerifyBatchedOneBad(benchmark::Bench& bench)
+{
+    const VoteVectors vectors(1);
+    const auto vecChecks = vectors.GetChecks();
+    bench.batch(VOTE_COUNT).unit("vote").run([&] {
+        std::set<NodeId> setBadSources;
+        bool fOneBad = CGovernanceManager::VerifyVoteSignatures(vecChecks, setBadSources).size() == 1;
+        assert(fOneBad);
+    });
+}
+
+BENCHMARK(GovernanceVote_VerifySingle);
+BENCHMARK(GovernanceVote_VerifyBatched);
+BENCHMARK(GovernanceVote_VerifyBatchedOneBad);
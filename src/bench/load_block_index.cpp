@@ -0,0 +1,84 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <random.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <memory>
+#include <vector>
+
+/* Entries in the synthetic block tree, a mostly proof-of-stake chain with some forks */
+static const int BLOCK_TREE_SIZE = 100000;
+
+static std::unique_ptr<CBlockTreeDB> BuildBlockTreeDB()
+{
+    std::unique_ptr<CBlockTreeDB> blocktree = std::make_unique<CBlockTreeDB>(8 << 20, true, true);
+    FastRandomContext rng(true);
+
+    std::vector<uint256> hashes(BLOCK_TREE_SIZE);
+    std::vector<CBlockIndex> entries(BLOCK_TREE_SIZE);
+    std::vector<const CBlockIndex*> blockinfo;
+    blockinfo.reserve(BLOCK_TREE_SIZE);
+    for (int i = 0; i < BLOCK_TREE_SIZE; ++i) {
+        CBlockIndex& index = entries[i];
+        hashes[i] = rng.rand256();
+        index.phashBlock = &hashes[i];
+        // Every 50th block forks off a few blocks back
+        index.pprev = i == 0 ? nullptr : &entries[i % 50 == 0 && i > 10 ? i - 1 - rng.randrange(10) : i - 1];
+        index.nHeight = index.pprev ? index.pprev->nHeight + 1 : 0;
+        index.nStatus = BLOCK_VALID_SCRIPTS | BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO;
+        index.nTx = 1 + rng.randrange(10);
+        index.nFile = i / 1000;
+        index.nDataPos = rng.randrange(1 << 27);
+        index.nUndoPos = rng.randrange(1 << 27);
+        index.nVersion = 4;
+        index.hashMerkleRoot = rng.rand256();
+        index.nTime = 1600000000 + 60 * i;
+        index.nBits = 0x1d00ffff;
+        if (i > 1000) {
+            index.SetProofOfStake();
+            index.posStakeHash = rng.rand256();
+            index.posStakeN = rng.randrange(4);
+            index.pvchBlockSig = std::make_shared<const std::vector<unsigned char>>(rng.randbytes(72));
+        }
+        blockinfo.push_back(&index);
+    }
+    bool ret = blocktree->WriteBatchSync({}, 0, blockinfo);
+    assert(ret);
+    return blocktree;
+}
+
+static void LoadBlockIndexGuts(benchmark::Bench& bench, int nWorkers)
+{
+    std::unique_ptr<CBlockTreeDB> blocktree = BuildBlockTreeDB();
+    const Consensus::Params& consensus = Params().GetConsensus();
+    BlockManager blockman;
+
+    bench.batch(BLOCK_TREE_SIZE).unit("entry").run([&] {
+        LOCK(cs_main);
+        bool ret = blocktree->LoadBlockIndexGuts(consensus, [&](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+            return blockman.InsertBlockIndex(hash);
+        }, nWorkers);
+        assert(ret);
+        assert(blockman.m_block_index.size() == (size_t)BLOCK_TREE_SIZE);
+        blockman.Unload();
+    });
+}
+
+static void LoadBlockIndexGuts_OneWorker(benchmark::Bench& bench)
+{
+    LoadBlockIndexGuts(bench, 1);
+}
+
+static void LoadBlockIndexGuts_Parallel(benchmark::Bench& bench)
+{
+    LoadBlockIndexGuts(bench, 0);
+}
+
+BENCHMARK(LoadBlockIndexGuts_OneWorker);
+BENCHMARK(LoadBlockIndexGuts_Parallel);
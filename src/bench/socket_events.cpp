@@ -0,0 +1,155 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat.h>
+#include <net.h>
+#include <test/util/net.h>
+
+#if defined(USE_EPOLL) && defined(USE_POLL)
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <set>
+#include <vector>
+
+/* Peers with nothing to say, and the few ones sending data every wakeup */
+static const size_t IDLE_PEERS = 1000;
+static const size_t HOT_PEERS = 8;
+
+namespace {
+/** CConnman with socketpair backed nodes, the remote ends are kept here */
+class FakePeers
+{
+public:
+    CConnmanTest connman{0x1337, 0x1337};
+    std::vector<CNode*> nodes;
+    std::vector<int> remotes;
+
+    explicit FakePeers(CConnman::SocketEventsMode mode)
+    {
+        connman.SetSocketEventsMode(mode);
+        const CAddress addr(CService(CNetAddr(), 9999), NODE_NONE);
+        for (size_t i = 0; i < IDLE_PEERS + HOT_PEERS; ++i) {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) != 0) {
+                break;
+            }
+            // Owned and deleted by connman
+            CNode* pnode = new CNode(i, NODE_NETWORK, 0, fds[0], addr, i, i, CAddress(), "", true);
+            // Send buffers are empty, SocketHandler() only selects for writability after a full one
+            pnode->fCanSendData = true;
+            connman.AddSocketNode(*pnode);
+            nodes.push_back(pnode);
+            remotes.push_back(fds[1]);
+        }
+    }
+
+    ~FakePeers()
+    {
+        connman.ClearNodes();
+        for (int hRemote : remotes) {
+            close(hRemote);
+        }
+    }
+
+    /** The hot peers are the last ones, like the most recent connections */
+    void SendFromHotPeers()
+    {
+        const char byte = 0;
+        for (size_t i = remotes.size() - std::min(HOT_PEERS, remotes.size()); i < remotes.size(); ++i) {
+            const ssize_t written = write(remotes[i], &byte, 1);
+            assert(written == 1);
+            (void)written;
+        }
+    }
+
+    /** What SocketHandler() does with the result, reduced to draining the ready sockets */
+    static void Drain(const CConnmanTest::SocketEventsResult& result)
+    {
+        for (const auto& node_events : result.vNodeEvents) {
+            if (!node_events.fRecv) continue;
+            char buf[256];
+            while (read(node_events.pnode->hSocket, buf, sizeof(buf)) > 0);
+        }
+    }
+};
+} // namespace
+
+// -socketevents=poll: socket sets built from vNodes on every wakeup, polled, then mapped back to nodes
+static void SocketEvents_Poll(benchmark::Bench& bench)
+{
+    FakePeers peers(CConnman::SOCKETEVENTS_POLL);
+
+    bench.batch(HOT_PEERS).unit("ready peer").run([&] {
+        peers.SendFromHotPeers();
+        CConnmanTest::SocketEventsResult result;
+        peers.connman.SocketEvents(result, /* fOnlyPoll */ true);
+        FakePeers::Drain(result);
+    });
+}
+
+// -socketevents=epoll before the ready list: epoll_wait() filled socket sets that were mapped back to nodes
+static void SocketEvents_EpollSets(benchmark::Bench& bench)
+{
+    FakePeers peers(CConnman::SOCKETEVENTS_SELECT);
+    const int epollfd = epoll_create1(0);
+    assert(epollfd != -1);
+    for (CNode* pnode : peers.nodes) {
+        epoll_event e;
+        e.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLERR | EPOLLHUP;
+        e.data.fd = pnode->hSocket;
+        epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &e);
+    }
+    // Consume the initial writability edge of every socket
+    epoll_event events[64];
+    while (epoll_wait(epollfd, events, 64, 0) > 0);
+
+    bench.batch(HOT_PEERS).unit("ready peer").run([&] {
+        peers.SendFromHotPeers();
+        std::set<SOCKET> recv_set, send_set, error_set;
+        int n = epoll_wait(epollfd, events, 64, 0);
+        for (int i = 0; i < n; ++i) {
+            if ((events[i].events & EPOLLERR) || (events[i].events & EPOLLHUP)) {
+                error_set.insert((SOCKET)events[i].data.fd);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) recv_set.insert((SOCKET)events[i].data.fd);
+            if (events[i].events & EPOLLOUT) send_set.insert((SOCKET)events[i].data.fd);
+        }
+        CConnmanTest::SocketEventsResult result;
+        peers.connman.MapSocketEvents(recv_set, send_set, error_set, result);
+        FakePeers::Drain(result);
+    });
+
+    close(epollfd);
+}
+
+// -socketevents=epoll: nodes registered with their CNode, the ready list comes straight from epoll_wait()
+static void SocketEvents_EpollReadyList(benchmark::Bench& bench)
+{
+    FakePeers peers(CConnman::SOCKETEVENTS_EPOLL);
+    // Consume the initial writability edge of every socket
+    CConnmanTest::SocketEventsResult initial;
+    do {
+        initial = CConnmanTest::SocketEventsResult();
+        peers.connman.SocketEvents(initial, /* fOnlyPoll */ true);
+    } while (!initial.vNodeEvents.empty());
+
+    bench.batch(HOT_PEERS).unit("ready peer").run([&] {
+        peers.SendFromHotPeers();
+        CConnmanTest::SocketEventsResult result;
+        peers.connman.SocketEvents(result, /* fOnlyPoll */ true);
+        FakePeers::Drain(result);
+    });
+}
+
+BENCHMARK(SocketEvents_Poll);
+BENCHMARK(SocketEvents_EpollSets);
+BENCHMARK(SocketEvents_EpollReadyList);
+
+#endif // USE_EPOLL && USE_POLL
@@ -0,0 +1,41 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <crypto/sha256.h>
+#include <pos_kernel.h>
+#include <random.h>
+#include <uint256.h>
+
+/* Number of consecutive timestamps a staker scans per stake input */
+static const size_t KERNEL_TIMESTAMPS = 1024;
+
+static void StakeKernel_Sequential(benchmark::Bench& bench)
+{
+    SHA256AutoDetect();
+    const uint256 prevout_hash = GetRandHash();
+    const uint32_t modifier = 0x12345678;
+    uint256 hash;
+    bench.batch(KERNEL_TIMESTAMPS).unit("kernel").run([&] {
+        for (unsigned int t = 0; t < KERNEL_TIMESTAMPS; ++t) {
+            CDataStream ss(SER_GETHASH, 0);
+            ss << modifier;
+            hash = stakeHash(1600000000 + t, ss, 1, prevout_hash, 1500000000);
+        }
+    });
+}
+
+static void StakeKernel_Batch(benchmark::Bench& bench)
+{
+    SHA256AutoDetect();
+    const uint256 prevout_hash = GetRandHash();
+    std::vector<uint32_t> modifiers(KERNEL_TIMESTAMPS, 0x12345678);
+    std::vector<uint256> hashes(KERNEL_TIMESTAMPS);
+    bench.batch(KERNEL_TIMESTAMPS).unit("kernel").run([&] {
+        stakeHashBatch(1600000000, KERNEL_TIMESTAMPS, modifiers.data(), 1, prevout_hash, 1500000000, hashes.data());
+    });
+}
+
+BENCHMARK(StakeKernel_Sequential);
+BENCHMARK(StakeKernel_Batch);
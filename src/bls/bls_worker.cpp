@@ -60,18 +60,18 @@ CBLSWorker::~CBLSWorker()
     Stop();
 }
 
-void CBLSWorker::Start()
+void CBLSWorker::Start(int workerCount)
 {
-    int workerCount = std::thread::hardware_concurrency() / 2;
-    workerCount = std::max(std::min(1, workerCount), 4);
-    workerPool.resize(workerCount);
-    RenameThreadPool(workerPool, "bls-work");
+    if (workerCount <= 0) {
+        workerCount = std::thread::hardware_concurrency() / 2;
+        workerCount = std::max(std::min(1, workerCount), 4);
+    }
+    workerPool.Start(workerCount, "bls-work");
 }
 
 void CBLSWorker::Stop()
 {
-    workerPool.clear_queue();
-    workerPool.stop(true);
+    workerPool.Stop();
 }
 
 bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skSharesRet)
@@ -96,7 +96,7 @@ bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& i
             }
             return true;
         };
-        futures.emplace_back(workerPool.push(f));
+        futures.emplace_back(workerPool.push(WorkStealingPool::Priority::LOW, f));
     }
 
     for (size_t i = 0; i < ids.size(); i += batchSize) {
@@ -110,7 +110,7 @@ bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& i
             }
             return true;
         };
-        futures.emplace_back(workerPool.push(f));
+        futures.emplace_back(workerPool.push(WorkStealingPool::Priority::LOW, f));
     }
     return ranges::all_of(futures, [](auto& f){
         return f.get();
@@ -131,12 +131,14 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
     std::shared_ptr<std::vector<const T*> > inputVec;
 
     bool parallel;
-    ctpl::thread_pool& workerPool;
+    WorkStealingPool& workerPool;
+    WorkStealingPool::Priority prio;
 
     std::mutex m;
     // items in the queue are all intermediate aggregation results of finished batches.
     // The intermediate results must be deleted by us again (which we do in SyncAggregateAndPushAggQueue)
-    ctpl::detail::Queue<T*> aggQueue;
+    // Protected by m
+    std::vector<T*> aggQueue;
     std::atomic<size_t> aggQueueSize{0};
 
     // keeps track of currently queued/in-progress batches. If it reaches 0, we are done
@@ -150,11 +152,13 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
     Aggregator(const std::vector<TP>& _inputVec,
                size_t start, size_t count,
                bool _parallel,
-               ctpl::thread_pool& _workerPool,
+               WorkStealingPool& _workerPool,
+               WorkStealingPool::Priority _prio,
                DoneCallback _doneCallback) :
             inputVec(std::make_shared<std::vector<const T*>>(count)),
             parallel(_parallel),
             workerPool(_workerPool),
+            prio(_prio),
             doneCallback(std::move(_doneCallback))
     {
         for (size_t i = 0; i < count; i++) {
@@ -222,13 +226,12 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
         // work. This is the case when these did not add up to a new batch. In this case, we have to aggregate
         // the items into the final result
 
-        std::vector<T*> rem(aggQueueSize);
-        for (size_t i = 0; i < rem.size(); i++) {
-            T* p = nullptr;
-            bool s = aggQueue.pop(p);
-            assert(s);
-            rem[i] = p;
+        std::vector<T*> rem;
+        {
+            std::unique_lock<std::mutex> l(m);
+            rem.swap(aggQueue);
         }
+        assert(rem.size() == aggQueueSize);
 
         T r;
         if (rem.size() == 1) {
@@ -271,7 +274,8 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
     {
         auto copyT = new T(v);
         try {
-            aggQueue.push(copyT);
+            std::unique_lock<std::mutex> l(m);
+            aggQueue.emplace_back(copyT);
         } catch (...) {
             delete copyT;
             throw;
@@ -289,10 +293,9 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
                 newBatch = std::make_shared<std::vector<const T*> >(batchSize);
                 // collect items for new batch
                 for (size_t i = 0; i < batchSize; i++) {
-                    T* p = nullptr;
-                    bool s = aggQueue.pop(p);
-                    assert(s);
-                    (*newBatch)[i] = p;
+                    assert(!aggQueue.empty());
+                    (*newBatch)[i] = aggQueue.back();
+                    aggQueue.pop_back();
                 }
                 aggQueueSize -= batchSize;
             }
@@ -316,7 +319,7 @@ struct Aggregator : public std::enable_shared_from_this<Aggregator<T>> {
     template <typename Callable>
     void PushWork(Callable&& f)
     {
-        workerPool.push(f);
+        workerPool.push(prio, f);
     }
 };
 
@@ -344,7 +347,8 @@ struct VectorAggregator : public std::enable_shared_from_this<VectorAggregator<T
     size_t start;
     size_t count;
     bool parallel;
-    ctpl::thread_pool& workerPool;
+    WorkStealingPool& workerPool;
+    WorkStealingPool::Priority prio;
 
     std::atomic<size_t> doneCount{0};
 
@@ -353,14 +357,15 @@ struct VectorAggregator : public std::enable_shared_from_this<VectorAggregator<T
 
     VectorAggregator(const VectorVectorType& _vecs,
                      size_t _start, size_t _count,
-                     bool _parallel, ctpl::thread_pool& _workerPool,
+                     bool _parallel, WorkStealingPool& _workerPool, WorkStealingPool::Priority _prio,
                      DoneCallback _doneCallback) :
             doneCallback(std::move(_doneCallback)),
             vecs(_vecs),
             start(_start),
             count(_count),
             parallel(_parallel),
-            workerPool(_workerPool)
+            workerPool(_workerPool),
+            prio(_prio)
     {
         assert(!vecs.empty());
         vecSize = vecs[0]->size();
@@ -376,7 +381,7 @@ struct VectorAggregator : public std::enable_shared_from_this<VectorAggregator<T
             }
 
             auto self(this->shared_from_this());
-            auto aggregator = std::make_shared<AggregatorType>(std::move(tmp), 0, count, parallel, workerPool, [self, i](const T& agg) {self->CheckDone(agg, i);});
+            auto aggregator = std::make_shared<AggregatorType>(std::move(tmp), 0, count, parallel, workerPool, prio, [self, i](const T& agg) {self->CheckDone(agg, i);});
             aggregator->Start();
         }
     }
@@ -418,7 +423,8 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
     bool parallel;
     bool aggregated;
 
-    ctpl::thread_pool& workerPool;
+    WorkStealingPool& workerPool;
+    WorkStealingPool::Priority prio;
 
     size_t batchCount{1};
     size_t verifyCount;
@@ -429,7 +435,7 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
 
     ContributionVerifier(CBLSId _forId, const std::vector<BLSVerificationVectorPtr>& _vvecs,
                          const BLSSecretKeyVector& _skShares, size_t _batchSize,
-                         bool _parallel, bool _aggregated, ctpl::thread_pool& _workerPool,
+                         bool _parallel, bool _aggregated, WorkStealingPool& _workerPool, WorkStealingPool::Priority _prio,
                          std::function<void(const std::vector<bool>&)> _doneCallback) :
         forId(std::move(_forId)),
         vvecs(_vvecs),
@@ -438,6 +444,7 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
         parallel(_parallel),
         aggregated(_aggregated),
         workerPool(_workerPool),
+        prio(_prio),
         verifyCount(_vvecs.size()),
         doneCallback(std::move(_doneCallback))
     {
@@ -492,8 +499,8 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
 
         // aggregate vvecs and skShares of batch in parallel
         auto self(this->shared_from_this());
-        auto vvecAgg = std::make_shared<VectorAggregator<CBLSPublicKey>>(vvecs, batchState.start, batchState.count, parallel, workerPool, [this, self, batchIdx] (const BLSVerificationVectorPtr& vvec) {HandleAggVvecDone(batchIdx, vvec);});
-        auto skShareAgg = std::make_shared<Aggregator<CBLSSecretKey>>(skShares, batchState.start, batchState.count, parallel, workerPool, [this, self, batchIdx] (const CBLSSecretKey& skShare) {HandleAggSkShareDone(batchIdx, skShare);});
+        auto vvecAgg = std::make_shared<VectorAggregator<CBLSPublicKey>>(vvecs, batchState.start, batchState.count, parallel, workerPool, prio, [this, self, batchIdx] (const BLSVerificationVectorPtr& vvec) {HandleAggVvecDone(batchIdx, vvec);});
+        auto skShareAgg = std::make_shared<Aggregator<CBLSSecretKey>>(skShares, batchState.start, batchState.count, parallel, workerPool, prio, [this, self, batchIdx] (const CBLSSecretKey& skShare) {HandleAggSkShareDone(batchIdx, skShare);});
 
         vvecAgg->Start();
         skShareAgg->Start();
@@ -587,7 +594,7 @@ struct ContributionVerifier : public std::enable_shared_from_this<ContributionVe
     void PushOrDoWork(Callable&& f)
     {
         if (parallel) {
-            workerPool.push(std::forward<Callable>(f));
+            workerPool.push(prio, std::forward<Callable>(f));
         } else {
             f(0);
         }
@@ -610,7 +617,7 @@ void CBLSWorker::AsyncBuildQuorumVerificationVector(const std::vector<BLSVerific
         return;
     }
 
-    auto agg = std::make_shared<VectorAggregator<CBLSPublicKey>>(vvecs, start, count, parallel, workerPool, std::move(doneCallback));
+    auto agg = std::make_shared<VectorAggregator<CBLSPublicKey>>(vvecs, start, count, parallel, workerPool, WorkStealingPool::Priority::LOW, std::move(doneCallback));
     agg->Start();
 }
 
@@ -629,7 +636,7 @@ BLSVerificationVectorPtr CBLSWorker::BuildQuorumVerificationVector(const std::ve
 }
 
 template <typename T>
-void AsyncAggregateHelper(ctpl::thread_pool& workerPool,
+void AsyncAggregateHelper(WorkStealingPool& workerPool, WorkStealingPool::Priority prio,
                           const std::vector<T>& vec, size_t start, size_t count, bool parallel,
                           std::function<void(const T&)> doneCallback)
 {
@@ -645,7 +652,7 @@ void AsyncAggregateHelper(ctpl::thread_pool& workerPool,
         return;
     }
 
-    auto agg = std::make_shared<Aggregator<T>>(vec, start, count, parallel, workerPool, std::move(doneCallback));
+    auto agg = std::make_shared<Aggregator<T>>(vec, start, count, parallel, workerPool, prio, std::move(doneCallback));
     agg->Start();
 }
 
@@ -653,7 +660,7 @@ void CBLSWorker::AsyncAggregateSecretKeys(const BLSSecretKeyVector& secKeys,
                                           size_t start, size_t count, bool parallel,
                                           std::function<void(const CBLSSecretKey&)> doneCallback)
 {
-    AsyncAggregateHelper(workerPool, secKeys, start, count, parallel, std::move(doneCallback));
+    AsyncAggregateHelper(workerPool, WorkStealingPool::Priority::LOW, secKeys, start, count, parallel, std::move(doneCallback));
 }
 
 std::future<CBLSSecretKey> CBLSWorker::AsyncAggregateSecretKeys(const BLSSecretKeyVector& secKeys,
@@ -674,7 +681,7 @@ void CBLSWorker::AsyncAggregatePublicKeys(const BLSPublicKeyVector& pubKeys,
                                           size_t start, size_t count, bool parallel,
                                           std::function<void(const CBLSPublicKey&)> doneCallback)
 {
-    AsyncAggregateHelper(workerPool, pubKeys, start, count, parallel, std::move(doneCallback));
+    AsyncAggregateHelper(workerPool, WorkStealingPool::Priority::LOW, pubKeys, start, count, parallel, std::move(doneCallback));
 }
 
 std::future<CBLSPublicKey> CBLSWorker::AsyncAggregatePublicKeys(const BLSPublicKeyVector& pubKeys,
@@ -689,7 +696,7 @@ void CBLSWorker::AsyncAggregateSigs(const BLSSignatureVector& sigs,
                                     size_t start, size_t count, bool parallel,
                                     std::function<void(const CBLSSignature&)> doneCallback)
 {
-    AsyncAggregateHelper(workerPool, sigs, start, count, parallel, std::move(doneCallback));
+    AsyncAggregateHelper(workerPool, WorkStealingPool::Priority::HIGH, sigs, start, count, parallel, std::move(doneCallback));
 }
 
 std::future<CBLSSignature> CBLSWorker::AsyncAggregateSigs(const BLSSignatureVector& sigs,
@@ -717,7 +724,7 @@ void CBLSWorker::AsyncVerifyContributionShares(const CBLSId& forId, const std::v
         return;
     }
 
-    auto verifier = std::make_shared<ContributionVerifier>(forId, vvecs, skShares, 8, parallel, aggregated, workerPool, std::move(doneCallback));
+    auto verifier = std::make_shared<ContributionVerifier>(forId, vvecs, skShares, 8, parallel, aggregated, workerPool, WorkStealingPool::Priority::LOW, std::move(doneCallback));
     verifier->Start();
 }
 
@@ -754,7 +761,7 @@ std::future<bool> CBLSWorker::AsyncVerifyContributionShare(const CBLSId& forId,
         CBLSPublicKey pk2 = skContribution.GetPublicKey();
         return pk1 == pk2;
     };
-    return workerPool.push(f);
+    return workerPool.push(WorkStealingPool::Priority::LOW, f);
 }
 
 bool CBLSWorker::VerifyVerificationVector(const BLSVerificationVector& vvec, size_t start, size_t count)
@@ -794,7 +801,7 @@ bool CBLSWorker::VerifyVerificationVectors(const std::vector<BLSVerificationVect
 
 void CBLSWorker::AsyncSign(const CBLSSecretKey& secKey, const uint256& msgHash, const CBLSWorker::SignDoneCallback& doneCallback)
 {
-    workerPool.push([secKey, msgHash, doneCallback](int threadId) {
+    workerPool.push(WorkStealingPool::Priority::HIGH, [secKey, msgHash, doneCallback](int threadId) {
         doneCallback(secKey.Sign(msgHash));
     });
 }
@@ -907,5 +914,5 @@ void CBLSWorker::PushSigVerifyBatch()
     sigVerifyQueue.reserve(SIG_VERIFY_BATCH_SIZE);
 
     sigVerifyBatchesInProgress++;
-    workerPool.push(f, batch);
+    workerPool.push(WorkStealingPool::Priority::HIGH, f, batch);
 }
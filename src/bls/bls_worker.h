@@ -6,8 +6,7 @@
 #define DASH_CRYPTO_BLS_WORKER_H
 
 #include <bls/bls.h>
-
-#include <ctpl_stl.h>
+#include <util/workstealingpool.h>
 
 #include <future>
 #include <mutex>
@@ -25,7 +24,9 @@ public:
     using CancelCond = std::function<bool()>;
 
 private:
-    ctpl::thread_pool workerPool;
+    // Signing and signature verification run at HIGH priority as they are latency sensitive, DKG work (contributions,
+    // verification vectors, aggregation) runs at LOW priority so large quorums can't delay them
+    WorkStealingPool workerPool;
 
     static const int SIG_VERIFY_BATCH_SIZE = 8;
     struct SigVerifyJob {
@@ -52,7 +53,8 @@ public:
     CBLSWorker();
     ~CBLSWorker();
 
-    void Start();
+    // workerCount = 0 picks the default number of threads
+    void Start(int workerCount = 0);
     void Stop();
 
     bool GenerateContributions(int threshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skSharesRet);
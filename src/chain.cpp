@@ -5,6 +5,133 @@
 
 #include <chain.h>
 
+#include <saltedhasher.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <unordered_lru_cache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+
+static std::atomic<BlockSigLoader> g_block_sig_loader{nullptr};
+
+//! Signatures of recently used proof-of-stake blocks whose CBlockIndex does not hold them anymore,
+//! mostly the tip area served to peers (header announcements, getheaders of synced peers)
+static const size_t BLOCK_SIG_CACHE_SIZE = 10000;
+static Mutex g_block_sig_cache_mutex;
+static unordered_lru_cache<uint256, std::shared_ptr<const std::vector<unsigned char>>, StaticSaltedHasher>
+    g_block_sig_cache GUARDED_BY(g_block_sig_cache_mutex){BLOCK_SIG_CACHE_SIZE};
+
+void SetBlockSigLoader(BlockSigLoader loader)
+{
+    g_block_sig_loader = loader;
+}
+
+bool HaveBlockSigLoader()
+{
+    return g_block_sig_loader != nullptr;
+}
+
+bool LoadBlockSig(const uint256& hash, std::vector<unsigned char>& vchBlockSig)
+{
+    std::shared_ptr<const std::vector<unsigned char>> pvchBlockSig;
+    if (WITH_LOCK(g_block_sig_cache_mutex, return g_block_sig_cache.get(hash, pvchBlockSig))) {
+        vchBlockSig = *pvchBlockSig;
+        return true;
+    }
+    vchBlockSig.clear();
+    BlockSigLoader loader = g_block_sig_loader;
+    if (!loader || !loader(hash, vchBlockSig) || vchBlockSig.empty()) {
+        vchBlockSig.clear();
+        return false;
+    }
+    pvchBlockSig = std::make_shared<const std::vector<unsigned char>>(vchBlockSig);
+    WITH_LOCK(g_block_sig_cache_mutex, g_block_sig_cache.insert(hash, pvchBlockSig));
+    return true;
+}
+
+std::vector<unsigned char> CBlockIndex::GetBlockSig() const
+{
+    if (pvchBlockSig) {
+        return *pvchBlockSig;
+    }
+    if (!IsProofOfStake() || !phashBlock) {
+        return {};
+    }
+    std::vector<unsigned char> vchBlockSig;
+    if (!LoadBlockSig(*phashBlock, vchBlockSig)) {
+        throw std::runtime_error(strprintf("%s: failed to read the signature of block %s", __func__, phashBlock->ToString()));
+    }
+    return vchBlockSig;
+}
+
+bool CBlockIndex::GetCachedBlockSig(std::vector<unsigned char>& vchBlockSig) const
+{
+    vchBlockSig.clear();
+    if (pvchBlockSig) {
+        vchBlockSig = *pvchBlockSig;
+        return true;
+    }
+    if (!IsProofOfStake() || !phashBlock) {
+        return true;
+    }
+    std::shared_ptr<const std::vector<unsigned char>> pvchCached;
+    if (!WITH_LOCK(g_block_sig_cache_mutex, return g_block_sig_cache.get(*phashBlock, pvchCached))) {
+        return false;
+    }
+    vchBlockSig = *pvchCached;
+    return true;
+}
+
+void CBlockIndex::ReleaseBlockSig()
+{
+    if (!HaveBlockSigLoader()) {
+        return;
+    }
+    if (pvchBlockSig && phashBlock) {
+        // recent blocks are the ones peers ask for, keep their signature at hand
+        WITH_LOCK(g_block_sig_cache_mutex, g_block_sig_cache.insert(*phashBlock, pvchBlockSig));
+    }
+    pvchBlockSig.reset();
+}
+
+CBlockIndexArena::Chunk& CBlockIndexArena::Reserve()
+{
+    if (!vChunks.empty() && vChunks.back().nUsed < vChunks.back().nCapacity) {
+        return vChunks.back();
+    }
+    Chunk chunk;
+    chunk.nCapacity = vChunks.empty() ? MIN_CHUNK_ENTRIES : std::min(vChunks.back().nCapacity * 2, MAX_CHUNK_ENTRIES);
+    chunk.data.reset(new Slot[chunk.nCapacity]);
+    const std::pair<uintptr_t, size_t> range((uintptr_t)chunk.data.get(), chunk.nCapacity * sizeof(Slot));
+    vRanges.insert(std::upper_bound(vRanges.begin(), vRanges.end(), range), range);
+    vChunks.push_back(std::move(chunk));
+    return vChunks.back();
+}
+
+bool CBlockIndexArena::Owns(const CBlockIndex* pindex) const
+{
+    const uintptr_t p = (uintptr_t)pindex;
+    auto it = std::upper_bound(vRanges.begin(), vRanges.end(), std::make_pair(p, std::numeric_limits<size_t>::max()));
+    if (it == vRanges.begin()) return false;
+    --it;
+    return p < it->first + it->second;
+}
+
+void CBlockIndexArena::Clear()
+{
+    for (Chunk& chunk : vChunks) {
+        for (size_t i = 0; i < chunk.nUsed; ++i) {
+            reinterpret_cast<CBlockIndex*>(&chunk.data[i])->~CBlockIndex();
+        }
+    }
+    vChunks.clear();
+    vRanges.clear();
+    nSize = 0;
+}
+
 /**
  * CChain implementation
  */
@@ -151,6 +278,12 @@ int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& fr
     return sign * r.GetLow64();
 }
 
+CBlockLocator GetLocator(const CBlockIndex* pindex)
+{
+    // An empty chain contains no block, so it walks the skiplist only
+    return CChain().GetLocator(pindex);
+}
+
 /** Find the last common ancestor two blocks have.
  *  Both pa and pb must be non-nullptr. */
 const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex* pb) {
@@ -13,6 +13,8 @@
 #include <tinyformat.h>
 #include <uint256.h>
 
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 /**
@@ -127,6 +129,15 @@ enum BlockStatus: uint32_t {
     BLOCK_CONFLICT_CHAINLOCK =   128, //!< conflicts with chainlock system
 };
 
+/** Reads the signature of a proof-of-stake block index entry from the block tree DB. */
+typedef bool (*BlockSigLoader)(const uint256& hash, std::vector<unsigned char>& vchBlockSig);
+void SetBlockSigLoader(BlockSigLoader loader);
+bool HaveBlockSigLoader();
+/** Signature of the proof-of-stake block with the given hash from the signature cache of recently
+ *  used blocks, else read through the loader and added to the cache. Does not need cs_main.
+ *  Returns false if it can't be read, a header must never be stored or served without it. */
+bool LoadBlockSig(const uint256& hash, std::vector<unsigned char>& vchBlockSig);
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -184,8 +195,12 @@ public:
     uint32_t nTime;
     uint32_t nBits;
     uint32_t nNonce;
+    // proof-of-stake input index, next to the header fields to avoid padding
+    uint32_t posStakeN;
 
-    std::vector<unsigned char> vchBlockSig;
+    //! Proof-of-stake block signature. Only kept in memory until the entry is written
+    //! to the block tree DB, GetBlockSig() reads it back from there on demand.
+    std::shared_ptr<const std::vector<unsigned char>> pvchBlockSig;
     // PirateCash: money supply related block index fields
     unsigned int nFlags{0};  // PirateCash: block index flags
     enum
@@ -196,7 +211,6 @@ public:
     };
     // proof-of-stake specific fields
     uint256 posStakeHash;
-    uint32_t posStakeN;
     bool IsProofOfWork() const
     {
         return !((nFlags & BLOCK_PROOF_OF_STAKE)||(nVersion & CBlockHeader::POS_BIT));
@@ -261,7 +275,7 @@ public:
         nNonce         = 0;
         posStakeHash   = uint256();
         posStakeN      = 0;
-        vchBlockSig.clear();
+        pvchBlockSig.reset();
     }
 
     CBlockIndex()
@@ -280,7 +294,9 @@ public:
         nNonce         = block.nNonce;
         posStakeHash   = block.posStakeHash;
         posStakeN      = block.posStakeN;
-        vchBlockSig    = block.vchBlockSig;
+        if (!block.vchBlockSig.empty()) {
+            pvchBlockSig = std::make_shared<const std::vector<unsigned char>>(block.vchBlockSig);
+        }
         nFlags         = block.nFlags;
     }
 
@@ -302,7 +318,9 @@ public:
         return ret;
     }
 
-    CBlockHeader GetBlockHeader() const
+    //! With fLoadSig=false the signature is only filled in if it is in memory or cached,
+    //! it can then be read outside cs_main with LoadBlockSig(). Else see GetBlockSig()
+    CBlockHeader GetBlockHeader(bool fLoadSig = true) const
     {
         CBlockHeader block;
         block.nVersion       = nVersion;
@@ -314,11 +332,25 @@ public:
         block.nNonce         = nNonce;
         block.posStakeHash   = posStakeHash;
         block.posStakeN      = posStakeN;
-        block.vchBlockSig    = vchBlockSig;
+        if (fLoadSig) {
+            block.vchBlockSig = GetBlockSig();
+        } else {
+            GetCachedBlockSig(block.vchBlockSig);
+        }
         block.nFlags         = nFlags;
         return block;
     }
 
+    //! Signature of a proof-of-stake block, read from the block tree DB if not in memory or cached.
+    //! Throws std::runtime_error if it can't be read.
+    std::vector<unsigned char> GetBlockSig() const;
+
+    //! Signature of a proof-of-stake block if it is in memory or cached, false if it would need a DB read
+    bool GetCachedBlockSig(std::vector<unsigned char>& vchBlockSig) const;
+
+    //! Drop the in-memory signature once it is stored in the block tree DB, it moves to the signature cache
+    void ReleaseBlockSig();
+
     uint256 GetBlockHash() const
     {
         //if (IsProofOfStake() || IsProofOfStakeV2()) {
@@ -421,6 +453,63 @@ arith_uint256 GetBlockProof(const CBlockIndex& block);
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params&);
 /** Find the forking point between two chain tips. */
 const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex* pb);
+/** Return a locator for pindex built from its ancestry alone, for callers without a CChain. */
+CBlockLocator GetLocator(const CBlockIndex* pindex);
+
+
+/**
+ * Bump allocator for CBlockIndex entries. Block index entries are never freed
+ * one by one, only all together when the index is unloaded, so they are carved
+ * out of large chunks instead of being heap allocated individually. This saves
+ * the per-allocation overhead and keeps entries that were loaded together next
+ * to each other in memory. Not thread safe, callers serialize access (cs_main).
+ */
+class CBlockIndexArena
+{
+public:
+    CBlockIndexArena() = default;
+    ~CBlockIndexArena() { Clear(); }
+
+    CBlockIndexArena(const CBlockIndexArena&) = delete;
+    CBlockIndexArena& operator=(const CBlockIndexArena&) = delete;
+
+    template <typename... Args>
+    CBlockIndex* New(Args&&... args)
+    {
+        Chunk& chunk = Reserve();
+        CBlockIndex* pindex = new (&chunk.data[chunk.nUsed]) CBlockIndex(std::forward<Args>(args)...);
+        ++chunk.nUsed;
+        ++nSize;
+        return pindex;
+    }
+
+    //! Whether pindex was allocated by this arena
+    bool Owns(const CBlockIndex* pindex) const;
+
+    //! Destroy all entries and release the memory
+    void Clear();
+
+    size_t Size() const { return nSize; }
+
+private:
+    static const size_t MIN_CHUNK_ENTRIES = 1024;
+    static const size_t MAX_CHUNK_ENTRIES = 65536;
+
+    typedef std::aligned_storage<sizeof(CBlockIndex), alignof(CBlockIndex)>::type Slot;
+
+    struct Chunk {
+        std::unique_ptr<Slot[]> data;
+        size_t nCapacity{0};
+        size_t nUsed{0};
+    };
+
+    Chunk& Reserve();
+
+    std::vector<Chunk> vChunks;
+    //! Chunk start addresses in ascending order, for Owns()
+    std::vector<std::pair<uintptr_t, size_t>> vRanges;
+    size_t nSize{0};
+};
 
 
 /** Used to marshal pointers into hashes for db storage. */
@@ -429,13 +518,15 @@ class CDiskBlockIndex : public CBlockIndex
 public:
     uint256 hash;
     uint256 hashPrev;
+    std::vector<unsigned char> vchBlockSig;
 
     CDiskBlockIndex() = default;
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) :
         CBlockIndex(*pindex),
         hash(pindex->GetBlockHash()),
-        hashPrev(pprev ? pprev->GetBlockHash() : uint256())
+        hashPrev(pprev ? pprev->GetBlockHash() : uint256()),
+        vchBlockSig(pindex->IsProofOfStake() ? pindex->GetBlockSig() : std::vector<unsigned char>())
     {}
 
     SERIALIZE_METHODS(CDiskBlockIndex, obj)
@@ -29,11 +29,28 @@
 
 #include "crypto/scrypt.h"
 //#include "util.h"
+#include <crypto/common.h>
+#include <assert.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <memory>
 #include <openssl/sha.h>
 
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace scrypt_sse2
+{
+void scrypt_1024_1_1_256_4way(const char *input, char *output, char *scratchpad);
+}
+
+namespace scrypt_avx2
+{
+void scrypt_1024_1_1_256_8way(const char *input, char *output, char *scratchpad);
+}
+
 #if defined(USE_SSE2) && !defined(USE_SSE2_ALWAYS)
 #ifdef _MSC_VER
 // MSVC 64bit is unable to use inline asm
@@ -330,3 +347,93 @@ void scrypt_1024_1_1_256(const char *input, char *output)
 	char scratchpad[SCRYPT_SCRATCHPAD_SIZE];
     scrypt_1024_1_1_256_sp(input, output, scratchpad);
 }
+
+namespace
+{
+typedef void (*ScryptNwayType)(const char *input, char *output, char *scratchpad);
+
+ScryptNwayType scrypt_4way = nullptr;
+ScryptNwayType scrypt_8way = nullptr;
+
+/** Scratchpad size of an N-lane kernel: one 128 KiB V array per lane plus alignment slack. */
+constexpr size_t ScratchpadSize(size_t lanes) { return 131072 * lanes + 63; }
+
+bool SelfTest()
+{
+    char input[8 * 80];
+    char expected[8 * 32];
+    char out[8 * 32];
+    std::unique_ptr<char[]> scratchpad(new char[ScratchpadSize(8)]);
+
+    for (int i = 0; i < 8 * 80; i++)
+        input[i] = (char)(i * 7 + 3);
+    for (int i = 0; i < 8; i++)
+        scrypt_1024_1_1_256_sp_generic(input + 80 * i, expected + 32 * i, scratchpad.get());
+
+    if (scrypt_4way) {
+        scrypt_4way(input, out, scratchpad.get());
+        if (memcmp(out, expected, 4 * 32) != 0) return false;
+    }
+    if (scrypt_8way) {
+        scrypt_8way(input, out, scratchpad.get());
+        if (memcmp(out, expected, 8 * 32) != 0) return false;
+    }
+    return true;
+}
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Check whether the CPU supports AVX2 and the OS has enabled AVX registers. */
+bool HaveAVX2()
+{
+    uint32_t eax, ebx, ecx, edx;
+    __cpuid_count(1, 0, eax, ebx, ecx, edx);
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    if (!have_xsave || !have_avx) return false;
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    if ((a & 6) != 6) return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+#endif
+} // namespace
+
+std::string ScryptAutoDetect()
+{
+    std::string ret = "generic(1way)";
+#if defined(__SSE2__)
+    scrypt_4way = scrypt_sse2::scrypt_1024_1_1_256_4way;
+    ret += ",sse2(4way)";
+#endif
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    if (HaveAVX2()) {
+        scrypt_8way = scrypt_avx2::scrypt_1024_1_1_256_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
+void scrypt_1024_1_1_256_batch(const char *input, char *output, size_t count, size_t max_lanes)
+{
+    if (count == 0) return;
+    if (max_lanes == 0) max_lanes = 8;
+
+    const bool use_8way = scrypt_8way && max_lanes >= 8 && count >= 8;
+    const bool use_4way = scrypt_4way && max_lanes >= 4 && count >= 4;
+    std::unique_ptr<char[]> scratchpad(new char[ScratchpadSize(use_8way ? 8 : use_4way ? 4 : 1)]);
+
+    if (use_8way) {
+        for (; count >= 8; count -= 8, input += 8 * 80, output += 8 * 32)
+            scrypt_8way(input, output, scratchpad.get());
+    }
+    if (use_4way) {
+        for (; count >= 4; count -= 4, input += 4 * 80, output += 4 * 32)
+            scrypt_4way(input, output, scratchpad.get());
+    }
+    for (; count > 0; count--, input += 80, output += 32)
+        scrypt_1024_1_1_256_sp(input, output, scratchpad.get());
+}
@@ -2,14 +2,26 @@
 #define SCRYPT_H
 #include <stdlib.h>
 #include <stdint.h>
+#include <string>
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
 void scrypt_1024_1_1_256(const char *input, char *output);
 void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad);
 
+/** Compute scrypt_1024_1_1_256 of many inputs at once.
+ *  input:     pointer to count consecutive 80-byte inputs
+ *  output:    pointer to a count*32 byte output buffer
+ *  max_lanes: widest interleaved kernel to use (1, 4 or 8), 0 for the widest available
+ */
+void scrypt_1024_1_1_256_batch(const char *input, char *output, size_t count, size_t max_lanes = 0);
+
+/** Autodetect the multi-lane scrypt kernels usable by scrypt_1024_1_1_256_batch().
+ *  Returns the name of the implementation.
+ */
+std::string ScryptAutoDetect();
+
 #if defined(USE_SSE2)
-#include <string>
 #if defined(_M_X64) || defined(__x86_64__) || defined(_M_AMD64) || (defined(MAC_OSX) && defined(__i386__))
 #define USE_SSE2_ALWAYS 1
 #define scrypt_1024_1_1_256_sp(input, output, scratchpad) scrypt_1024_1_1_256_sp_sse2((input), (output), (scratchpad))
@@ -0,0 +1,101 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(__SSE2__)
+
+#include <crypto/scrypt.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <emmintrin.h>
+
+namespace scrypt_sse2 {
+namespace {
+
+static const int LANES = 4;
+
+/* Each vector holds the same salsa word of all four lanes. */
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline RotL(__m128i x, int n) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+
+void inline QuarterRound(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    b = Xor(b, RotL(Add(a, d), 7));
+    c = Xor(c, RotL(Add(b, a), 9));
+    d = Xor(d, RotL(Add(c, b), 13));
+    a = Xor(a, RotL(Add(d, c), 18));
+}
+
+void inline xor_salsa8(__m128i B[16], const __m128i Bx[16])
+{
+    __m128i x[16];
+    for (int i = 0; i < 16; i++) {
+        x[i] = B[i] = Xor(B[i], Bx[i]);
+    }
+    for (int i = 0; i < 8; i += 2) {
+        /* Operate on columns. */
+        QuarterRound(x[0], x[4], x[8], x[12]);
+        QuarterRound(x[5], x[9], x[13], x[1]);
+        QuarterRound(x[10], x[14], x[2], x[6]);
+        QuarterRound(x[15], x[3], x[7], x[11]);
+
+        /* Operate on rows. */
+        QuarterRound(x[0], x[1], x[2], x[3]);
+        QuarterRound(x[5], x[6], x[7], x[4]);
+        QuarterRound(x[10], x[11], x[8], x[9]);
+        QuarterRound(x[15], x[12], x[13], x[14]);
+    }
+    for (int i = 0; i < 16; i++) {
+        B[i] = Add(B[i], x[i]);
+    }
+}
+
+} // namespace
+
+void scrypt_1024_1_1_256_4way(const char* input, char* output, char* scratchpad)
+{
+    uint8_t B[LANES][128];
+    union {
+        __m128i v[32];
+        uint32_t u32[32][LANES];
+    } X;
+    __m128i* V;
+    uint32_t i, k;
+    int l;
+
+    V = (__m128i*)(((uintptr_t)(scratchpad) + 63) & ~(uintptr_t)(63));
+
+    for (l = 0; l < LANES; l++) {
+        PBKDF2_SHA256((const uint8_t*)input + 80 * l, 80, (const uint8_t*)input + 80 * l, 80, 1, B[l], 128);
+        for (k = 0; k < 32; k++)
+            X.u32[k][l] = le32dec(&B[l][4 * k]);
+    }
+
+    for (i = 0; i < 1024; i++) {
+        memcpy(&V[i * 32], X.v, sizeof(X.v));
+        xor_salsa8(&X.v[0], &X.v[16]);
+        xor_salsa8(&X.v[16], &X.v[0]);
+    }
+    for (i = 0; i < 1024; i++) {
+        /* Every lane reads a different, data-dependent row of V. */
+        for (l = 0; l < LANES; l++) {
+            const uint32_t* row = (const uint32_t*)&V[32 * (X.u32[16][l] & 1023)];
+            for (k = 0; k < 32; k++)
+                X.u32[k][l] ^= row[k * LANES + l];
+        }
+        xor_salsa8(&X.v[0], &X.v[16]);
+        xor_salsa8(&X.v[16], &X.v[0]);
+    }
+
+    for (l = 0; l < LANES; l++) {
+        for (k = 0; k < 32; k++)
+            le32enc(&B[l][4 * k], X.u32[k][l]);
+        PBKDF2_SHA256((const uint8_t*)input + 80 * l, 80, B[l], 128, 1, (uint8_t*)output + 32 * l, 32);
+    }
+}
+
+} // namespace scrypt_sse2
+
+#endif // __SSE2__
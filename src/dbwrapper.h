@@ -8,10 +8,13 @@
 #include <clientversion.h>
 #include <fs.h>
 #include <serialize.h>
+#include <span.h>
 #include <streams.h>
+#include <support/allocators/arena.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 
+#include <cstring>
 #include <typeindex>
 
 #include <leveldb/db.h>
@@ -191,6 +194,12 @@ public:
         return piter->value().size();
     }
 
+    /** Append the still obfuscated value bytes, for callers that decode off-thread. */
+    void AppendRawValue(std::vector<unsigned char>& vch) {
+        leveldb::Slice slValue = piter->value();
+        vch.insert(vch.end(), slValue.data(), slValue.data() + slValue.size());
+    }
+
 };
 
 class CDBWrapper
@@ -475,7 +484,7 @@ public:
         } else {
             try {
                 // TODO try to avoid this copy (we need a stream that allows reading from external buffers)
-                CDataStream ssKey = transactionIt->first;
+                CDataStream ssKey(transactionIt->first.begin(), transactionIt->first.end(), SER_DISK, CLIENT_VERSION);
                 ssKey >> key;
             } catch (const std::exception&) {
                 return false;
@@ -491,7 +500,7 @@ public:
         if (curIsParent) {
             return parentKey;
         } else {
-            return transactionIt->first;
+            return CDataStream(transactionIt->first.begin(), transactionIt->first.end(), SER_DISK, CLIENT_VERSION);
         }
     }
 
@@ -502,7 +511,7 @@ public:
         if (curIsParent) {
             return parentIt->GetKeySize();
         } else {
-            return transactionIt->first.vKey.size();
+            return transactionIt->first.size();
         }
     }
 
@@ -514,7 +523,8 @@ public:
         if (curIsParent) {
             return transaction.Read(parentKey, value);
         } else {
-            return transaction.Read(transactionIt->first, value);
+            CDBTransaction::ReadValue(transactionIt->second, value);
+            return true;
         }
     };
 
@@ -535,7 +545,7 @@ private:
         } else if (transactionIt == transaction.writes.end() && parentIt->Valid()) {
             curIsParent = true;
         } else if (transactionIt != transaction.writes.end() && parentIt->Valid()) {
-            if (CDBTransaction::DataStreamCmp::less(transactionIt->first, parentKey)) {
+            if (transaction.writes.key_comp()(transactionIt->first, parentKey)) {
                 curIsParent = false;
             } else {
                 curIsParent = true;
@@ -551,16 +561,34 @@ class CDBTransaction {
 protected:
     Parent &parent;
     CommitTarget &commitTarget;
-    ssize_t memoryUsage{0}; // signed, just in case we made an error in the calculations so that we don't get an overflow
+    // serialized size of the pending values, keys and tree nodes are accounted for by the arena.
+    // signed, just in case we made an error in the calculations so that we don't get an overflow
+    ssize_t memoryUsage{0};
+
+    // Keys, values and the tree nodes of writes/deletes all live in this arena and are released at once when
+    // the transaction is committed or cleared. Must be declared before the containers which allocate from it.
+    MonotonicArena arena;
+
+    // Serialized key, the bytes are owned by the arena
+    typedef Span<const char> Key;
+
+    struct KeyCmp {
+        using is_transparent = void;
 
-    struct DataStreamCmp {
-        static bool less(const CDataStream& a, const CDataStream& b) {
-            return std::lexicographical_compare(
-                    (const uint8_t*)a.data(), (const uint8_t*)a.data() + a.size(),
-                    (const uint8_t*)b.data(), (const uint8_t*)b.data() + b.size());
+        static bool less(const char* a, size_t aSize, const char* b, size_t bSize) {
+            // same order as comparing unsigned bytes lexicographically
+            const size_t n = std::min(aSize, bSize);
+            const int c = n ? memcmp(a, b, n) : 0;
+            return c < 0 || (c == 0 && aSize < bSize);
         }
-        bool operator()(const CDataStream& a, const CDataStream& b) const {
-            return less(a, b);
+        bool operator()(const Key& a, const Key& b) const {
+            return less(a.data(), a.size(), b.data(), b.size());
+        }
+        bool operator()(const Key& a, const CDataStream& b) const {
+            return less(a.data(), a.size(), b.data(), b.size());
+        }
+        bool operator()(const CDataStream& a, const Key& b) const {
+            return less(a.data(), a.size(), b.data(), b.size());
         }
     };
 
@@ -569,8 +597,8 @@ protected:
         explicit ValueHolder(size_t _memoryUsage) : memoryUsage(_memoryUsage) {}
         virtual ~ValueHolder() = default;
         virtual void Write(const CDataStream& ssKey, CommitTarget &parent) = 0;
+        virtual void Serialize(CDataStream& ssValue) const = 0;
     };
-    typedef std::unique_ptr<ValueHolder> ValueHolderPtr;
 
     template <typename V>
     struct ValueHolderImpl : ValueHolder {
@@ -581,6 +609,9 @@ protected:
             // ValueHolderImpl instance. Commit() clears the write maps, so this ok.
             commitTarget.Write(ssKey, std::move(value));
         }
+        virtual void Serialize(CDataStream& ssValue) const override {
+            ssValue << value;
+        }
         V value;
     };
 
@@ -592,14 +623,56 @@ protected:
         return ssKey;
     }
 
-    typedef std::map<CDataStream, ValueHolderPtr, DataStreamCmp> WritesMap;
-    typedef std::set<CDataStream, DataStreamCmp> DeletesSet;
+    typedef std::map<Key, ValueHolder*, KeyCmp, arena_allocator<std::pair<const Key, ValueHolder*>>> WritesMap;
+    typedef std::set<Key, KeyCmp, arena_allocator<Key>> DeletesSet;
 
     WritesMap writes;
     DeletesSet deletes;
 
+    Key CopyKey(const CDataStream& ssKey) {
+        char* p = static_cast<char*>(arena.Allocate(ssKey.size(), 1));
+        memcpy(p, ssKey.data(), ssKey.size());
+        return Key(p, ssKey.size());
+    }
+
+    template <typename V>
+    ValueHolder* NewValue(const V& v, size_t valueMemoryUsage) {
+        void* p = arena.Allocate(sizeof(ValueHolderImpl<V>), alignof(ValueHolderImpl<V>));
+        return new (p) ValueHolderImpl<V>(v, valueMemoryUsage);
+    }
+
+    // only runs the destructor, the memory stays in the arena until the next Clear()
+    static void DestroyValue(ValueHolder* holder) {
+        holder->~ValueHolder();
+    }
+
+    template <typename V>
+    static void ReadValue(const ValueHolder* holder, V& value) {
+        auto *impl = dynamic_cast<const ValueHolderImpl<V> *>(holder);
+        if (!impl) {
+            throw std::runtime_error("Read called with V != previously written type");
+        }
+        value = impl->value;
+    }
+
 public:
-    CDBTransaction(Parent &_parent, CommitTarget &_commitTarget) : parent(_parent), commitTarget(_commitTarget) {}
+    CDBTransaction(Parent &_parent, CommitTarget &_commitTarget) :
+            parent(_parent),
+            commitTarget(_commitTarget),
+            writes(KeyCmp(), typename WritesMap::allocator_type(arena)),
+            deletes(KeyCmp(), typename DeletesSet::allocator_type(arena))
+    {
+    }
+
+    ~CDBTransaction() {
+        for (auto &p : writes) {
+            DestroyValue(p.second);
+        }
+    }
+
+    // the containers point into the arena of this instance
+    CDBTransaction(const CDBTransaction&) = delete;
+    CDBTransaction& operator=(const CDBTransaction&) = delete;
 
     template <typename K, typename V>
     void Write(const K& key, const V& v) {
@@ -610,16 +683,30 @@ public:
     void Write(const CDataStream& ssKey, const V& v) {
         auto valueMemoryUsage = ::GetSerializeSize(v, SER_DISK, CLIENT_VERSION);
 
-        if (deletes.erase(ssKey)) {
-            memoryUsage -= ssKey.size();
-        }
-        auto it = writes.emplace(ssKey, nullptr).first;
-        if (it->second) {
-            memoryUsage -= ssKey.size() + it->second->memoryUsage;
+        // the holder is only created once its slot exists, nothing is left half way if copying v throws
+        auto it = writes.lower_bound(ssKey);
+        if (it != writes.end() && !writes.key_comp()(ssKey, it->first)) {
+            ValueHolder* holder = NewValue(v, valueMemoryUsage);
+            memoryUsage -= it->second->memoryUsage;
+            DestroyValue(it->second);
+            it->second = holder;
+        } else {
+            // a key can't be in both containers, so reuse the copy made for the delete if there is one
+            auto itDel = deletes.find(ssKey);
+            const bool fDeleted = itDel != deletes.end();
+            it = writes.emplace_hint(it, fDeleted ? *itDel : CopyKey(ssKey), nullptr);
+            try {
+                it->second = NewValue(v, valueMemoryUsage);
+            } catch (...) {
+                writes.erase(it);
+                throw;
+            }
+            if (fDeleted) {
+                deletes.erase(itDel);
+            }
         }
-        it->second = std::make_unique<ValueHolderImpl<V>>(v, valueMemoryUsage);
 
-        memoryUsage += ssKey.size() + valueMemoryUsage;
+        memoryUsage += valueMemoryUsage;
     }
 
     template <typename K, typename V>
@@ -635,17 +722,34 @@ public:
 
         auto it = writes.find(ssKey);
         if (it != writes.end()) {
-            auto *impl = dynamic_cast<ValueHolderImpl<V> *>(it->second.get());
-            if (!impl) {
-                throw std::runtime_error("Read called with V != previously written type");
-            }
-            value = impl->value;
+            ReadValue(it->second, value);
             return true;
         }
 
         return parent.Read(ssKey, value);
     }
 
+    template <typename K>
+    bool ReadDataStream(const K& key, CDataStream& ssValue) {
+        return ReadDataStream(KeyToDataStream(key), ssValue);
+    }
+
+    bool ReadDataStream(const CDataStream& ssKey, CDataStream& ssValue) {
+        if (deletes.count(ssKey)) {
+            return false;
+        }
+
+        auto it = writes.find(ssKey);
+        if (it != writes.end()) {
+            // pending values are not serialized yet
+            ssValue.clear();
+            it->second->Serialize(ssValue);
+            return true;
+        }
+
+        return parent.ReadDataStream(ssKey, ssValue);
+    }
+
     template <typename K>
     bool Exists(const K& key) {
         return Exists(KeyToDataStream(key));
@@ -671,26 +775,44 @@ public:
     void Erase(const CDataStream& ssKey) {
         auto it = writes.find(ssKey);
         if (it != writes.end()) {
-            memoryUsage -= ssKey.size() + it->second->memoryUsage;
+            // the key moves over to the deletes, its bytes stay in the arena. Insert it first, the pending write
+            // stays intact if that throws
+            deletes.emplace(it->first);
+            memoryUsage -= it->second->memoryUsage;
+            DestroyValue(it->second);
             writes.erase(it);
-        }
-        if (deletes.emplace(ssKey).second) {
-            memoryUsage += ssKey.size();
+        } else {
+            auto itDel = deletes.lower_bound(ssKey);
+            if (itDel == deletes.end() || deletes.key_comp()(ssKey, *itDel)) {
+                deletes.emplace_hint(itDel, CopyKey(ssKey));
+            }
         }
     }
 
     void Clear() {
+        for (auto &p : writes) {
+            DestroyValue(p.second);
+        }
+        // the containers hand their nodes back to the arena (a no-op) and must be empty before it's cleared
         writes.clear();
         deletes.clear();
+        arena.Clear();
         memoryUsage = 0;
     }
 
     void Commit() {
+        // one stream for all keys, the targets copy what they need
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         for (const auto &k : deletes) {
-            commitTarget.Erase(k);
+            ssKey.clear();
+            ssKey.write(k.data(), k.size());
+            commitTarget.Erase(ssKey);
         }
         for (auto &p : writes) {
-            p.second->Write(p.first, commitTarget);
+            ssKey.clear();
+            ssKey.write(p.first.data(), p.first.size());
+            p.second->Write(ssKey, commitTarget);
         }
         Clear();
     }
@@ -709,7 +831,7 @@ public:
             }
             return 0;
         }
-        return (size_t)memoryUsage;
+        return (size_t)memoryUsage + arena.DynamicMemoryUsage();
     }
 
     CDBTransactionIterator<CDBTransaction>* NewIterator() {
@@ -100,10 +100,14 @@ bool CheckCbTxMerkleRoots(const CBlock& block, const CBlockIndex* pindex, CValid
     return true;
 }
 
+// Merkle tree of the MN list at the block smlTreeBlockHash. Every call moves it forward to the list of
+// pindexPrev (usually by a single block), applies the new block's changes to it and reverts them again
+static Mutex cs_smlTree;
+static CSimplifiedMNListMerkleTree smlTreeCached GUARDED_BY(cs_smlTree);
+static uint256 smlTreeBlockHash GUARDED_BY(cs_smlTree);
+
 bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev, uint256& merkleRootRet, CValidationState& state, const CCoinsViewCache& view)
 {
-    LOCK(deterministicMNManager->cs);
-
     try {
         static int64_t nTimeDMN = 0;
         static int64_t nTimeSMNL = 0;
@@ -111,42 +115,60 @@ bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev
 
         int64_t nTime1 = GetTimeMicros();
 
+        CDeterministicMNList prevMNList;
         CDeterministicMNList tmpMNList;
-        if (!deterministicMNManager->BuildNewListFromBlock(block, pindexPrev, state, view, tmpMNList, false)) {
-            // pass the state returned by the function above
-            return false;
+        // the diffs stored by CDeterministicMNManager::ProcessBlock for pindexPrev and, when connecting, for the block
+        CDeterministicMNListDiff prevDiff;
+        CDeterministicMNListDiff blockDiff;
+        bool fPrevDiff = false;
+        // only a hint which diff is needed, checked again below
+        const uint256 treeBlockHash = WITH_LOCK(cs_smlTree, return smlTreeBlockHash);
+        {
+            LOCK(deterministicMNManager->cs);
+            if (!deterministicMNManager->BuildNewListFromBlock(block, pindexPrev, state, view, tmpMNList, false)) {
+                // pass the state returned by the function above
+                return false;
+            }
+            prevMNList = deterministicMNManager->GetListForBlock(pindexPrev);
+            if (!deterministicMNManager->GetListDiff(block.GetHash(), blockDiff, false)) {
+                // mined or only checked blocks are not processed yet
+                blockDiff = prevMNList.BuildDiff(tmpMNList);
+            }
+            if (pindexPrev->pprev && treeBlockHash == pindexPrev->pprev->GetBlockHash()) {
+                fPrevDiff = deterministicMNManager->GetListDiff(pindexPrev->GetBlockHash(), prevDiff);
+            }
         }
 
         int64_t nTime2 = GetTimeMicros(); nTimeDMN += nTime2 - nTime1;
         LogPrint(BCLog::BENCHMARK, "            - BuildNewListFromBlock: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeDMN * 0.000001);
 
-        CSimplifiedMNList sml(tmpMNList);
-
-        int64_t nTime3 = GetTimeMicros(); nTimeSMNL += nTime3 - nTime2;
-        LogPrint(BCLog::BENCHMARK, "            - CSimplifiedMNList: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeSMNL * 0.000001);
-
-        static CSimplifiedMNList smlCached;
-        static uint256 merkleRootCached;
-        static bool mutatedCached{false};
+        LOCK(cs_smlTree);
 
-        if (sml == smlCached) {
-            merkleRootRet = merkleRootCached;
-            if (mutatedCached) {
-                return state.DoS(100, false, REJECT_INVALID, "mutated-cached-calc-cb-mnmerkleroot");
+        if (smlTreeBlockHash != pindexPrev->GetBlockHash()) {
+            const uint256 cachedBlockHash = smlTreeBlockHash;
+            // invalid until fully updated, an exception may leave the tree half way
+            smlTreeBlockHash.SetNull();
+            if (fPrevDiff && cachedBlockHash == pindexPrev->pprev->GetBlockHash()) {
+                smlTreeCached.ApplyDiff(deterministicMNManager->GetListForBlock(pindexPrev->pprev), prevMNList, prevDiff);
+            } else {
+                smlTreeCached = CSimplifiedMNListMerkleTree(prevMNList);
             }
-            return true;
+            smlTreeBlockHash = pindexPrev->GetBlockHash();
         }
 
+        int64_t nTime3 = GetTimeMicros(); nTimeSMNL += nTime3 - nTime2;
+        LogPrint(BCLog::BENCHMARK, "            - CSimplifiedMNListMerkleTree: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeSMNL * 0.000001);
+
+        smlTreeBlockHash.SetNull();
+        smlTreeCached.ApplyDiff(prevMNList, tmpMNList, blockDiff);
         bool mutated = false;
-        merkleRootRet = sml.CalcMerkleRoot(&mutated);
+        merkleRootRet = smlTreeCached.GetMerkleRoot(&mutated);
+        smlTreeCached.RevertDiff(prevMNList, blockDiff);
+        smlTreeBlockHash = pindexPrev->GetBlockHash();
 
         int64_t nTime4 = GetTimeMicros(); nTimeMerkle += nTime4 - nTime3;
         LogPrint(BCLog::BENCHMARK, "            - CalcMerkleRoot: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeMerkle * 0.000001);
 
-        smlCached = std::move(sml);
-        merkleRootCached = merkleRootRet;
-        mutatedCached = mutated;
-
         if (mutated) {
             return state.DoS(100, false, REJECT_INVALID, "mutated-calc-cb-mnmerkleroot");
         }
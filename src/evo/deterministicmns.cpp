@@ -529,6 +529,17 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
     mnInternalIdMap = mnInternalIdMap.erase(dmn->GetInternalId());
 }
 
+CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb, int nDiffReaders) :
+    evoDb(_evoDb)
+{
+    if (nDiffReaders < 0) {
+        nDiffReaders = std::max(std::min(GetNumCores() / 2, 4), 1);
+    }
+    if (nDiffReaders > 0) {
+        diffReaderPool.Start(nDiffReaders, "mndiff");
+    }
+}
+
 bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& _state, const CCoinsViewCache& view, bool fJustCheck)
 {
     AssertLockHeld(cs_main);
@@ -566,13 +577,32 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
         diff = oldList.BuildDiff(newList);
 
         evoDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
-        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1) {
+
+        // Besides the daily snapshot, write one as soon as the diffs since the last one are bigger than it. Small
+        // lists with a lot of churn get denser snapshots, replaying diffs never reads much more than a snapshot.
+        // the spacing is derived from the parent block's, an unknown parent (e.g. after a restart) disables dense
+        // snapshots until the next daily one
+        SnapshotSpacing spacing;
+        auto itSpacing = pindex->pprev ? mapSnapshotSpacing.find(pindex->pprev->GetBlockHash()) : mapSnapshotSpacing.end();
+        if (itSpacing != mapSnapshotSpacing.end()) {
+            spacing = itSpacing->second;
+        }
+        spacing.nHeight = nHeight;
+        spacing.nDiffBytesSinceSnapshot += ::GetSerializeSize(diff, SER_DISK, CLIENT_VERSION);
+        const bool fDenseSnapshot = spacing.nLastSnapshotSize != 0 && spacing.nDiffBytesSinceSnapshot >= spacing.nLastSnapshotSize &&
+                                    nHeight - spacing.nLastSnapshotHeight >= MIN_DISK_SNAPSHOT_DISTANCE;
+        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1 || fDenseSnapshot) {
             evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
             mnListsCache.emplace(newList.GetBlockHash(), newList);
+            spacing.nLastSnapshotSize = ::GetSerializeSize(newList, SER_DISK, CLIENT_VERSION);
+            spacing.nLastSnapshotHeight = nHeight;
+            spacing.nDiffBytesSinceSnapshot = 0;
             LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d\n",
                 __func__, nHeight, newList.GetAllMNsCount());
         }
 
+        mapSnapshotSpacing[pindex->GetBlockHash()] = spacing;
+
         diff.nHeight = pindex->nHeight;
         mnListDiffsCache.emplace(pindex->GetBlockHash(), diff);
     } catch (const std::exception& e) {
@@ -618,7 +648,9 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
         }
 
         mnListsCache.erase(blockHash);
+        mnListsQueryCache.erase(blockHash);
         mnListDiffsCache.erase(blockHash);
+        mapSnapshotSpacing.erase(blockHash);
     }
 
     if (diff.HasChanges()) {
@@ -928,6 +960,8 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
 
     CDeterministicMNList snapshot;
     std::list<const CBlockIndex*> listDiffIndexes;
+    // diffs which are not cached yet, newest first, only their raw data is read while walking back
+    std::vector<std::pair<const CBlockIndex*, CDataStream>> vecDiffsToLoad;
 
     while (true) {
         // try using cache before reading from disk
@@ -937,6 +971,10 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
             break;
         }
 
+        if (mnListsQueryCache.get(pindex->GetBlockHash(), snapshot)) {
+            break;
+        }
+
         if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), snapshot)) {
             mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
             break;
@@ -950,21 +988,51 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
             continue;
         }
 
-        CDeterministicMNListDiff diff;
-        if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
+        CDataStream ssDiff(SER_DISK, CLIENT_VERSION);
+        if (!evoDb.ReadDataStream(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), ssDiff)) {
             // no snapshot and no diff on disk means that it's the initial snapshot
             snapshot = CDeterministicMNList(pindex->GetBlockHash(), -1, 0);
             mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
             break;
         }
 
-        diff.nHeight = pindex->nHeight;
-        mnListDiffsCache.emplace(pindex->GetBlockHash(), std::move(diff));
+        vecDiffsToLoad.emplace_back(pindex, std::move(ssDiff));
         listDiffIndexes.emplace_front(pindex);
         pindex = pindex->pprev;
     }
 
+    // Deserialize the diffs oldest first on the pool, so that the loop below can apply the first ones while the
+    // later ones are still being deserialized. The tasks own their data, nothing dangles if ApplyDiff throws.
+    std::reverse(vecDiffsToLoad.begin(), vecDiffsToLoad.end());
+    const bool fParallel = vecDiffsToLoad.size() >= PARALLEL_DIFFS_MIN && diffReaderPool.size() > 0;
+    std::vector<std::future<CDeterministicMNListDiff>> vecDiffFutures;
+    if (fParallel) {
+        vecDiffFutures.reserve(vecDiffsToLoad.size());
+        for (auto& p : vecDiffsToLoad) {
+            vecDiffFutures.emplace_back(diffReaderPool.push(WorkStealingPool::Priority::HIGH, [](int, CDataStream& ssDiff) {
+                CDeterministicMNListDiff diff;
+                ssDiff >> diff;
+                return diff;
+            }, std::move(p.second)));
+        }
+    }
+
+    // keep some of the lists of long replays, queries tend to come for nearby heights (e.g. "protx diff")
+    const bool fKeepQuerySnapshots = listDiffIndexes.size() >= (size_t)QUERY_SNAPSHOT_DISTANCE;
+
+    size_t nNextToLoad = 0;
     for (const auto& diffIndex : listDiffIndexes) {
+        if (nNextToLoad < vecDiffsToLoad.size() && vecDiffsToLoad[nNextToLoad].first == diffIndex) {
+            CDeterministicMNListDiff diff;
+            if (fParallel) {
+                diff = vecDiffFutures[nNextToLoad].get();
+            } else {
+                vecDiffsToLoad[nNextToLoad].second >> diff;
+            }
+            diff.nHeight = diffIndex->nHeight;
+            mnListDiffsCache.emplace(diffIndex->GetBlockHash(), std::move(diff));
+            nNextToLoad++;
+        }
         const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash());
         if (diff.HasChanges()) {
             snapshot = snapshot.ApplyDiff(diffIndex, diff);
@@ -972,6 +1040,9 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
             snapshot.SetBlockHash(diffIndex->GetBlockHash());
             snapshot.SetHeight(diffIndex->nHeight);
         }
+        if (fKeepQuerySnapshots && (diffIndex->nHeight % QUERY_SNAPSHOT_DISTANCE == 0 || diffIndex == listDiffIndexes.back())) {
+            mnListsQueryCache.insert(diffIndex->GetBlockHash(), snapshot);
+        }
     }
 
     if (tipIndex) {
@@ -993,6 +1064,18 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
     return snapshot;
 }
 
+bool CDeterministicMNManager::GetListDiff(const uint256& blockHash, CDeterministicMNListDiff& diffRet, bool fReadDb)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListDiffsCache.find(blockHash);
+    if (it != mnListDiffsCache.end()) {
+        diffRet = it->second;
+        return true;
+    }
+    return fReadDb && evoDb.Read(std::make_pair(DB_LIST_DIFF, blockHash), diffRet);
+}
+
 CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
 {
     LOCK(cs);
@@ -1077,6 +1160,14 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
     for (const auto& h : toDeleteDiffs) {
         mnListDiffsCache.erase(h);
     }
+    // only the spacing of recent blocks is needed to connect the next ones or to reorg
+    for (auto it = mapSnapshotSpacing.begin(); it != mapSnapshotSpacing.end(); ) {
+        if (it->second.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
+            it = mapSnapshotSpacing.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 void CDeterministicMNManager::UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList)
@@ -15,6 +15,8 @@
 #include <saltedhasher.h>
 #include <scheduler.h>
 #include <sync.h>
+#include <unordered_lru_cache.h>
+#include <util/workstealingpool.h>
 
 #include <immer/map.hpp>
 
@@ -514,6 +516,13 @@ class CDeterministicMNManager
     static constexpr int DISK_SNAPSHOT_PERIOD = 576; // once per day
     static constexpr int DISK_SNAPSHOTS = 3; // keep cache for 3 disk snapshots to have 2 full days covered
     static constexpr int LIST_DIFFS_CACHE_SIZE = DISK_SNAPSHOT_PERIOD * DISK_SNAPSHOTS;
+    // extra disk snapshots for small or fast changing lists are at least this many blocks apart
+    static constexpr int MIN_DISK_SNAPSHOT_DISTANCE = 16;
+    // lists rebuilt by replaying diffs are kept in memory at this spacing, for following queries of nearby heights
+    static constexpr int QUERY_SNAPSHOT_DISTANCE = 32;
+    static constexpr size_t QUERY_SNAPSHOTS = 128;
+    // with less diffs to read from disk, deserializing them on the calling thread is faster
+    static constexpr size_t PARALLEL_DIFFS_MIN = 16;
 
 public:
     CCriticalSection cs;
@@ -531,9 +540,24 @@ private:
     std::unordered_map<uint256, CDeterministicMNList, StaticSaltedHasher> mnListsCache GUARDED_BY(cs);
     std::unordered_map<uint256, CDeterministicMNListDiff, StaticSaltedHasher> mnListDiffsCache GUARDED_BY(cs);
     const CBlockIndex* tipIndex GUARDED_BY(cs) {nullptr};
+    unordered_lru_cache<uint256, CDeterministicMNList, StaticSaltedHasher, QUERY_SNAPSHOTS> mnListsQueryCache GUARDED_BY(cs);
+
+    // serialized size of the last disk snapshot and of the diffs written after it, as of a block
+    struct SnapshotSpacing {
+        int nHeight{-1};
+        size_t nLastSnapshotSize{0};
+        int nLastSnapshotHeight{-1};
+        size_t nDiffBytesSinceSnapshot{0};
+    };
+    // keyed by block hash, so blocks which fail to connect or are undone don't affect the spacing of others
+    std::unordered_map<uint256, SnapshotSpacing, StaticSaltedHasher> mapSnapshotSpacing GUARDED_BY(cs);
+
+    // deserializes diffs read from disk ahead of the serial ApplyDiff loop in GetListForBlock
+    WorkStealingPool diffReaderPool;
 
 public:
-    explicit CDeterministicMNManager(CEvoDB& _evoDb) : evoDb(_evoDb) {}
+    // nDiffReaders threads deserialize diffs for GetListForBlock, -1 picks half the cores (up to 4), 0 reads serially
+    explicit CDeterministicMNManager(CEvoDB& _evoDb, int nDiffReaders = -1);
     ~CDeterministicMNManager() = default;
 
     bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state,
@@ -550,6 +574,9 @@ public:
 
     CDeterministicMNList GetListForBlock(const CBlockIndex* pindex);
     CDeterministicMNList GetListAtChainTip();
+    // the diff stored for the given block by ProcessBlock, fReadDb=false restricts the lookup to the in-memory cache.
+    // nHeight of diffs read from disk is not set.
+    bool GetListDiff(const uint256& blockHash, CDeterministicMNListDiff& diffRet, bool fReadDb = true) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     // Test if given TX is a ProRegTx which also contains the collateral at index n
     static bool IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n);
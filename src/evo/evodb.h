@@ -65,6 +65,14 @@ public:
         return curDBTransaction.Read(key, value);
     }
 
+    // reads the serialized value, so that it can be deserialized without holding cs
+    template <typename K>
+    bool ReadDataStream(const K& key, CDataStream& ssValue)
+    {
+        LOCK(cs);
+        return curDBTransaction.ReadDataStream(key, ssValue);
+    }
+
     template <typename K, typename V>
     void Write(const K& key, const V& value)
     {
@@ -18,6 +18,7 @@
 #include <base58.h>
 #include <chainparams.h>
 #include <consensus/merkle.h>
+#include <crypto/sha256.h>
 #include <univalue.h>
 #include <validation.h>
 #include <key_io.h>
@@ -104,6 +105,217 @@ bool CSimplifiedMNList::operator==(const CSimplifiedMNList& rhs) const
             );
 }
 
+CSimplifiedMNListMerkleTree::CSimplifiedMNListMerkleTree(const CDeterministicMNList& dmnList)
+{
+    std::vector<std::pair<uint256, uint256>> entries;
+    entries.reserve(dmnList.GetAllMNsCount());
+    dmnList.ForEachMN(false, [&entries](auto& dmn) {
+        entries.emplace_back(dmn.proTxHash, CSimplifiedMNListEntry(dmn).CalcHash());
+    });
+    std::sort(entries.begin(), entries.end());
+    Init(entries);
+}
+
+CSimplifiedMNListMerkleTree::CSimplifiedMNListMerkleTree(const std::vector<std::pair<uint256, uint256>>& entries)
+{
+    Init(entries);
+}
+
+void CSimplifiedMNListMerkleTree::Init(const std::vector<std::pair<uint256, uint256>>& entries)
+{
+    proTxHashes.reserve(entries.size());
+    levels[0].reserve(entries.size());
+    for (const auto& p : entries) {
+        proTxHashes.emplace_back(p.first);
+        levels[0].emplace_back(p.second);
+    }
+    Rehash(0, {});
+}
+
+size_t CSimplifiedMNListMerkleTree::FindLeaf(const uint256& proTxHash) const
+{
+    auto it = std::lower_bound(proTxHashes.begin(), proTxHashes.end(), proTxHash);
+    if (it == proTxHashes.end() || *it != proTxHash) {
+        throw std::runtime_error(strprintf("%s: masternode %s not found", __func__, proTxHash.ToString()));
+    }
+    return it - proTxHashes.begin();
+}
+
+void CSimplifiedMNListMerkleTree::HashParent(size_t nLevel, size_t nIndex)
+{
+    const std::vector<uint256>& children = levels[nLevel];
+    const size_t nLeft = nIndex * 2;
+    // the last node of an odd sized level is hashed with itself
+    const size_t nRight = std::min(nLeft + 1, children.size() - 1);
+
+    const bool fMutated = nRight != nLeft && children[nLeft] == children[nRight];
+    if (mutatedPairs[nLevel + 1][nIndex] != fMutated) {
+        mutatedPairs[nLevel + 1][nIndex] = fMutated;
+        if (fMutated) {
+            nMutatedPairs++;
+        } else {
+            nMutatedPairs--;
+        }
+    }
+
+    unsigned char pair[64];
+    memcpy(pair, children[nLeft].begin(), 32);
+    memcpy(pair + 32, children[nRight].begin(), 32);
+    SHA256D64(levels[nLevel + 1][nIndex].begin(), pair, 1);
+}
+
+// Rehashes the parents of the leaves in setDirty and of all leaves starting at nDirtyFrom
+void CSimplifiedMNListMerkleTree::Rehash(size_t nDirtyFrom, std::set<size_t> setDirty)
+{
+    size_t nLevel = 0;
+    while (levels[nLevel].size() > 1) {
+        if (levels.size() == nLevel + 1) {
+            levels.emplace_back();
+            mutatedPairs.emplace_back();
+        }
+        const size_t nParents = (levels[nLevel].size() + 1) / 2;
+        nDirtyFrom /= 2;
+
+        // flags of parents which are rehashed or dropped are recalculated from scratch
+        std::vector<bool>& mutated = mutatedPairs[nLevel + 1];
+        for (size_t i = nDirtyFrom; i < mutated.size(); i++) {
+            if (mutated[i]) {
+                nMutatedPairs--;
+            }
+        }
+        mutated.resize(std::min(nDirtyFrom, mutated.size()));
+        mutated.resize(nParents, false);
+        levels[nLevel + 1].resize(nParents);
+
+        std::set<size_t> setDirtyParents;
+        for (size_t nPos : setDirty) {
+            if (nPos / 2 < nDirtyFrom) {
+                setDirtyParents.emplace(nPos / 2);
+            }
+        }
+        for (size_t i : setDirtyParents) {
+            HashParent(nLevel, i);
+        }
+        for (size_t i = nDirtyFrom; i < nParents; i++) {
+            HashParent(nLevel, i);
+        }
+        setDirty = std::move(setDirtyParents);
+        nLevel++;
+    }
+
+    // the list shrunk, drop the levels above the new root
+    while (levels.size() > nLevel + 1) {
+        for (bool fMutated : mutatedPairs.back()) {
+            if (fMutated) {
+                nMutatedPairs--;
+            }
+        }
+        levels.pop_back();
+        mutatedPairs.pop_back();
+    }
+}
+
+void CSimplifiedMNListMerkleTree::ApplyDiff(const CDeterministicMNList& from, const CDeterministicMNList& to)
+{
+    ApplyDiff(from, to, from.BuildDiff(to));
+}
+
+void CSimplifiedMNListMerkleTree::ApplyDiff(const CDeterministicMNList& from, const CDeterministicMNList& to, const CDeterministicMNListDiff& diff)
+{
+    std::vector<uint256> vecRemoved;
+    std::vector<std::pair<uint256, uint256>> vecAdded, vecUpdated;
+    vecRemoved.reserve(diff.removedMns.size());
+    for (uint64_t internalId : diff.removedMns) {
+        vecRemoved.emplace_back(from.GetMNByInternalId(internalId)->proTxHash);
+    }
+    vecAdded.reserve(diff.addedMNs.size());
+    for (const auto& dmn : diff.addedMNs) {
+        vecAdded.emplace_back(dmn->proTxHash, CSimplifiedMNListEntry(*dmn).CalcHash());
+    }
+    vecUpdated.reserve(diff.updatedMNs.size());
+    for (const auto& p : diff.updatedMNs) {
+        const auto dmn = to.GetMNByInternalId(p.first);
+        vecUpdated.emplace_back(dmn->proTxHash, CSimplifiedMNListEntry(*dmn).CalcHash());
+    }
+    ApplyChanges(vecRemoved, vecAdded, vecUpdated);
+}
+
+void CSimplifiedMNListMerkleTree::RevertDiff(const CDeterministicMNList& from, const CDeterministicMNListDiff& diff)
+{
+    std::vector<uint256> vecRemoved;
+    std::vector<std::pair<uint256, uint256>> vecAdded, vecUpdated;
+    vecRemoved.reserve(diff.addedMNs.size());
+    for (const auto& dmn : diff.addedMNs) {
+        vecRemoved.emplace_back(dmn->proTxHash);
+    }
+    vecAdded.reserve(diff.removedMns.size());
+    for (uint64_t internalId : diff.removedMns) {
+        const auto dmn = from.GetMNByInternalId(internalId);
+        vecAdded.emplace_back(dmn->proTxHash, CSimplifiedMNListEntry(*dmn).CalcHash());
+    }
+    vecUpdated.reserve(diff.updatedMNs.size());
+    for (const auto& p : diff.updatedMNs) {
+        const auto dmn = from.GetMNByInternalId(p.first);
+        vecUpdated.emplace_back(dmn->proTxHash, CSimplifiedMNListEntry(*dmn).CalcHash());
+    }
+    ApplyChanges(vecRemoved, vecAdded, vecUpdated);
+}
+
+void CSimplifiedMNListMerkleTree::ApplyChanges(const std::vector<uint256>& vecRemoved, const std::vector<std::pair<uint256, uint256>>& vecAdded,
+                                               const std::vector<std::pair<uint256, uint256>>& vecUpdated)
+{
+    std::vector<uint256>& leaves = levels[0];
+
+    // leaves right of an added or removed one move, all of their parents need to be rehashed
+    size_t nDirtyFrom = leaves.size();
+    bool fResized = false;
+    for (const uint256& proTxHash : vecRemoved) {
+        const size_t nPos = FindLeaf(proTxHash);
+        proTxHashes.erase(proTxHashes.begin() + nPos);
+        leaves.erase(leaves.begin() + nPos);
+        nDirtyFrom = std::min(nDirtyFrom, nPos);
+        fResized = true;
+    }
+    for (const auto& p : vecAdded) {
+        auto it = std::lower_bound(proTxHashes.begin(), proTxHashes.end(), p.first);
+        if (it != proTxHashes.end() && *it == p.first) {
+            throw std::runtime_error(strprintf("%s: duplicate masternode %s", __func__, p.first.ToString()));
+        }
+        const size_t nPos = it - proTxHashes.begin();
+        proTxHashes.insert(it, p.first);
+        leaves.insert(leaves.begin() + nPos, p.second);
+        nDirtyFrom = std::min(nDirtyFrom, nPos);
+        fResized = true;
+    }
+
+    std::set<size_t> setDirty;
+    for (const auto& p : vecUpdated) {
+        const size_t nPos = FindLeaf(p.first);
+        // most state changes (e.g. PoSe penalties) don't affect the simplified entry
+        if (leaves[nPos] != p.second) {
+            leaves[nPos] = p.second;
+            if (nPos < nDirtyFrom) {
+                setDirty.emplace(nPos);
+            }
+        }
+    }
+
+    if (fResized || !setDirty.empty()) {
+        Rehash(std::min(nDirtyFrom, leaves.size()), std::move(setDirty));
+    }
+}
+
+uint256 CSimplifiedMNListMerkleTree::GetMerkleRoot(bool* pmutated) const
+{
+    if (pmutated) {
+        *pmutated = nMutatedPairs != 0;
+    }
+    if (levels.back().empty()) {
+        return uint256();
+    }
+    return levels.back()[0];
+}
+
 CSimplifiedMNListDiff::CSimplifiedMNListDiff() = default;
 
 CSimplifiedMNListDiff::~CSimplifiedMNListDiff() = default;
@@ -10,9 +10,13 @@
 #include <netaddress.h>
 #include <pubkey.h>
 
+#include <set>
+#include <vector>
+
 class UniValue;
 class CBlockIndex;
 class CDeterministicMNList;
+class CDeterministicMNListDiff;
 class CDeterministicMN;
 
 namespace llmq
@@ -79,6 +83,49 @@ public:
     bool operator==(const CSimplifiedMNList& rhs) const;
 };
 
+/**
+ * Merkle tree over the simplified MN list entries of a deterministic MN list, keyed by proRegTxHash.
+ * All levels of the tree are kept, so applying the changes between two lists only rehashes the changed
+ * leaves and their paths to the root. Added and removed entries shift the leaves right of them, which
+ * rehashes the inner nodes above these, but not the shifted leaves themselves.
+ * Root and mutation flag are the same as CSimplifiedMNList::CalcMerkleRoot returns for the list.
+ */
+class CSimplifiedMNListMerkleTree
+{
+private:
+    // sorted, proTxHashes[i] belongs to levels[0][i]
+    std::vector<uint256> proTxHashes;
+    // levels[0] are the leaves, levels.back() holds the root
+    std::vector<std::vector<uint256>> levels{{}};
+    // mutatedPairs[k][i] is set if both children of levels[k][i] are identical, see ComputeMerkleRoot
+    std::vector<std::vector<bool>> mutatedPairs{{}};
+    size_t nMutatedPairs{0};
+
+    void Init(const std::vector<std::pair<uint256, uint256>>& entries);
+    size_t FindLeaf(const uint256& proTxHash) const;
+    void HashParent(size_t nLevel, size_t nIndex);
+    void Rehash(size_t nDirtyFrom, std::set<size_t> setDirty);
+
+public:
+    CSimplifiedMNListMerkleTree() = default;
+    explicit CSimplifiedMNListMerkleTree(const CDeterministicMNList& dmnList);
+    // entries are pairs of proRegTxHash and leaf hash, sorted by proRegTxHash
+    explicit CSimplifiedMNListMerkleTree(const std::vector<std::pair<uint256, uint256>>& entries);
+
+    // Updates the tree from representing the "from" list to representing the "to" list
+    void ApplyDiff(const CDeterministicMNList& from, const CDeterministicMNList& to);
+    // Same with the diff between the lists at hand, e.g. the one stored for a block
+    void ApplyDiff(const CDeterministicMNList& from, const CDeterministicMNList& to, const CDeterministicMNListDiff& diff);
+    // Updates the tree from representing the list "from" with diff applied back to representing "from"
+    void RevertDiff(const CDeterministicMNList& from, const CDeterministicMNListDiff& diff);
+    // Removes, adds and updates leaves, given as proRegTxHash and pairs of proRegTxHash and leaf hash
+    void ApplyChanges(const std::vector<uint256>& vecRemoved, const std::vector<std::pair<uint256, uint256>>& vecAdded,
+                      const std::vector<std::pair<uint256, uint256>>& vecUpdated);
+
+    size_t size() const { return proTxHashes.size(); }
+    uint256 GetMerkleRoot(bool* pmutated = nullptr) const;
+};
+
 /// P2P messages
 
 class CGetSimplifiedMNListDiff
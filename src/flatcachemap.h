@@ -0,0 +1,477 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_FLATCACHEMAP_H
+#define BITCOIN_FLATCACHEMAP_H
+
+#include <cachemap.h>
+#include <memusage.h>
+#include <saltedhasher.h>
+#include <serialize.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <vector>
+
+/**
+ * Flat replacement for CacheMap (fMulti = false) and CacheMultiMap (fMulti = true).
+ *
+ * All items live in a single vector and are linked by index in insertion order, most
+ * recent first, like the item list of CacheMap. Keys are found through an open-addressing
+ * table of item indexes with linear probing, so there is no allocation per item and a
+ * lookup touches one or two cache lines instead of a chain of tree nodes.
+ *
+ * With fMulti, the table references one item per key and the other items of that key are
+ * chained from it. Checking for a duplicate value walks that chain.
+ *
+ * The serialization format is the one of CacheMap and CacheMultiMap.
+ */
+template<typename K, typename V, typename Hash, typename Size, bool fMulti>
+class FlatCacheMapImpl
+{
+public:
+    using size_type = Size;
+
+    using item_t = CacheItem<K,V>;
+
+private:
+    static constexpr Size NIL = std::numeric_limits<Size>::max();
+
+    static constexpr size_t MIN_TABLE_SIZE = 16;
+
+    struct Entry
+    {
+        // Empty while the entry is on the free list. Values like CGovernanceVote
+        // can't be assigned, so a reused entry gets its item constructed in place.
+        std::optional<item_t> item;
+        uint32_t nHash;
+        // Insertion order list, the free list is chained through next
+        Size prev;
+        Size next;
+        // Other items with the same key, only used with fMulti
+        Size prevSameKey;
+        Size nextSameKey;
+    };
+
+    size_type nMaxSize;
+
+    std::vector<Entry> vEntries;
+
+    // Power of two sized, NIL for empty slots
+    std::vector<Size> vTable;
+
+    Size nSize{0};
+    Size nKeys{0};
+    Size nHead{NIL};
+    Size nTail{NIL};
+    Size nFree{NIL};
+
+    Hash hasher;
+
+public:
+    /** Iterates the items from the most to the least recently added one */
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = item_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const item_t*;
+        using reference = const item_t&;
+
+        const_iterator(const std::vector<Entry>* pEntriesIn, Size nIn) : pEntries(pEntriesIn), n(nIn) {}
+
+        reference operator*() const { return *(*pEntries)[n].item; }
+        pointer operator->() const { return &*(*pEntries)[n].item; }
+        const_iterator& operator++() { n = (*pEntries)[n].next; return *this; }
+        const_iterator operator++(int) { const_iterator it(*this); ++*this; return it; }
+        bool operator==(const const_iterator& other) const { return n == other.n; }
+        bool operator!=(const const_iterator& other) const { return n != other.n; }
+
+    private:
+        const std::vector<Entry>* pEntries;
+        Size n;
+    };
+
+    explicit FlatCacheMapImpl(size_type nMaxSizeIn = 0)
+        : nMaxSize(nMaxSizeIn)
+    {}
+
+    void Clear()
+    {
+        std::vector<Entry>().swap(vEntries);
+        std::vector<Size>().swap(vTable);
+        nSize = 0;
+        nKeys = 0;
+        nHead = nTail = nFree = NIL;
+    }
+
+    void SetMaxSize(size_type nMaxSizeIn)
+    {
+        nMaxSize = nMaxSizeIn;
+    }
+
+    size_type GetMaxSize() const {
+        return nMaxSize;
+    }
+
+    size_type GetSize() const {
+        return nSize;
+    }
+
+    bool Insert(const K& key, const V& value)
+    {
+        const uint32_t nHash = HashKey(key);
+        Size nSlot = FindSlot(key, nHash);
+        if (nSlot != NIL) {
+            if (!fMulti) {
+                return false;
+            }
+            for (Size n = vTable[nSlot]; n != NIL; n = vEntries[n].nextSameKey) {
+                if (vEntries[n].item->value == value) {
+                    // Don't insert duplicates
+                    return false;
+                }
+            }
+        }
+        if (nSize == nMaxSize) {
+            PruneLast();
+            // Pruning may have removed the key or shifted it to another slot
+            nSlot = FindSlot(key, nHash);
+        }
+
+        const Size n = AllocEntry(key, value, nHash);
+        AddToKey(n, nSlot);
+        LinkFront(n);
+        return true;
+    }
+
+    bool HasKey(const K& key) const
+    {
+        return FindSlot(key, HashKey(key)) != NIL;
+    }
+
+    /** With fMulti, returns the smallest value of the key, like CacheMultiMap */
+    bool Get(const K& key, V& value) const
+    {
+        const Size nSlot = FindSlot(key, HashKey(key));
+        if (nSlot == NIL) {
+            return false;
+        }
+        const V* pValue = &vEntries[vTable[nSlot]].item->value;
+        for (Size n = vEntries[vTable[nSlot]].nextSameKey; n != NIL; n = vEntries[n].nextSameKey) {
+            if (vEntries[n].item->value < *pValue) {
+                pValue = &vEntries[n].item->value;
+            }
+        }
+        value = *pValue;
+        return true;
+    }
+
+    /** Appends all values of the key, in ascending order like CacheMultiMap */
+    bool GetAll(const K& key, std::vector<V>& vecValues) const
+    {
+        const Size nSlot = FindSlot(key, HashKey(key));
+        if (nSlot == NIL) {
+            return false;
+        }
+        // Sort pointers, values may not be assignable
+        std::vector<const V*> vecSorted;
+        for (Size n = vTable[nSlot]; n != NIL; n = vEntries[n].nextSameKey) {
+            vecSorted.push_back(&vEntries[n].item->value);
+        }
+        std::sort(vecSorted.begin(), vecSorted.end(), [](const V* a, const V* b) { return *a < *b; });
+        for (const V* pValue : vecSorted) {
+            vecValues.push_back(*pValue);
+        }
+        return true;
+    }
+
+    void GetKeys(std::vector<K>& vecKeys) const
+    {
+        for (const Size n : vTable) {
+            if (n != NIL) {
+                vecKeys.push_back(vEntries[n].item->key);
+            }
+        }
+    }
+
+    void Erase(const K& key)
+    {
+        const Size nSlot = FindSlot(key, HashKey(key));
+        if (nSlot == NIL) {
+            return;
+        }
+        Size n = vTable[nSlot];
+        while (n != NIL) {
+            const Size nNext = vEntries[n].nextSameKey;
+            UnlinkEntry(n);
+            FreeEntry(n);
+            n = nNext;
+        }
+        EraseSlot(nSlot);
+    }
+
+    void Erase(const K& key, const V& value)
+    {
+        const Size nSlot = FindSlot(key, HashKey(key));
+        if (nSlot == NIL) {
+            return;
+        }
+        for (Size n = vTable[nSlot]; n != NIL; n = vEntries[n].nextSameKey) {
+            if (vEntries[n].item->value == value) {
+                EraseEntry(n, nSlot);
+                return;
+            }
+        }
+    }
+
+    const_iterator begin() const { return const_iterator(&vEntries, nHead); }
+    const_iterator end() const { return const_iterator(&vEntries, NIL); }
+
+    /** Memory held by the container itself, not counting heap memory owned by keys or values */
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(vEntries) + memusage::DynamicUsage(vTable);
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << nMaxSize;
+        WriteCompactSize(s, nSize);
+        for (Size n = nHead; n != NIL; n = vEntries[n].next) {
+            s << *vEntries[n].item;
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        Clear();
+        s >> nMaxSize;
+        const uint64_t nCount = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nCount; ++i) {
+            item_t item;
+            s >> item;
+            // Items are stored from the most recent one, so each one goes to the back
+            const uint32_t nHash = HashKey(item.key);
+            const Size nSlot = FindSlot(item.key, nHash);
+            if (nSlot != NIL && (!fMulti || HasValue(nSlot, item.value))) {
+                continue;
+            }
+            const Size n = AllocEntry(item.key, item.value, nHash);
+            AddToKey(n, nSlot);
+            LinkBack(n);
+        }
+    }
+
+private:
+    uint32_t HashKey(const K& key) const
+    {
+        return static_cast<uint32_t>(hasher(key));
+    }
+
+    Size FindSlot(const K& key, uint32_t nHash) const
+    {
+        if (vTable.empty()) {
+            return NIL;
+        }
+        const size_t nMask = vTable.size() - 1;
+        for (size_t i = nHash & nMask; vTable[i] != NIL; i = (i + 1) & nMask) {
+            const Entry& entry = vEntries[vTable[i]];
+            if (entry.nHash == nHash && entry.item->key == key) {
+                return static_cast<Size>(i);
+            }
+        }
+        return NIL;
+    }
+
+    bool HasValue(Size nSlot, const V& value) const
+    {
+        for (Size n = vTable[nSlot]; n != NIL; n = vEntries[n].nextSameKey) {
+            if (vEntries[n].item->value == value) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Makes n the item referenced by the table for its key, chaining the items the key
+     * already has at nSlot after it. Must run before n is linked in insertion order,
+     * a rehash places every linked item.
+     */
+    void AddToKey(Size n, Size nSlot)
+    {
+        if (nSlot == NIL) {
+            InsertSlot(n);
+        } else {
+            vEntries[n].nextSameKey = vTable[nSlot];
+            vEntries[vTable[nSlot]].prevSameKey = n;
+            vTable[nSlot] = n;
+        }
+    }
+
+    void InsertSlot(Size n)
+    {
+        if ((static_cast<size_t>(nKeys) + 1) * 2 > vTable.size()) {
+            Rehash(std::max(MIN_TABLE_SIZE, vTable.size() * 2));
+        }
+        PlaceInTable(n);
+        ++nKeys;
+    }
+
+    void PlaceInTable(Size n)
+    {
+        const size_t nMask = vTable.size() - 1;
+        size_t i = vEntries[n].nHash & nMask;
+        while (vTable[i] != NIL) {
+            i = (i + 1) & nMask;
+        }
+        vTable[i] = n;
+    }
+
+    void Rehash(size_t nTableSize)
+    {
+        vTable.assign(nTableSize, NIL);
+        for (Size n = nHead; n != NIL; n = vEntries[n].next) {
+            if (vEntries[n].prevSameKey == NIL) {
+                PlaceInTable(n);
+            }
+        }
+    }
+
+    /** Backward shift deletion, keeps every probe sequence free of holes without tombstones */
+    void EraseSlot(Size nSlot)
+    {
+        const size_t nMask = vTable.size() - 1;
+        size_t i = nSlot;
+        size_t j = i;
+        while (true) {
+            j = (j + 1) & nMask;
+            if (vTable[j] == NIL) {
+                break;
+            }
+            const size_t nHome = vEntries[vTable[j]].nHash & nMask;
+            // Leave the entry at j alone if its home slot lies cyclically in (i, j]
+            if (i <= j ? (i < nHome && nHome <= j) : (i < nHome || nHome <= j)) {
+                continue;
+            }
+            vTable[i] = vTable[j];
+            i = j;
+        }
+        vTable[i] = NIL;
+        --nKeys;
+    }
+
+    /** Removes entry n of the key found at nSlot */
+    void EraseEntry(Size n, Size nSlot)
+    {
+        Entry& entry = vEntries[n];
+        if (entry.nextSameKey != NIL) {
+            vEntries[entry.nextSameKey].prevSameKey = entry.prevSameKey;
+        }
+        if (entry.prevSameKey != NIL) {
+            vEntries[entry.prevSameKey].nextSameKey = entry.nextSameKey;
+        } else if (entry.nextSameKey != NIL) {
+            vTable[nSlot] = entry.nextSameKey;
+        } else {
+            EraseSlot(nSlot);
+        }
+        UnlinkEntry(n);
+        FreeEntry(n);
+    }
+
+    void PruneLast()
+    {
+        if (nTail == NIL) {
+            return;
+        }
+        const Entry& entry = vEntries[nTail];
+        EraseEntry(nTail, FindSlot(entry.item->key, entry.nHash));
+    }
+
+    Size AllocEntry(const K& key, const V& value, uint32_t nHash)
+    {
+        Size n;
+        if (nFree != NIL) {
+            n = nFree;
+            nFree = vEntries[n].next;
+            vEntries[n].item.emplace(key, value);
+        } else {
+            n = static_cast<Size>(vEntries.size());
+            vEntries.push_back(Entry{item_t(key, value), 0, NIL, NIL, NIL, NIL});
+        }
+        Entry& entry = vEntries[n];
+        entry.nHash = nHash;
+        entry.prev = entry.next = NIL;
+        entry.prevSameKey = entry.nextSameKey = NIL;
+        ++nSize;
+        return n;
+    }
+
+    void FreeEntry(Size n)
+    {
+        // Release whatever memory the key and value own
+        vEntries[n].item.reset();
+        vEntries[n].next = nFree;
+        nFree = n;
+        --nSize;
+    }
+
+    void LinkFront(Size n)
+    {
+        vEntries[n].next = nHead;
+        if (nHead != NIL) {
+            vEntries[nHead].prev = n;
+        } else {
+            nTail = n;
+        }
+        nHead = n;
+    }
+
+    void LinkBack(Size n)
+    {
+        vEntries[n].prev = nTail;
+        if (nTail != NIL) {
+            vEntries[nTail].next = n;
+        } else {
+            nHead = n;
+        }
+        nTail = n;
+    }
+
+    void UnlinkEntry(Size n)
+    {
+        Entry& entry = vEntries[n];
+        if (entry.prev != NIL) {
+            vEntries[entry.prev].next = entry.next;
+        } else {
+            nHead = entry.next;
+        }
+        if (entry.next != NIL) {
+            vEntries[entry.next].prev = entry.prev;
+        } else {
+            nTail = entry.prev;
+        }
+    }
+};
+
+/**
+ * Map like container that keeps the N most recently added items
+ */
+template<typename K, typename V, typename Hash = StaticSaltedHasher, typename Size = uint32_t>
+using FlatCacheMap = FlatCacheMapImpl<K, V, Hash, Size, false>;
+
+/**
+ * Multimap like container that keeps the N most recently added items
+ */
+template<typename K, typename V, typename Hash = StaticSaltedHasher, typename Size = uint32_t>
+using FlatCacheMultiMap = FlatCacheMapImpl<K, V, Hash, Size, true>;
+
+#endif // BITCOIN_FLATCACHEMAP_H
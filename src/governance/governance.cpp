@@ -9,7 +9,9 @@
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <evo/deterministicmns.h>
+#include <bls/bls_batchverifier.h>
 #include <governance/classes.h>
+#include <governance/governancedb.h>
 #include <governance/validators.h>
 #include <masternode/meta.h>
 #include <masternode/sync.h>
@@ -24,7 +26,7 @@ CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-16";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-17";
 const int CGovernanceManager::MAX_TIME_FUTURE_DEVIATION = 60 * 60;
 const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
 
@@ -44,6 +46,22 @@ CGovernanceManager::CGovernanceManager() :
 {
 }
 
+CGovernanceManager::~CGovernanceManager() = default;
+
+void CGovernanceManager::InitDb(bool fMemory, bool fWipe)
+{
+    LOCK(cs);
+    db = std::make_unique<CGovernanceDb>(fMemory, fWipe);
+}
+
+void CGovernanceManager::DestroyDb()
+{
+    LOCK(cs);
+    // Objects changed since the last write would be lost otherwise
+    WriteChangedObjects();
+    db.reset();
+}
+
 // Accessors for thread-safe access to maps
 bool CGovernanceManager::HaveObjectForHash(const uint256& nHash) const
 {
@@ -64,12 +82,31 @@ bool CGovernanceManager::SerializeObjectForHash(const uint256& nHash, CDataStrea
     return true;
 }
 
+const CGovernanceObject* CGovernanceManager::FindVoteObject(const uint256& nVoteHash) const
+{
+    AssertLockHeld(cs);
+
+    CGovernanceObject* pGovobj = nullptr;
+    if (cmapVoteToObject.Get(nVoteHash, pGovobj)) {
+        return pGovobj;
+    }
+    // votes of objects loaded on startup are only indexed in the database
+    uint256 nObjectHash;
+    if (db && db->GetVoteObjectHash(nVoteHash, nObjectHash)) {
+        auto it = mapObjects.find(nObjectHash);
+        if (it != mapObjects.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
 bool CGovernanceManager::HaveVoteForHash(const uint256& nHash) const
 {
     LOCK(cs);
 
-    CGovernanceObject* pGovobj = nullptr;
-    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().HasVote(nHash);
+    const CGovernanceObject* pGovobj = FindVoteObject(nHash);
+    return pGovobj && pGovobj->GetVoteFile().HasVote(nHash);
 }
 
 int CGovernanceManager::GetVoteCount() const
@@ -82,8 +119,8 @@ bool CGovernanceManager::SerializeVoteForHash(const uint256& nHash, CDataStream&
 {
     LOCK(cs);
 
-    CGovernanceObject* pGovobj = nullptr;
-    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().SerializeVoteToStream(nHash, ss);
+    const CGovernanceObject* pGovobj = FindVoteObject(nHash);
+    return pGovobj && pGovobj->GetVoteFile().SerializeVoteToStream(nHash, ss);
 }
 
 void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman, bool enable_bip61)
@@ -212,20 +249,185 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
             return;
         }
 
-        CGovernanceException exception;
-        if (ProcessVote(pfrom, vote, exception, connman)) {
-            LogPrint(BCLog::GOBJECT, "MNGOVERNANCEOBJECTVOTE -- %s new\n", strHash);
-            masternodeSync.BumpAssetLastTime("MNGOVERNANCEOBJECTVOTE");
-            vote.Relay(connman);
-        } else {
-            LogPrint(BCLog::GOBJECT, "MNGOVERNANCEOBJECTVOTE -- Rejected vote, error = %s\n", exception.what());
-            if ((exception.GetNodePenalty() != 0) && masternodeSync.IsSynced()) {
+        if (QueuePendingVote(pfrom->GetId(), vote)) {
+            // verified in a batch by ProcessPendingVotes
+            return;
+        }
+        ProcessPeerVote(pfrom, pfrom->GetId(), vote, connman, false);
+    }
+}
+
+void CGovernanceManager::ProcessPeerVote(CNode* pfrom, NodeId nodeId, const CGovernanceVote& vote, CConnman& connman, bool fSignatureChecked)
+{
+    CGovernanceException exception;
+    if (ProcessVote(pfrom, vote, exception, connman, fSignatureChecked)) {
+        LogPrint(BCLog::GOBJECT, "MNGOVERNANCEOBJECTVOTE -- %s new\n", vote.GetHash().ToString());
+        masternodeSync.BumpAssetLastTime("MNGOVERNANCEOBJECTVOTE");
+        vote.Relay(connman);
+    } else {
+        LogPrint(BCLog::GOBJECT, "MNGOVERNANCEOBJECTVOTE -- Rejected vote, error = %s\n", exception.what());
+        if ((exception.GetNodePenalty() != 0) && masternodeSync.IsSynced()) {
+            LOCK(cs_main);
+            Misbehaving(nodeId, exception.GetNodePenalty());
+        }
+    }
+}
+
+bool CGovernanceManager::QueuePendingVote(NodeId nodeId, const CGovernanceVote& vote)
+{
+    {
+        LOCK(cs);
+        const uint256 nHash = vote.GetHash();
+        // known, invalid and orphan votes are rejected or stored without checking the signature
+        if (cmapVoteToObject.HasKey(nHash) || cmapInvalidVotes.HasKey(nHash)) {
+            return false;
+        }
+        auto it = mapObjects.find(vote.GetParentHash());
+        if (it == mapObjects.end()) {
+            return false;
+        }
+        // funding votes on proposals are signed with the ECDSA voting key
+        if (it->second.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING) {
+            return false;
+        }
+    }
+
+    LOCK(cs_pendingVotes);
+    if (vecPendingVotes.size() >= MAX_PENDING_VOTES) {
+        return false;
+    }
+    vecPendingVotes.emplace_back(nodeId, vote);
+    return true;
+}
+
+std::set<uint256> CGovernanceManager::VerifyVoteSignatures(const std::vector<vote_sig_check_t>& vecChecks, std::set<NodeId>& setBadSourcesRet)
+{
+    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, VOTE_VERIFY_BATCH_SIZE);
+    std::set<uint256> setBadVotes;
+
+    for (const auto& check : vecChecks) {
+        const uint256 nHash = check.pVote->GetHash();
+        CBLSSignature sig(check.pVote->GetSignature());
+        if (!sig.IsValid() || !check.pubKey.IsValid()) {
+            setBadVotes.emplace(nHash);
+            setBadSourcesRet.emplace(check.nodeId);
+            continue;
+        }
+        batchVerifier.PushMessage(check.nodeId, nHash, check.pVote->GetSignatureHash(), sig, check.pubKey);
+    }
+    batchVerifier.Verify();
+
+    setBadVotes.insert(batchVerifier.badMessages.begin(), batchVerifier.badMessages.end());
+    setBadSourcesRet.insert(batchVerifier.badSources.begin(), batchVerifier.badSources.end());
+
+    // votes are stored and relayed as checked, a passing aggregate is not enough for that
+    for (const auto& check : vecChecks) {
+        const uint256 nHash = check.pVote->GetHash();
+        if (setBadVotes.count(nHash)) {
+            continue;
+        }
+        CBLSSignature sig(check.pVote->GetSignature());
+        if (!sig.VerifyInsecure(check.pubKey, check.pVote->GetSignatureHash())) {
+            setBadVotes.emplace(nHash);
+            setBadSourcesRet.emplace(check.nodeId);
+        }
+    }
+    return setBadVotes;
+}
+
+void CGovernanceManager::StartWorkerThread(CConnman& connman)
+{
+    // can't start new thread if we have one running already
+    if (workThread.joinable()) {
+        assert(false);
+    }
+
+    workInterrupt.reset();
+    workThread = std::thread(&TraceThread<std::function<void()> >, "govvotes", std::function<void()>(std::bind(&CGovernanceManager::WorkThreadMain, this, std::ref(connman))));
+}
+
+void CGovernanceManager::StopWorkerThread()
+{
+    // make sure to call InterruptWorkerThread() first
+    if (workThread.joinable()) {
+        assert(workInterrupt);
+        workThread.join();
+    }
+}
+
+void CGovernanceManager::WorkThreadMain(CConnman& connman)
+{
+    while (!workInterrupt) {
+        bool fMoreWork = ProcessPendingVotes(connman);
+
+        if (!fMoreWork && !workInterrupt.sleep_for(std::chrono::milliseconds(100))) {
+            return;
+        }
+    }
+}
+
+bool CGovernanceManager::ProcessPendingVotes(CConnman& connman)
+{
+    std::vector<std::pair<NodeId, CGovernanceVote>> vecVotes;
+    bool fMoreWork;
+    {
+        LOCK(cs_pendingVotes);
+        vecVotes.swap(vecPendingVotes);
+        // votes are not assignable, the ones beyond this pass are moved back in order
+        for (size_t i = MAX_VOTES_PER_PASS; i < vecVotes.size(); ++i) {
+            vecPendingVotes.emplace_back(std::move(vecVotes[i]));
+        }
+        while (vecVotes.size() > MAX_VOTES_PER_PASS) {
+            vecVotes.pop_back();
+        }
+        fMoreWork = !vecPendingVotes.empty();
+    }
+    if (vecVotes.empty()) {
+        return fMoreWork;
+    }
+
+    // Votes from unknown masternodes take the regular path, which rejects them
+    auto mnList = deterministicMNManager->GetListAtChainTip();
+    std::vector<vote_sig_check_t> vecChecks;
+    std::vector<const std::pair<NodeId, CGovernanceVote>*> vecUnchecked;
+    vecChecks.reserve(vecVotes.size());
+    for (const auto& p : vecVotes) {
+        auto dmn = mnList.GetMNByCollateral(p.second.GetMasternodeOutpoint());
+        if (!dmn) {
+            vecUnchecked.push_back(&p);
+            continue;
+        }
+        vecChecks.push_back(vote_sig_check_t{p.first, &p.second, dmn->pdmnState->pubKeyOperator.Get()});
+    }
+
+    int64_t nStart = GetTimeMicros();
+    std::set<NodeId> setBadSources;
+    const std::set<uint256> setBadVotes = VerifyVoteSignatures(vecChecks, setBadSources);
+    LogPrint(BCLog::GOBJECT, "CGovernanceManager::%s -- verified %d votes from %d peers in %dus, %d bad\n", __func__,
+        vecChecks.size(), setBadSources.size(), GetTimeMicros() - nStart, setBadVotes.size());
+
+    // The operator key may have changed while the batch was verified, such votes are checked again on their own
+    auto mnListNow = deterministicMNManager->GetListAtChainTip();
+    for (const auto& check : vecChecks) {
+        const CGovernanceVote& vote = *check.pVote;
+        if (setBadVotes.count(vote.GetHash())) {
+            LogPrintf("CGovernanceManager::%s -- Invalid vote signature, MN outpoint = %s, governance object hash = %s, vote hash = %s, peer=%d\n", __func__,
+                vote.GetMasternodeOutpoint().ToStringShort(), vote.GetParentHash().ToString(), vote.GetHash().ToString(), check.nodeId);
+            WITH_LOCK(cs, AddInvalidVote(vote));
+            if (masternodeSync.IsSynced()) {
                 LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), exception.GetNodePenalty());
+                Misbehaving(check.nodeId, 20);
             }
-            return;
+            continue;
         }
+        auto dmn = mnListNow.GetMNByCollateral(vote.GetMasternodeOutpoint());
+        const bool fKeyUnchanged = dmn && dmn->pdmnState->pubKeyOperator.Get() == check.pubKey;
+        ProcessPeerVote(nullptr, check.nodeId, vote, connman, fKeyUnchanged);
+    }
+    for (const auto* p : vecUnchecked) {
+        ProcessPeerVote(nullptr, p->first, p->second, connman, false);
     }
+    return fMoreWork;
 }
 
 void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CConnman& connman)
@@ -289,11 +491,15 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
     LogPrint(BCLog::GOBJECT, "CGovernanceManager::AddGovernanceObject -- Before trigger block, GetDataAsPlainString = %s, nObjectType = %d\n",
                 govobj.GetDataAsPlainString(), govobj.GetObjectType());
 
+    CGovernanceObject& govobjStored = objpair.first->second;
+
     if (govobj.GetObjectType() == GOVERNANCE_OBJECT_TRIGGER && !triggerman.AddNewTrigger(nHash)) {
         LogPrint(BCLog::GOBJECT, "CGovernanceManager::AddGovernanceObject -- undo adding invalid trigger object: hash = %s\n", nHash.ToString());
-        objpair.first->second.PrepareDeletion(GetAdjustedTime());
+        govobjStored.PrepareDeletion(GetAdjustedTime());
+        WriteObject(govobjStored);
         return;
     }
+    WriteObject(govobjStored);
 
     LogPrint(BCLog::GOBJECT, "CGovernanceManager::AddGovernanceObject -- %s new, received from peer %s\n", strHash, pfrom ? pfrom->GetLogString() : "nullptr");
     govobj.Relay(connman);
@@ -305,7 +511,7 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
 
     // WE MIGHT HAVE PENDING/ORPHAN VOTES FOR THIS OBJECT
 
-    CheckOrphanVotes(govobj, connman);
+    CheckOrphanVotes(govobjStored, connman);
 
     // SEND NOTIFICATION TO SCRIPT/ZMQ
     GetMainSignals().NotifyGovernanceObject(std::make_shared<const CGovernanceObject>(govobj));
@@ -374,9 +580,8 @@ void CGovernanceManager::UpdateCachesAndClean()
             mmetaman.RemoveGovernanceObject(pObj->GetHash());
 
             // Remove vote references
-            const object_ref_cm_t::list_t& listItems = cmapVoteToObject.GetItemList();
-            auto lit = listItems.begin();
-            while (lit != listItems.end()) {
+            auto lit = cmapVoteToObject.begin();
+            while (lit != cmapVoteToObject.end()) {
                 if (lit->value == pObj) {
                     uint256 nKey = lit->key;
                     ++lit;
@@ -397,6 +602,9 @@ void CGovernanceManager::UpdateCachesAndClean()
             }
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+            if (db) {
+                db->EraseObject(nHash);
+            }
             mapObjects.erase(it++);
         } else {
             // NOTE: triggers are handled via triggerman
@@ -412,6 +620,8 @@ void CGovernanceManager::UpdateCachesAndClean()
         }
     }
 
+    WriteChangedObjects();
+
     // forget about expired deleted objects
     auto s_it = mapErasedGovernanceObjects.begin();
     while (s_it != mapErasedGovernanceObjects.end()) {
@@ -779,7 +989,7 @@ bool CGovernanceManager::MasternodeRateCheck(const CGovernanceObject& govobj, bo
     return false;
 }
 
-bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman)
+bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureChecked)
 {
     ENTER_CRITICAL_SECTION(cs)
     uint256 nHashVote = vote.GetHash();
@@ -828,7 +1038,7 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
         return false;
     }
 
-    bool fOk = govobj.ProcessVote(vote, exception) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    bool fOk = govobj.ProcessVote(vote, exception, fSignatureChecked) && cmapVoteToObject.Insert(nHashVote, &govobj);
     LEAVE_CRITICAL_SECTION(cs)
     return fOk;
 }
@@ -1064,18 +1274,50 @@ bool CGovernanceManager::AcceptMessage(const uint256& nHash, hash_s_t& setHash)
     return true;
 }
 
-void CGovernanceManager::RebuildIndexes()
+void CGovernanceManager::LoadObjects()
 {
     LOCK(cs);
 
+    // Votes stay on disk until their object needs them, FindVoteObject() looks them up there
     cmapVoteToObject.Clear();
-    for (auto& objPair : mapObjects) {
-        CGovernanceObject& govobj = objPair.second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for (const auto& vecVote : vecVotes) {
-            cmapVoteToObject.Insert(vecVote.GetHash(), &govobj);
+    mapObjects.clear();
+    if (db) {
+        db->LoadObjects(mapObjects);
+    }
+}
+
+void CGovernanceManager::WriteObject(CGovernanceObject& govobj)
+{
+    AssertLockHeld(cs);
+    if (!db) {
+        return;
+    }
+
+    if (db->WriteObjects({&govobj})) {
+        govobj.ClearDirtyDb();
+    }
+}
+
+void CGovernanceManager::WriteChangedObjects()
+{
+    AssertLockHeld(cs);
+    if (!db) {
+        return;
+    }
+
+    std::vector<const CGovernanceObject*> vecChanged;
+    for (auto& objpair : mapObjects) {
+        if (objpair.second.IsSetDirtyDb()) {
+            vecChanged.push_back(&objpair.second);
         }
     }
+    // Objects that could not be written stay dirty and are retried on the next call
+    if (vecChanged.empty() || !db->WriteObjects(vecChanged)) {
+        return;
+    }
+    for (auto& objpair : mapObjects) {
+        objpair.second.ClearDirtyDb();
+    }
 }
 
 void CGovernanceManager::AddCachedTriggers()
@@ -1101,10 +1343,11 @@ void CGovernanceManager::InitOnLoad()
     // CSuperblock::ParsePaymentSchedule() once DIP0024 is active
     LOCK2(cs_main, cs);
     int64_t nStart = GetTimeMillis();
-    LogPrintf("Preparing masternode indexes and governance triggers...\n");
-    RebuildIndexes();
+    LogPrintf("Loading governance objects and preparing governance triggers...\n");
+    LoadObjects();
     AddCachedTriggers();
-    LogPrintf("Masternode indexes and governance triggers prepared  %dms\n", GetTimeMillis() - nStart);
+    WriteChangedObjects();
+    LogPrintf("Governance objects loaded and triggers prepared  %dms\n", GetTimeMillis() - nStart);
     LogPrintf("     %s\n", ToString());
 }
 
@@ -1223,12 +1466,10 @@ void CGovernanceManager::RequestOrphanObjects(CConnman& connman)
 void CGovernanceManager::CleanOrphanObjects()
 {
     LOCK(cs);
-    const vote_cmm_t::list_t& items = cmmapOrphanVotes.GetItemList();
-
     int64_t nNow = GetAdjustedTime();
 
-    auto it = items.begin();
-    while (it != items.end()) {
+    auto it = cmmapOrphanVotes.begin();
+    while (it != cmmapOrphanVotes.end()) {
         auto prevIt = it;
         ++it;
         const vote_time_pair_t& pairVote = prevIt->value;
@@ -5,12 +5,17 @@
 #ifndef BITCOIN_GOVERNANCE_GOVERNANCE_H
 #define BITCOIN_GOVERNANCE_GOVERNANCE_H
 
-#include <cachemap.h>
-#include <cachemultimap.h>
+#include <bls/bls.h>
+#include <flatcachemap.h>
 #include <governance/object.h>
+#include <threadinterrupt.h>
+
+#include <memory>
+#include <thread>
 
 class CBloomFilter;
 class CBlockIndex;
+class CGovernanceDb;
 class CInv;
 
 class CGovernanceManager;
@@ -25,6 +30,8 @@ static constexpr int RATE_BUFFER_SIZE = 5;
 class CDeterministicMNList;
 using CDeterministicMNListPtr = std::shared_ptr<CDeterministicMNList>;
 
+using NodeId = int64_t;
+
 class CRateCheckBuffer
 {
 private:
@@ -145,17 +152,30 @@ public: // Types
     };
 
 
-    using object_ref_cm_t = CacheMap<uint256, CGovernanceObject*>;
+    using object_ref_cm_t = FlatCacheMap<uint256, CGovernanceObject*>;
 
-    using vote_cmm_t = CacheMultiMap<uint256, vote_time_pair_t>;
+    using vote_cmm_t = FlatCacheMultiMap<uint256, vote_time_pair_t>;
 
     using txout_m_t = std::map<COutPoint, last_object_rec>;
 
     using hash_s_t = std::set<uint256>;
 
+    struct vote_sig_check_t {
+        NodeId nodeId;
+        const CGovernanceVote* pVote;
+        CBLSPublicKey pubKey;
+    };
+
 private:
     static constexpr int MAX_CACHE_SIZE = 1000000;
 
+    // votes are rejected in batches of this size, only a bad batch is verified again per peer and per vote
+    static constexpr size_t VOTE_VERIFY_BATCH_SIZE = 32;
+    // votes beyond this are processed right away instead of waiting for ProcessPendingVotes
+    static constexpr size_t MAX_PENDING_VOTES = 10000;
+    // votes taken from the queue by one ProcessPendingVotes call, so an interrupt is seen in time
+    static constexpr size_t MAX_VOTES_PER_PASS = 1024;
+
     static const std::string SERIALIZATION_VERSION_STRING;
 
     static const int MAX_TIME_FUTURE_DEVIATION;
@@ -179,7 +199,7 @@ private:
 
     object_ref_cm_t cmapVoteToObject;
 
-    CacheMap<uint256, CGovernanceVote> cmapInvalidVotes;
+    FlatCacheMap<uint256, CGovernanceVote> cmapInvalidVotes;
 
     vote_cmm_t cmmapOrphanVotes;
 
@@ -194,6 +214,17 @@ private:
     // used to check for changed voting keys
     CDeterministicMNListPtr lastMNListForVotingKeys;
 
+    // objects and votes, mapObjects is loaded from it on startup and changes are written through
+    std::unique_ptr<CGovernanceDb> db;
+
+    // votes signed with operator keys, waiting for ProcessPendingVotes to verify them in batches
+    Mutex cs_pendingVotes;
+    std::vector<std::pair<NodeId, CGovernanceVote>> vecPendingVotes GUARDED_BY(cs_pendingVotes);
+
+    // verifies the pending votes off the scheduler thread
+    std::thread workThread;
+    CThreadInterrupt workInterrupt;
+
     class ScopedLockBool
     {
         bool& ref;
@@ -220,7 +251,14 @@ public:
 
     CGovernanceManager();
 
-    virtual ~CGovernanceManager() = default;
+    virtual ~CGovernanceManager();
+
+    void InitDb(bool fMemory, bool fWipe);
+    void DestroyDb();
+
+    void StartWorkerThread(CConnman& connman);
+    void StopWorkerThread();
+    void InterruptWorkerThread() { workInterrupt(); };
 
     /**
      * This is called by AlreadyHave in net_processing.cpp as part of the inventory
@@ -236,6 +274,20 @@ public:
 
     void DoMaintenance(CConnman& connman);
 
+    /**
+     * Verifies the signatures of up to MAX_VOTES_PER_PASS queued votes in batches and processes
+     * the valid ones. Returns true if more votes are waiting.
+     */
+    bool ProcessPendingVotes(CConnman& connman);
+
+    /**
+     * Verifies the operator key signatures of votes, votes from peers in setBadSourcesRet had bad signatures.
+     * Returns the hashes of the votes with bad signatures. CBLSBatchVerifier only rejects bad batches early,
+     * signatures which cancel each other out pass an aggregated check, so every vote of a good batch is
+     * verified on its own too.
+     */
+    static std::set<uint256> VerifyVoteSignatures(const std::vector<vote_sig_check_t>& vecChecks, std::set<NodeId>& setBadSourcesRet);
+
     CGovernanceObject* FindGovernanceObject(const uint256& nHash);
 
     // These commands are only used in RPC
@@ -272,7 +324,6 @@ public:
             << mapErasedGovernanceObjects
             << cmapInvalidVotes
             << cmmapOrphanVotes
-            << mapObjects
             << mapLastMasternodeObject
             << *lastMNListForVotingKeys;
     }
@@ -292,7 +343,6 @@ public:
         s   >> mapErasedGovernanceObjects
             >> cmapInvalidVotes
             >> cmmapOrphanVotes
-            >> mapObjects
             >> mapLastMasternodeObject
             >> *lastMNListForVotingKeys;
     }
@@ -356,7 +406,13 @@ private:
         cmapInvalidVotes.Insert(vote.GetHash(), vote);
     }
 
-    bool ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman);
+    bool ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureChecked = false);
+
+    /// Processes a vote received from a peer and relays it, pfrom can be null for queued votes
+    void ProcessPeerVote(CNode* pfrom, NodeId nodeId, const CGovernanceVote& vote, CConnman& connman, bool fSignatureChecked);
+
+    /// Queues votes which need an operator key signature check for ProcessPendingVotes
+    bool QueuePendingVote(NodeId nodeId, const CGovernanceVote& vote);
 
     /// Called to indicate a requested object has been received
     bool AcceptObjectMessage(const uint256& nHash);
@@ -368,7 +424,15 @@ private:
 
     void CheckOrphanVotes(CGovernanceObject& govobj, CConnman& connman);
 
-    void RebuildIndexes();
+    void WorkThreadMain(CConnman& connman);
+
+    void LoadObjects();
+
+    void WriteObject(CGovernanceObject& govobj);
+
+    void WriteChangedObjects();
+
+    const CGovernanceObject* FindVoteObject(const uint256& nVoteHash) const;
 
     void AddCachedTriggers();
 
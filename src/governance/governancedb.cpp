@@ -0,0 +1,151 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <governance/governancedb.h>
+
+#include <dbwrapper.h>
+#include <util/system.h>
+
+#include <tuple>
+#include <utility>
+
+static const std::string DB_OBJECT = "gov_o";
+static const std::string DB_MN_VOTES = "gov_mv";
+static const std::string DB_VOTE_OBJECT = "gov_vo";
+
+using mn_votes_t = std::pair<vote_rec_t, std::vector<CGovernanceVote>>;
+
+namespace {
+/** Serializes an object in the database format, its votes are stored separately */
+template <typename T>
+struct ObjectWithoutVotes {
+    T& obj;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        obj.SerializeWithoutVotes(s);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        obj.UnserializeWithoutVotes(s);
+    }
+};
+} // namespace
+
+CGovernanceDb::CGovernanceDb(bool fMemory, bool fWipe) :
+    db(std::make_unique<CDBWrapper>(fMemory ? "" : (GetDataDir() / "governance"), 8 << 20, fMemory, fWipe))
+{
+}
+
+CGovernanceDb::~CGovernanceDb() = default;
+
+bool CGovernanceDb::WriteObjects(const std::vector<const CGovernanceObject*>& vecObjects)
+{
+    CDBBatch batch(*db);
+    for (const CGovernanceObject* pObj : vecObjects) {
+        batch.Write(std::make_pair(DB_OBJECT, pObj->GetHash()), ObjectWithoutVotes<const CGovernanceObject>{*pObj});
+    }
+    if (!db->WriteBatch(batch)) {
+        LogPrintf("CGovernanceDb::%s -- failed to write %d objects\n", __func__, vecObjects.size());
+        return false;
+    }
+    return true;
+}
+
+bool CGovernanceDb::EraseObject(const uint256& nObjectHash)
+{
+    CDBBatch batch(*db);
+    batch.Erase(std::make_pair(DB_OBJECT, nObjectHash));
+
+    std::unique_ptr<CDBIterator> it(db->NewIterator());
+    it->Seek(std::make_pair(DB_MN_VOTES, nObjectHash));
+    std::tuple<std::string, uint256, COutPoint> curKey;
+    while (it->Valid() && it->GetKey(curKey) && std::get<0>(curKey) == DB_MN_VOTES && std::get<1>(curKey) == nObjectHash) {
+        EraseMasternodeVotes(batch, nObjectHash, std::get<2>(curKey));
+        it->Next();
+    }
+    if (!db->WriteBatch(batch)) {
+        LogPrintf("CGovernanceDb::%s -- failed to erase object %s\n", __func__, nObjectHash.ToString());
+        return false;
+    }
+    return true;
+}
+
+void CGovernanceDb::LoadObjects(std::map<uint256, CGovernanceObject>& mapObjects) const
+{
+    std::unique_ptr<CDBIterator> it(db->NewIterator());
+    it->Seek(std::make_pair(DB_OBJECT, uint256()));
+    std::pair<std::string, uint256> curKey;
+    while (it->Valid() && it->GetKey(curKey) && curKey.first == DB_OBJECT) {
+        ObjectWithoutVotes<CGovernanceObject> obj{mapObjects[curKey.second]};
+        if (!it->GetValue(obj)) {
+            LogPrintf("CGovernanceDb::%s -- failed to read object %s\n", __func__, curKey.second.ToString());
+            mapObjects.erase(curKey.second);
+        }
+        it->Next();
+    }
+}
+
+void CGovernanceDb::EraseMasternodeVotes(CDBBatch& batch, const uint256& nObjectHash, const COutPoint& outpoint)
+{
+    const auto key = std::make_tuple(DB_MN_VOTES, nObjectHash, outpoint);
+    mn_votes_t mnVotes;
+    if (!db->Read(key, mnVotes)) {
+        return;
+    }
+    for (const auto& vote : mnVotes.second) {
+        batch.Erase(std::make_pair(DB_VOTE_OBJECT, vote.GetHash()));
+    }
+    batch.Erase(key);
+}
+
+bool CGovernanceDb::WriteMasternodeVotes(const uint256& nObjectHash, const COutPoint& outpoint, const vote_rec_t& voteRecord, const std::vector<CGovernanceVote>& vecVotes)
+{
+    CDBBatch batch(*db);
+    // LevelDB applies the batch in order, so the index entries of the votes kept are written again below
+    EraseMasternodeVotes(batch, nObjectHash, outpoint);
+    if (!voteRecord.mapInstances.empty() || !vecVotes.empty()) {
+        batch.Write(std::make_tuple(DB_MN_VOTES, nObjectHash, outpoint), mn_votes_t(voteRecord, vecVotes));
+        for (const auto& vote : vecVotes) {
+            batch.Write(std::make_pair(DB_VOTE_OBJECT, vote.GetHash()), nObjectHash);
+        }
+    }
+    if (!db->WriteBatch(batch)) {
+        LogPrintf("CGovernanceDb::%s -- failed to write votes of %s on %s\n", __func__, outpoint.ToStringShort(), nObjectHash.ToString());
+        return false;
+    }
+    return true;
+}
+
+bool CGovernanceDb::HasMasternodeVotes(const uint256& nObjectHash, const COutPoint& outpoint) const
+{
+    return db->Exists(std::make_tuple(DB_MN_VOTES, nObjectHash, outpoint));
+}
+
+void CGovernanceDb::ReadObjectVotes(const uint256& nObjectHash, CGovernanceObject::vote_m_t& mapVoteRecords, std::vector<CGovernanceVote>& vecVotes) const
+{
+    std::unique_ptr<CDBIterator> it(db->NewIterator());
+    it->Seek(std::make_pair(DB_MN_VOTES, nObjectHash));
+    std::tuple<std::string, uint256, COutPoint> curKey;
+    while (it->Valid() && it->GetKey(curKey) && std::get<0>(curKey) == DB_MN_VOTES && std::get<1>(curKey) == nObjectHash) {
+        mn_votes_t mnVotes;
+        if (it->GetValue(mnVotes)) {
+            if (!mnVotes.first.mapInstances.empty()) {
+                mapVoteRecords.emplace(std::get<2>(curKey), mnVotes.first);
+            }
+            for (const auto& vote : mnVotes.second) {
+                vecVotes.push_back(vote);
+            }
+        }
+        it->Next();
+    }
+}
+
+bool CGovernanceDb::GetVoteObjectHash(const uint256& nVoteHash, uint256& nObjectHashRet) const
+{
+    return db->Read(std::make_pair(DB_VOTE_OBJECT, nVoteHash), nObjectHashRet);
+}
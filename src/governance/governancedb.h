@@ -0,0 +1,59 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_GOVERNANCE_GOVERNANCEDB_H
+#define BITCOIN_GOVERNANCE_GOVERNANCEDB_H
+
+#include <governance/object.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+class CDBBatch;
+class CDBWrapper;
+
+/**
+ * Keeps governance objects and their votes in a LevelDB database.
+ *
+ * Objects are stored without their votes. The votes are stored per object and masternode,
+ * along with the masternode's current vote record, and are only read once an object needs
+ * them, so loading the objects on startup doesn't depend on the number of votes.
+ */
+class CGovernanceDb
+{
+private:
+    std::unique_ptr<CDBWrapper> db;
+
+    void EraseMasternodeVotes(CDBBatch& batch, const uint256& nObjectHash, const COutPoint& outpoint);
+
+public:
+    CGovernanceDb(bool fMemory, bool fWipe);
+    ~CGovernanceDb();
+
+    /** Writes the objects without their votes, returns false if the batch could not be written */
+    bool WriteObjects(const std::vector<const CGovernanceObject*>& vecObjects);
+
+    /** Erases the object and all of its votes, returns false if the batch could not be written */
+    bool EraseObject(const uint256& nObjectHash);
+
+    /** Reads all objects without their votes */
+    void LoadObjects(std::map<uint256, CGovernanceObject>& mapObjects) const;
+
+    /**
+     * Replaces the votes of a masternode on an object with its current vote record and votes.
+     * An empty record erases them. Returns false if the batch could not be written.
+     */
+    bool WriteMasternodeVotes(const uint256& nObjectHash, const COutPoint& outpoint, const vote_rec_t& voteRecord, const std::vector<CGovernanceVote>& vecVotes);
+
+    bool HasMasternodeVotes(const uint256& nObjectHash, const COutPoint& outpoint) const;
+
+    /** Reads the vote records and the votes of all masternodes on an object */
+    void ReadObjectVotes(const uint256& nObjectHash, CGovernanceObject::vote_m_t& mapVoteRecords, std::vector<CGovernanceVote>& vecVotes) const;
+
+    /** Returns the hash of the object a stored vote belongs to */
+    bool GetVoteObjectHash(const uint256& nVoteHash, uint256& nObjectHashRet) const;
+};
+
+#endif // BITCOIN_GOVERNANCE_GOVERNANCEDB_H
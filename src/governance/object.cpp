@@ -9,6 +9,7 @@
 #include <core_io.h>
 #include <evo/deterministicmns.h>
 #include <governance/governance.h>
+#include <governance/governancedb.h>
 #include <governance/validators.h>
 #include <masternode/meta.h>
 #include <masternode/sync.h>
@@ -17,6 +18,7 @@
 #include <validation.h>
 #include <validationinterface.h>
 
+#include <algorithm>
 #include <string>
 
 CGovernanceObject::CGovernanceObject() :
@@ -39,6 +41,8 @@ CGovernanceObject::CGovernanceObject() :
     fDirtyCache(true),
     fExpired(false),
     fUnparsable(false),
+    fDirtyDb(true),
+    fVotesLoaded(true),
     mapCurrentMNVotes(),
     fileVotes()
 {
@@ -66,6 +70,8 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fDirtyCache(true),
     fExpired(false),
     fUnparsable(false),
+    fDirtyDb(true),
+    fVotesLoaded(true),
     mapCurrentMNVotes(),
     fileVotes()
 {
@@ -93,14 +99,17 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     fDirtyCache(other.fDirtyCache),
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
+    fDirtyDb(other.fDirtyDb),
+    fVotesLoaded(other.fVotesLoaded),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
     fileVotes(other.fileVotes)
 {
 }
 
-bool CGovernanceObject::ProcessVote(const CGovernanceVote& vote, CGovernanceException& exception)
+bool CGovernanceObject::ProcessVote(const CGovernanceVote& vote, CGovernanceException& exception, bool fSignatureChecked)
 {
     LOCK(cs);
+    LoadVotes();
 
     // do not process already known valid votes twice
     if (fileVotes.HasVote(vote.GetHash())) {
@@ -186,7 +195,7 @@ bool CGovernanceObject::ProcessVote(const CGovernanceVote& vote, CGovernanceExce
     bool onlyVotingKeyAllowed = nObjectType == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
 
     // Finally check that the vote is actually valid (done last because of cost of signature verification)
-    if (!vote.IsValid(onlyVotingKeyAllowed)) {
+    if (!vote.IsValid(onlyVotingKeyAllowed, !fSignatureChecked)) {
         std::ostringstream ostr;
         ostr << "CGovernanceObject::ProcessVote -- Invalid vote"
              << ", MN outpoint = " << vote.GetMasternodeOutpoint().ToStringShort()
@@ -210,6 +219,7 @@ bool CGovernanceObject::ProcessVote(const CGovernanceVote& vote, CGovernanceExce
 
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
     fileVotes.AddVote(vote);
+    WriteMasternodeVotes(vote.GetMasternodeOutpoint());
     fDirtyCache = true;
     // SEND NOTIFICATION TO SCRIPT/ZMQ
     GetMainSignals().NotifyGovernanceVote(std::make_shared<const CGovernanceVote>(vote));
@@ -219,14 +229,17 @@ bool CGovernanceObject::ProcessVote(const CGovernanceVote& vote, CGovernanceExce
 void CGovernanceObject::ClearMasternodeVotes()
 {
     LOCK(cs);
+    LoadVotes();
 
     auto mnList = deterministicMNManager->GetListAtChainTip();
 
     auto it = mapCurrentMNVotes.begin();
     while (it != mapCurrentMNVotes.end()) {
         if (!mnList.HasMNByCollateral(it->first)) {
-            fileVotes.RemoveVotesFromMasternode(it->first);
+            const COutPoint mnOutpoint = it->first;
+            fileVotes.RemoveVotesFromMasternode(mnOutpoint);
             mapCurrentMNVotes.erase(it++);
+            WriteMasternodeVotes(mnOutpoint);
             fDirtyCache = true;
         } else {
             ++it;
@@ -238,6 +251,12 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
 {
     LOCK(cs);
 
+    if (!fVotesLoaded && governance.db && !governance.db->HasMasternodeVotes(GetHash(), mnOutpoint)) {
+        // don't load the votes of every object when only a few of them have votes from this MN
+        return {};
+    }
+    LoadVotes();
+
     auto it = mapCurrentMNVotes.find(mnOutpoint);
     if (it == mapCurrentMNVotes.end()) {
         // don't even try as we don't have any votes from this MN
@@ -262,6 +281,7 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
     if (it->second.mapInstances.empty()) {
         mapCurrentMNVotes.erase(it);
     }
+    WriteMasternodeVotes(mnOutpoint);
 
     std::string removedStr;
     for (auto& h : removedVotes) {
@@ -618,6 +638,7 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
     LOCK(cs);
+    LoadVotes();
 
     int nCount = 0;
     for (const auto& votepair : mapCurrentMNVotes) {
@@ -662,6 +683,7 @@ int CGovernanceObject::GetAbstainCount(vote_signal_enum_t eVoteSignalIn) const
 bool CGovernanceObject::GetCurrentMNVotes(const COutPoint& mnCollateralOutpoint, vote_rec_t& voteRecord) const
 {
     LOCK(cs);
+    LoadVotes();
 
     auto it = mapCurrentMNVotes.find(mnCollateralOutpoint);
     if (it == mapCurrentMNVotes.end()) {
@@ -702,6 +724,9 @@ void CGovernanceObject::Relay(CConnman& connman) const
 
 void CGovernanceObject::UpdateSentinelVariables()
 {
+    const bool fPrevFunding = fCachedFunding, fPrevValid = fCachedValid, fPrevDelete = fCachedDelete, fPrevEndorsed = fCachedEndorsed;
+    const int64_t nPrevDeletionTime = nDeletionTime;
+
     // CALCULATE MINIMUM SUPPORT LEVELS REQUIRED
 
     int nMnCount = (int)deterministicMNManager->GetListAtChainTip().GetValidMNsCount();
@@ -732,4 +757,60 @@ void CGovernanceObject::UpdateSentinelVariables()
     if (GetAbsoluteYesCount(VOTE_SIGNAL_ENDORSED) >= nAbsVoteReq) fCachedEndorsed = true;
 
     if (GetAbsoluteNoCount(VOTE_SIGNAL_VALID) >= nAbsVoteReq) fCachedValid = false;
+
+    if (fCachedFunding != fPrevFunding || fCachedValid != fPrevValid || fCachedDelete != fPrevDelete ||
+        fCachedEndorsed != fPrevEndorsed || nDeletionTime != nPrevDeletionTime) {
+        fDirtyDb = true;
+    }
+}
+
+const CGovernanceObjectVoteFile& CGovernanceObject::GetVoteFile() const
+{
+    LOCK(cs);
+    LoadVotes();
+    return fileVotes;
+}
+
+void CGovernanceObject::LoadVotes() const
+{
+    AssertLockHeld(cs);
+    if (fVotesLoaded) {
+        return;
+    }
+    fVotesLoaded = true;
+    if (!governance.db) {
+        return;
+    }
+
+    std::vector<CGovernanceVote> vecVotes;
+    governance.db->ReadObjectVotes(GetHash(), mapCurrentMNVotes, vecVotes);
+
+    // Add the oldest votes first so the most recent ones end up in front, like they were received
+    std::vector<const CGovernanceVote*> vecSorted;
+    vecSorted.reserve(vecVotes.size());
+    for (const auto& vote : vecVotes) {
+        vecSorted.push_back(&vote);
+    }
+    std::sort(vecSorted.begin(), vecSorted.end(), [](const CGovernanceVote* a, const CGovernanceVote* b) {
+        return a->GetTimestamp() < b->GetTimestamp();
+    });
+    for (const CGovernanceVote* pVote : vecSorted) {
+        fileVotes.AddVote(*pVote);
+    }
+    LogPrint(BCLog::GOBJECT, "CGovernanceObject::%s -- hash = %s, vote count = %d\n", __func__, GetHash().ToString(), fileVotes.GetVoteCount());
+}
+
+void CGovernanceObject::WriteMasternodeVotes(const COutPoint& mnOutpoint) const
+{
+    AssertLockHeld(cs);
+    if (!governance.db) {
+        return;
+    }
+
+    vote_rec_t voteRecord;
+    auto it = mapCurrentMNVotes.find(mnOutpoint);
+    if (it != mapCurrentMNVotes.end()) {
+        voteRecord = it->second;
+    }
+    governance.db->WriteMasternodeVotes(GetHash(), mnOutpoint, voteRecord, fileVotes.GetVotesFromMasternode(mnOutpoint));
 }
@@ -152,9 +152,19 @@ private:
     /// Failed to parse object data
     bool fUnparsable;
 
-    vote_m_t mapCurrentMNVotes;
+    /// object fields changed since the object was last written to the governance database
+    bool fDirtyDb;
 
-    CGovernanceObjectVoteFile fileVotes;
+    /// votes were read from the governance database, or the object was never stored there
+    mutable bool fVotesLoaded;
+
+    mutable vote_m_t mapCurrentMNVotes;
+
+    mutable CGovernanceObjectVoteFile fileVotes;
+
+    void LoadVotes() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    void WriteMasternodeVotes(const COutPoint& mnOutpoint) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
 public:
     CGovernanceObject();
@@ -222,14 +232,24 @@ public:
 
     void SetExpired()
     {
-        fExpired = true;
+        if (!fExpired) {
+            fExpired = true;
+            fDirtyDb = true;
+        }
     }
 
-    const CGovernanceObjectVoteFile& GetVoteFile() const
+    bool IsSetDirtyDb() const
     {
-        return fileVotes;
+        return fDirtyDb;
     }
 
+    void ClearDirtyDb()
+    {
+        fDirtyDb = false;
+    }
+
+    const CGovernanceObjectVoteFile& GetVoteFile() const;
+
     // Signature related functions
 
     void SetMasternodeOutpoint(const COutPoint& outpoint);
@@ -253,6 +273,9 @@ public:
 
     void PrepareDeletion(int64_t nDeletionTime_)
     {
+        if (!fCachedDelete || nDeletionTime == 0) {
+            fDirtyDb = true;
+        }
         fCachedDelete = true;
         if (nDeletionTime == 0) {
             nDeletionTime = nDeletionTime_;
@@ -311,13 +334,34 @@ public:
         // AFTER DESERIALIZATION OCCURS, CACHED VARIABLES MUST BE CALCULATED MANUALLY
     }
 
+    // The governance database format, votes are stored and loaded separately (see CGovernanceDb)
+
+    template <typename Stream>
+    void SerializeWithoutVotes(Stream& s) const
+    {
+        s << nHashParent << nRevision << nTime << nCollateralHash << vchData << nObjectType << masternodeOutpoint << vchSig;
+        s << nDeletionTime << fExpired << fCachedFunding << fCachedValid << fCachedDelete << fCachedEndorsed;
+    }
+
+    template <typename Stream>
+    void UnserializeWithoutVotes(Stream& s)
+    {
+        s >> nHashParent >> nRevision >> nTime >> nCollateralHash >> vchData >> nObjectType >> masternodeOutpoint >> vchSig;
+        s >> nDeletionTime >> fExpired >> fCachedFunding >> fCachedValid >> fCachedDelete >> fCachedEndorsed;
+        // The cached flags were stored along with the object, they only need to be
+        // recalculated once its votes change, which loads them
+        fDirtyCache = false;
+        fDirtyDb = false;
+        fVotesLoaded = false;
+    }
+
     UniValue ToJson() const;
 
     // FUNCTIONS FOR DEALING WITH DATA STRING
     void LoadData();
     void GetData(UniValue& objResult) const;
 
-    bool ProcessVote(const CGovernanceVote& vote, CGovernanceException& exception);
+    bool ProcessVote(const CGovernanceVote& vote, CGovernanceException& exception, bool fSignatureChecked = false);
 
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
@@ -54,6 +54,17 @@ std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
     return vecResult;
 }
 
+std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotesFromMasternode(const COutPoint& outpointMasternode) const
+{
+    std::vector<CGovernanceVote> vecResult;
+    for (const auto& vote : listVotes) {
+        if (vote.GetMasternodeOutpoint() == outpointMasternode) {
+            vecResult.push_back(vote);
+        }
+    }
+    return vecResult;
+}
+
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
     auto it = listVotes.begin();
@@ -15,11 +15,9 @@
 
 /**
  * Represents the collection of votes associated with a given CGovernanceObject
- * Recently received votes are held in memory until a maximum size is reached after
- * which older votes a flushed to a disk file.
  *
- * Note: This is a stub implementation that doesn't limit the number of votes held
- * in memory and doesn't flush to disk.
+ * Note: The votes are written to the governance database per masternode as they change,
+ * see CGovernanceDb, and are only read back when the object needs them.
  */
 class CGovernanceObjectVoteFile
 {
@@ -62,6 +60,8 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    std::vector<CGovernanceVote> GetVotesFromMasternode(const COutPoint& outpointMasternode) const;
+
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal);
 
@@ -0,0 +1,439 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+
+#include <chainparams.h>
+#include <consensus/consensus.h>
+#include <shutdown.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <map>
+#include <set>
+
+#include <boost/thread.hpp>
+
+constexpr char DB_ADDRESSINDEX = 'a';
+constexpr char DB_ADDRESSUNSPENTINDEX = 'u';
+constexpr char DB_ADDRESSBALANCE = 'A';
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+namespace {
+
+/** The address index changes caused by one block */
+struct BlockAddressEntries {
+    //! Address activity, outputs and spent inputs
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vActivity;
+    //! Unspent outputs the block creates
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vCreated;
+    //! Unspent outputs the block spends
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vSpent;
+};
+
+BlockAddressEntries GetBlockAddressEntries(const CBlock& block, const CBlockUndo& block_undo, int nHeight)
+{
+    BlockAddressEntries entries;
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+        uint160 hashBytes;
+
+        if (i > 0) {
+            const CTxUndo& txundo = block_undo.vtxundo[i - 1];
+            for (size_t j = 0; j < tx.vin.size(); ++j) {
+                const Coin& coin = txundo.vprevout[j];
+                const int type = GetScriptAddress(coin.out.scriptPubKey, hashBytes);
+                if (type == 0) continue;
+                entries.vActivity.emplace_back(CAddressIndexKey(type, hashBytes, nHeight, i, txhash, j, true), coin.out.nValue * -1);
+                entries.vSpent.emplace_back(CAddressUnspentKey(type, hashBytes, tx.vin[j].prevout.hash, tx.vin[j].prevout.n),
+                                            CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight));
+            }
+        }
+
+        for (size_t k = 0; k < tx.vout.size(); ++k) {
+            const CTxOut& out = tx.vout[k];
+            const int type = GetScriptAddress(out.scriptPubKey, hashBytes);
+            if (type == 0) continue;
+            entries.vActivity.emplace_back(CAddressIndexKey(type, hashBytes, nHeight, i, txhash, k, false), out.nValue);
+            entries.vCreated.emplace_back(CAddressUnspentKey(type, hashBytes, txhash, k),
+                                          CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight));
+        }
+    }
+    return entries;
+}
+
+struct AddressBalanceDelta {
+    CAmount balance{0};
+    CAmount received{0};
+    int64_t txCount{0};
+};
+
+typedef std::map<std::pair<unsigned int, uint160>, AddressBalanceDelta> AddressBalanceDeltas;
+
+} // namespace
+
+/** Access to the address index database (indexes/addressindex/) */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Apply the entries of a connected block and move the best block to it, atomically.
+    bool ConnectBlock(const BlockAddressEntries& entries, const CBlockLocator& locator);
+
+    /// Revert the entries of a disconnected block and move the best block to its parent, atomically.
+    bool DisconnectBlock(const BlockAddressEntries& entries, const CBlockLocator& locator);
+
+    bool ReadAddressIndex(uint160 addressHash, int type,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                          int start, int end) const;
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs) const;
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue& value) const;
+
+    /// Compute the balances from the address activity, for databases predating them.
+    bool RebuildAddressBalances();
+
+private:
+    /// Sum address activity into per-address balance deltas. Only entries whose
+    /// presence in the index matches fPresent count, so a block which is applied
+    /// twice (e.g. after an unclean shutdown) is not counted twice.
+    AddressBalanceDeltas GetBalanceDeltas(const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect, bool fPresent) const;
+
+    void WriteBalanceDeltas(CDBBatch& batch, const AddressBalanceDeltas& deltas, int sign) const;
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+AddressBalanceDeltas AddressIndex::DB::GetBalanceDeltas(const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect, bool fPresent) const
+{
+    AddressBalanceDeltas deltas;
+    std::set<std::pair<std::pair<unsigned int, uint160>, uint256> > setTxs;
+    for (const auto& entry : vect) {
+        if (Exists(std::make_pair(DB_ADDRESSINDEX, entry.first)) != fPresent) continue;
+        const auto address = std::make_pair(entry.first.type, entry.first.hashBytes);
+        AddressBalanceDelta& delta = deltas[address];
+        delta.balance += entry.second;
+        if (entry.second > 0) {
+            delta.received += entry.second;
+        }
+        if (setTxs.emplace(address, entry.first.txhash).second) {
+            ++delta.txCount;
+        }
+    }
+    return deltas;
+}
+
+void AddressIndex::DB::WriteBalanceDeltas(CDBBatch& batch, const AddressBalanceDeltas& deltas, int sign) const
+{
+    for (const auto& item : deltas) {
+        const auto key = std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(item.first.first, item.first.second));
+        CAddressBalanceValue value;
+        if (!Read(key, value)) {
+            value.SetNull();
+        }
+        value.balance += sign * item.second.balance;
+        value.received += sign * item.second.received;
+        value.txCount += sign * item.second.txCount;
+        if (value.txCount <= 0) {
+            batch.Erase(key);
+        } else {
+            batch.Write(key, value);
+        }
+    }
+}
+
+bool AddressIndex::DB::ConnectBlock(const BlockAddressEntries& entries, const CBlockLocator& locator)
+{
+    CDBBatch batch(*this);
+    WriteBalanceDeltas(batch, GetBalanceDeltas(entries.vActivity, false), 1);
+    for (const auto& entry : entries.vActivity) {
+        batch.Write(std::make_pair(DB_ADDRESSINDEX, entry.first), entry.second);
+    }
+    // Outputs created and spent within the block end up erased
+    for (const auto& entry : entries.vCreated) {
+        batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first), entry.second);
+    }
+    for (const auto& entry : entries.vSpent) {
+        batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first));
+    }
+    WriteBestBlock(batch, locator);
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::DisconnectBlock(const BlockAddressEntries& entries, const CBlockLocator& locator)
+{
+    CDBBatch batch(*this);
+    WriteBalanceDeltas(batch, GetBalanceDeltas(entries.vActivity, true), -1);
+    for (const auto& entry : entries.vActivity) {
+        batch.Erase(std::make_pair(DB_ADDRESSINDEX, entry.first));
+    }
+    // Restore the spent outputs first, so outputs created and spent within the block end up erased
+    for (const auto& entry : entries.vSpent) {
+        batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first), entry.second);
+    }
+    for (const auto& entry : entries.vCreated) {
+        batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first));
+    }
+    WriteBestBlock(batch, locator);
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::ReadAddressIndex(uint160 addressHash, int type,
+                                        std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                                        int start, int end) const
+{
+    std::unique_ptr<CDBIterator> pcursor(const_cast<DB&>(*this).NewIterator());
+
+    if (start > 0 && end > 0) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
+            if (end > 0 && key.second.blockHeight > end) {
+                break;
+            }
+            CAmount nValue;
+            if (pcursor->GetValue(nValue)) {
+                addressIndex.push_back(std::make_pair(key.second, nValue));
+                pcursor->Next();
+            } else {
+                return error("failed to get address index value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                               std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs) const
+{
+    std::unique_ptr<CDBIterator> pcursor(const_cast<DB&>(*this).NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
+            CAddressUnspentValue nValue;
+            if (pcursor->GetValue(nValue)) {
+                unspentOutputs.push_back(std::make_pair(key.second, nValue));
+                pcursor->Next();
+            } else {
+                return error("failed to get address unspent value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue& value) const
+{
+    if (!Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), value)) {
+        value.SetNull();
+    }
+    return true;
+}
+
+bool AddressIndex::DB::RebuildAddressBalances()
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey()));
+
+    // Entries are sorted by address and then by transaction, so one pass suffices
+    CDBBatch batch(*this);
+    CAddressIndexIteratorKey address;
+    CAddressBalanceValue value;
+    uint256 lastTx;
+    size_t nAddresses = 0;
+    auto flush = [&] {
+        if (!value.IsNull()) {
+            batch.Write(std::make_pair(DB_ADDRESSBALANCE, address), value);
+            ++nAddresses;
+        }
+        value.SetNull();
+    };
+
+    while (pcursor->Valid()) {
+        if (ShutdownRequested()) return false;
+        std::pair<char,CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX) break;
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("failed to get address index value");
+        }
+        if (key.second.type != address.type || key.second.hashBytes != address.hashBytes) {
+            flush();
+            address = CAddressIndexIteratorKey(key.second.type, key.second.hashBytes);
+            lastTx.SetNull();
+        }
+        value.balance += nValue;
+        if (nValue > 0) {
+            value.received += nValue;
+        }
+        if (key.second.txhash != lastTx) {
+            ++value.txCount;
+            lastTx = key.second.txhash;
+        }
+        if (batch.SizeEstimate() > (size_t)nDefaultDbBatchSize) {
+            if (!WriteBatch(batch)) return false;
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    flush();
+    LogPrintf("%s: computed balances of %u addresses\n", __func__, nAddresses);
+    return WriteBatch(batch, true);
+}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::Init()
+{
+    LOCK(cs_main);
+
+    if (!MigrateLegacyData("addressindex", [this] {
+            if (!MoveLegacyEntries<CAddressIndexKey, CAmount>(*pblocktree, DB_ADDRESSINDEX) ||
+                !MoveLegacyEntries<CAddressUnspentKey, CAddressUnspentValue>(*pblocktree, DB_ADDRESSUNSPENTINDEX) ||
+                !MoveLegacyEntries<CAddressIndexIteratorKey, CAddressBalanceValue>(*pblocktree, DB_ADDRESSBALANCE)) {
+                return false;
+            }
+            // Block tree databases which had no balances yet
+            bool fAddressBalance = false;
+            pblocktree->ReadFlag("addressbalance", fAddressBalance);
+            if (!fAddressBalance && !m_db->RebuildAddressBalances()) {
+                return false;
+            }
+            return pblocktree->WriteFlag("addressbalance", false);
+        })) {
+        return false;
+    }
+
+    if (!BaseIndex::Init()) {
+        return false;
+    }
+
+    LOCK(m_cs_db);
+    m_db_height = GetSummary().best_block_height;
+    return true;
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo block_undo;
+    if (!ReadBlockUndo(block, pindex, block_undo)) {
+        return false;
+    }
+    const BlockAddressEntries entries = GetBlockAddressEntries(block, block_undo, pindex->nHeight);
+
+    LOCK(m_cs_db);
+    if (!m_db->ConnectBlock(entries, GetLocator(pindex))) {
+        return false;
+    }
+    m_db_height = pindex->nHeight;
+    return true;
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    std::vector<const CBlockIndex*> disconnected;
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+            disconnected.push_back(pindex);
+        }
+    }
+
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    for (const CBlockIndex* pindex : disconnected) {
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params) || !ReadBlockUndo(block, pindex, block_undo)) {
+            return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        const BlockAddressEntries entries = GetBlockAddressEntries(block, block_undo, pindex->nHeight);
+
+        LOCK(m_cs_db);
+        if (!m_db->DisconnectBlock(entries, GetLocator(pindex->pprev))) {
+            return false;
+        }
+        m_db_height = pindex->pprev->nHeight;
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::ReadAddressIndex(uint160 addressHash, int type,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                                    int start, int end) const
+{
+    return m_db->ReadAddressIndex(addressHash, type, addressIndex, start, end);
+}
+
+bool AddressIndex::ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs) const
+{
+    return m_db->ReadAddressUnspentIndex(addressHash, type, unspentOutputs);
+}
+
+bool AddressIndex::ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue& value) const
+{
+    return m_db->ReadAddressBalance(addressHash, type, value);
+}
+
+bool AddressIndex::ReadAddressBalances(const std::vector<std::pair<uint160, int> >& addresses,
+                                       CAddressBalanceValue& value, CAmount& nImmature, int& nHeight) const
+{
+    LOCK(m_cs_db);
+    nHeight = m_db_height;
+    value.SetNull();
+    nImmature = 0;
+
+    // Only coinbase outputs of the last COINBASE_MATURITY blocks can be immature
+    const int nImmatureStart = std::max(1, nHeight - COINBASE_MATURITY + 1);
+
+    for (const auto& address : addresses) {
+        CAddressBalanceValue addressValue;
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        if (!m_db->ReadAddressBalance(address.first, address.second, addressValue) ||
+            (nHeight > 0 && !m_db->ReadAddressIndex(address.first, address.second, addressIndex, nImmatureStart, nHeight))) {
+            return false;
+        }
+
+        value.balance += addressValue.balance;
+        value.received += addressValue.received;
+        value.txCount += addressValue.txCount;
+        for (const auto& entry : addressIndex) {
+            if (entry.first.txindex == 0) {
+                nImmature += entry.second;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <spentindex.h>
+#include <sync.h>
+
+/**
+ * AddressIndex records, per address, every output paying to it and every input
+ * spending from it, its unspent outputs and its balance. It is kept in its own
+ * LevelDB database (indexes/addressindex/) and built in the background.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// Serializes database writes against readers which need one consistent block state.
+    mutable Mutex m_cs_db;
+
+    /// Height of the block the database holds the entries up to, 0 if none.
+    int m_db_height GUARDED_BY(m_cs_db){0};
+
+protected:
+    /// Override base class init to migrate from the block tree database.
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Look up the activity of an address, optionally restricted to the heights start..end.
+    bool ReadAddressIndex(uint160 addressHash, int type,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                          int start = 0, int end = 0) const;
+
+    /// Look up the unspent outputs of an address.
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs) const;
+
+    /// Look up the balance of an address. Addresses without activity have a null balance.
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue& value) const;
+
+    /// Sum the balances of addresses and the amount of it in immature coinbase outputs, both as of
+    /// one block of the index, whose height is returned in nHeight.
+    bool ReadAddressBalances(const std::vector<std::pair<uint160, int> >& addresses,
+                             CAddressBalanceValue& value, CAmount& nImmature, int& nHeight) const;
+};
+
+/// The global address index. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
@@ -5,6 +5,8 @@
 #include <chainparams.h>
 #include <index/base.h>
 #include <shutdown.h>
+#include <txdb.h>
+#include <undo.h>
 #include <tinyformat.h>
 #include <ui_interface.h>
 #include <util/translation.h>
@@ -12,6 +14,8 @@
 #include <warnings.h>
 
 constexpr char DB_BEST_BLOCK = 'B';
+//! Block tree DB key of the chain a legacy index is being migrated from
+constexpr char DB_LEGACY_BEST_BLOCK = 'M';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
@@ -50,6 +54,64 @@ BaseIndex::~BaseIndex()
     Stop();
 }
 
+bool BaseIndex::MigrateLegacyData(const std::string& legacy_flag, const std::function<bool()>& move_entries)
+{
+    AssertLockHeld(cs_main);
+
+    // The legacy index was in sync with the chain tip and its presence was
+    // indicated by a flag. The flag is replaced by the locator of that chain
+    // first, so that a migration interrupted by shutdown resumes from there
+    // and a downgraded node sees the legacy index as disabled.
+    const auto locator_key = std::make_pair(DB_LEGACY_BEST_BLOCK, legacy_flag);
+    bool f_legacy_flag = false;
+    pblocktree->ReadFlag(legacy_flag, f_legacy_flag);
+    if (f_legacy_flag) {
+        if (!pblocktree->Write(locator_key, ::ChainActive().GetLocator())) {
+            return error("%s: cannot write block indicator", __func__);
+        }
+        if (!pblocktree->WriteFlag(legacy_flag, false)) {
+            return error("%s: cannot write block index db flag", __func__);
+        }
+    }
+
+    CBlockLocator locator;
+    if (!pblocktree->Read(locator_key, locator)) {
+        return true;
+    }
+
+    LogPrintf("Moving %s out of the block index database...\n", GetName());
+    if (!move_entries()) {
+        LogPrintf("[CANCELLED].\n");
+        return false;
+    }
+    CDBBatch batch(GetDB());
+    GetDB().WriteBestBlock(batch, locator);
+    if (!GetDB().WriteBatch(batch, /*fSync=*/ true) || !pblocktree->Erase(locator_key)) {
+        return error("%s: cannot finish moving %s", __func__, GetName());
+    }
+    LogPrintf("[DONE].\n");
+    return true;
+}
+
+bool BaseIndex::ReadBlockUndo(const CBlock& block, const CBlockIndex* pindex, CBlockUndo& block_undo)
+{
+    // The genesis block has no undo data
+    if (pindex->nHeight == 0) return true;
+
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return error("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: block and undo data inconsistent", __func__);
+    }
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        if (block_undo.vtxundo[i - 1].vprevout.size() != block.vtx[i]->vin.size()) {
+            return error("%s: transaction and undo data inconsistent", __func__);
+        }
+    }
+    return true;
+}
+
 bool BaseIndex::Init()
 {
     CBlockLocator locator;
@@ -101,9 +163,10 @@ void BaseIndex::ThreadSync()
                 return;
             }
 
+            const CBlockIndex* pindex_next;
             {
                 LOCK(cs_main);
-                const CBlockIndex* pindex_next = NextSyncBlock(pindex);
+                pindex_next = NextSyncBlock(pindex);
                 if (!pindex_next) {
                     m_best_block_index = pindex;
                     m_synced = true;
@@ -111,13 +174,14 @@ void BaseIndex::ThreadSync()
                     Commit();
                     break;
                 }
-                if (pindex_next->pprev != pindex && !Rewind(pindex, pindex_next->pprev)) {
-                    FatalError("%s: Failed to rewind index %s to a previous chain tip",
-                               __func__, GetName());
-                    return;
-                }
-                pindex = pindex_next;
             }
+            // Rewinding reads the disconnected blocks from disk, don't hold cs_main for that
+            if (pindex_next->pprev != pindex && !Rewind(pindex, pindex_next->pprev)) {
+                FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                           __func__, GetName());
+                return;
+            }
+            pindex = pindex_next;
 
             int64_t current_time = GetTime();
             if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
@@ -319,3 +383,13 @@ void BaseIndex::Stop()
         m_thread_sync.join();
     }
 }
+
+IndexSummary BaseIndex::GetSummary() const
+{
+    IndexSummary summary{};
+    summary.name = GetName();
+    summary.synced = m_synced;
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    summary.best_block_height = best_block_index ? best_block_index->nHeight : 0;
+    return summary;
+}
@@ -8,10 +8,19 @@
 #include <dbwrapper.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <shutdown.h>
 #include <threadinterrupt.h>
+#include <util/system.h>
 #include <validationinterface.h>
 
 class CBlockIndex;
+class CBlockUndo;
+
+struct IndexSummary {
+    std::string name;
+    bool synced{false};
+    int best_block_height{0};
+};
 
 /**
  * Base class for indices of blockchain data. This implements
@@ -90,6 +99,19 @@ protected:
     /// be an ancestor of the current best block.
     virtual bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip);
 
+    /// Move this index out of the block tree DB, where it used to be maintained
+    /// inline with block connection and enabled by the legacy_flag DB flag. The
+    /// entries are moved by move_entries; afterwards the index continues from
+    /// the chain the legacy entries were in sync with. Requires cs_main.
+    bool MigrateLegacyData(const std::string& legacy_flag, const std::function<bool()>& move_entries);
+
+    /// Read the undo data of a block and check that it matches the block.
+    static bool ReadBlockUndo(const CBlock& block, const CBlockIndex* pindex, CBlockUndo& block_undo);
+
+    /// Move all block tree DB entries under prefix to this index's database.
+    template <typename K, typename V>
+    bool MoveLegacyEntries(CDBWrapper& legacy_db, char prefix);
+
     virtual DB& GetDB() const = 0;
 
     /// Get the name of the index for display in logs.
@@ -114,6 +136,37 @@ public:
 
     /// Stops the instance from staying in sync with blockchain updates.
     void Stop();
+
+    /// Get a summary of the index and its state.
+    IndexSummary GetSummary() const;
 };
 
+template <typename K, typename V>
+bool BaseIndex::MoveLegacyEntries(CDBWrapper& legacy_db, char prefix)
+{
+    const size_t batch_size = 1 << 24; // 16 MiB
+
+    CDBBatch batch_newdb(GetDB());
+    CDBBatch batch_olddb(legacy_db);
+    std::pair<char, K> key;
+    std::unique_ptr<CDBIterator> cursor(legacy_db.NewIterator());
+    for (cursor->Seek(std::make_pair(prefix, K())); cursor->Valid(); cursor->Next()) {
+        if (ShutdownRequested()) return false;
+        if (!cursor->GetKey(key) || key.first != prefix) break;
+        V value;
+        if (!cursor->GetValue(value)) {
+            return error("%s: cannot parse %s record", __func__, GetName());
+        }
+        batch_newdb.Write(key, value);
+        batch_olddb.Erase(key);
+        if (batch_newdb.SizeEstimate() > batch_size || batch_olddb.SizeEstimate() > batch_size) {
+            // Sync new DB changes to disk before deleting from old DB.
+            if (!GetDB().WriteBatch(batch_newdb, /*fSync=*/ true) || !legacy_db.WriteBatch(batch_olddb)) return false;
+            batch_newdb.Clear();
+            batch_olddb.Clear();
+        }
+    }
+    return GetDB().WriteBatch(batch_newdb, /*fSync=*/ true) && legacy_db.WriteBatch(batch_olddb);
+}
+
 #endif // BITCOIN_INDEX_BASE_H
@@ -0,0 +1,134 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+
+#include <chainparams.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+constexpr char DB_SPENTINDEX = 'p';
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+/** Access to the spent index database (indexes/spentindex/) */
+class SpentIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+
+    /// Write (or, for null values, erase) a block's entries and move the best block, atomically.
+    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& vect, const CBlockLocator& locator);
+};
+
+SpentIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "spentindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool SpentIndex::DB::ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
+
+bool SpentIndex::DB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& vect, const CBlockLocator& locator)
+{
+    CDBBatch batch(*this);
+    for (const auto& entry : vect) {
+        if (entry.second.IsNull()) {
+            batch.Erase(std::make_pair(DB_SPENTINDEX, entry.first));
+        } else {
+            batch.Write(std::make_pair(DB_SPENTINDEX, entry.first), entry.second);
+        }
+    }
+    WriteBestBlock(batch, locator);
+    return WriteBatch(batch);
+}
+
+/** The spent index entries of a block, with null values when it is disconnected */
+static std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > GetBlockSpentEntries(const CBlock& block, const CBlockUndo& block_undo,
+                                                                                     int nHeight, bool fConnect)
+{
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > entries;
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+        for (size_t j = 0; j < tx.vin.size(); ++j) {
+            const CSpentIndexKey key(tx.vin[j].prevout.hash, tx.vin[j].prevout.n);
+            if (!fConnect) {
+                entries.emplace_back(key, CSpentIndexValue());
+                continue;
+            }
+            const CTxOut& prevout = block_undo.vtxundo[i - 1].vprevout[j].out;
+            uint160 hashBytes;
+            const int addressType = GetScriptAddress(prevout.scriptPubKey, hashBytes);
+            entries.emplace_back(key, CSpentIndexValue(txhash, j, nHeight, prevout.nValue, addressType, hashBytes));
+        }
+    }
+    return entries;
+}
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<SpentIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+SpentIndex::~SpentIndex() {}
+
+bool SpentIndex::Init()
+{
+    LOCK(cs_main);
+
+    if (!MigrateLegacyData("spentindex", [this] {
+            return MoveLegacyEntries<CSpentIndexKey, CSpentIndexValue>(*pblocktree, DB_SPENTINDEX);
+        })) {
+        return false;
+    }
+
+    return BaseIndex::Init();
+}
+
+bool SpentIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo block_undo;
+    if (!ReadBlockUndo(block, pindex, block_undo)) {
+        return false;
+    }
+    return m_db->UpdateSpentIndex(GetBlockSpentEntries(block, block_undo, pindex->nHeight, true), GetLocator(pindex));
+}
+
+bool SpentIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    std::vector<const CBlockIndex*> disconnected;
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+            disconnected.push_back(pindex);
+        }
+    }
+
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    for (const CBlockIndex* pindex : disconnected) {
+        // Erasing only needs the spent outpoints, which are in the block itself
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        if (!m_db->UpdateSpentIndex(GetBlockSpentEntries(block, CBlockUndo(), pindex->nHeight, false), GetLocator(pindex->pprev))) {
+            return false;
+        }
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& SpentIndex::GetDB() const { return *m_db; }
+
+bool SpentIndex::ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return m_db->ReadSpentIndex(key, value);
+}
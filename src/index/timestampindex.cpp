@@ -0,0 +1,107 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/timestampindex.h>
+
+#include <spentindex.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <boost/thread.hpp>
+
+constexpr char DB_TIMESTAMPINDEX = 's';
+
+std::unique_ptr<TimestampIndex> g_timestampindex;
+
+/** Access to the timestamp index database (indexes/timestampindex/) */
+class TimestampIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<uint256>& hashes) const;
+
+    /// Add or remove the entry of a block and move the best block, atomically.
+    bool UpdateTimestampIndex(const CTimestampIndexKey& key, bool fConnect, const CBlockLocator& locator);
+};
+
+TimestampIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "timestampindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool TimestampIndex::DB::ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<uint256>& hashes) const
+{
+    std::unique_ptr<CDBIterator> pcursor(const_cast<DB&>(*this).NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CTimestampIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp <= high) {
+            hashes.push_back(key.second.blockHash);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool TimestampIndex::DB::UpdateTimestampIndex(const CTimestampIndexKey& key, bool fConnect, const CBlockLocator& locator)
+{
+    CDBBatch batch(*this);
+    if (fConnect) {
+        batch.Write(std::make_pair(DB_TIMESTAMPINDEX, key), 0);
+    } else {
+        batch.Erase(std::make_pair(DB_TIMESTAMPINDEX, key));
+    }
+    WriteBestBlock(batch, locator);
+    return WriteBatch(batch);
+}
+
+TimestampIndex::TimestampIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<TimestampIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+TimestampIndex::~TimestampIndex() {}
+
+bool TimestampIndex::Init()
+{
+    LOCK(cs_main);
+
+    if (!MigrateLegacyData("timestampindex", [this] {
+            return MoveLegacyEntries<CTimestampIndexKey, int>(*pblocktree, DB_TIMESTAMPINDEX);
+        })) {
+        return false;
+    }
+
+    return BaseIndex::Init();
+}
+
+bool TimestampIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    return m_db->UpdateTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash()), true, GetLocator(pindex));
+}
+
+bool TimestampIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        if (!m_db->UpdateTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash()), false, GetLocator(pindex->pprev))) {
+            return false;
+        }
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& TimestampIndex::GetDB() const { return *m_db; }
+
+bool TimestampIndex::ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<uint256>& hashes) const
+{
+    return m_db->ReadTimestampIndex(high, low, hashes);
+}
@@ -67,6 +67,8 @@ void DestroyLLMQSystem()
 
 void StartLLMQSystem()
 {
+    // before the DKG threads and the quorum manager ask for members
+    CLLMQUtils::LoadQuorumMembersCache();
     if (blsWorker) {
         blsWorker->Start();
     }
@@ -6,6 +6,7 @@
 #define BITCOIN_LLMQ_QUORUMS_H
 
 #include <chain.h>
+#include <ctpl_stl.h>
 #include <consensus/params.h>
 #include <saltedhasher.h>
 #include <threadinterrupt.h>
@@ -11,6 +11,7 @@
 
 #include <bls/bls.h>
 #include <chainparams.h>
+#include <compat/endian.h>
 #include <evo/deterministicmns.h>
 #include <evo/evodb.h>
 #include <masternode/meta.h>
@@ -30,6 +31,109 @@ namespace llmq
 CCriticalSection cs_llmq_vbc;
 VersionBitsCache llmq_versionbitscache;
 
+static const std::string DB_QUORUM_MEMBERS = "q_mem";
+static const std::string DB_QUORUM_MEMBERS_ROTATED = "q_memr";
+
+static CCriticalSection cs_members;
+static std::map<Consensus::LLMQType, unordered_lru_cache<uint256, std::vector<CDeterministicMNCPtr>, StaticSaltedHasher>> mapQuorumMembers GUARDED_BY(cs_members);
+static CCriticalSection cs_indexed_members;
+static std::map<Consensus::LLMQType, unordered_lru_cache<std::pair<uint256, int>, std::vector<CDeterministicMNCPtr>, StaticSaltedHasher>> mapIndexedQuorumMembers GUARDED_BY(cs_indexed_members);
+
+/*
+ * Computed members are persisted in the raw evodb, like the quorum snapshots. The members of a quorum base block never
+ * change, so there is nothing to roll back together with the evodb transaction. Members are stored with their state
+ * and not only as proTxHashes: rotated quorums take members from older lists, which a single list can't restore.
+ * The key starts with the height, so that loading the recent quorums and pruning the old ones is a single scan.
+ */
+static auto BuildQuorumMembersKey(const std::string& strPrefix, Consensus::LLMQType llmqType, int nHeight, const uint256& blockHash)
+{
+    return std::make_tuple(strPrefix, llmqType, htobe32(uint32_t(nHeight)), blockHash);
+}
+
+template <typename T>
+static bool ReadQuorumMembers(const std::string& strPrefix, Consensus::LLMQType llmqType, const CBlockIndex* pindex, T& members)
+{
+    return evoDb && evoDb->GetRawDB().Read(BuildQuorumMembersKey(strPrefix, llmqType, pindex->nHeight, pindex->GetBlockHash()), members);
+}
+
+template <typename T>
+static void WriteQuorumMembers(const std::string& strPrefix, Consensus::LLMQType llmqType, const CBlockIndex* pindex, const T& members)
+{
+    if (evoDb) {
+        evoDb->GetRawDB().Write(BuildQuorumMembersKey(strPrefix, llmqType, pindex->nHeight, pindex->GetBlockHash()), members);
+    }
+}
+
+template <typename T, typename Callback>
+static void LoadQuorumMembers(const std::string& strPrefix, Consensus::LLMQType llmqType, int nKeepHeight, Callback&& callback) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CDBBatch batch(evoDb->GetRawDB());
+    std::unique_ptr<CDBIterator> pcursor(evoDb->GetRawDB().NewIterator());
+    auto firstKey = BuildQuorumMembersKey(strPrefix, llmqType, 0, uint256());
+    for (pcursor->Seek(firstKey); pcursor->Valid(); pcursor->Next()) {
+        decltype(firstKey) curKey;
+        if (!pcursor->GetKey(curKey) || std::get<0>(curKey) != strPrefix || std::get<1>(curKey) != llmqType) {
+            break;
+        }
+        // quorums which are too old to be in the caches or were reorged out are not needed anymore
+        const CBlockIndex* pindex = LookupBlockIndex(std::get<3>(curKey));
+        T members;
+        if (int(be32toh(std::get<2>(curKey))) < nKeepHeight || pindex == nullptr || !::ChainActive().Contains(pindex) || !pcursor->GetValue(members)) {
+            batch.Erase(curKey);
+            continue;
+        }
+        callback(pindex, members);
+    }
+    evoDb->GetRawDB().WriteBatch(batch);
+}
+
+void CLLMQUtils::LoadQuorumMembersCache()
+{
+    if (!evoDb) {
+        return;
+    }
+
+    LOCK(cs_main);
+    const CBlockIndex* pindexTip = ::ChainActive().Tip();
+    if (pindexTip == nullptr) {
+        return;
+    }
+
+    if (LOCK(cs_members); mapQuorumMembers.empty()) {
+        InitQuorumsCache(mapQuorumMembers);
+    }
+    if (LOCK(cs_indexed_members); mapIndexedQuorumMembers.empty()) {
+        InitQuorumsCache(mapIndexedQuorumMembers);
+    }
+
+    size_t nLoaded = 0;
+    for (const auto& llmqParams : Params().GetConsensus().llmqs) {
+        // the caches keep keepOldConnections quorums per type, older ones are pruned
+        const int nKeepHeight = pindexTip->nHeight - llmqParams.dkgInterval * (llmqParams.keepOldConnections + 1);
+        LoadQuorumMembers<std::vector<CDeterministicMNCPtr>>(DB_QUORUM_MEMBERS, llmqParams.type, nKeepHeight,
+            [&](const CBlockIndex* pQuorumBaseBlockIndex, const std::vector<CDeterministicMNCPtr>& members) {
+                LOCK(cs_members);
+                mapQuorumMembers[llmqParams.type].insert(pQuorumBaseBlockIndex->GetBlockHash(), members);
+                nLoaded++;
+            });
+        LoadQuorumMembers<std::vector<std::vector<CDeterministicMNCPtr>>>(DB_QUORUM_MEMBERS_ROTATED, llmqParams.type, nKeepHeight,
+            [&](const CBlockIndex* pCycleQuorumBaseBlockIndex, const std::vector<std::vector<CDeterministicMNCPtr>>& q) {
+                LOCK(cs_indexed_members);
+                for (int i = 0; i < static_cast<int>(q.size()); ++i) {
+                    mapIndexedQuorumMembers[llmqParams.type].insert(std::make_pair(pCycleQuorumBaseBlockIndex->GetBlockHash(), i), q[i]);
+                }
+                nLoaded++;
+            });
+    }
+    LogPrintf("CLLMQUtils::%s -- loaded members of %d quorums\n", __func__, nLoaded);
+}
+
+void CLLMQUtils::ClearQuorumMembersCache()
+{
+    WITH_LOCK(cs_members, mapQuorumMembers.clear());
+    WITH_LOCK(cs_indexed_members, mapIndexedQuorumMembers.clear());
+}
+
 void CLLMQUtils::PreComputeQuorumMembers(const CBlockIndex* pQuorumBaseBlockIndex, bool reset_cache)
 {
     for (const Consensus::LLMQParams& params : CLLMQUtils::GetEnabledQuorumParams(pQuorumBaseBlockIndex->pprev)) {
@@ -41,10 +145,6 @@ void CLLMQUtils::PreComputeQuorumMembers(const CBlockIndex* pQuorumBaseBlockInde
 
 std::vector<CDeterministicMNCPtr> CLLMQUtils::GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pQuorumBaseBlockIndex, bool reset_cache)
 {
-    static CCriticalSection cs_members;
-    static std::map<Consensus::LLMQType, unordered_lru_cache<uint256, std::vector<CDeterministicMNCPtr>, StaticSaltedHasher>> mapQuorumMembers GUARDED_BY(cs_members);
-    static CCriticalSection cs_indexed_members;
-    static std::map<Consensus::LLMQType, unordered_lru_cache<std::pair<uint256, int>, std::vector<CDeterministicMNCPtr>, StaticSaltedHasher>> mapIndexedQuorumMembers GUARDED_BY(cs_indexed_members);
     if (!IsQuorumTypeEnabled(llmqType, pQuorumBaseBlockIndex->pprev)) {
         return {};
     }
@@ -95,15 +195,25 @@ std::vector<CDeterministicMNCPtr> CLLMQUtils::GetAllQuorumMembers(Consensus::LLM
             return quorumMembers;
         }
 
-        auto q = ComputeQuorumMembersByQuarterRotation(llmqType, pCycleQuorumBaseBlockIndex);
+        std::vector<std::vector<CDeterministicMNCPtr>> q;
+        if (reset_cache || !ReadQuorumMembers(DB_QUORUM_MEMBERS_ROTATED, llmqType, pCycleQuorumBaseBlockIndex, q) || q.size() != size_t(llmqParams.signingActiveQuorumCount)) {
+            q = ComputeQuorumMembersByQuarterRotation(llmqType, pCycleQuorumBaseBlockIndex);
+            // incomplete quorums (e.g. a quorum snapshot was missing) are only kept in memory, a restart recomputes them
+            if (ranges::all_of(q, [&llmqParams](const auto& members) { return members.size() == size_t(llmqParams.size); })) {
+                WriteQuorumMembers(DB_QUORUM_MEMBERS_ROTATED, llmqType, pCycleQuorumBaseBlockIndex, q);
+            }
+        }
         LOCK(cs_indexed_members);
         for (int i = 0; i < static_cast<int>(q.size()); ++i) {
             mapIndexedQuorumMembers[llmqType].insert(std::make_pair(pCycleQuorumBaseBlockIndex->GetBlockHash(), i), q[i]);
         }
 
         quorumMembers = q[quorumIndex];
-    } else {
+    } else if (reset_cache || !ReadQuorumMembers(DB_QUORUM_MEMBERS, llmqType, pQuorumBaseBlockIndex, quorumMembers)) {
         quorumMembers = ComputeQuorumMembers(llmqType, pQuorumBaseBlockIndex);
+        if (!quorumMembers.empty()) {
+            WriteQuorumMembers(DB_QUORUM_MEMBERS, llmqType, pQuorumBaseBlockIndex, quorumMembers);
+        }
     }
 
     LOCK(cs_members);
@@ -27,6 +27,7 @@
 #include <pow.h>
 #include <primitives/transaction.h>
 #include <script/standard.h>
+#include <shutdown.h>
 #include <timedata.h>
 #include <util/moneystr.h>
 #include <util/system.h>
@@ -43,8 +44,11 @@
 #include <masternode/sync.h>
 
 #include <algorithm>
+#include <map>
 #include <queue>
+#include <set>
 #include <utility>
+#include <ctpl_stl.h>
 #include <boost/thread.hpp>
 
 int64_t nLastCoinStakeSearchTime = 0;
@@ -112,32 +116,19 @@ void BlockAssembler::resetBlock()
 Optional<int64_t> BlockAssembler::m_last_block_num_txs{nullopt};
 Optional<int64_t> BlockAssembler::m_last_block_size{nullopt};
 
-std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(
-        const CScript& scriptPubKeyIn, std::shared_ptr<CWallet> pwallet, int64_t block_time, bool isPos)
+CBlockIndex* BlockAssembler::AssembleBlock(const CScript& scriptPubKeyIn, int64_t block_time, bool isPos,
+                                           CMutableTransaction& coinbaseTx, int& nPackagesSelected, int& nDescendantsUpdated)
 {
-    int64_t nTimeStart = GetTimeMicros();
-
     resetBlock();
 
     pblocktemplate.reset(new CBlockTemplate());
-
-    if(!pblocktemplate.get())
-        return nullptr;
     pblock = pblocktemplate->block; // pointer for convenience
 
-    int64_t nTime1;
     CBlockIndex* pindexPrev;
-    int nPackagesSelected = 0;
-    int nDescendantsUpdated = 0;
-    bool sign_block = false;
-    CMutableTransaction coinbaseTx;
 
-    // Crete template
-    //---
     {
         LOCK2(cs_main, mempool.cs);
 
-        nTime1 = GetTimeMicros();
         pindexPrev = ::ChainActive().Tip();
 
         // Common header
@@ -196,8 +187,6 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(
             }
         }
 
-        int nPackagesSelected = 0;
-        int nDescendantsUpdated = 0;
         addPackageTxs(nPackagesSelected, nDescendantsUpdated);
 
         m_last_block_num_txs = nBlockTx;
@@ -256,6 +245,24 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(
         UpdateTime(pblock.get(), chainparams.GetConsensus(), pindexPrev);
     }
 
+    return pindexPrev;
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(
+        const CScript& scriptPubKeyIn, std::shared_ptr<CWallet> pwallet, int64_t block_time, bool isPos)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    int nPackagesSelected = 0;
+    int nDescendantsUpdated = 0;
+    bool sign_block = false;
+    CMutableTransaction coinbaseTx;
+
+    // Crete template
+    //---
+    CBlockIndex* pindexPrev = AssembleBlock(scriptPubKeyIn, block_time, isPos, coinbaseTx, nPackagesSelected, nDescendantsUpdated);
+    int64_t nTime1 = GetTimeMicros();
+
     // PIVX PoS mining code
     //---
     if (pblock->IsProofOfStake()) {
@@ -317,6 +324,71 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(
     return std::move(pblocktemplate);
 }
 
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateStakeTemplate(int64_t block_time)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    int nPackagesSelected = 0;
+    int nDescendantsUpdated = 0;
+    CMutableTransaction coinbaseTx;
+    AssembleBlock(CScript(), block_time, true, coinbaseTx, nPackagesSelected, nDescendantsUpdated);
+    if (!pblock->IsProofOfStake()) {
+        return nullptr;
+    }
+
+    // The coinstake placeholder stays empty until FinishProofOfStake()
+    pblock->CoinBase() = MakeTransactionRef(std::move(coinbaseTx));
+    pblocktemplate->vTxFees[0] = -nFees;
+    pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(*pblock->CoinBase());
+
+    LogPrint(BCLog::BENCHMARK, "CreateStakeTemplate() packages: %.2fms (%d packages, %d updated descendants)\n", 0.001 * (GetTimeMicros() - nTimeStart), nPackagesSelected, nDescendantsUpdated);
+
+    return std::move(pblocktemplate);
+}
+
+bool BlockAssembler::FinishProofOfStake(CBlockTemplate& blocktemplate, CWallet& wallet, const CWallet::StakeKernel& kernel)
+{
+    CBlock& block = *blocktemplate.block;
+
+    // The kernel only holds for the header it was searched with
+    if (block.hashPrevBlock != kernel.header.hashPrevBlock || block.nVersion != kernel.header.nVersion || block.nBits != kernel.header.nBits) {
+        return error("%s: kernel does not match the block template", __func__);
+    }
+
+    CMutableTransaction coinbaseTx(*block.CoinBase());
+    if (!wallet.CreateCoinStake(kernel, block, coinbaseTx)) {
+        return false;
+    }
+    blocktemplate.vTxFees[1] = 0;
+    blocktemplate.vTxSigOps[1] = GetLegacySigOpCount(*block.Stake());
+
+    block.CoinBase() = MakeTransactionRef(std::move(coinbaseTx));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    blocktemplate.vTxSigOps[0] = GetLegacySigOpCount(*block.CoinBase());
+
+    if (!block.SignBlock(wallet)) {
+        return error("%s: failed to sign block", __func__);
+    }
+
+    // Validate
+    //---
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        CBlockIndex* pindexPrev = ::ChainActive().Tip();
+
+        if (pindexPrev->GetBlockHash() != block.hashPrevBlock) {
+            LogPrint(BCLog::STAKING, "%s: the network has already found another block\n", __func__);
+            return false;
+        }
+
+        if (!TestBlockValidity(state, Params(), block, pindexPrev, false, false)) {
+            return error("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state));
+        }
+    }
+    return true;
+}
+
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
 {
     for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
@@ -585,31 +657,158 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 }
 
 
-void PoSMiner(std::shared_ptr<CWallet> pwallet, CThreadInterrupt &interrupt)
+static Mutex cs_stakingPhaseTimes;
+static StakingPhaseTimes g_stakingPhaseTimes GUARDED_BY(cs_stakingPhaseTimes);
+
+static void RecordStakingPhase(StakingPhaseTimes::Phase StakingPhaseTimes::*phase, int64_t nMicros)
+{
+    LOCK(cs_stakingPhaseTimes);
+    StakingPhaseTimes::Phase& times = g_stakingPhaseTimes.*phase;
+    times.nLastMicros = nMicros;
+    times.nTotalMicros += nMicros;
+    ++times.nCount;
+}
+
+StakingPhaseTimes GetStakingPhaseTimes()
+{
+    LOCK(cs_stakingPhaseTimes);
+    return g_stakingPhaseTimes;
+}
+
+/** Sleep until the timeout expires, the tip moves away from tip, or the miner is interrupted */
+static void WaitForStakingWork(CThreadInterrupt& interrupt, const uint256& tip, std::chrono::seconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!interrupt && std::chrono::steady_clock::now() < deadline) {
+        WAIT_LOCK(g_best_block_mutex, lock);
+        if (g_best_block != tip) {
+            return;
+        }
+        g_best_block_cv.wait_for(lock, std::chrono::milliseconds(250));
+    }
+}
+
+/**
+ * Search the stake inputs of all wallets for a kernel on top of pindexPrev. The inputs
+ * are merged into one work set, so each is hashed once however many wallets hold it,
+ * and scanned on the threads of pool. pwinner is set to the wallet owning the kernel.
+ */
+static bool FindStakeKernel(const std::vector<std::shared_ptr<CWallet>>& wallets, const CBlockIndex* pindexPrev,
+                            const CBlockHeader& header, ctpl::thread_pool& pool,
+                            CWallet::StakeKernel& kernel, std::shared_ptr<CWallet>& pwinner)
+{
+    std::vector<StakeKernelCandidate> vCandidates;
+    std::vector<CPubKey> vKeys;
+    std::vector<size_t> vOwners;
+    std::vector<bool> vSearched(wallets.size(), false);
+    std::set<COutPoint> setSeen;
+    for (size_t i = 0; i < wallets.size(); ++i) {
+        std::vector<StakeKernelCandidate> candidates;
+        std::vector<CPubKey> keys;
+        if (!wallets[i]->GetStakeKernelCandidates(pindexPrev, header, candidates, keys)) {
+            continue;
+        }
+        vSearched[i] = true;
+        for (size_t j = 0; j < candidates.size(); ++j) {
+            // The first wallet holding an input stakes it
+            if (!setSeen.insert(candidates[j].prevout).second) {
+                continue;
+            }
+            vCandidates.push_back(candidates[j]);
+            vKeys.push_back(keys[j]);
+            vOwners.push_back(i);
+        }
+    }
+
+    StakeKernelWindow window;
+    {
+        LOCK(cs_main);
+        // -poshashdrift is node wide, every wallet holds the same value
+        if (!PrepareStakeKernelWindow(header, *pindexPrev, wallets.front()->nHashDrift, window)) {
+            return false;
+        }
+        // Kernels not newer than the median time past would be rejected
+        window.nTimePastLimit = ::ChainActive().Tip()->GetMedianTimePast();
+    }
+
+    StakeKernelSearch search;
+    SearchStakeKernels(window, vCandidates, pool.size() + 1, search, &pool);
+
+    // Account the hashing to the wallets owning the inputs
+    std::vector<uint64_t> vScanned(wallets.size(), 0);
+    std::vector<uint64_t> vKernels(wallets.size(), 0);
+    for (size_t i = 0; i < vCandidates.size(); ++i) {
+        if (search.vHashes[i] > 0) {
+            ++vScanned[vOwners[i]];
+        }
+        vKernels[vOwners[i]] += search.vHashes[i];
+    }
+    const int64_t nNow = GetTime();
+    for (size_t i = 0; i < wallets.size(); ++i) {
+        if (!vSearched[i]) {
+            continue;
+        }
+        LOCK(wallets[i]->cs_wallet);
+        CWallet::StakeSearchStats& stats = wallets[i]->m_last_stake_search;
+        stats.nTime = nNow;
+        stats.nDurationMicros = search.nDurationMicros;
+        stats.nThreads = search.nThreads;
+        stats.nCandidates = vScanned[i];
+        stats.nKernels = vKernels[i];
+    }
+    LogPrint(BCLog::STAKING, "%s : scanned %u of %u inputs from %u wallets in %.2fms using %d threads\n", __func__,
+             search.nScanned, vCandidates.size(), wallets.size(), search.nDurationMicros * 0.001, search.nThreads);
+
+    if (search.nFound == vCandidates.size() || ShutdownRequested()) {
+        LogPrint(BCLog::STAKING, "%s : no stakes found\n", __func__);
+        return false;
+    }
+
+    kernel.header = header;
+    kernel.header.nTime = search.nTimeTx;
+    kernel.header.nStakeModifier() = search.nStakeModifier;
+    kernel.header.posPubKey = vKeys[search.nFound];
+    kernel.prevout = vCandidates[search.nFound].prevout;
+    pwinner = wallets[vOwners[search.nFound]];
+
+    LogPrint(BCLog::STAKING, "%s : kernel found wallet=%s tx=%s n=%u time=%u hashProof=%s\n", __func__,
+             pwinner->GetName(), kernel.prevout.hash.ToString(), kernel.prevout.n, kernel.header.nTime,
+             search.hashProofOfStake.ToString());
+    return true;
+}
+
+void PoSMiner(CThreadInterrupt &interrupt)
 {
     LogPrintf("PoSMiner started\n");
     util::ThreadRename("piratecash-miner");
     SetThreadPriority(THREAD_PRIORITY_NORMAL);
 
     BlockAssembler ba{Params()};
-    CScript coinbaseScript; // unused for PoS
 
-    //control the amount of times the client will check for mintable coins
-    bool fMintableCoins = false;
-    int nMintableLastCheck = 0;
+    //control the amount of times the client will check for mintable coins, per wallet
+    std::map<std::string, std::pair<int64_t, bool>> mapMintableCoins;
     int last_height = -1;
     int64_t start_block_time = 0;
+    uint256 last_tip;
+    unsigned int hash_interval = 1;
     const CChainParams& chainparams = Params();
 
+    // Kernel search threads shared by all wallets, the miner thread being one more
+    ctpl::thread_pool workerPool;
+
+    // Template pre-assembled while no kernel is found, used if the tip and
+    // the mempool are unchanged when one is
+    std::unique_ptr<CBlockTemplate> pspeculative;
+    unsigned int nSpeculativeMempoolUpdates = 0;
+
     while (!interrupt) {
-        auto hash_interval = std::max(pwallet->nHashInterval, (unsigned int)1);
-        interrupt.sleep_for(std::chrono::seconds(hash_interval));
+        WaitForStakingWork(interrupt, last_tip, std::chrono::seconds(hash_interval));
+        if (interrupt) break;
+        last_tip = WITH_LOCK(g_best_block_mutex, return g_best_block);
 
-        if ((GetTime() - nMintableLastCheck > 60))
-        {
-            nMintableLastCheck = GetTime();
-            fMintableCoins = pwallet->MintableCoins();
-        }
+        const std::vector<std::shared_ptr<CWallet>> wallets = GetWallets();
+        // -poshashinterval is node wide, every wallet holds the same value
+        hash_interval = wallets.empty() ? 1 : std::max(wallets.front()->nHashInterval, (unsigned int)1);
 
         {
             CBlockIndex* pindexPrev = ::ChainActive().Tip();
@@ -638,17 +837,39 @@ void PoSMiner(std::shared_ptr<CWallet> pwallet, CThreadInterrupt &interrupt)
 
         miningStatus = "";
 
-        if (pwallet->IsLocked(true) ||
-            !fMintableCoins ||
-            (nReserveBalance >= pwallet->GetBalance().m_mine_trusted) ||
+        // Every loaded wallet that is unlocked and has coins above the reserve takes part
+        std::vector<std::shared_ptr<CWallet>> vStakingWallets;
+        bool fAnyUnlocked = false;
+        bool fAnyMintable = false;
+        bool fAnyAboveReserve = false;
+        int nThreads = 1;
+        for (const auto& pwallet : wallets) {
+            auto& mintable = mapMintableCoins[pwallet->GetName()];
+            if (GetTime() - mintable.first > 60) {
+                mintable = std::make_pair(GetTime(), pwallet->MintableCoins());
+            }
+            const bool fUnlocked = !pwallet->IsLocked(true);
+            const bool fAboveReserve = nReserveBalance < pwallet->GetTrustedBalance();
+            fAnyUnlocked |= fUnlocked;
+            fAnyMintable |= mintable.second;
+            fAnyAboveReserve |= fAboveReserve;
+            if (fUnlocked && mintable.second && fAboveReserve) {
+                vStakingWallets.push_back(pwallet);
+                nThreads = std::max(nThreads, pwallet->nStakeThreads);
+            }
+        }
+
+        if (vStakingWallets.empty() ||
             !masternodeSync.IsSynced() ||
             (g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0)
         ) {
             miningStatus += ":";
-            if (pwallet->IsLocked(true)){
+            if (wallets.empty()) {
+                miningStatus += "<br>- no wallet is loaded";
+            } else if (!fAnyUnlocked) {
                 miningStatus += "<br>- wallet is currently <b>locked</b>";
             }
-            if (nReserveBalance >= pwallet->GetBalance().m_mine_trusted){
+            if (!wallets.empty() && !fAnyAboveReserve){
                 miningStatus += "<br>- your balance is less than the reserved amount";
             }
             if (!masternodeSync.IsSynced()){
@@ -657,21 +878,31 @@ void PoSMiner(std::shared_ptr<CWallet> pwallet, CThreadInterrupt &interrupt)
             if ((g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0)){
                 miningStatus += "<br>- no connections with network";
             }
-            if (!fMintableCoins){
+            if (!wallets.empty() && !fAnyMintable){
                 miningStatus += "<br>- no mature or available coins for staking";
             }
+            if (vStakingWallets.empty() && fAnyUnlocked && fAnyMintable && fAnyAboveReserve) {
+                miningStatus += "<br>- no unlocked wallet has coins to stake";
+            }
             nLastCoinStakeSearchTime = 0;
             interrupt.sleep_for(std::chrono::seconds(hash_interval));
-            LogPrint(BCLog::STAKING, "%s : not ready to mine locked=%d coins=%d reserve=%d mnsync=%d peers=%d\n",
+            LogPrint(BCLog::STAKING, "%s : not ready to mine wallets=%u staking=%u unlocked=%d coins=%d reserve=%d mnsync=%d peers=%d\n",
                                   __func__,
-                                  int(pwallet->IsLocked(true)),
-                                  int(!fMintableCoins),
-                                  int(nReserveBalance >= pwallet->GetBalance().m_mine_trusted),
+                                  wallets.size(),
+                                  vStakingWallets.size(),
+                                  int(fAnyUnlocked),
+                                  int(fAnyMintable),
+                                  int(fAnyAboveReserve),
                                   int(!masternodeSync.IsSynced()),
                                   int(g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL)));
             continue;
         }
 
+        if (workerPool.size() != nThreads - 1) {
+            workerPool.resize(nThreads - 1);
+            RenameThreadPool(workerPool, "piratecash-stake");
+        }
+
         if (last_height == ::ChainActive().Height())
         {
             if ((GetTime() - hash_interval) < nLastCoinStakeSearchTime)
@@ -684,45 +915,108 @@ void PoSMiner(std::shared_ptr<CWallet> pwallet, CThreadInterrupt &interrupt)
         }
 
         //
-        // Create new block
+        // Scan for a kernel, no block is assembled until one is found
         //
-        auto pblocktemplate = ba.CreateNewBlock(coinbaseScript, pwallet, start_block_time, true);
-        nLastCoinStakeSearchTime = GetAdjustedTime();
-
-        if (!pblocktemplate.get())
-            continue;
+        const CBlockIndex* pindexPrev;
+        CBlockHeader header;
+        {
+            LOCK(cs_main);
+            pindexPrev = ::ChainActive().Tip();
+            header.nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus(), chainparams.BIP9CheckMasternodesUpgraded(), true);
+            if (chainparams.MineBlocksOnDemand())
+                header.nVersion = gArgs.GetArg("-blockversion", header.nVersion);
+            header.hashPrevBlock = pindexPrev->GetBlockHash();
+            header.nBits = GetNextWorkRequired(pindexPrev, &header, chainparams.GetConsensus());
+            header.nTime = start_block_time;
+            UpdateTime(&header, chainparams.GetConsensus(), pindexPrev);
+        }
 
-        auto pblock = pblocktemplate->block;
-        
-        CValidationState state;
+        int64_t nTimeStart = GetTimeMicros();
+        CWallet::StakeKernel kernel;
+        std::shared_ptr<CWallet> pwinner;
+        const bool fKernelFound = FindStakeKernel(vStakingWallets, pindexPrev, header, workerPool, kernel, pwinner);
+        nLastCoinStakeSearchTime = GetAdjustedTime();
+        int64_t nTimeScan = GetTimeMicros();
+        RecordStakingPhase(&StakingPhaseTimes::kernelScan, nTimeScan - nTimeStart);
 
-        if (!CheckProof(state, *pblock, Params().GetConsensus())) {
+        if (!fKernelFound) {
             // Mimics limit in pos_kernel.cpp
             start_block_time = std::min<int64_t>(
-                pblock->nTime + pwallet->nHashDrift,
+                header.nTime + vStakingWallets.front()->nHashDrift,
                 nLastCoinStakeSearchTime + MAX_POS_BLOCK_AHEAD_TIME - MAX_POS_BLOCK_AHEAD_SAFETY_MARGIN
             );
 
+            // Use the idle time to have a template ready for the next kernel
+            if (!pspeculative || pspeculative->block->hashPrevBlock != header.hashPrevBlock ||
+                nSpeculativeMempoolUpdates != mempool.GetTransactionsUpdated()) {
+                nSpeculativeMempoolUpdates = mempool.GetTransactionsUpdated();
+                pspeculative = ba.CreateStakeTemplate(header.nTime);
+                RecordStakingPhase(&StakingPhaseTimes::templateBuild, GetTimeMicros() - nTimeScan);
+            }
             continue;
         }
 
+        //
+        // Assemble the block around the kernel
+        //
+        std::unique_ptr<CBlockTemplate> pblocktemplate;
+        if (pspeculative && pspeculative->block->hashPrevBlock == kernel.header.hashPrevBlock &&
+            nSpeculativeMempoolUpdates == mempool.GetTransactionsUpdated()) {
+            pblocktemplate = std::move(pspeculative);
+            LOCK(cs_stakingPhaseTimes);
+            ++g_stakingPhaseTimes.nSpeculativeHits;
+        } else {
+            pspeculative.reset();
+            pblocktemplate = ba.CreateStakeTemplate(kernel.header.nTime);
+        }
+        int64_t nTimeTemplate = GetTimeMicros();
+        RecordStakingPhase(&StakingPhaseTimes::templateBuild, nTimeTemplate - nTimeScan);
+
+        if (!pblocktemplate) {
+            continue;
+        }
+        // The wallet owning the kernel signs the coinstake and the block
+        const bool fSigned = BlockAssembler::FinishProofOfStake(*pblocktemplate, *pwinner, kernel);
+        int64_t nTimeSign = GetTimeMicros();
+        RecordStakingPhase(&StakingPhaseTimes::sign, nTimeSign - nTimeTemplate);
+
+        if (!fSigned) {
+            continue;
+        }
+
+        auto pblock = pblocktemplate->block;
+
         //Stake miner main
-        LogPrintf("PoSMiner : proof-of-stake block found %s \n", pblock->GetHash().ToString().c_str());
+        LogPrintf("PoSMiner : proof-of-stake block found %s wallet=%s\n", pblock->GetHash().ToString().c_str(), pwinner->GetName());
 
         bool fNewBlock = false;
         bool fAccepted = ProcessNewBlock(Params(), pblock, true, &fNewBlock);
         auto hash = pblock->GetHash();
+        int64_t nTimeSubmit = GetTimeMicros();
+        RecordStakingPhase(&StakingPhaseTimes::submit, nTimeSubmit - nTimeSign);
 
         if (fAccepted) {
             if (fNewBlock) {
                 LogPrintf("PoSMiner : block is submitted %s\n", hash.ToString().c_str());
+                LOCK(pwinner->cs_wallet);
+                CWallet::StakeHitStats& hits = pwinner->m_stake_hits;
+                ++hits.nCount;
+                hits.nLastTime = pblock->GetBlockTime();
+                hits.nLastHeight = pindexPrev->nHeight + 1;
+                hits.hashLastBlock = hash;
             } else {
                 LogPrintf("PoSMiner : block duplicate %s\n", hash.ToString().c_str());
             }
         } else {
             LogPrintf("PoSMiner : block is rejected %s\n", hash.ToString().c_str());
         }
+        LogPrint(BCLog::BENCHMARK, "PoSMiner: kernel scan %.2fms, template %.2fms, signing %.2fms, submit %.2fms\n",
+                 0.001 * (nTimeScan - nTimeStart), 0.001 * (nTimeTemplate - nTimeScan),
+                 0.001 * (nTimeSign - nTimeTemplate), 0.001 * (nTimeSubmit - nTimeSign));
     }
+
+    workerPool.clear_queue();
+    workerPool.stop(true);
 }
 
 bool IsStakingActive() {
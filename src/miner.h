@@ -164,6 +164,13 @@ public:
 
     /** Construct a new block template with coinbase to scriptPubKeyIn */
     std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, std::shared_ptr<CWallet> pwallet, int64_t block_time=0, bool isPos = false);
+    /**
+     * Construct a proof-of-stake block template on the current tip, leaving the
+     * coinstake and the coinbase payee to FinishProofOfStake().
+     */
+    std::unique_ptr<CBlockTemplate> CreateStakeTemplate(int64_t block_time);
+    /** Spend a kernel in a template from CreateStakeTemplate(), sign the block and check it against the current tip */
+    static bool FinishProofOfStake(CBlockTemplate& blocktemplate, CWallet& wallet, const CWallet::StakeKernel& kernel);
 
     static Optional<int64_t> m_last_block_num_txs;
     static Optional<int64_t> m_last_block_size;
@@ -172,6 +179,9 @@ private:
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
+    /** Fill a new template on the current tip up to the coinbase, which is returned in coinbaseTx */
+    CBlockIndex* AssembleBlock(const CScript& scriptPubKeyIn, int64_t block_time, bool isPos,
+                               CMutableTransaction& coinbaseTx, int& nPackagesSelected, int& nDescendantsUpdated);
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
 
@@ -205,7 +215,24 @@ private:
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
-void PoSMiner(std::shared_ptr<CWallet> pwallet, CThreadInterrupt &interrupt);
+/** Time spent by PoSMiner in each phase of producing a block */
+struct StakingPhaseTimes {
+    struct Phase {
+        int64_t nLastMicros{0};
+        int64_t nTotalMicros{0};
+        uint64_t nCount{0};
+    };
+    Phase kernelScan;
+    Phase templateBuild;
+    Phase sign;
+    Phase submit;
+    //! Kernels spent in a template assembled before they were found
+    uint64_t nSpeculativeHits{0};
+};
+
+/** Stake with every loaded wallet that is unlocked and has coins to stake */
+void PoSMiner(CThreadInterrupt &interrupt);
+StakingPhaseTimes GetStakingPhaseTimes();
 bool IsStakingActive();
 std::string getMiningStatus();
 void SetThreadPriority(int nPriority);
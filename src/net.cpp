@@ -47,6 +47,13 @@
 
 #ifdef USE_EPOLL
 #include <sys/epoll.h>
+
+// epoll_event::data of a node socket is its CNode. The listening sockets and the
+// wakeup pipe carry their descriptor with the lowest bit set, which never is for
+// a CNode pointer.
+static uint64_t EpollSocketData(SOCKET hSocket) { return (uint64_t(hSocket) << 1) | 1; }
+static bool IsEpollSocketData(uint64_t data) { return (data & 1) != 0; }
+static SOCKET EpollDataSocket(uint64_t data) { return (SOCKET)(data >> 1); }
 #endif
 
 #ifdef USE_KQUEUE
@@ -1447,7 +1454,7 @@ void CConnman::SocketEventsKqueue(std::set<SOCKET> &recv_set, std::set<SOCKET> &
 #endif
 
 #ifdef USE_EPOLL
-void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll)
+void CConnman::SocketEventsEpoll(SocketEventsResult& result, bool fOnlyPoll)
 {
     const size_t maxEvents = 64;
     epoll_event events[maxEvents];
@@ -1455,20 +1462,36 @@ void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
     wakeupSelectNeeded = true;
     int n = epoll_wait(epollfd, events, maxEvents, fOnlyPoll ? 0 : SELECT_TIMEOUT_MILLISECONDS);
     wakeupSelectNeeded = false;
+    if (n > 0) {
+        result.vNodeEvents.reserve(n);
+    }
     for (int i = 0; i < n; i++) {
         auto& e = events[i];
-        if((e.events & EPOLLERR) || (e.events & EPOLLHUP)) {
-            error_set.insert((SOCKET)e.data.fd);
+        const bool fError = (e.events & EPOLLERR) || (e.events & EPOLLHUP);
+        if (IsEpollSocketData(e.data.u64)) {
+            const SOCKET hSocket = EpollDataSocket(e.data.u64);
+#ifdef USE_WAKEUP_PIPE
+            if (hSocket == wakeupPipe[0]) {
+                result.fWakeup = true;
+                continue;
+            }
+#endif
+            if (!fError && (e.events & EPOLLIN)) {
+                result.vListenSockets.push_back(hSocket);
+            }
             continue;
         }
 
-        if (e.events & EPOLLIN) {
-            recv_set.insert((SOCKET)e.data.fd);
-        }
-
-        if (e.events & EPOLLOUT) {
-            send_set.insert((SOCKET)e.data.fd);
+        // Nodes are unregistered before they are closed and only deleted by this
+        // thread, so the pointer is valid for the rest of this SocketHandler() run
+        NodeSocketEvents node_events{static_cast<CNode*>(e.data.ptr)};
+        if (fError) {
+            node_events.fError = true;
+        } else {
+            node_events.fRecv = (e.events & EPOLLIN) != 0;
+            node_events.fSend = (e.events & EPOLLOUT) != 0;
         }
+        result.vNodeEvents.push_back(node_events);
     }
 }
 #endif
@@ -1597,8 +1620,9 @@ void CConnman::SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &
     }
 }
 
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll)
+void CConnman::SocketEvents(SocketEventsResult& result, bool fOnlyPoll)
 {
+    std::set<SOCKET> recv_set, send_set, error_set;
     switch (socketEventsMode) {
 #ifdef USE_KQUEUE
         case SOCKETEVENTS_KQUEUE:
@@ -1607,8 +1631,8 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 #endif
 #ifdef USE_EPOLL
         case SOCKETEVENTS_EPOLL:
-            SocketEventsEpoll(recv_set, send_set, error_set, fOnlyPoll);
-            break;
+            SocketEventsEpoll(result, fOnlyPoll);
+            return;
 #endif
 #ifdef USE_POLL
         case SOCKETEVENTS_POLL:
@@ -1621,6 +1645,50 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
         default:
             assert(false);
     }
+
+    // The other modes report sockets, map them back to their nodes
+    MapSocketEvents(recv_set, send_set, error_set, result);
+}
+
+void CConnman::MapSocketEvents(const std::set<SOCKET>& recv_set, const std::set<SOCKET>& send_set, const std::set<SOCKET>& error_set, SocketEventsResult& result)
+{
+#ifdef USE_WAKEUP_PIPE
+    result.fWakeup = recv_set.count(wakeupPipe[0]) > 0;
+#endif
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket) > 0) {
+            result.vListenSockets.push_back(hListenSocket.socket);
+        }
+    }
+
+    LOCK(cs_vNodes);
+    std::unordered_map<SOCKET, size_t> mapEventsIndex;
+    auto eventsFor = [&](SOCKET hSocket) -> NodeSocketEvents* {
+        auto it = mapSocketToNode.find(hSocket);
+        if (it == mapSocketToNode.end()) {
+            return nullptr;
+        }
+        auto jt = mapEventsIndex.emplace(hSocket, result.vNodeEvents.size());
+        if (jt.second) {
+            result.vNodeEvents.push_back(NodeSocketEvents{it->second});
+        }
+        return &result.vNodeEvents[jt.first->second];
+    };
+    for (auto hSocket : error_set) {
+        if (auto node_events = eventsFor(hSocket)) {
+            node_events->fError = true;
+        }
+    }
+    for (auto hSocket : recv_set) {
+        if (auto node_events = eventsFor(hSocket)) {
+            node_events->fRecv = true;
+        }
+    }
+    for (auto hSocket : send_set) {
+        if (auto node_events = eventsFor(hSocket)) {
+            node_events->fSend = true;
+        }
+    }
 }
 
 void CConnman::SocketHandler()
@@ -1643,12 +1711,12 @@ void CConnman::SocketHandler()
         }
     }
 
-    std::set<SOCKET> recv_set, send_set, error_set;
-    SocketEvents(recv_set, send_set, error_set, fOnlyPoll);
+    SocketEventsResult events;
+    SocketEvents(events, fOnlyPoll);
 
 #ifdef USE_WAKEUP_PIPE
     // drain the wakeup pipe
-    if (recv_set.count(wakeupPipe[0])) {
+    if (events.fWakeup) {
         char buf[128];
         while (true) {
             int r = read(wakeupPipe[0], buf, sizeof(buf));
@@ -1664,11 +1732,14 @@ void CConnman::SocketHandler()
     //
     // Accept new connections
     //
-    for (const ListenSocket& hListenSocket : vhListenSocket)
+    for (SOCKET hSocket : events.vListenSockets)
     {
-        if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket) > 0)
+        for (const ListenSocket& hListenSocket : vhListenSocket)
         {
-            AcceptConnection(hListenSocket);
+            if (hListenSocket.socket == hSocket)
+            {
+                AcceptConnection(hListenSocket);
+            }
         }
     }
 
@@ -1677,38 +1748,22 @@ void CConnman::SocketHandler()
     std::vector<CNode*> vSendableNodes;
     {
         LOCK(cs_vNodes);
-        for (auto hSocket : error_set) {
-            auto it = mapSocketToNode.find(hSocket);
-            if (it == mapSocketToNode.end()) {
-                continue;
-            }
-            it->second->AddRef();
-            vErrorNodes.emplace_back(it->second);
-        }
-        for (auto hSocket : recv_set) {
-            if (error_set.count(hSocket)) {
-                // no need to handle it twice
-                continue;
-            }
-
-            auto it = mapSocketToNode.find(hSocket);
-            if (it == mapSocketToNode.end()) {
-                continue;
+        for (const NodeSocketEvents& node_events : events.vNodeEvents) {
+            CNode* pnode = node_events.pnode;
+            if (node_events.fError) {
+                pnode->AddRef();
+                vErrorNodes.emplace_back(pnode);
+            } else if (node_events.fRecv) {
+                // no need to handle error sockets twice
+                auto jt = mapReceivableNodes.emplace(pnode->GetId(), pnode);
+                assert(jt.first->second == pnode);
+                pnode->fHasRecvData = true;
             }
-
-            auto jt = mapReceivableNodes.emplace(it->second->GetId(), it->second);
-            assert(jt.first->second == it->second);
-            it->second->fHasRecvData = true;
-        }
-        for (auto hSocket : send_set) {
-            auto it = mapSocketToNode.find(hSocket);
-            if (it == mapSocketToNode.end()) {
-                continue;
+            if (node_events.fSend) {
+                auto jt = mapSendableNodes.emplace(pnode->GetId(), pnode);
+                assert(jt.first->second == pnode);
+                pnode->fCanSendData = true;
             }
-
-            auto jt = mapSendableNodes.emplace(it->second->GetId(), it->second);
-            assert(jt.first->second == it->second);
-            it->second->fCanSendData = true;
         }
 
         // collect nodes that have a receivable socket
@@ -1846,7 +1901,7 @@ size_t CConnman::SocketRecvData(CNode *pnode)
                 pnode->nProcessQueueSize += nSizeAdded;
                 pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
             }
-            WakeMessageHandler();
+            WakeMessageHandler(pnode);
         }
     }
     else if (nBytes == 0)
@@ -1903,9 +1958,31 @@ void CConnman::WakeMessageHandler()
 {
     {
         LOCK(mutexMsgProc);
-        fMsgProcWake = true;
+        std::fill(vMsgProcWake.begin(), vMsgProcWake.end(), true);
+    }
+    condMsgProc.notify_all();
+}
+
+void CConnman::WakeMessageHandler(const CNode* pnode)
+{
+    {
+        LOCK(mutexMsgProc);
+        if (vMsgProcWake.empty()) {
+            return;
+        }
+        vMsgProcWake[GetMessageHandlerShard(pnode)] = true;
+    }
+    // All shards wait on the same condition variable, only the owner of pnode finds its flag set
+    if (nMessageHandlerThreads == 1) {
+        condMsgProc.notify_one();
+    } else {
+        condMsgProc.notify_all();
     }
-    condMsgProc.notify_one();
+}
+
+int CConnman::GetMessageHandlerShard(const CNode* pnode) const
+{
+    return pnode->GetId() % nMessageHandlerThreads;
 }
 
 void CConnman::WakeSelect()
@@ -2577,13 +2654,17 @@ void CConnman::OpenMasternodeConnection(const CAddress &addrConnect, bool probe)
     OpenNetworkConnection(addrConnect, false, nullptr, nullptr, false, false, false, true, probe);
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int nShard)
 {
     int64_t nLastSendMessagesTimeMasternodes = 0;
 
     while (!flagInterruptMsgProc)
     {
-        std::vector<CNode*> vNodesCopy = CopyNodeVector();
+        FlushRelayQueue();
+
+        std::vector<CNode*> vNodesCopy = CopyNodeVector([this, nShard](const CNode* pnode) {
+            return GetMessageHandlerShard(pnode) == nShard;
+        });
 
         bool fMoreWork = false;
 
@@ -2617,9 +2698,9 @@ void CConnman::ThreadMessageHandler()
 
         WAIT_LOCK(mutexMsgProc, lock);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this]() EXCLUSIVE_LOCKS_REQUIRED(mutexMsgProc) { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, nShard]() EXCLUSIVE_LOCKS_REQUIRED(mutexMsgProc) { return vMsgProcWake[nShard]; });
         }
-        fMsgProcWake = false;
+        vMsgProcWake[nShard] = false;
     }
 }
 
@@ -2627,7 +2708,7 @@ void CConnman::ThreadMessageHandler()
 // ppcoin: stake minter thread
 void CConnman::ThreadStakeMinter()
 {
-    PoSMiner(GetWallets()[0], interruptNet);
+    PoSMiner(interruptNet);
 }
 
 
@@ -2707,7 +2788,7 @@ bool CConnman::BindListenPort(const CService& addrBind, bilingual_str& strError,
 #ifdef USE_EPOLL
     if (socketEventsMode == SOCKETEVENTS_EPOLL) {
         epoll_event event;
-        event.data.fd = hListenSocket;
+        event.data.u64 = EpollSocketData(hListenSocket);
         event.events = EPOLLIN;
         if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket, &event) != 0) {
             strError = strprintf(_("Error: failed to add socket to epollfd (epoll_ctl returned error %s)"), NetworkErrorString(WSAGetLastError()));
@@ -2929,7 +3010,7 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     {
         LOCK(mutexMsgProc);
-        fMsgProcWake = false;
+        vMsgProcWake.assign(nMessageHandlerThreads, false);
     }
 
 #ifdef USE_WAKEUP_PIPE
@@ -2961,7 +3042,7 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         if (socketEventsMode == SOCKETEVENTS_EPOLL) {
             epoll_event event;
             event.events = EPOLLIN;
-            event.data.fd = wakeupPipe[0];
+            event.data.u64 = EpollSocketData(wakeupPipe[0]);
             int r = epoll_ctl(epollfd, EPOLL_CTL_ADD, wakeupPipe[0], &event);
             if (r != 0) {
                 LogPrint(BCLog::NET, "%s -- epoll_ctl(%d, %d, %d, ...) failed. error: %s\n", __func__,
@@ -2999,7 +3080,15 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     threadOpenMasternodeConnections = std::thread(&TraceThread<std::function<void()> >, "mncon", std::function<void()>(std::bind(&CConnman::ThreadOpenMasternodeConnections, this)));
 
     // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    // With several handler threads, a peer stuck behind cs_main (e.g. block validation) only delays the peers of
+    // its own shard, the others keep processing network-only messages like pings, inventory and LLMQ sig shares
+    for (int nShard = 0; nShard < nMessageHandlerThreads; ++nShard) {
+        std::string strThreadName = nShard == 0 ? "msghand" : strprintf("msghand.%d", nShard);
+        threadMessageHandlers.emplace_back(&TraceThread<std::function<void()> >, strThreadName, std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, nShard)));
+    }
+    if (nMessageHandlerThreads > 1) {
+        LogPrintf("Using %d message handler threads\n", nMessageHandlerThreads);
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpAddresses, this), DUMP_PEERS_INTERVAL * 1000);
@@ -3061,8 +3150,11 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& threadMessageHandler : threadMessageHandlers) {
+        if (threadMessageHandler.joinable())
+            threadMessageHandler.join();
+    }
+    threadMessageHandlers.clear();
     if (threadOpenMasternodeConnections.joinable())
         threadOpenMasternodeConnections.join();
     if (threadOpenConnections.joinable())
@@ -3460,41 +3552,102 @@ void CConnman::RelayTransaction(const CTransaction& tx)
 }
 
 void CConnman::RelayInv(CInv &inv, const int minProtoVersion) {
-    LOCK(cs_vNodes);
-    for (const auto& pnode : vNodes) {
-        if (pnode->nVersion < minProtoVersion || !pnode->CanRelay())
-            continue;
-        pnode->PushInventory(inv);
-    }
+    QueueRelayInv(inv, minProtoVersion, nullptr, uint256());
 }
 
-void CConnman::RelayInvFiltered(CInv &inv, const CTransaction& relatedTx, const int minProtoVersion)
+void CConnman::RelayInvFiltered(CInv &inv, const CTransactionRef& relatedTx, const int minProtoVersion)
 {
-    LOCK(cs_vNodes);
-    for (const auto& pnode : vNodes) {
-        if (pnode->nVersion < minProtoVersion || !pnode->CanRelay())
-            continue;
-        {
-            LOCK(pnode->cs_filter);
-            if(pnode->pfilter && !pnode->pfilter->IsRelevantAndUpdate(relatedTx))
-                continue;
-        }
-        pnode->PushInventory(inv);
-    }
+    QueueRelayInv(inv, minProtoVersion, relatedTx, relatedTx->GetHash());
 }
 
 void CConnman::RelayInvFiltered(CInv &inv, const uint256& relatedTxHash, const int minProtoVersion)
 {
-    LOCK(cs_vNodes);
-    for (const auto& pnode : vNodes) {
-        if (pnode->nVersion < minProtoVersion || !pnode->CanRelay())
-            continue;
-        {
+    QueueRelayInv(inv, minProtoVersion, nullptr, relatedTxHash);
+}
+
+void CConnman::QueueRelayInv(const CInv& inv, int minProtoVersion, const CTransactionRef& relatedTx, const uint256& relatedTxHash)
+{
+    bool fWasEmpty;
+    {
+        LOCK(cs_vRelayQueue);
+        fWasEmpty = vRelayQueue.empty();
+        vRelayQueue.push_back(QueuedRelayInv{inv, minProtoVersion, relatedTx, relatedTxHash, GetTimeMicros()});
+    }
+    // The message handler flushes the queue on its next iteration. Invs queued while it is busy are
+    // batched together, so only the first one of a batch needs to wake it up.
+    if (fWasEmpty) {
+        WakeMessageHandler();
+    }
+}
+
+void CConnman::FlushRelayQueue()
+{
+    std::vector<QueuedRelayInv> vQueued;
+    {
+        LOCK(cs_vRelayQueue);
+        if (vRelayQueue.empty()) {
+            return;
+        }
+        vQueued.swap(vRelayQueue);
+    }
+
+    const int64_t nTimeStart = GetTimeMicros();
+    int64_t nTimeFilterLock = 0;
+    int64_t nTimeInventoryLock = 0;
+
+    const bool fAnyFiltered = std::any_of(vQueued.begin(), vQueued.end(), [](const QueuedRelayInv& queued) {
+        return !queued.relatedTxHash.IsNull();
+    });
+
+    std::vector<CNode*> vNodesCopy = CopyNodeVector([](const CNode* pnode) { return pnode->CanRelay(); });
+    std::vector<CInv> vToPush;
+    vToPush.reserve(vQueued.size());
+    for (CNode* pnode : vNodesCopy) {
+        vToPush.clear();
+        const auto collect = [&](CBloomFilter* pfilter) {
+            for (const QueuedRelayInv& queued : vQueued) {
+                if (pnode->nVersion < queued.minProtoVersion) {
+                    continue;
+                }
+                if (pfilter && !queued.relatedTxHash.IsNull()) {
+                    if (queued.relatedTx ? !pfilter->IsRelevantAndUpdate(*queued.relatedTx) : !pfilter->contains(queued.relatedTxHash)) {
+                        continue;
+                    }
+                }
+                vToPush.push_back(queued.inv);
+            }
+        };
+        if (fAnyFiltered) {
+            const int64_t nTimeLock = GetTimeMicros();
             LOCK(pnode->cs_filter);
-            if(pnode->pfilter && !pnode->pfilter->contains(relatedTxHash)) continue;
+            collect(pnode->pfilter.get());
+            nTimeFilterLock += GetTimeMicros() - nTimeLock;
+        } else {
+            collect(nullptr);
+        }
+        if (!vToPush.empty()) {
+            const int64_t nTimeLock = GetTimeMicros();
+            pnode->PushInventory(vToPush);
+            nTimeInventoryLock += GetTimeMicros() - nTimeLock;
         }
-        pnode->PushInventory(inv);
     }
+    ReleaseNodeVector(vNodesCopy);
+
+    const int64_t nTimeEnd = GetTimeMicros();
+    int64_t nMaxLatency = 0;
+    int64_t nTotalLatency = 0;
+    for (const QueuedRelayInv& queued : vQueued) {
+        const int64_t nLatency = nTimeEnd - queued.nTimeQueued;
+        nMaxLatency = std::max(nMaxLatency, nLatency);
+        nTotalLatency += nLatency;
+        statsClient.timing("relay.queueLatencyMs", nLatency / 1000, 0.1f);
+    }
+    statsClient.timing("relay.flushDurationMs", (nTimeEnd - nTimeStart) / 1000, 0.1f);
+    statsClient.count("relay.flushedInvs", vQueued.size(), 0.1f);
+
+    LogPrint(BCLog::BENCHMARK, "%s: %u invs to %u peers in %.2fms (cs_filter held %.2fms, cs_inventory held %.2fms), queue latency avg %.2fms max %.2fms\n",
+             __func__, vQueued.size(), vNodesCopy.size(), 0.001 * (nTimeEnd - nTimeStart), 0.001 * nTimeFilterLock, 0.001 * nTimeInventoryLock,
+             0.001 * nTotalLatency / vQueued.size(), 0.001 * nMaxLatency);
 }
 
 void CConnman::RecordBytesRecv(uint64_t bytes)
@@ -3750,13 +3903,16 @@ bool CConnman::IsMasternodeOrDisconnectRequested(const CService& addr) {
 
 int64_t CConnman::PoissonNextSendInbound(int64_t now, int average_interval_seconds)
 {
-    if (m_next_send_inv_to_incoming < now) {
-        // If this function were called from multiple threads simultaneously
-        // it would possible that both update the next send variable, and return a different result to their caller.
-        // This is not possible in practice as only the net processing thread invokes this function.
-        m_next_send_inv_to_incoming = PoissonNextSend(now, average_interval_seconds);
+    int64_t nNext = m_next_send_inv_to_incoming;
+    if (nNext < now) {
+        // Several message handler threads may get here simultaneously, only one of them moves the
+        // shared send time forward and the others return the value it stored
+        const int64_t nNew = PoissonNextSend(now, average_interval_seconds);
+        if (m_next_send_inv_to_incoming.compare_exchange_strong(nNext, nNew)) {
+            nNext = nNew;
+        }
     }
-    return m_next_send_inv_to_incoming;
+    return nNext;
 }
 
 int64_t PoissonNextSend(int64_t now, int average_interval_seconds)
@@ -3835,7 +3991,7 @@ void CConnman::RegisterEvents(CNode *pnode)
     epoll_event e;
     // We're using edge-triggered mode, so it's important that we drain sockets even if no signals come in
     e.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLERR | EPOLLHUP;
-    e.data.fd = pnode->hSocket;
+    e.data.ptr = pnode;
 
     int r = epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &e);
     if (r != 0) {
@@ -17,6 +17,7 @@
 #include <netaddress.h>
 #include <net_permissions.h>
 #include <policy/feerate.h>
+#include <primitives/transaction.h>
 #include <protocol.h>
 #include <random.h>
 #include <saltedhasher.h>
@@ -93,6 +94,10 @@ static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** -msghandlerthreads default: one thread processes the messages of all peers */
+static const int DEFAULT_MSGHANDLER_THREADS = 1;
+/** Maximum number of message handler threads */
+static const int MAX_MSGHANDLER_THREADS = 16;
 
 #if defined USE_KQUEUE
 #define DEFAULT_SOCKETEVENTS "kqueue"
@@ -178,6 +183,7 @@ public:
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
         SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+        int nMessageHandlerThreads = DEFAULT_MSGHANDLER_THREADS;
         std::vector<bool> m_asmap;
     };
 
@@ -206,6 +212,7 @@ public:
             vAddedNodes = connOptions.m_added_nodes;
         }
         socketEventsMode = connOptions.socketEventsMode;
+        nMessageHandlerThreads = std::max(1, std::min(connOptions.nMessageHandlerThreads, MAX_MSGHANDLER_THREADS));
     }
 
     CConnman(uint64_t seed0, uint64_t seed1);
@@ -378,9 +385,14 @@ public:
 
     void RelayTransaction(const CTransaction& tx);
     void RelayInv(CInv &inv, const int minProtoVersion = MIN_PEER_PROTO_VERSION);
-    void RelayInvFiltered(CInv &inv, const CTransaction &relatedTx, const int minProtoVersion = MIN_PEER_PROTO_VERSION);
+    void RelayInvFiltered(CInv &inv, const CTransactionRef &relatedTx, const int minProtoVersion = MIN_PEER_PROTO_VERSION);
     // This overload will not update node filters,  so use it only for the cases when other messages will update related transaction data in filters
     void RelayInvFiltered(CInv &inv, const uint256 &relatedTxHash, const int minProtoVersion = MIN_PEER_PROTO_VERSION);
+    /**
+     * Fan the invs queued by RelayInv and RelayInvFiltered out to the peers, taking
+     * the locks of every peer only once for the whole batch.
+     */
+    void FlushRelayQueue();
 
     // Addrman functions
     size_t GetAddressCount() const;
@@ -466,7 +478,10 @@ public:
 
     unsigned int GetReceiveFloodSize() const;
 
+    /** Wake all message handler threads */
     void WakeMessageHandler();
+    /** Wake only the message handler thread owning pnode */
+    void WakeMessageHandler(const CNode* pnode);
     void WakeSelect();
 
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
@@ -494,24 +509,49 @@ private:
     void AddOneShot(const std::string& strDest);
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
-    void ThreadMessageHandler();
+    /**
+     * Process messages of the peers owned by nShard. Every peer belongs to exactly
+     * one shard, so its messages are still processed in order.
+     */
+    void ThreadMessageHandler(int nShard);
+    void QueueRelayInv(const CInv& inv, int minProtoVersion, const CTransactionRef& relatedTx, const uint256& relatedTxHash);
+    int GetMessageHandlerShard(const CNode* pnode) const;
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void CalculateNumConnectionsChangedStats();
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+
+    /** Readiness of a node socket reported by SocketEvents() */
+    struct NodeSocketEvents {
+        CNode* pnode;
+        bool fRecv{false};
+        bool fSend{false};
+        bool fError{false};
+    };
+    /** Everything a single SocketEvents() call found ready */
+    struct SocketEventsResult {
+        std::vector<NodeSocketEvents> vNodeEvents;
+        //! Listening sockets with pending connections
+        std::vector<SOCKET> vListenSockets;
+        bool fWakeup{false};
+    };
+
 #ifdef USE_KQUEUE
     void SocketEventsKqueue(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll);
 #endif
 #ifdef USE_EPOLL
-    void SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll);
+    /** Node sockets are registered with their CNode, so the ready nodes come straight from epoll_wait() */
+    void SocketEventsEpoll(SocketEventsResult& result, bool fOnlyPoll);
 #endif
 #ifdef USE_POLL
     void SocketEventsPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll);
 #endif
     void SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll);
-    void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll);
+    void SocketEvents(SocketEventsResult& result, bool fOnlyPoll);
+    /** Turn the socket sets of the select, poll and kqueue modes into per-node events */
+    void MapSocketEvents(const std::set<SOCKET>& recv_set, const std::set<SOCKET>& send_set, const std::set<SOCKET>& error_set, SocketEventsResult& result);
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -618,8 +658,9 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake GUARDED_BY(mutexMsgProc);
+    /** flags for waking the message processors, one per message handler thread. */
+    std::vector<bool> vMsgProcWake GUARDED_BY(mutexMsgProc);
+    int nMessageHandlerThreads{DEFAULT_MSGHANDLER_THREADS};
 
     std::condition_variable condMsgProc;
     Mutex mutexMsgProc;
@@ -641,6 +682,19 @@ private:
     int epollfd{-1};
 #endif
 
+    /** An inv waiting in the relay queue */
+    struct QueuedRelayInv {
+        CInv inv;
+        int minProtoVersion;
+        /** When set, only relay to peers without a bloom filter or with one matching this tx... */
+        CTransactionRef relatedTx;
+        /** ...or, when relatedTx is not set, matching this txid. Null for unfiltered invs. */
+        uint256 relatedTxHash;
+        int64_t nTimeQueued;
+    };
+    std::vector<QueuedRelayInv> vRelayQueue GUARDED_BY(cs_vRelayQueue);
+    CCriticalSection cs_vRelayQueue;
+
     /** Protected by cs_vNodes */
     std::unordered_map<NodeId, CNode*> mapReceivableNodes GUARDED_BY(cs_vNodes);
     std::unordered_map<NodeId, CNode*> mapSendableNodes GUARDED_BY(cs_vNodes);
@@ -653,7 +707,7 @@ private:
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadOpenMasternodeConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
     std::thread threadStakeMint;
 
     /** flag for deciding to connect to an extra outbound peer,
@@ -1212,6 +1266,19 @@ public:
     void PushInventory(const CInv& inv)
     {
         LOCK(cs_inventory);
+        PushInventoryLocked(inv);
+    }
+
+    void PushInventory(const std::vector<CInv>& vInv)
+    {
+        LOCK(cs_inventory);
+        for (const CInv& inv : vInv) {
+            PushInventoryLocked(inv);
+        }
+    }
+
+    void PushInventoryLocked(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_inventory)
+    {
         if (inv.type == MSG_TX || inv.type == MSG_DSTX) {
             if (!filterInventoryKnown.contains(inv.hash)) {
                 LogPrint(BCLog::NET, "%s -- adding new inv: %s peer=%d\n", __func__, inv.ToString(), id);
@@ -1966,26 +1966,37 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, std::deque<CB
             }
             return true;
         }
+    }
 
-        uint256 hashLastBlock;
-        for (const CBlockHeader& header : headers) {
-            if (!hashLastBlock.IsNull() && header.hashPrevBlock != hashLastBlock) {
-                Misbehaving(pfrom->GetId(), 20, "non-continuous headers sequence");
-                return false;
-            }
-            hashLastBlock = header.GetHash();
-        }
+    // Hash all headers once, outside cs_main: legacy headers are hashed with scrypt, which
+    // GetBlockHeaderHashes() runs through the multi-lane kernels. The hashes are reused by
+    // ProcessNewBlockHeaders() below.
+    std::vector<const CBlockHeader*> to_hash;
+    to_hash.reserve(headers.size());
+    for (const CBlockHeader& header : headers) {
+        to_hash.push_back(&header);
+    }
+    const std::vector<uint256> header_hashes = GetBlockHeaderHashes(to_hash);
 
-        // If we don't have the last header, then they'll have given us
-        // something new (if these headers are valid).
-        if (!LookupBlockIndex(hashLastBlock)) {
-            received_new_header = true;
+    uint256 hashLastBlock;
+    for (size_t i = 0; i < headers.size(); i++) {
+        if (!hashLastBlock.IsNull() && headers[i].hashPrevBlock != hashLastBlock) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 20, "non-continuous headers sequence");
+            return false;
         }
+        hashLastBlock = header_hashes[i];
+    }
+
+    // If we don't have the last header, then they'll have given us
+    // something new (if these headers are valid).
+    if (!WITH_LOCK(cs_main, return LookupBlockIndex(hashLastBlock))) {
+        received_new_header = true;
     }
 
     CValidationState state;
     CBlockHeader first_invalid_header;
-    if (!ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid_header, MAX_NEW_HEADER_BURST)) {
+    if (!ProcessNewBlockHeaders(headers, header_hashes, state, chainparams, &pindexLast, &first_invalid_header, MAX_NEW_HEADER_BURST)) {
         int nDoS;
         if (state.IsInvalid(nDoS)) {
             LOCK(cs_main);
@@ -3177,58 +3188,79 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        LOCK(cs_main);
-        if (::ChainstateActive().IsInitialBlockDownload() && !pfrom->HasPermission(PF_NOBAN)) {
-            LogPrint(BCLog::NET, "Ignoring getheaders from peer=%d because node is in initial block download\n", pfrom->GetId());
-            return true;
-        }
-
-        CNodeState *nodestate = State(pfrom->GetId());
-        const CBlockIndex* pindex = nullptr;
-        if (locator.IsNull())
+        // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
+        std::vector<CBlock> vHeaders;
+        // Signatures of PoS headers which are neither in memory nor cached, read after releasing cs_main
+        std::vector<std::pair<size_t, uint256>> vMissingSigs;
         {
-            // If locator is null, return the hashStop block
-            pindex = LookupBlockIndex(hashStop);
-            if (!pindex) {
+            LOCK(cs_main);
+            if (::ChainstateActive().IsInitialBlockDownload() && !pfrom->HasPermission(PF_NOBAN)) {
+                LogPrint(BCLog::NET, "Ignoring getheaders from peer=%d because node is in initial block download\n", pfrom->GetId());
                 return true;
             }
 
-            if (!BlockRequestAllowed(pindex, chainparams.GetConsensus())) {
-                LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block header that isn't in the main chain\n", __func__, pfrom->GetId());
-                return true;
+            CNodeState *nodestate = State(pfrom->GetId());
+            const CBlockIndex* pindex = nullptr;
+            if (locator.IsNull())
+            {
+                // If locator is null, return the hashStop block
+                pindex = LookupBlockIndex(hashStop);
+                if (!pindex) {
+                    return true;
+                }
+
+                if (!BlockRequestAllowed(pindex, chainparams.GetConsensus())) {
+                    LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block header that isn't in the main chain\n", __func__, pfrom->GetId());
+                    return true;
+                }
+            }
+            else
+            {
+                // Find the last block the caller has in the main chain
+                pindex = FindForkInGlobalIndex(::ChainActive(), locator);
+                if (pindex)
+                    pindex = ::ChainActive().Next(pindex);
             }
-        }
-        else
-        {
-            // Find the last block the caller has in the main chain
-            pindex = FindForkInGlobalIndex(::ChainActive(), locator);
-            if (pindex)
-                pindex = ::ChainActive().Next(pindex);
-        }
 
-        // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
-        std::vector<CBlock> vHeaders;
-        int nLimit = MAX_HEADERS_RESULTS;
-        LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), pfrom->GetId());
-        for (; pindex; pindex = ::ChainActive().Next(pindex))
-        {
-            vHeaders.push_back(pindex->GetBlockHeader());
-            if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
+            int nLimit = MAX_HEADERS_RESULTS;
+            LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), pfrom->GetId());
+            for (; pindex; pindex = ::ChainActive().Next(pindex))
+            {
+                vHeaders.push_back(pindex->GetBlockHeader(/* fLoadSig */ false));
+                if (pindex->IsProofOfStake() && vHeaders.back().vchBlockSig.empty()) {
+                    vMissingSigs.emplace_back(vHeaders.size() - 1, pindex->GetBlockHash());
+                }
+                if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
+                    break;
+            }
+            // pindex can be nullptr either if we sent ::ChainActive().Tip() OR
+            // if our peer has ::ChainActive().Tip() (and thus we are sending an empty
+            // headers message). In both cases it's safe to update
+            // pindexBestHeaderSent to be our tip.
+            //
+            // It is important that we simply reset the BestHeaderSent value here,
+            // and not max(BestHeaderSent, newHeaderSent). We might have announced
+            // the currently-being-connected tip using a compact block, which
+            // resulted in the peer sending a headers request, which we respond to
+            // without the new block. By resetting the BestHeaderSent, we ensure we
+            // will re-announce the new block via headers (or compact blocks again)
+            // in the SendMessages logic.
+            nodestate->pindexBestHeaderSent = pindex ? pindex : ::ChainActive().Tip();
+        }
+        for (const auto& [i, hash] : vMissingSigs) {
+            if (!LoadBlockSig(hash, vHeaders[i].vchBlockSig)) {
+                // peers reject PoS headers without a signature, send the ones before instead
+                LogPrintf("getheaders: failed to read the signature of block %s, sending %d headers to peer=%d\n", hash.ToString(), i, pfrom->GetId());
+                vHeaders.resize(i);
+                LOCK(cs_main);
+                CNodeState* nodestate = State(pfrom->GetId());
+                if (nodestate) {
+                    const CBlockIndex* pindexLast = LookupBlockIndex(hash);
+                    nodestate->pindexBestHeaderSent = pindexLast ? pindexLast->pprev : nullptr;
+                }
                 break;
+            }
         }
-        // pindex can be nullptr either if we sent ::ChainActive().Tip() OR
-        // if our peer has ::ChainActive().Tip() (and thus we are sending an empty
-        // headers message). In both cases it's safe to update
-        // pindexBestHeaderSent to be our tip.
-        //
-        // It is important that we simply reset the BestHeaderSent value here,
-        // and not max(BestHeaderSent, newHeaderSent). We might have announced
-        // the currently-being-connected tip using a compact block, which
-        // resulted in the peer sending a headers request, which we respond to
-        // without the new block. By resetting the BestHeaderSent, we ensure we
-        // will re-announce the new block via headers (or compact blocks again)
-        // in the SendMessages logic.
-        nodestate->pindexBestHeaderSent = pindex ? pindex : ::ChainActive().Tip();
         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
         return true;
     }
@@ -4575,6 +4607,16 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
 
             if (!fRevertToInv) {
                 bool fFoundStartingHeader = false;
+                // A PoS header is never announced without its signature, revert to an inv if it can't be read
+                const auto PushHeader = [&](const CBlockIndex* pindex) {
+                    try {
+                        vHeaders.push_back(pindex->GetBlockHeader());
+                        return true;
+                    } catch (const std::runtime_error& e) {
+                        LogPrintf("%s: %s, reverting to inv for peer=%d\n", __func__, e.what(), pto->GetId());
+                        return false;
+                    }
+                };
                 // Try to find first header that our peer doesn't have, and
                 // then send all headers past that one.  If we come across any
                 // headers that aren't on ::ChainActive(), give up.
@@ -4613,14 +4655,20 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                     }
                     if (fFoundStartingHeader) {
                         // add this to the headers message
-                        vHeaders.push_back(pindex->GetBlockHeader());
+                        if (!PushHeader(pindex)) {
+                            fRevertToInv = true;
+                            break;
+                        }
                     } else if (PeerHasHeader(&state, pindex)) {
                         continue; // keep looking for the first new block
                     } else if (pindex->pprev == nullptr || PeerHasHeader(&state, pindex->pprev) || isPrevDevnetGenesisBlock) {
                         // Peer doesn't have this header but they do have the prior one.
                         // Start sending headers.
                         fFoundStartingHeader = true;
-                        vHeaders.push_back(pindex->GetBlockHeader());
+                        if (!PushHeader(pindex)) {
+                            fRevertToInv = true;
+                            break;
+                        }
                     } else {
                         // Peer doesn't have this header or the prior one -- nothing will
                         // connect, so bail out.
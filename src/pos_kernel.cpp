@@ -10,12 +10,22 @@
 #include "chainparams.h"
 #include "db.h"
 #include "pos_kernel.h"
+#include "pos_stakeinput.h"
 #include "script/interpreter.h"
 #include "policy/policy.h"
+#include "shutdown.h"
 #include "timedata.h"
 #include "util/system.h"
 #include "consensus/validation.h"
 #include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <ctpl_stl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <limits>
+#include <thread>
 
 using namespace std;
 
@@ -95,7 +105,7 @@ static constexpr int64_t GetStakeModifierSelectionInterval()
 // already selected blocks in vSelectedBlocks, and with timestamp up to
 // nSelectionIntervalStop.
 static bool SelectBlockFromCandidates(
-    vector<pair<int64_t, uint256> >& vSortedByTimestamp,
+    vector<const CBlockIndex*>& vSortedByTimestamp,
     map<uint256, const CBlockIndex*>& mapSelectedBlocks,
     int64_t nSelectionIntervalStop,
     uint64_t nStakeModifierPrev,
@@ -111,10 +121,7 @@ static bool SelectBlockFromCandidates(
             break;
         }
 
-        if (!::BlockIndex().count(iter->second))
-            return error("SelectBlockFromCandidates: failed to find block index for candidate block %s", iter->second.ToString().c_str());
-
-        const CBlockIndex* pindex = ::BlockIndex()[iter->second];
+        const CBlockIndex* pindex = *iter;
         if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop) {
             // No point to re-consider the blocks
             vSortedByTimestamp.erase(vSortedByTimestamp.begin(), iter+1);
@@ -197,20 +204,25 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint32_t& nStakeMod
     }
 
     // Sort candidate blocks by timestamp
-    vector<pair<int64_t, uint256> > vSortedByTimestamp;
+    vector<const CBlockIndex*> vSortedByTimestamp;
     vSortedByTimestamp.reserve(MODIFIER_INTERVAL_SECTIONS_MAX);
     int64_t nSelectionInterval = GetStakeModifierSelectionInterval();
     int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / MODIFIER_INTERVAL) * MODIFIER_INTERVAL - nSelectionInterval;
     const CBlockIndex* pindex = pindexPrev;
 
     while (pindex && pindex->GetBlockTime() >= nSelectionIntervalStart) {
-        vSortedByTimestamp.push_back(make_pair(pindex->GetBlockTime(), pindex->GetBlockHash()));
+        vSortedByTimestamp.push_back(pindex);
         pindex = pindex->pprev;
     }
 
     int nHeightFirstCandidate = pindex ? (pindex->nHeight + 1) : 0;
     reverse(vSortedByTimestamp.begin(), vSortedByTimestamp.end()); // it should improve sorting time
-    sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end());
+    sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end(), [](const CBlockIndex* a, const CBlockIndex* b) {
+        if (a->GetBlockTime() != b->GetBlockTime()) {
+            return a->GetBlockTime() < b->GetBlockTime();
+        }
+        return a->GetBlockHash() < b->GetBlockHash();
+    });
 
     // Select 64 blocks from candidate blocks to generate stake modifier
     uint64_t nStakeModifierNew = 0;
@@ -263,6 +275,33 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint32_t& nStakeMod
     return true;
 }
 
+// Length of the PoS v2 modifier interval, see ComputeNextStakeModifierV2()
+static constexpr uint32_t MODIFIER_INTERVAL_V2 = 3600;
+
+static inline uint32_t StakeModifierV2TimeMid(uint32_t blockTime)
+{
+    return blockTime - (MODIFIER_INTERVAL_V2 / 2);
+}
+
+static inline uint32_t StakeModifierV2TimeOld(uint32_t blockTime)
+{
+    return blockTime - (MODIFIER_INTERVAL_V2 - MAX_POS_BLOCK_AHEAD_TIME);
+}
+
+static uint32_t StakeModifierV2(const CBlockIndex* pindexPrev, const CBlockIndex* pmiddle, const CBlockIndex* poldest)
+{
+    auto prevout = pindexPrev->StakeInput();
+
+    // From more recent to more oldest
+    CDataStream ss(SER_GETHASH, 0);
+    ss << prevout.hash << prevout.n;
+    ss << pmiddle->GetBlockHash();
+    ss << poldest->GetBlockHash();
+
+    // The first 64 bits
+    return ReadLE64(Hash(ss.begin(), ss.end()).begin());
+}
+
 bool ComputeNextStakeModifierV2(const uint32_t blockTime, const CBlockIndex* pindexPrev, uint32_t& nStakeModifier)
 {
     nStakeModifier = 0;
@@ -291,26 +330,13 @@ bool ComputeNextStakeModifierV2(const uint32_t blockTime, const CBlockIndex* pin
      *   progresses rapidly.
      * - current hash power demand is in Thz
      */
-    const uint32_t MODIFIER_INTERVAL = 3600;
-    const uint32_t timeMid = blockTime - (MODIFIER_INTERVAL / 2);
-    const uint32_t timeOld = blockTime - (MODIFIER_INTERVAL - MAX_POS_BLOCK_AHEAD_TIME);
-
     const CBlockIndex* pmiddle = pindexPrev;
-    for (; pmiddle->pprev && (pmiddle->pprev->nTime > timeMid); pmiddle = pmiddle->pprev);
+    for (; pmiddle->pprev && (pmiddle->pprev->nTime > StakeModifierV2TimeMid(blockTime)); pmiddle = pmiddle->pprev);
 
     const CBlockIndex* poldest = pmiddle;
-    for (; poldest->pprev && (poldest->pprev->nTime > timeOld); poldest = poldest->pprev);
+    for (; poldest->pprev && (poldest->pprev->nTime > StakeModifierV2TimeOld(blockTime)); poldest = poldest->pprev);
 
-    auto prevout = pindexPrev->StakeInput();
-
-    // From more recent to more oldest
-    CDataStream ss(SER_GETHASH, 0);
-    ss << prevout.hash << prevout.n;
-    ss << pmiddle->GetBlockHash();
-    ss << poldest->GetBlockHash();
-
-    // The first 64 bits
-    nStakeModifier = ReadLE64(Hash(ss.begin(), ss.end()).begin());
+    nStakeModifier = StakeModifierV2(pindexPrev, pmiddle, poldest);
 
     LogPrint(BCLog::STAKING, "%s: new modifier=%llx time=%llu, prevblk=%s\n",
              __func__, nStakeModifier,
@@ -320,44 +346,120 @@ bool ComputeNextStakeModifierV2(const uint32_t blockTime, const CBlockIndex* pin
     return true;
 }
 
-bool CachedNextStakeModifierV2(const uint32_t blockTime, const CBlockIndex* pindexPrev, uint32_t& nStakeModifier)
+CStakeModifierCache stakeModifierCache;
+
+bool CStakeModifierCache::GetV1(const CBlockIndex* pindexPrev, uint32_t& nStakeModifier)
 {
-    // This can be done more "correct" way...
-    static uint256 last_parent;
-    static std::map<uint32_t, uint64_t> sm_cache;
+    if (!pindexPrev) {
+        nStakeModifier = 0;
+        return true;
+    }
 
-    auto parent = pindexPrev->GetBlockHash();
+    const uint256& hash = pindexPrev->GetBlockHash();
+    {
+        LOCK(cs);
+        if (mapV1.get(hash, nStakeModifier)) {
+            return true;
+        }
+    }
 
-    // Reset cache
-    if (last_parent != parent) {
-        sm_cache.clear();
-        last_parent = parent;
+    // The selection is slow, do not hold the lock meanwhile
+    if (!ComputeNextStakeModifier(pindexPrev, nStakeModifier)) {
+        return false;
     }
 
-    // Fast path
-    auto cached = sm_cache.find(blockTime);
+    LOCK(cs);
+    mapV1.insert(hash, nStakeModifier);
+    return true;
+}
 
-    if (cached != sm_cache.end()) {
-        nStakeModifier = cached->second;
+size_t CStakeModifierCache::FindFirstAtOrBefore(Ancestry& ancestry, uint32_t nTime)
+{
+    AssertLockHeld(cs);
 
-        LogPrint(BCLog::STAKING, "%s: cached modifier=%llx time=%llu, prevblk=%s\n",
-                __func__, nStakeModifier,
-                blockTime,
-                pindexPrev->GetBlockHash().ToString().c_str());
-        return true;
+    auto& vBlocks = ancestry.vBlocks;
+    auto& vMinTime = ancestry.vMinTime;
+
+    // Extend the ancestry until it reaches a block at or before nTime, or genesis
+    while (vMinTime.back() > nTime && vBlocks.back()->pprev) {
+        const CBlockIndex* pindex = vBlocks.back()->pprev;
+        vBlocks.push_back(pindex);
+        vMinTime.push_back(std::min<uint32_t>(vMinTime.back(), pindex->nTime));
     }
 
-    // Slow path
-    if (!ComputeNextStakeModifierV2(blockTime, pindexPrev, nStakeModifier)) {
+    // vMinTime is non-increasing, the first entry at or before nTime is the first such block
+    auto it = std::partition_point(vMinTime.begin() + 1, vMinTime.end(), [nTime](uint32_t t) { return t > nTime; });
+    return it - vMinTime.begin();
+}
+
+bool CStakeModifierCache::GetV2(uint32_t blockTime, const CBlockIndex* pindexPrev, uint32_t& nStakeModifier)
+{
+    nStakeModifier = 0;
+
+    if (!pindexPrev) {
         return false;
     }
 
-    // Cache
-    sm_cache[blockTime] = nStakeModifier;
+    LOCK(cs);
+
+    auto it = mapTips.find(pindexPrev);
+    if (it == mapTips.end()) {
+        if (mapTips.size() >= MAX_TIPS) {
+            auto oldest = std::min_element(mapTips.begin(), mapTips.end(), [](const auto& a, const auto& b) {
+                return a.second.nLastUse < b.second.nLastUse;
+            });
+            mapTips.erase(oldest);
+        }
+        it = mapTips.emplace(pindexPrev, Ancestry()).first;
+        it->second.vBlocks.push_back(pindexPrev);
+        it->second.vMinTime.push_back(std::numeric_limits<uint32_t>::max());
+    }
+    auto& ancestry = it->second;
+    ancestry.nLastUse = ++nUseCounter;
+
+    // pmiddle is the block right after the first ancestor at or before timeMid, or
+    // genesis when there is none. poldest likewise for timeOld, which is always
+    // further back, so it can be searched from pindexPrev as well.
+    const size_t nMiddle = FindFirstAtOrBefore(ancestry, StakeModifierV2TimeMid(blockTime)) - 1;
+    const size_t nOldest = FindFirstAtOrBefore(ancestry, StakeModifierV2TimeOld(blockTime)) - 1;
+
+    auto bucket = std::make_pair(nMiddle, nOldest);
+    auto cached = ancestry.mapModifiers.find(bucket);
+    if (cached != ancestry.mapModifiers.end()) {
+        nStakeModifier = cached->second;
+        return true;
+    }
+
+    nStakeModifier = StakeModifierV2(pindexPrev, ancestry.vBlocks[nMiddle], ancestry.vBlocks[nOldest]);
+    ancestry.mapModifiers.emplace(bucket, nStakeModifier);
+
+    LogPrint(BCLog::STAKING, "%s: new modifier=%llx time=%llu, prevblk=%s\n",
+             __func__, nStakeModifier,
+             blockTime,
+             pindexPrev->GetBlockHash().ToString().c_str());
 
     return true;
 }
 
+void CStakeModifierCache::BlockDisconnected(const CBlockIndex* pindex)
+{
+    LOCK(cs);
+    for (auto it = mapTips.begin(); it != mapTips.end(); ) {
+        if (it->first->GetAncestor(pindex->nHeight) == pindex) {
+            it = mapTips.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CStakeModifierCache::Clear()
+{
+    LOCK(cs);
+    mapTips.clear();
+    mapV1.clear();
+}
+
 uint256 stakeHash(unsigned int nTimeTx, CDataStream ss, unsigned int prevoutIndex, uint256 prevoutHash, unsigned int nTimeBlockFrom)
 {
     //Pivx will hash in the transaction hash and the index number in order to make sure each hash is unique
@@ -365,78 +467,258 @@ uint256 stakeHash(unsigned int nTimeTx, CDataStream ss, unsigned int prevoutInde
     return Hash(ss.begin(), ss.end());
 }
 
-//instead of looping outside and reinitializing variables many times, we will give a nTimeTx and also search interval so that we can do all the hashing here
-bool CheckStakeKernelHash(
-    CBlockHeader &current,
-    const CBlockIndex &blockPrev,
-    const CBlockIndex &blockFrom,
-    const CTransaction txPrev,
-    const COutPoint prevout,
-    unsigned int nHashDrift,
-    bool fCheck,
-    uint256& hashProofOfStake,
-    bool fPrintProofOfStake
-) {
-    // Legacy way of parameter passing
-    unsigned int nBits = current.nBits;
-    unsigned int& nTimeTx = current.nTime;
-    uint32_t &nStakeModifier = current.nStakeModifier();
-    //
+// Kernel input is modifier(4) | nTimeBlockFrom(4) | prevout.n(4) | prevout.hash(32) | nTimeTx(4),
+// which fits in a single SHA256 block.
+static constexpr size_t STAKE_KERNEL_SIZE = 48;
+// Number of timestamps hashed per stakeHashBatch() call in the search loop
+static constexpr size_t STAKE_KERNEL_BATCH = 64;
+
+void stakeHashBatch(unsigned int nTimeTxStart, size_t count, const uint32_t* vStakeModifier,
+                    unsigned int prevoutIndex, const uint256& prevoutHash, unsigned int nTimeBlockFrom, uint256* vHashOut)
+{
+    // Precompute the padded block once, only the modifier and nTimeTx change per timestamp
+    unsigned char block[64] = {0};
+    WriteLE32(block + 4, nTimeBlockFrom);
+    WriteLE32(block + 8, prevoutIndex);
+    memcpy(block + 12, prevoutHash.begin(), 32);
+    block[STAKE_KERNEL_SIZE] = 0x80;
+    WriteBE64(block + 56, STAKE_KERNEL_SIZE * 8);
+
+    unsigned char in[64 * STAKE_KERNEL_BATCH];
+    while (count > 0) {
+        const size_t n = std::min(count, STAKE_KERNEL_BATCH);
+        for (size_t i = 0; i < n; ++i) {
+            unsigned char* p = in + 64 * i;
+            memcpy(p, block, 64);
+            WriteLE32(p, vStakeModifier[i]);
+            WriteLE32(p + 44, nTimeTxStart + i);
+        }
+        SHA256D1(vHashOut->begin(), in, n);
+        nTimeTxStart += n;
+        vStakeModifier += n;
+        vHashOut += n;
+        count -= n;
+    }
+}
+
+static arith_uint256 GetStakeKernelTarget(unsigned int nBits, CAmount nValueIn)
+{
+    arith_uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits);
+    arith_uint256 bnTarget = (arith_uint256(nValueIn) / 100) * bnTargetPerCoinDay;
+
+    if (bnTarget < bnTargetPerCoinDay) {
+        LogPrint(BCLog::STAKING, "PoS target overflow %s amount %d < common %s, using ~0\n",
+                  bnTarget.GetHex().c_str(),
+                  nValueIn,
+                  bnTargetPerCoinDay.GetHex().c_str());
+        bnTarget = ~arith_uint256(0);
+    }
+    return bnTarget;
+}
+
+bool PrepareStakeKernelWindow(const CBlockHeader& current, const CBlockIndex& blockPrev, unsigned int nHashDrift, StakeKernelWindow& window)
+{
+    window.nBits = current.nBits;
+    window.nTimeStart = current.nTime;
+    window.nTimeEnd = std::max<int64_t>(window.nTimeStart, std::min<int64_t>(
+                window.nTimeStart + nHashDrift,
+                GetAdjustedTime() + MAX_POS_BLOCK_AHEAD_TIME - MAX_POS_BLOCK_AHEAD_SAFETY_MARGIN));
+    window.nTimePastLimit = 0;
+    window.vStakeModifier.clear();
+
+    LogPrint(BCLog::STAKING, "%s: looking for solution in range %lld .. %lld (%lld) \n",
+             __func__, window.nTimeStart, window.nTimeEnd, (window.nTimeEnd - window.nTimeStart));
+
+    // PoS v2 modifiers depend on the timestamp only, not on the stake input
+    if (current.IsProofOfStakeV2()) {
+        window.vStakeModifier.resize(window.nTimeEnd - window.nTimeStart);
+        for (size_t i = 0; i < window.vStakeModifier.size(); ++i) {
+            if (!stakeModifierCache.GetV2(window.nTimeStart + i, &blockPrev, window.vStakeModifier[i])) {
+                LogPrintf("%s: failed to get kernel stake modifier V2 \n", __func__);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool PrepareStakeKernelCandidate(const CBlockHeader& current, const CBlockIndex& blockFrom, CAmount nValueIn,
+                                 const COutPoint& prevout, StakeKernelCandidate& candidate, bool fCheck)
+{
+    candidate.prevout = prevout;
+    candidate.nValueIn = nValueIn;
+    candidate.nTimeBlockFrom = blockFrom.GetBlockTime();
+    candidate.nStakeModifier = 0;
 
-    //assign new variables to make it easier to read
-    CAmount nValueIn = txPrev.vout[prevout.n].nValue;
-    unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
+    const unsigned int nTimeTx = current.nTime;
     auto min_age = Params().MinStakeAge();
-    
+
     if (nValueIn < MIN_STAKE_AMOUNT) {
         return error("CheckStakeKernelHash() : stake value is too small %d < %d", nValueIn, MIN_STAKE_AMOUNT);
     }
 
-    if (nTimeTx < nTimeBlockFrom) // Transaction timestamp violation
+    if (nTimeTx < candidate.nTimeBlockFrom) // Transaction timestamp violation
         return error("CheckStakeKernelHash() : nTime violation");
 
-    if (nTimeBlockFrom + min_age > nTimeTx) // Min age requirement
+    if (candidate.nTimeBlockFrom + min_age > nTimeTx) // Min age requirement
     {
         // During generation, some stakes may be not year ready
         if (fCheck) {
             error("%s : min age violation - nTimeBlockFrom=%d nStakeMinAge=%d nTimeTx=%d",
-                  __func__, nTimeBlockFrom, min_age, nTimeTx);
+                  __func__, candidate.nTimeBlockFrom, min_age, nTimeTx);
         }
         return false;
     }
 
-    //grab difficulty
-    arith_uint256 bnTargetPerCoinDay;
-    bnTargetPerCoinDay.SetCompact(nBits);
-    arith_uint256 bnTarget = (arith_uint256(nValueIn) / 100) * bnTargetPerCoinDay;
+    // NOTE: this must be calculated based on previous-to-tip, but not previous-to-stake block!
+    if (!current.IsProofOfStakeV2() && !stakeModifierCache.GetV1(&blockFrom, candidate.nStakeModifier)) {
+        LogPrintf("CheckStakeKernelHash(): failed to get kernel stake modifier \n");
+        return false;
+    }
+    return true;
+}
 
-    if (bnTarget < bnTargetPerCoinDay) {
-        LogPrint(BCLog::STAKING, "PoS target overflow %s amount %d < common %s, using ~0\n",
-                  bnTarget.GetHex().c_str(),
-                  nValueIn,
-                  bnTargetPerCoinDay.GetHex().c_str());
-        bnTarget = ~arith_uint256(0);
+bool SearchStakeKernel(const StakeKernelWindow& window, const StakeKernelCandidate& candidate,
+                       unsigned int& nTimeTx, uint32_t& nStakeModifier, uint256& hashProofOfStake, uint64_t& nHashes)
+{
+    const arith_uint256 bnTarget = GetStakeKernelTarget(window.nBits, candidate.nValueIn);
+    const bool fV2 = !window.vStakeModifier.empty();
+
+    uint32_t vStakeModifier[STAKE_KERNEL_BATCH];
+    uint256 vHashProofOfStake[STAKE_KERNEL_BATCH];
+
+    for (unsigned int batch_time = window.nTimeStart; batch_time < window.nTimeEnd; batch_time += STAKE_KERNEL_BATCH)
+    {
+        const size_t count = std::min<size_t>(STAKE_KERNEL_BATCH, window.nTimeEnd - batch_time);
+        for (size_t i = 0; i < count; ++i) {
+            vStakeModifier[i] = fV2 ? window.vStakeModifier[batch_time - window.nTimeStart + i] : candidate.nStakeModifier;
+        }
+
+        //hash this batch of timestamps at once
+        stakeHashBatch(batch_time, count, vStakeModifier, candidate.prevout.n, candidate.prevout.hash,
+                       candidate.nTimeBlockFrom, vHashProofOfStake);
+        nHashes += count;
+
+        // take the earliest timestamp meeting the target, as the sequential search did
+        size_t hit = 0;
+        for (; hit < count && UintToArith256(vHashProofOfStake[hit]) >= bnTarget; ++hit);
+        if (hit == count) {
+            continue;
+        }
+        if (batch_time + hit <= window.nTimePastLimit) {
+            // the block would be too far in the past, the sequential search skipped such an input
+            LogPrint(BCLog::STAKING, "%s : kernel found, but it is too far in the past\n", __func__);
+            return false;
+        }
+
+        nTimeTx = batch_time + hit;
+        nStakeModifier = vStakeModifier[hit];
+        hashProofOfStake = vHashProofOfStake[hit];
+        return true;
+    }
+
+    return false;
+}
+
+void SearchStakeKernels(const StakeKernelWindow& window, const std::vector<StakeKernelCandidate>& candidates,
+                        int nThreads, StakeKernelSearch& result, ctpl::thread_pool* pool)
+{
+    // Workers claim candidates in order and stop once a kernel is known for an
+    // earlier one, so the winner does not depend on the number of threads.
+    const size_t nCandidates = candidates.size();
+    nThreads = std::max<int>(1, std::min<size_t>(nThreads, nCandidates));
+    std::atomic<size_t> nNextCandidate{0};
+    std::atomic<size_t> nFoundCandidate{nCandidates};
+    std::atomic<uint64_t> nScanned{0};
+    std::vector<unsigned int> vTimeTx(nCandidates);
+    std::vector<uint32_t> vStakeModifier(nCandidates);
+    std::vector<uint256> vHashProofOfStake(nCandidates);
+    result.vHashes.assign(nCandidates, 0);
+
+    auto search = [&]() {
+        uint64_t scanned = 0;
+        for (size_t i = nNextCandidate++; i < nFoundCandidate.load(); i = nNextCandidate++) {
+            if (ShutdownRequested()) {
+                break;
+            }
+            ++scanned;
+            if (SearchStakeKernel(window, candidates[i], vTimeTx[i], vStakeModifier[i], vHashProofOfStake[i], result.vHashes[i])) {
+                size_t found = nFoundCandidate.load();
+                while (i < found && !nFoundCandidate.compare_exchange_weak(found, i));
+                break;
+            }
+        }
+        nScanned += scanned;
+    };
+
+    const int64_t nSearchStart = GetTimeMicros();
+    if (pool != nullptr) {
+        std::vector<std::future<void>> futures;
+        for (int i = 1; i < nThreads; ++i) {
+            futures.emplace_back(pool->push([&](int) { search(); }));
+        }
+        search();
+        for (auto& future : futures) {
+            future.wait();
+        }
+    } else {
+        std::vector<std::thread> workers;
+        for (int i = 1; i < nThreads; ++i) {
+            workers.emplace_back(search);
+        }
+        search();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    result.nDurationMicros = GetTimeMicros() - nSearchStart;
+    result.nThreads = nThreads;
+    result.nScanned = nScanned;
+    result.nFound = nFoundCandidate;
+    if (result.nFound < nCandidates) {
+        result.nTimeTx = vTimeTx[result.nFound];
+        result.nStakeModifier = vStakeModifier[result.nFound];
+        result.hashProofOfStake = vHashProofOfStake[result.nFound];
+    }
+}
+
+//instead of looping outside and reinitializing variables many times, we will give a nTimeTx and also search interval so that we can do all the hashing here
+bool CheckStakeKernelHash(
+    CBlockHeader &current,
+    const CBlockIndex &blockPrev,
+    const CBlockIndex &blockFrom,
+    CAmount nValueIn,
+    const COutPoint prevout,
+    unsigned int nHashDrift,
+    bool fCheck,
+    uint256& hashProofOfStake,
+    bool fPrintProofOfStake
+) {
+    // Legacy way of parameter passing
+    unsigned int& nTimeTx = current.nTime;
+    uint32_t &nStakeModifier = current.nStakeModifier();
+    //
+
+    StakeKernelCandidate candidate;
+    if (!PrepareStakeKernelCandidate(current, blockFrom, nValueIn, prevout, candidate, fCheck)) {
+        return false;
     }
 
     //grab stake modifier
     //-------------------
-    uint32_t nRequiredStakeModifier = 0;
+    uint32_t nRequiredStakeModifier = candidate.nStakeModifier;
 
     // This is a six month later fix of the problem stated in the note below.
     if (current.IsProofOfStakeV2()) {
-        if (fCheck && !ComputeNextStakeModifierV2(nTimeTx, &blockPrev, nRequiredStakeModifier)) {
+        if (fCheck && !stakeModifierCache.GetV2(nTimeTx, &blockPrev, nRequiredStakeModifier)) {
             LogPrintf("CheckStakeKernelHash(): failed to get kernel stake modifier V2 \n");
             return false;
         }
         // pass
-    } else // PoS v1
-
-    // NOTE: this must be calculated based on previous-to-tip, but not previous-to-stake block!
-    if (!ComputeNextStakeModifier(&blockFrom, nRequiredStakeModifier)) {
-        LogPrintf("CheckStakeKernelHash(): failed to get kernel stake modifier \n");
-        return false;
     }
-    
+
     if (fCheck) {
         if (nStakeModifier != nRequiredStakeModifier) {
             return error(
@@ -448,64 +730,42 @@ bool CheckStakeKernelHash(
         nStakeModifier = nRequiredStakeModifier;
     }
 
-    //create data stream once instead of repeating it in the loop
-    CDataStream ss(SER_GETHASH, 0);
-    ss << nStakeModifier;
-    hashProofOfStake = stakeHash(nTimeTx, ss, prevout.n, prevout.hash, nTimeBlockFrom);
-
     // if wallet is simply checking to make sure a hash is valid
     //-------------------
     if (fCheck) {
-        return UintToArith256(hashProofOfStake) < bnTarget;
+        //create data stream once instead of repeating it in the loop
+        CDataStream ss(SER_GETHASH, 0);
+        ss << nStakeModifier;
+        hashProofOfStake = stakeHash(nTimeTx, ss, prevout.n, prevout.hash, candidate.nTimeBlockFrom);
+        return UintToArith256(hashProofOfStake) < GetStakeKernelTarget(current.nBits, candidate.nValueIn);
     }
 
     // search
     //-------------------
-    auto min_time = nTimeTx;
-    auto max_time = std::min<int64_t>(
-                min_time + nHashDrift,
-                GetAdjustedTime() + MAX_POS_BLOCK_AHEAD_TIME - MAX_POS_BLOCK_AHEAD_SAFETY_MARGIN);
-    LogPrint(BCLog::STAKING, "%s: looking for solution in range %lld .. %lld (%lld) \n",
-             __func__, min_time, max_time, (max_time - min_time));
-
-    for (auto try_time = min_time; try_time < max_time; ++try_time)
-    {
-        if (current.IsProofOfStakeV2()) {
-            if (!CachedNextStakeModifierV2(try_time, &blockPrev, nStakeModifier)) {
-                LogPrintf("CheckStakeKernelHash(): failed to get kernel stake modifier V2 \n");
-                return false;
-            }
-        }
-        ss = CDataStream(SER_GETHASH, 0);
-        ss << nStakeModifier;
-
-        //hash this iteration
-        hashProofOfStake = stakeHash(try_time, ss, prevout.n, prevout.hash, nTimeBlockFrom);
-
-        // if stake hash does not meet the target then continue to next iteration
-        if (UintToArith256(hashProofOfStake) >= bnTarget) {
-            continue;
-        }
-
-        nTimeTx = try_time;
+    StakeKernelWindow window;
+    if (!PrepareStakeKernelWindow(current, blockPrev, nHashDrift, window)) {
+        return false;
+    }
 
-        if (fPrintProofOfStake) {
-            LogPrintf("CheckStakeKernelHash() : using modifier %s at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
-                nStakeModifier,
-                blockFrom.nHeight,
-                FormatISO8601DateTime(blockFrom.nTime).c_str(),
-                blockFrom.nHeight,
-                FormatISO8601DateTime(blockFrom.GetBlockTime()).c_str());
-            LogPrintf("CheckStakeKernelHash() : pass protocol=%s modifier=%s nTimeBlockFrom=%u prevoutHash=%s nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
-                "0.3",
-                boost::lexical_cast<std::string>(nStakeModifier).c_str(),
-                nTimeBlockFrom, prevout.hash.ToString().c_str(), nTimeBlockFrom, prevout.n, try_time,
-                hashProofOfStake.ToString().c_str());
-        }
-        return true;
+    uint64_t nHashes = 0;
+    if (!SearchStakeKernel(window, candidate, nTimeTx, nStakeModifier, hashProofOfStake, nHashes)) {
+        return false;
     }
 
-    return false;
+    if (fPrintProofOfStake) {
+        LogPrintf("CheckStakeKernelHash() : using modifier %s at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
+            nStakeModifier,
+            blockFrom.nHeight,
+            FormatISO8601DateTime(blockFrom.nTime).c_str(),
+            blockFrom.nHeight,
+            FormatISO8601DateTime(blockFrom.GetBlockTime()).c_str());
+        LogPrintf("CheckStakeKernelHash() : pass protocol=%s modifier=%s nTimeBlockFrom=%u prevoutHash=%s nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
+            "0.3",
+            boost::lexical_cast<std::string>(nStakeModifier).c_str(),
+            candidate.nTimeBlockFrom, prevout.hash.ToString().c_str(), candidate.nTimeBlockFrom, prevout.n, nTimeTx,
+            hashProofOfStake.ToString().c_str());
+    }
+    return true;
 }
 
 // Check kernel hash target and coinstake signature
@@ -517,33 +777,20 @@ bool CheckProofOfStake(CValidationState &state, const CBlockHeader &header, uint
 
     COutPoint prevout = header.StakeInput();
 
-    // First try finding the previous transaction in database
-    uint256 txinHashBlock;
-    CTransactionRef txinPrevRef;
+    LOCK(cs_main);
+
+    // Resolve the stake input from the UTXO set or the stake provenance index
+    CStakeProvenance stake_input;
+    StakeInputSource stake_source;
     CBlockIndex* pindex_tx = nullptr;
     CBlockIndex* pindex_prev = nullptr;
 
-    if (!GetTransaction(prevout.hash, txinPrevRef, consensus, txinHashBlock)) {
+    if (!ResolveStakeInput(prevout, consensus, stake_input, stake_source)) {
         BlockMap::iterator it = ::BlockIndex().find(header.hashPrevBlock);
-        
-        if ((it != ::BlockIndex().end()) && ::ChainActive().Contains(it->second)) {
-            return state.DoS(100, false, REJECT_INVALID, "bad-unkown-stake");
-        } else {
-            // We do not have the previous block, so the block may be valid
-            return state.TransientError("tmp-bad-unkown-stake");
-        }
-    }
+        const bool fPrevActive = (it != ::BlockIndex().end()) && ::ChainActive().Contains(it->second);
 
-    // Check tx input block is known
-    {
-        BlockMap::iterator it = ::BlockIndex().find(txinHashBlock);
-
-        if ((it != ::BlockIndex().end()) && ::ChainActive().Contains(it->second)) {
-            pindex_tx = it->second;
-        } else {
-            it = ::BlockIndex().find(header.hashPrevBlock);
-            
-            if ((it != ::BlockIndex().end()) && ::ChainActive().Contains(it->second)) {
+        if (stake_source == StakeInputSource::OFF_CHAIN) {
+            if (fPrevActive) {
                 return state.DoS(100, false, REJECT_INVALID, "bad-stake-mempool",
                                  false, "stake from mempool");
             } else {
@@ -551,8 +798,17 @@ bool CheckProofOfStake(CValidationState &state, const CBlockHeader &header, uint
                 return state.TransientError("tmp-bad-stake-mempool");
             }
         }
+
+        if (fPrevActive) {
+            return state.DoS(100, false, REJECT_INVALID, "bad-unkown-stake");
+        } else {
+            // We do not have the previous block, so the block may be valid
+            return state.TransientError("tmp-bad-unkown-stake");
+        }
     }
 
+    pindex_tx = ::ChainActive()[stake_input.nHeight];
+
     // Header-only chain specific validation
     {
         BlockMap::iterator it = ::BlockIndex().find(header.hashPrevBlock);
@@ -595,7 +851,7 @@ bool CheckProofOfStake(CValidationState &state, const CBlockHeader &header, uint
     // NOTE: stake age check is part of CheckStakeKernelHash()
 
     // Check stake maturity (double checking with other functionality for DoS mitigation)
-    if (txinPrevRef->IsCoinBase() &&
+    if (stake_input.fCoinBase &&
         ((::ChainActive().Tip()->nHeight - pindex_tx->nHeight) <= COINBASE_MATURITY)
     ) {
         return state.DoS(100, false, REJECT_INVALID, "bad-stake-coinbase-maturity",
@@ -607,7 +863,7 @@ bool CheckProofOfStake(CValidationState &state, const CBlockHeader &header, uint
         txnouttype whichType;
         std::vector<std::vector<unsigned char>> vSolutions;
         CKeyID key_id;
-        const auto &spk = txinPrevRef->vout[prevout.n].scriptPubKey;
+        const auto &spk = stake_input.out.scriptPubKey;
 
         whichType = Solver(spk, vSolutions);
 
@@ -643,7 +899,7 @@ bool CheckProofOfStake(CValidationState &state, const CBlockHeader &header, uint
             rwheader,
             *pindex_prev,
             *pindex_tx,
-            *txinPrevRef,
+            stake_input.out.nValue,
             prevout,
             nInterval,
             true,
@@ -5,9 +5,18 @@
 #ifndef BITCOIN_KERNEL_H
 #define BITCOIN_KERNEL_H
 
+#include "saltedhasher.h"
 #include "streams.h"
+#include "sync.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"
 
+#include <map>
+#include <vector>
+
+namespace ctpl {
+    class thread_pool;
+}
 
 static constexpr CAmount MIN_STAKE_AMOUNT = COIN;
 static constexpr int64_t MAX_POS_BLOCK_AHEAD_TIME = 180;
@@ -17,14 +26,111 @@ static constexpr int64_t MAX_POS_BLOCK_AHEAD_SAFETY_MARGIN = 5;
 bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint32_t& nStakeModifier);
 bool ComputeNextStakeModifierV2(const uint32_t blockTime, const CBlockIndex* pindexPrev, uint32_t& nStakeModifier);
 
+/**
+ * Memoized stake modifiers, shared by validation and the staker.
+ *
+ * v1 modifiers are keyed by the hash of the block they are computed on top of.
+ * v2 modifiers depend on pindexPrev and, through the middle and oldest blocks of
+ * the modifier interval, on the block time. For every recent pindexPrev the
+ * timestamps of its ancestors are kept together with their running minimum, which
+ * turns the middle/oldest walks into binary searches, and all block times mapping
+ * to the same middle/oldest pair share one entry.
+ */
+class CStakeModifierCache
+{
+public:
+    static const size_t MAX_TIPS = 16;
+    static const size_t MAX_V1_ENTRIES = 10000;
+
+    // Same as ComputeNextStakeModifier()
+    bool GetV1(const CBlockIndex* pindexPrev, uint32_t& nStakeModifier);
+    // Same as ComputeNextStakeModifierV2()
+    bool GetV2(uint32_t blockTime, const CBlockIndex* pindexPrev, uint32_t& nStakeModifier);
+
+    // Drop the v2 entries of tips building on a disconnected block
+    void BlockDisconnected(const CBlockIndex* pindex);
+    void Clear();
+
+private:
+    struct Ancestry {
+        // vBlocks[i] is the i-th ancestor of pindexPrev, vMinTime[i] the lowest nTime of vBlocks[1..i]
+        std::vector<const CBlockIndex*> vBlocks;
+        std::vector<uint32_t> vMinTime;
+        // (middle, oldest) ancestor positions -> modifier
+        std::map<std::pair<size_t, size_t>, uint32_t> mapModifiers;
+        uint64_t nLastUse{0};
+    };
+
+    // Position of the first ancestor at or before nTime, vBlocks.size() if there is none
+    size_t FindFirstAtOrBefore(Ancestry& ancestry, uint32_t nTime) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    CCriticalSection cs;
+    std::map<const CBlockIndex*, Ancestry> mapTips GUARDED_BY(cs);
+    uint64_t nUseCounter GUARDED_BY(cs){0};
+    unordered_lru_cache<uint256, uint32_t, StaticSaltedHasher> mapV1 GUARDED_BY(cs){MAX_V1_ENTRIES};
+};
+
+extern CStakeModifierCache stakeModifierCache;
+
 // Check whether stake kernel meets hash target
 // Sets hashProofOfStake on success return
 uint256 stakeHash(unsigned int nTimeTx, CDataStream ss, unsigned int prevoutIndex, uint256 prevoutHash, unsigned int nTimeBlockFrom);
+// Same as stakeHash() for count consecutive timestamps starting at nTimeTxStart,
+// vStakeModifier[i] being the modifier for nTimeTxStart + i. Uses the multi-buffer SHA256.
+void stakeHashBatch(unsigned int nTimeTxStart, size_t count, const uint32_t* vStakeModifier,
+                    unsigned int prevoutIndex, const uint256& prevoutHash, unsigned int nTimeBlockFrom, uint256* vHashOut);
+// Timestamp range searched for a new kernel, shared by all stake inputs tried
+// on top of the same block.
+struct StakeKernelWindow {
+    unsigned int nBits{0};
+    unsigned int nTimeStart{0};
+    unsigned int nTimeEnd{0}; // exclusive
+    // Inputs whose earliest kernel is at or before this time are skipped (median time past of the tip)
+    unsigned int nTimePastLimit{0};
+    // PoS v2 only: modifier of nTimeStart + i
+    std::vector<uint32_t> vStakeModifier;
+};
+
+// Per stake input data of the kernel search. Together with StakeKernelWindow it
+// is all SearchStakeKernel() needs, so searches can run without cs_main.
+struct StakeKernelCandidate {
+    COutPoint prevout;
+    CAmount nValueIn{0};
+    unsigned int nTimeBlockFrom{0};
+    // PoS v1 only: modifier of the block the input comes from
+    uint32_t nStakeModifier{0};
+};
+
+bool PrepareStakeKernelWindow(const CBlockHeader& current, const CBlockIndex& blockPrev, unsigned int nHashDrift, StakeKernelWindow& window);
+bool PrepareStakeKernelCandidate(const CBlockHeader& current, const CBlockIndex& blockFrom, CAmount nValueIn,
+                                 const COutPoint& prevout, StakeKernelCandidate& candidate, bool fCheck = false);
+// Find the earliest timestamp of the window meeting the kernel target, nHashes is increased
+// by the number of kernels hashed. Fails if that timestamp is not after window.nTimePastLimit.
+bool SearchStakeKernel(const StakeKernelWindow& window, const StakeKernelCandidate& candidate,
+                       unsigned int& nTimeTx, uint32_t& nStakeModifier, uint256& hashProofOfStake, uint64_t& nHashes);
+// Outcome of SearchStakeKernels()
+struct StakeKernelSearch {
+    // Index of the earliest candidate with a kernel, the number of candidates if none
+    size_t nFound{0};
+    unsigned int nTimeTx{0};
+    uint32_t nStakeModifier{0};
+    uint256 hashProofOfStake;
+    int nThreads{0};
+    uint64_t nScanned{0};
+    // Kernels hashed for each candidate
+    std::vector<uint64_t> vHashes;
+    int64_t nDurationMicros{0};
+};
+// Run SearchStakeKernel() over the candidates on nThreads threads, the calling one included.
+// The extra threads are taken from pool if given, else started for this search only. The
+// winner is the earliest candidate with a kernel, as with a sequential search.
+void SearchStakeKernels(const StakeKernelWindow& window, const std::vector<StakeKernelCandidate>& candidates,
+                        int nThreads, StakeKernelSearch& result, ctpl::thread_pool* pool = nullptr);
 bool CheckStakeKernelHash(
     CBlockHeader &current,
     const CBlockIndex &blockPrev,
     const CBlockIndex &blockFrom,
-    const CTransaction txPrev,
+    CAmount nValueIn,
     const COutPoint prevout,
     unsigned int nHashDrift,
     bool fCheck,
@@ -0,0 +1,50 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POS_STAKEINPUT_H
+#define BITCOIN_POS_STAKEINPUT_H
+
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <sync.h>
+
+namespace Consensus { struct Params; }
+
+extern CCriticalSection cs_main;
+
+/** Everything proof-of-stake validation needs to know about a stake input. */
+struct CStakeProvenance {
+    int nHeight{-1};
+    uint32_t nBlockTime{0};
+    bool fCoinBase{false};
+    CTxOut out;
+
+    SERIALIZE_METHODS(CStakeProvenance, obj)
+    {
+        READWRITE(obj.nHeight, obj.nBlockTime, obj.fCoinBase, obj.out);
+    }
+};
+
+enum class StakeInputSource {
+    UNKNOWN,
+    //! Unspent output of the active chain
+    COINS,
+    //! Output spent by a proof-of-stake block of the active chain
+    PROVENANCE,
+    //! Transaction index lookup, used for outputs spent by ordinary transactions
+    TXINDEX,
+    //! Found in the mempool or in a block outside of the active chain
+    OFF_CHAIN,
+};
+
+/**
+ * Resolve a stake input to the active chain. The UTXO set and the stake provenance
+ * index (stake inputs of connected proof-of-stake blocks) answer from the coins cache
+ * and the block tree DB, only inputs spent by other transactions fall back to -txindex.
+ * Returns true if the input was created in a block of the active chain.
+ */
+bool ResolveStakeInput(const COutPoint& prevout, const Consensus::Params& consensus,
+                       CStakeProvenance& provenance, StakeInputSource& source) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+#endif // BITCOIN_POS_STAKEINPUT_H
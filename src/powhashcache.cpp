@@ -0,0 +1,85 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <powhashcache.h>
+
+#include <hash.h>
+#include <logging.h>
+#include <txdb.h>
+
+std::unique_ptr<CPowHashCache> powHashCache;
+
+static uint256 HeaderKey(const char* header)
+{
+    return Hash(header, header + 80);
+}
+
+CPowHashCache::CPowHashCache(CBlockTreeDB& _db, size_t nMaxSize) :
+    db(_db),
+    mapCache(nMaxSize)
+{
+}
+
+bool CPowHashCache::Lookup(const char* header, uint256& hash)
+{
+    const uint256 key = HeaderKey(header);
+    {
+        LOCK(cs);
+        if (mapCache.get(key, hash)) {
+            return true;
+        }
+    }
+    if (!db.ReadLegacyPowHash(key, hash)) {
+        return false;
+    }
+    LOCK(cs);
+    mapCache.insert(key, hash);
+    return true;
+}
+
+void CPowHashCache::Insert(const std::vector<std::pair<const char*, uint256>>& entries)
+{
+    std::vector<std::pair<uint256, uint256>> vect;
+    vect.reserve(entries.size());
+    for (const auto& p : entries) {
+        vect.emplace_back(HeaderKey(p.first), p.second);
+    }
+    LOCK(cs);
+    for (const auto& p : vect) {
+        mapCache.insert(p.first, p.second);
+    }
+}
+
+void CPowHashCache::Persist(const CBlockHeader& header, const uint256& hash)
+{
+    if (header.nVersion >= 4) {
+        return;
+    }
+    const uint256 key = HeaderKey(BEGIN(header.nVersion));
+    bool fFlush;
+    {
+        LOCK(cs);
+        mapCache.insert(key, hash);
+        vecPending.emplace_back(key, hash);
+        fFlush = vecPending.size() >= POW_HASH_CACHE_WRITE_BATCH;
+    }
+    if (fFlush) {
+        Flush();
+    }
+}
+
+bool CPowHashCache::Flush()
+{
+    std::vector<std::pair<uint256, uint256>> vect;
+    WITH_LOCK(cs, vect.swap(vecPending));
+    if (vect.empty()) {
+        return true;
+    }
+    // Not synced, losing the tail on a crash only costs a re-hash
+    if (!db.WriteLegacyPowHashes(vect)) {
+        LogPrintf("CPowHashCache::%s -- failed to write %d entries\n", __func__, vect.size());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POWHASHCACHE_H
+#define BITCOIN_POWHASHCACHE_H
+
+#include <primitives/block.h>
+#include <saltedhasher.h>
+#include <sync.h>
+#include <uint256.h>
+#include <unordered_lru_cache.h>
+
+#include <memory>
+#include <vector>
+
+class CBlockTreeDB;
+class CPowHashCache;
+
+extern std::unique_ptr<CPowHashCache> powHashCache;
+
+//! Default number of legacy header hashes kept in memory
+static const size_t DEFAULT_POW_HASH_CACHE_SIZE = 100000;
+//! Number of queued legacy header hashes that triggers a write to the block tree DB
+static const size_t POW_HASH_CACHE_WRITE_BATCH = 10000;
+
+/**
+ * Cache of the scrypt hash of pre-v4 headers. Entries are keyed by the SHA256d of the
+ * 80-byte header and kept in an in-memory LRU, so re-hashing an already known legacy
+ * header (headers re-sent by peers, ReadBlockFromDisk consistency checks, RPCs on old
+ * heights) is a lookup instead of a full scrypt.
+ *
+ * Only the hashes of headers accepted into the block index are written to the block
+ * tree DB (in batches, see Persist()), so they survive restarts while headers from
+ * unvalidated peer messages never touch the disk.
+ */
+class CPowHashCache : public CLegacyHeaderHashCache
+{
+private:
+    CBlockTreeDB& db;
+
+    mutable CCriticalSection cs;
+    unordered_lru_cache<uint256, uint256, StaticSaltedHasher> mapCache GUARDED_BY(cs);
+    //! Entries of headers in the block index which are not written to the DB yet
+    std::vector<std::pair<uint256, uint256>> vecPending GUARDED_BY(cs);
+
+public:
+    explicit CPowHashCache(CBlockTreeDB& _db, size_t nMaxSize = DEFAULT_POW_HASH_CACHE_SIZE);
+
+    bool Lookup(const char* header, uint256& hash) override;
+    //! Only updates the in-memory cache, see Persist()
+    void Insert(const std::vector<std::pair<const char*, uint256>>& entries) override;
+
+    /** Queue the hash of a header accepted into the block index for writing to the DB */
+    void Persist(const CBlockHeader& header, const uint256& hash);
+    /** Write all queued entries to the DB */
+    bool Flush();
+};
+
+#endif // BITCOIN_POWHASHCACHE_H
@@ -15,24 +15,90 @@
 #include <util/strencodings.h>
 #include <crypto/common.h>
 
+#include <atomic>
+
+static std::atomic<CLegacyHeaderHashCache*> g_legacy_hash_cache{nullptr};
+
+void SetLegacyHeaderHashCache(CLegacyHeaderHashCache* cache)
+{
+    g_legacy_hash_cache = cache;
+}
+
+/** scrypt of the 80-byte header at nVersion, going through the legacy hash cache if one is installed */
+static uint256 LegacyScryptHash(const CBlockHeader& header)
+{
+    CLegacyHeaderHashCache* cache = g_legacy_hash_cache;
+    uint256 thash;
+    if (cache && cache->Lookup(BEGIN(header.nVersion), thash)) {
+        return thash;
+    }
+    scrypt_1024_1_1_256(BEGIN(header.nVersion), BEGIN(thash));
+    if (cache) {
+        cache->Insert({{BEGIN(header.nVersion), thash}});
+    }
+    return thash;
+}
+
 uint256 CBlockHeader::GetHash() const
 {
     if (nVersion < 4)
     {
-        uint256 thash;
-        scrypt_1024_1_1_256(BEGIN(nVersion), BEGIN(thash));
-        return thash;
+        return LegacyScryptHash(*this);
     }
     return SerializeHash(*this);
 }
 
 uint256 CBlockHeader::GetPoWHash() const
 {
+    if (nVersion < 4)
+    {
+        // identical to GetHash() for legacy headers, so share its cache
+        return LegacyScryptHash(*this);
+    }
     uint256 thash;
     scrypt_1024_1_1_256(BEGIN(nVersion), BEGIN(thash));
     return thash;
 }
 
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<const CBlockHeader*>& headers)
+{
+    CLegacyHeaderHashCache* cache = g_legacy_hash_cache;
+    std::vector<uint256> hashes(headers.size());
+    std::vector<size_t> legacy;
+    legacy.reserve(headers.size());
+
+    for (size_t i = 0; i < headers.size(); i++) {
+        if (headers[i]->nVersion < 4) {
+            if (!cache || !cache->Lookup(BEGIN(headers[i]->nVersion), hashes[i])) {
+                legacy.push_back(i);
+            }
+        } else {
+            hashes[i] = SerializeHash(*headers[i]);
+        }
+    }
+    if (legacy.empty()) {
+        return hashes;
+    }
+
+    // scrypt input is the 80 bytes starting at nVersion, see GetHash()
+    std::vector<char> input(legacy.size() * 80);
+    std::vector<char> output(legacy.size() * 32);
+    for (size_t i = 0; i < legacy.size(); i++) {
+        memcpy(&input[i * 80], BEGIN(headers[legacy[i]]->nVersion), 80);
+    }
+    scrypt_1024_1_1_256_batch(input.data(), output.data(), legacy.size());
+    std::vector<std::pair<const char*, uint256>> computed;
+    computed.reserve(legacy.size());
+    for (size_t i = 0; i < legacy.size(); i++) {
+        memcpy(hashes[legacy[i]].begin(), &output[i * 32], 32);
+        computed.emplace_back(BEGIN(headers[legacy[i]]->nVersion), hashes[legacy[i]]);
+    }
+    if (cache) {
+        cache->Insert(computed);
+    }
+    return hashes;
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -15,6 +15,21 @@ class CKeyStore;
 
 #define BEGIN(a)	((char*)&(a))
 
+/** Cache for the scrypt hash of pre-v4 (nVersion < 4) headers, installed by the
+ *  node through SetLegacyHeaderHashCache(). Lookups and inserts take the raw
+ *  80-byte header starting at nVersion and must be thread-safe.
+ */
+class CLegacyHeaderHashCache
+{
+public:
+    virtual ~CLegacyHeaderHashCache() = default;
+    virtual bool Lookup(const char* header, uint256& hash) = 0;
+    virtual void Insert(const std::vector<std::pair<const char*, uint256>>& entries) = 0;
+};
+
+/** Install (or remove, with nullptr) the cache used by CBlockHeader::GetHash() for legacy headers */
+void SetLegacyHeaderHashCache(CLegacyHeaderHashCache* cache);
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -131,6 +146,12 @@ public:
     }
 };
 
+/** Compute GetHash() for a run of headers. The scrypt of all pre-v4 headers
+ *  is done in one scrypt_1024_1_1_256_batch() call so the multi-lane kernels
+ *  can be used; the result is in the same order as the input.
+ */
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<const CBlockHeader*>& headers);
+
 
 class CBlock : public CBlockHeader
 {
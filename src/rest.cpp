@@ -149,8 +149,12 @@ static bool rest_headers(HTTPRequest* req,
     switch (rf) {
     case RetFormat::BINARY: {
         CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
-        for (const CBlockIndex *pindex : headers) {
-            ssHeader << pindex->GetBlockHeader();
+        try {
+            for (const CBlockIndex *pindex : headers) {
+                ssHeader << pindex->GetBlockHeader();
+            }
+        } catch (const std::runtime_error& e) {
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, e.what());
         }
 
         std::string binaryHeader = ssHeader.str();
@@ -161,8 +165,12 @@ static bool rest_headers(HTTPRequest* req,
 
     case RetFormat::HEX: {
         CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
-        for (const CBlockIndex *pindex : headers) {
-            ssHeader << pindex->GetBlockHeader();
+        try {
+            for (const CBlockIndex *pindex : headers) {
+                ssHeader << pindex->GetBlockHeader();
+            }
+        } catch (const std::runtime_error& e) {
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, e.what());
         }
 
         std::string strHex = HexStr(ssHeader) + "\n";
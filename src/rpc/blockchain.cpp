@@ -14,6 +14,7 @@
 #include <core_io.h>
 #include <consensus/validation.h>
 #include <index/blockfilterindex.h>
+#include <index/timestampindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
 #include <node/coinstats.h>
@@ -60,7 +61,7 @@ static Mutex cs_blockchange;
 static std::condition_variable cond_blockchange;
 static CUpdatedBlock latestblock GUARDED_BY(cs_blockchange);
 
-extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
+extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, bool fSpentInfo = true);
 
 /* Calculate the difficulty for a given block index.
  */
@@ -776,6 +777,10 @@ static UniValue getblockhashes(const JSONRPCRequest& request)
     unsigned int low = request.params[1].get_int();
     std::vector<uint256> blockHashes;
 
+    if (g_timestampindex && !g_timestampindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Timestamp index is still syncing. Try again later.");
+    }
+
     if (!GetTimestampIndex(high, low, blockHashes)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
     }
@@ -8,6 +8,11 @@
 #include <consensus/consensus.h>
 #include <evo/mnauth.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
+#include <index/txindex.h>
 #include <key_io.h>
 #include <net.h>
 #include <rpc/blockchain.h>
@@ -649,6 +654,14 @@ static bool getAddressesFromParams(const UniValue& params, std::vector<std::pair
     return true;
 }
 
+/** Wait for the address index to catch up with the chain, so that queries do not miss recent blocks. */
+static void SyncAddressIndex()
+{
+    if (g_addressindex && !g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is still syncing. Try again later.");
+    }
+}
+
 static bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
                 std::pair<CAddressUnspentKey, CAddressUnspentValue> b) {
     return a.second.blockHeight < b.second.blockHeight;
@@ -768,6 +781,8 @@ static UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    SyncAddressIndex();
+
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -851,6 +866,8 @@ static UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    SyncAddressIndex();
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -904,7 +921,8 @@ static UniValue getaddressbalance(const JSONRPCRequest& request)
             "  \"balance\" : xxxxx,              (numeric) The current total balance in corsars\n"
             "  \"balance_immature\" : xxxxx,     (numeric) The current immature balance in corsars\n"
             "  \"balance_spendable\" : xxxxx,    (numeric) The current spendable balance in corsars\n"
-            "  \"received\" : xxxxx              (numeric) The total number of corsars received (including change)\n"
+            "  \"received\" : xxxxx,             (numeric) The total number of corsars received (including change)\n"
+            "  \"txcount\" : xxxxx               (numeric) The number of transactions involving each address, summed over the addresses\n"
             "}\n"
                 },
                 RPCExamples{
@@ -919,38 +937,23 @@ static UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
-    int nHeight = WITH_LOCK(cs_main, return ::ChainActive().Height());
+    SyncAddressIndex();
 
-    CAmount balance = 0;
-    CAmount balance_spendable = 0;
+    // The balance and the immature entries are read as of one block the index has processed,
+    // which need not be the chain tip while the index is catching up
+    CAddressBalanceValue value;
     CAmount balance_immature = 0;
-    CAmount received = 0;
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
-        }
-        if (it->first.txindex == 0 && nHeight - it->first.blockHeight < COINBASE_MATURITY) {
-            balance_immature += it->second;
-        } else {
-            balance_spendable += it->second;
-        }
-        balance += it->second;
+    int nHeight = 0;
+    if (!g_addressindex || !g_addressindex->ReadAddressBalances(addresses, value, balance_immature, nHeight)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
     }
 
     UniValue result(UniValue::VOBJ);
-    result.pushKV("balance", balance);
+    result.pushKV("balance", value.balance);
     result.pushKV("balance_immature", balance_immature);
-    result.pushKV("balance_spendable", balance_spendable);
-    result.pushKV("received", received);
+    result.pushKV("balance_spendable", value.balance - balance_immature);
+    result.pushKV("received", value.received);
+    result.pushKV("txcount", value.txCount);
 
     return result;
 
@@ -998,6 +1001,8 @@ static UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
+    SyncAddressIndex();
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -1078,6 +1083,10 @@ static UniValue getspentinfo(const JSONRPCRequest& request)
     CSpentIndexKey key(txid, outputIndex);
     CSpentIndexValue value;
 
+    if (g_spentindex && !g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index is still syncing. Try again later.");
+    }
+
     if (!GetSpentIndex(key, value)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
     }
@@ -1268,6 +1277,70 @@ static UniValue logging(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue SummaryToJSON(const IndexSummary&& summary, std::string index_name)
+{
+    UniValue ret_summary(UniValue::VOBJ);
+    if (!index_name.empty() && index_name != summary.name) return ret_summary;
+
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("synced", summary.synced);
+    entry.pushKV("best_block_height", summary.best_block_height);
+    ret_summary.pushKV(summary.name, entry);
+    return ret_summary;
+}
+
+static UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getindexinfo",
+                "\nReturns the status of one or all available indices currently running in the node.\n",
+                {
+                    {"index_name", RPCArg::Type::STR, /* default */ "all indices", "Filter results for an index with a specific name."},
+                },
+                RPCResult{
+            "{\n"
+            "  \"name\" : {                  (json object) The name of the index\n"
+            "    \"synced\" : true|false,    (boolean) Whether the index is synced or not\n"
+            "    \"best_block_height\" : n   (numeric) The block height to which the index is synced\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+            + HelpExampleCli("getindexinfo", "addressindex")
+            + HelpExampleRpc("getindexinfo", "addressindex")
+                },
+            }.ToString());
+
+    UniValue result(UniValue::VOBJ);
+    const std::string index_name = request.params[0].isNull() ? "" : request.params[0].get_str();
+
+    if (g_txindex) {
+        result.pushKVs(SummaryToJSON(g_txindex->GetSummary(), index_name));
+    }
+
+    if (g_addressindex) {
+        result.pushKVs(SummaryToJSON(g_addressindex->GetSummary(), index_name));
+    }
+
+    if (g_spentindex) {
+        result.pushKVs(SummaryToJSON(g_spentindex->GetSummary(), index_name));
+    }
+
+    if (g_timestampindex) {
+        result.pushKVs(SummaryToJSON(g_timestampindex->GetSummary(), index_name));
+    }
+
+    ForEachBlockFilterIndex([&result, &index_name](const BlockFilterIndex& index) {
+        result.pushKVs(SummaryToJSON(index.GetSummary(), index_name));
+    });
+
+    return result;
+}
+
 static UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -1301,6 +1374,7 @@ static const CRPCCommand commands[] =
     { "util",               "getdescriptorinfo",      &getdescriptorinfo,      {"descriptor"} },
     { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
     { "util",               "signmessagewithprivkey", &signmessagewithprivkey, {"privkey","message"} },
+    { "util",               "getindexinfo",           &getindexinfo,           {"index_name"} },
     { "blockchain",         "getspentinfo",           &getspentinfo,           {"json"} },
 
     /* Address index */
@@ -10,6 +10,7 @@
 #include <consensus/validation.h>
 #include <consensus/tx_verify.h>
 #include <core_io.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <init.h>
 #include <key_io.h>
@@ -51,7 +52,7 @@
  */
 constexpr static CAmount DEFAULT_MAX_RAW_TX_FEE{COIN / 10};
 
-void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
+void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, bool fSpentInfo)
 {
     // Call into TxToUniv() in bitcoin-common to decode the transaction hex.
     //
@@ -64,7 +65,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
     // Add spent information if spentindex is enabled
     CSpentIndexTxInfo txSpentInfo;
     for (const auto& txin : tx.vin) {
-        if (!tx.IsCoinBase()) {
+        if (fSpentInfo && !tx.IsCoinBase()) {
             CSpentIndexValue spentInfo;
             CSpentIndexKey spentKey(txin.prevout.hash, txin.prevout.n);
             if (GetSpentIndex(spentKey, spentInfo)) {
@@ -72,7 +73,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
             }
         }
     }
-    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+    for (unsigned int i = 0; fSpentInfo && i < tx.vout.size(); i++) {
         CSpentIndexValue spentInfo;
         CSpentIndexKey spentKey(txid, i);
         if (GetSpentIndex(spentKey, spentInfo)) {
@@ -178,6 +179,7 @@ static UniValue getrawtransaction(const JSONRPCRequest& request)
             "  \"instantlock\" : true|false, (boolean) Current transaction lock state\n"
             "  \"instantlock_internal\" : true|false, (boolean) Current internal transaction lock state\n"
             "  \"chainlock\" : true|false, (boolean) The state of the corresponding block chainlock\n"
+            "  \"spentindex_syncing\" : true, (boolean) Only present if -spentindex is still syncing, spent information is left out then\n"
             "}\n"
                     },
                 },
@@ -244,9 +246,15 @@ static UniValue getrawtransaction(const JSONRPCRequest& request)
         return EncodeHexTx(*tx);
     }
 
+    // Let the spent information reflect the blocks validated so far, it is left out while the index catches up
+    const bool fSpentIndexSynced = !g_spentindex || g_spentindex->BlockUntilSyncedToCurrentChain();
+
     UniValue result(UniValue::VOBJ);
     if (blockindex) result.pushKV("in_active_chain", in_active_chain);
-    TxToJSON(*tx, hash_block, result);
+    TxToJSON(*tx, hash_block, result, fSpentIndexSynced);
+    if (!fSpentIndexSynced) {
+        result.pushKV("spentindex_syncing", true);
+    }
     return result;
 }
 
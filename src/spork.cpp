@@ -17,26 +17,30 @@
 #include <script/standard.h>
 #include <timedata.h>
 #include <util/ranges.h>
+#include <util/system.h>
 #include <util/validation.h> // for strMessageMagic
 
 #include <string>
 
 CSporkManager sporkManager;
 
+CSporkManager::CSporkManager()
+{
+    // no spork messages yet, every spork has its default value
+    auto state = std::make_unique<CSporkState>();
+    for (size_t i = 0; i < sporkDefs.size(); i++) {
+        state->values[i] = sporkDefs[i].defaultValue;
+    }
+    sporkState.store(state.get(), std::memory_order_release);
+    vecSporkStates.emplace_back(std::move(state));
+}
+
 bool CSporkManager::SporkValueIsActive(SporkId nSporkID, int64_t& nActiveValueRet) const
 {
     AssertLockHeld(cs);
 
     if (!mapSporksActive.count(nSporkID)) return false;
 
-    {
-        LOCK(cs_mapSporksCachedValues);
-        if (auto it = mapSporksCachedValues.find(nSporkID); it != mapSporksCachedValues.end()) {
-            nActiveValueRet = it->second;
-            return true;
-        }
-    }
-
     // calc how many values we have and how many signers vote for every value
     std::unordered_map<int64_t, int> mapValueCounts;
     for (const auto& [_, spork] : mapSporksActive.at(nSporkID)) {
@@ -45,7 +49,6 @@ bool CSporkManager::SporkValueIsActive(SporkId nSporkID, int64_t& nActiveValueRe
             // nMinSporkKeys is always more than the half of the max spork keys number,
             // so there is only one such value and we can stop here
             nActiveValueRet = spork.nValue;
-            WITH_LOCK(cs_mapSporksCachedValues, mapSporksCachedValues[nSporkID] = nActiveValueRet);
             return true;
         }
     }
@@ -53,6 +56,28 @@ bool CSporkManager::SporkValueIsActive(SporkId nSporkID, int64_t& nActiveValueRe
     return false;
 }
 
+void CSporkManager::UpdateSporkState()
+{
+    AssertLockHeld(cs);
+
+    auto state = std::make_unique<CSporkState>();
+    state->nMaxTimeAdjustment = std::max<int64_t>(0, gArgs.GetArg("-maxtimeadjustment", DEFAULT_MAX_TIME_ADJUSTMENT));
+    for (size_t i = 0; i < sporkDefs.size(); i++) {
+        if (int64_t nSporkValue = -1; SporkValueIsActive(sporkDefs[i].sporkId, nSporkValue)) {
+            state->values[i] = nSporkValue;
+        } else {
+            state->values[i] = sporkDefs[i].defaultValue;
+        }
+    }
+
+    const CSporkState* pcurrent = sporkState.load(std::memory_order_relaxed);
+    if (pcurrent->values == state->values && pcurrent->nMaxTimeAdjustment == state->nMaxTimeAdjustment) {
+        return;
+    }
+    sporkState.store(state.get(), std::memory_order_release);
+    vecSporkStates.emplace_back(std::move(state));
+}
+
 void CSporkManager::Clear()
 {
     LOCK(cs);
@@ -60,6 +85,7 @@ void CSporkManager::Clear()
     mapSporksByHash.clear();
     // sporkPubKeyID and sporkPrivKey should be set in init.cpp,
     // we should not alter them here.
+    UpdateSporkState();
 }
 
 void CSporkManager::CheckAndRemove()
@@ -100,6 +126,8 @@ void CSporkManager::CheckAndRemove()
         }
         ++itByHash;
     }
+
+    UpdateSporkState();
 }
 
 void CSporkManager::ProcessSporkMessages(CNode* pfrom, std::string_view strCommand, CDataStream& vRecv, CConnman& connman)
@@ -164,9 +192,7 @@ void CSporkManager::ProcessSpork(const CNode* pfrom, std::string_view strCommand
         LOCK(cs); // make sure to not lock this together with cs_main
         mapSporksByHash[hash] = spork;
         mapSporksActive[spork.nSporkID][keyIDSigner] = spork;
-        // Clear cached values on new spork being processed
-        WITH_LOCK(cs_mapSporksCachedActive, mapSporksCachedActive.erase(spork.nSporkID));
-        WITH_LOCK(cs_mapSporksCachedValues, mapSporksCachedValues.erase(spork.nSporkID));
+        UpdateSporkState();
     }
     spork.Relay(connman);
 }
@@ -206,9 +232,7 @@ bool CSporkManager::UpdateSpork(SporkId nSporkID, int64_t nValue, CConnman& conn
 
         mapSporksByHash[spork.GetHash()] = spork;
         mapSporksActive[nSporkID][keyIDSigner] = spork;
-        // Clear cached values on new spork being processed
-        WITH_LOCK(cs_mapSporksCachedActive, mapSporksCachedActive.erase(spork.nSporkID));
-        WITH_LOCK(cs_mapSporksCachedValues, mapSporksCachedValues.erase(spork.nSporkID));
+        UpdateSporkState();
     }
 
     spork.Relay(connman);
@@ -217,41 +241,36 @@ bool CSporkManager::UpdateSpork(SporkId nSporkID, int64_t nValue, CConnman& conn
 
 bool CSporkManager::IsSporkActive(SporkId nSporkID) const
 {
-    // If nSporkID is cached, and the cached value is true, then return early true
-    {
-        LOCK(cs_mapSporksCachedActive);
-        if (auto it = mapSporksCachedActive.find(nSporkID); it != mapSporksCachedActive.end() && it->second) {
-            return true;
-        }
+    const int nIndex = GetSporkDefIndex(nSporkID);
+    if (nIndex < 0) {
+        return GetSporkValue(nSporkID) < GetAdjustedTime();
     }
 
-    int64_t nSporkValue = GetSporkValue(nSporkID);
-    // Get time is somewhat costly it looks like
-    bool ret = nSporkValue < GetAdjustedTime();
-    // Only cache true values
-    if (ret) {
-        LOCK(cs_mapSporksCachedActive);
-        mapSporksCachedActive[nSporkID] = ret;
-    }
-    return ret;
+    const CSporkState* pstate = sporkState.load(std::memory_order_acquire);
+    const int64_t nSporkValue = pstate->values[nIndex];
+    // The adjusted time is within nMaxTimeAdjustment of the local clock, so only close to the activation time
+    // the (locked) network time offset can make a difference
+    const int64_t nTime = GetTime();
+    if (nSporkValue >= nTime + pstate->nMaxTimeAdjustment) return false;
+    if (nSporkValue < nTime - pstate->nMaxTimeAdjustment) return true;
+    return nSporkValue < GetAdjustedTime();
 }
 
 int64_t CSporkManager::GetSporkValue(SporkId nSporkID) const
 {
+    if (const int nIndex = GetSporkDefIndex(nSporkID); nIndex >= 0) {
+        return sporkState.load(std::memory_order_acquire)->values[nIndex];
+    }
+
+    // not in sporkDefs, only spork messages can give it a value
     LOCK(cs);
 
     if (int64_t nSporkValue = -1; SporkValueIsActive(nSporkID, nSporkValue)) {
         return nSporkValue;
     }
 
-
-    if (auto optSpork = ranges::find_if_opt(sporkDefs,
-                                            [&nSporkID](const auto& sporkDef){return sporkDef.sporkId == nSporkID;})) {
-        return optSpork->defaultValue;
-    } else {
-        LogPrint(BCLog::SPORK, "CSporkManager::GetSporkValue -- Unknown Spork ID %d\n", nSporkID);
-        return -1;
-    }
+    LogPrint(BCLog::SPORK, "CSporkManager::GetSporkValue -- Unknown Spork ID %d\n", nSporkID);
+    return -1;
 }
 
 SporkId CSporkManager::GetSporkIDByName(std::string_view strName)
@@ -300,6 +319,7 @@ bool CSporkManager::SetMinSporkKeys(int minSporkKeys)
         return false;
     }
     nMinSporkKeys = minSporkKeys;
+    UpdateSporkState();
     return true;
 }
 
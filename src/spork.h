@@ -11,9 +11,12 @@
 #include <pubkey.h>
 #include <saltedhasher.h>
 #include <sync.h>
+#include <timedata.h>
 #include <uint256.h>
 
 #include <array>
+#include <atomic>
+#include <memory>
 #include <string_view>
 #include <unordered_map>
 #include <vector>
@@ -76,6 +79,16 @@ struct CSporkDef
 #undef MAKE_SPORK_DEF
 extern CSporkManager sporkManager;
 
+/**
+ * CSporkState is an immutable snapshot of the effective spork values, indexed like sporkDefs.
+ */
+struct CSporkState
+{
+    std::array<int64_t, sporkDefs.size()> values{};
+    // GetAdjustedTime() never differs from GetTime() by more than this, see -maxtimeadjustment
+    int64_t nMaxTimeAdjustment{DEFAULT_MAX_TIME_ADJUSTMENT};
+};
+
 /**
  * Sporks are network parameters used primarily to prevent forking and turn
  * on/off certain features. They are a soft consensus mechanism.
@@ -165,14 +178,16 @@ class CSporkManager
 private:
     static constexpr std::string_view SERIALIZATION_VERSION_STRING = "CSporkManager-Version-2";
 
-    mutable Mutex cs_mapSporksCachedActive;
-    mutable std::unordered_map<const SporkId, bool> mapSporksCachedActive GUARDED_BY(cs_mapSporksCachedActive);
-
-    mutable Mutex cs_mapSporksCachedValues;
-    mutable std::unordered_map<SporkId, int64_t> mapSporksCachedValues GUARDED_BY(cs_mapSporksCachedValues);
-
     mutable Mutex cs;
 
+    /**
+     * The spork state queried by IsSporkActive and GetSporkValue without locking. It is replaced (never modified)
+     * under cs whenever the spork messages or the signer threshold change. Replaced states are kept alive as
+     * readers might still hold them, they are tiny and sporks rarely change.
+     */
+    std::atomic<const CSporkState*> sporkState{nullptr};
+    std::vector<std::unique_ptr<const CSporkState>> vecSporkStates GUARDED_BY(cs);
+
     std::unordered_map<uint256, CSporkMessage, StaticSaltedHasher> mapSporksByHash GUARDED_BY(cs);
     std::unordered_map<SporkId, std::map<CKeyID, CSporkMessage> > mapSporksActive GUARDED_BY(cs);
 
@@ -186,9 +201,25 @@ private:
      */
     bool SporkValueIsActive(SporkId nSporkID, int64_t& nActiveValueRet) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /**
+     * UpdateSporkState recalculates the spork values and publishes them as a new CSporkState if anything changed.
+     */
+    void UpdateSporkState() EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /**
+     * GetSporkDefIndex returns the position of the spork in sporkDefs and CSporkState::values, -1 if unknown.
+     */
+    static constexpr int GetSporkDefIndex(SporkId nSporkID)
+    {
+        for (size_t i = 0; i < sporkDefs.size(); i++) {
+            if (sporkDefs[i].sporkId == nSporkID) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
 public:
 
-    CSporkManager() = default;
+    CSporkManager();
 
     template<typename Stream>
     void Serialize(Stream &s) const LOCKS_EXCLUDED(cs)
@@ -211,6 +242,7 @@ public:
             return;
         }
         s >> mapSporksByHash >> mapSporksActive;
+        UpdateSporkState();
     }
 
     /**
@@ -265,12 +297,16 @@ public:
      * value should not be considered a timestamp, but an integer value
      * instead, and therefore this method doesn't make sense and should not be
      * used.
+     *
+     * Lock-free for sporks listed in sporkDefs.
      */
     bool IsSporkActive(SporkId nSporkID) const;
 
     /**
      * GetSporkValue returns the spork value given a Spork ID. If no active spork
      * message has yet been received by the node, it returns the default value.
+     *
+     * Lock-free for sporks listed in sporkDefs.
      */
     int64_t GetSporkValue(SporkId nSporkID) const LOCKS_EXCLUDED(cs);
 
@@ -0,0 +1,118 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_ARENA_H
+#define BITCOIN_SUPPORT_ALLOCATORS_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//
+// Bump allocator handing out memory from large blocks. Single allocations are never freed, all memory is
+// released at once by Clear(), which keeps the first block around for reuse. This allocator is NOT thread safe
+//
+class MonotonicArena
+{
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+private:
+    const size_t nBlockSize;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* pos{nullptr};
+    char* end{nullptr};
+    size_t nAllocated{0};
+
+    void NewBlock()
+    {
+        blocks.emplace_back(new char[nBlockSize]);
+        nAllocated += nBlockSize;
+        pos = blocks.back().get();
+        end = pos + nBlockSize;
+    }
+
+    void* AllocateSlow(size_t nSize, size_t nAlign)
+    {
+        // the first block is the one Clear() keeps, so it must be a regular one
+        if (blocks.empty()) {
+            NewBlock();
+            return Allocate(nSize, nAlign);
+        }
+        // requests which would waste more than a quarter of a block get a block of their own
+        if (nSize + nAlign > nBlockSize / 4) {
+            blocks.emplace_back(new char[nSize + nAlign]);
+            nAllocated += nSize + nAlign;
+            // keep bumping in the current block, the dedicated one is not used for anything else
+            auto p = reinterpret_cast<uintptr_t>(blocks.back().get());
+            return reinterpret_cast<void*>((p + nAlign - 1) & ~(uintptr_t)(nAlign - 1));
+        }
+        NewBlock();
+        return Allocate(nSize, nAlign);
+    }
+
+public:
+    explicit MonotonicArena(size_t _nBlockSize = DEFAULT_BLOCK_SIZE) : nBlockSize(_nBlockSize) {}
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    // nAlign must be a power of two
+    void* Allocate(size_t nSize, size_t nAlign = alignof(std::max_align_t))
+    {
+        auto p = reinterpret_cast<uintptr_t>(pos);
+        auto aligned = (p + nAlign - 1) & ~(uintptr_t)(nAlign - 1);
+        if (pos != nullptr && aligned + nSize <= reinterpret_cast<uintptr_t>(end)) {
+            pos = reinterpret_cast<char*>(aligned + nSize);
+            return reinterpret_cast<void*>(aligned);
+        }
+        return AllocateSlow(nSize, nAlign);
+    }
+
+    // invalidates all memory handed out so far
+    void Clear()
+    {
+        if (blocks.empty()) {
+            return;
+        }
+        // only the first block can be shared, later ones might be dedicated to a single large allocation
+        blocks.resize(1);
+        nAllocated = nBlockSize;
+        pos = blocks[0].get();
+        end = pos + nBlockSize;
+    }
+
+    // bytes currently reserved from the heap, including unused parts of the blocks
+    size_t DynamicMemoryUsage() const { return nAllocated; }
+};
+
+//
+// STL allocator backed by a MonotonicArena. deallocate() is a no-op, the memory is given back when the arena is
+// cleared. Containers using it must not outlive the arena and must be emptied before the arena is cleared
+//
+template <typename T>
+struct arena_allocator {
+    using value_type = T;
+
+    MonotonicArena* arena;
+
+    explicit arena_allocator(MonotonicArena& _arena) noexcept : arena(&_arena) {}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(arena->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {}
+
+    template <typename U>
+    bool operator==(const arena_allocator<U>& other) const noexcept { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const arena_allocator<U>& other) const noexcept { return arena != other.arena; }
+};
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_ARENA_H
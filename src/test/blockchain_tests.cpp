@@ -3,8 +3,11 @@
 #include <stdlib.h>
 
 #include <chain.h>
+#include <chainparams.h>
 #include <rpc/blockchain.h>
 #include <test/util/setup_common.h>
+#include <txdb.h>
+#include <validation.h>
 
 /* Equality between doubles is imprecise. Comparison should be done
  * with a small threshold of tolerance, rather than exact equality.
@@ -69,4 +72,116 @@ BOOST_AUTO_TEST_CASE(get_difficulty_for_very_high_target)
     TestDifficulty(0x12345678, 5913134931067755359633408.0);
 }
 
+BOOST_FIXTURE_TEST_CASE(block_sig_on_demand, TestingSetup)
+{
+    CBlockHeader header;
+    header.nVersion = CBlockHeader::POSV2_BITS;
+    header.nTime = 1600000000;
+    header.posStakeHash = InsecureRand256();
+    header.posStakeN = 1;
+    header.vchBlockSig = std::vector<unsigned char>(65, 0x5a);
+
+    const uint256 hash = header.GetHash();
+    CBlockIndex index(header);
+    index.phashBlock = &hash;
+    BOOST_CHECK(index.pvchBlockSig);
+
+    // Once the entry is in the block index DB the signature is read back on demand
+    BOOST_CHECK(pblocktree->WriteBatchSync({}, 0, {&index}));
+    index.ReleaseBlockSig();
+    BOOST_CHECK(!index.pvchBlockSig);
+    BOOST_CHECK(index.GetBlockSig() == header.vchBlockSig);
+    BOOST_CHECK(index.GetBlockHeader().GetHash() == hash);
+    BOOST_CHECK(index.GetBlockHeader().vchBlockSig == header.vchBlockSig);
+
+    // Rewriting the entry keeps the signature
+    BOOST_CHECK(pblocktree->WriteBatchSync({}, 0, {&index}));
+    BOOST_CHECK(index.GetBlockSig() == header.vchBlockSig);
+
+    // A released signature stays in the recent signature cache, headers can be built without DB reads
+    std::vector<unsigned char> vchBlockSig;
+    BOOST_CHECK(index.GetCachedBlockSig(vchBlockSig));
+    BOOST_CHECK(vchBlockSig == header.vchBlockSig);
+    BOOST_CHECK(index.GetBlockHeader(/* fLoadSig */ false).GetHash() == hash);
+
+    // Entries that were never used are only in the DB until they are loaded once
+    CBlockHeader header2 = header;
+    header2.nTime++;
+    header2.vchBlockSig = std::vector<unsigned char>(65, 0xa5);
+    const uint256 hash2 = header2.GetHash();
+    CBlockIndex index2(header2);
+    index2.phashBlock = &hash2;
+    BOOST_CHECK(pblocktree->WriteBatchSync({}, 0, {&index2}));
+    index2.pvchBlockSig.reset();
+    BOOST_CHECK(!index2.GetCachedBlockSig(vchBlockSig));
+    BOOST_CHECK(vchBlockSig.empty());
+    BOOST_CHECK(index2.GetBlockHeader(/* fLoadSig */ false).vchBlockSig.empty());
+    BOOST_CHECK(LoadBlockSig(hash2, vchBlockSig) && vchBlockSig == header2.vchBlockSig);
+    BOOST_CHECK(index2.GetCachedBlockSig(vchBlockSig));
+    BOOST_CHECK(vchBlockSig == header2.vchBlockSig);
+
+    // A signature that can't be read is an error, neither headers nor the DB entry get an empty one
+    CBlockHeader header3 = header;
+    header3.nTime += 2;
+    const uint256 hash3 = header3.GetHash();
+    CBlockIndex index3(header3);
+    index3.phashBlock = &hash3;
+    index3.pvchBlockSig.reset();
+    BOOST_CHECK(!LoadBlockSig(hash3, vchBlockSig));
+    BOOST_CHECK(vchBlockSig.empty());
+    BOOST_CHECK_THROW(index3.GetBlockSig(), std::runtime_error);
+    BOOST_CHECK_THROW(index3.GetBlockHeader(), std::runtime_error);
+    BOOST_CHECK_THROW(pblocktree->WriteBatchSync({}, 0, {&index3}), std::runtime_error);
+    BOOST_CHECK(!pblocktree->Exists(std::make_pair('b', hash3)));
+}
+
+BOOST_FIXTURE_TEST_CASE(load_block_index_guts, TestingSetup)
+{
+    // Spans several reader batches
+    const int nBlocks = 10000;
+    CBlockTreeDB blocktree(1 << 20, true, true);
+    std::vector<uint256> hashes(nBlocks);
+    std::vector<CBlockIndex> entries(nBlocks);
+    std::vector<const CBlockIndex*> blockinfo;
+    for (int i = 0; i < nBlocks; ++i) {
+        hashes[i] = InsecureRand256();
+        entries[i].phashBlock = &hashes[i];
+        entries[i].pprev = i ? &entries[i - 1] : nullptr;
+        entries[i].nHeight = i;
+        entries[i].nTime = 1600000000 + i;
+        entries[i].nStatus = BLOCK_VALID_TREE;
+        if (i % 2) {
+            entries[i].SetProofOfStake();
+            entries[i].posStakeN = i;
+            entries[i].pvchBlockSig = std::make_shared<const std::vector<unsigned char>>(65, 0x5a);
+        }
+        blockinfo.push_back(&entries[i]);
+    }
+    BOOST_CHECK(blocktree.WriteBatchSync({}, 0, blockinfo));
+
+    BlockManager blockman;
+    LOCK(cs_main);
+    BOOST_CHECK(blocktree.LoadBlockIndexGuts(Params().GetConsensus(), [&](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+        return blockman.InsertBlockIndex(hash);
+    }, 3));
+    BOOST_CHECK_EQUAL(blockman.m_block_index.size(), (size_t)nBlocks);
+    BOOST_CHECK_EQUAL(blockman.m_block_index_arena.Size(), (size_t)nBlocks);
+    for (int i = 0; i < nBlocks; ++i) {
+        const CBlockIndex* pindex = blockman.m_block_index.at(hashes[i]);
+        BOOST_CHECK(blockman.m_block_index_arena.Owns(pindex));
+        BOOST_CHECK_EQUAL(pindex->nHeight, i);
+        BOOST_CHECK_EQUAL(pindex->nTime, 1600000000U + i);
+        BOOST_CHECK_EQUAL(pindex->IsProofOfStake(), i % 2 == 1);
+        BOOST_CHECK(pindex->pprev == (i ? blockman.m_block_index.at(hashes[i - 1]) : nullptr));
+    }
+
+    // Entries which were not allocated by the arena are still freed on unload
+    CBlockIndex* pindexForeign = new CBlockIndex();
+    BOOST_CHECK(!blockman.m_block_index_arena.Owns(pindexForeign));
+    blockman.m_block_index.emplace(InsecureRand256(), pindexForeign);
+    blockman.Unload();
+    BOOST_CHECK(blockman.m_block_index.empty());
+    BOOST_CHECK_EQUAL(blockman.m_block_index_arena.Size(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
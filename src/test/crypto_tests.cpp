@@ -11,6 +11,7 @@
 #include <crypto/hmac_sha512.h>
 #include <crypto/pkcs5_pbkdf2_hmac_sha512.h>
 #include <crypto/ripemd160.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha3.h>
@@ -733,6 +734,24 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(scrypt_batch)
+{
+    // 13 inputs exercise the 8-way, 4-way and single-lane paths in one call
+    char in[80 * 13];
+    char out1[32 * 13], out2[32 * 13];
+    for (size_t j = 0; j < sizeof(in); ++j) {
+        in[j] = InsecureRandBits(8);
+    }
+    for (int j = 0; j < 13; ++j) {
+        scrypt_1024_1_1_256(in + 80 * j, out1 + 32 * j);
+    }
+    for (size_t lanes : {0, 1, 4, 8}) {
+        memset(out2, 0, sizeof(out2));
+        scrypt_1024_1_1_256_batch(in, out2, 13, lanes);
+        BOOST_CHECK(memcmp(out1, out2, sizeof(out1)) == 0);
+    }
+}
+
 static void TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
@@ -7,6 +7,7 @@
 #include <test/util/setup_common.h>
 #include <util/memory.h>
 
+#include <map>
 #include <memory>
 
 #include <boost/test/unit_test.hpp>
@@ -399,6 +400,121 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbtransaction_nested)
+{
+    // Same layering as CEvoDB, random writes/erases through the inner transaction must look like a plain map
+    CDBWrapper dbw(GetDataDir() / "dbtransaction_nested", (1 << 20), true, false);
+    CDBBatch batch(dbw);
+    CDBTransaction<CDBWrapper, CDBBatch> rootTransaction(dbw, batch);
+    CDBTransaction<CDBTransaction<CDBWrapper, CDBBatch>, CDBTransaction<CDBWrapper, CDBBatch>> curTransaction(rootTransaction, rootTransaction);
+
+    std::map<uint32_t, uint256> model;
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 200; i++) {
+            const uint32_t n = InsecureRandRange(100);
+            if (InsecureRandBool()) {
+                const uint256 value = InsecureRand256();
+                curTransaction.Write(std::make_pair('t', n), value);
+                model[n] = value;
+            } else {
+                curTransaction.Erase(std::make_pair('t', n));
+                model.erase(n);
+            }
+        }
+        if (InsecureRandBool()) {
+            curTransaction.Commit();
+        }
+        if (InsecureRandRange(4) == 0) {
+            rootTransaction.Commit();
+            BOOST_CHECK(dbw.WriteBatch(batch));
+            batch.Clear();
+        }
+
+        for (uint32_t n = 0; n < 100; n++) {
+            uint256 value;
+            auto it = model.find(n);
+            BOOST_CHECK_EQUAL(curTransaction.Exists(std::make_pair('t', n)), it != model.end());
+            BOOST_CHECK_EQUAL(curTransaction.Read(std::make_pair('t', n), value), it != model.end());
+            if (it != model.end()) {
+                BOOST_CHECK(value == it->second);
+            }
+        }
+
+        // the iterator merges all layers in key order and skips erased keys
+        std::map<uint32_t, uint256> seen;
+        auto it = curTransaction.NewIteratorUniquePtr();
+        it->Seek(std::make_pair('t', uint32_t(0)));
+        CDataStream ssPrevKey(SER_DISK, CLIENT_VERSION);
+        for (; it->Valid(); it->Next()) {
+            std::pair<char, uint32_t> key;
+            uint256 value;
+            BOOST_REQUIRE(it->GetKey(key) && key.first == 't');
+            BOOST_REQUIRE(it->GetValue(value));
+            CDataStream ssKey = it->GetKey();
+            BOOST_CHECK(std::lexicographical_compare(
+                    (const uint8_t*)ssPrevKey.data(), (const uint8_t*)ssPrevKey.data() + ssPrevKey.size(),
+                    (const uint8_t*)ssKey.data(), (const uint8_t*)ssKey.data() + ssKey.size()));
+            ssPrevKey = ssKey;
+            seen.emplace(key.second, value);
+        }
+        BOOST_CHECK(seen == model);
+    }
+    curTransaction.Write(std::make_pair('t', uint32_t(0)), uint256());
+    // pending values by their serialized size plus the arena holding keys, holders and tree nodes
+    BOOST_CHECK_GE(curTransaction.GetMemoryUsage(), MonotonicArena::DEFAULT_BLOCK_SIZE + 32);
+    curTransaction.Clear();
+    BOOST_CHECK(curTransaction.IsClean());
+    // only the first arena block is kept for reuse
+    BOOST_CHECK_EQUAL(curTransaction.GetMemoryUsage(), MonotonicArena::DEFAULT_BLOCK_SIZE);
+}
+
+// serializes like a uint32_t, copying it throws once fThrow is set
+struct ThrowingCopyValue {
+    static bool fThrow;
+    uint32_t n{0};
+    ThrowingCopyValue() = default;
+    ThrowingCopyValue(const ThrowingCopyValue& other) : n(other.n) {
+        if (fThrow) throw std::runtime_error("copy failed");
+    }
+    SERIALIZE_METHODS(ThrowingCopyValue, obj) { READWRITE(obj.n); }
+};
+bool ThrowingCopyValue::fThrow = false;
+
+BOOST_AUTO_TEST_CASE(dbtransaction_write_throws)
+{
+    CDBWrapper dbw(GetDataDir() / "dbtransaction_write_throws", (1 << 20), true, false);
+    CDBBatch batch(dbw);
+    CDBTransaction<CDBWrapper, CDBBatch> transaction(dbw, batch);
+
+    ThrowingCopyValue value;
+    value.n = 1;
+    transaction.Write(std::make_pair('t', uint32_t(0)), value);
+    transaction.Erase(std::make_pair('t', uint32_t(1)));
+    const size_t nMemoryUsage = transaction.GetMemoryUsage();
+
+    // a failed write neither adds a key nor replaces or drops the pending write/erase
+    ThrowingCopyValue::fThrow = true;
+    value.n = 2;
+    for (uint32_t n : {0, 1, 2}) {
+        BOOST_CHECK_THROW(transaction.Write(std::make_pair('t', n), value), std::runtime_error);
+    }
+    ThrowingCopyValue::fThrow = false;
+
+    // pending values are read back as the type they were written with
+    ThrowingCopyValue pending;
+    BOOST_CHECK(transaction.Read(std::make_pair('t', uint32_t(0)), pending) && pending.n == 1);
+    BOOST_CHECK(!transaction.Exists(std::make_pair('t', uint32_t(1))));
+    BOOST_CHECK(!transaction.Exists(std::make_pair('t', uint32_t(2))));
+    // the arena keeps the key copied for the failed insert
+    BOOST_CHECK_GE(transaction.GetMemoryUsage(), nMemoryUsage);
+
+    transaction.Commit();
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    uint32_t n;
+    BOOST_CHECK(dbw.Read(std::make_pair('t', uint32_t(0)), n) && n == 1);
+    BOOST_CHECK(!dbw.Exists(std::make_pair('t', uint32_t(2))));
+}
+
 BOOST_AUTO_TEST_CASE(unicodepath)
 {
     // Attempt to create a database with a utf8 character in the path.
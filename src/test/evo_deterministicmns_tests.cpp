@@ -6,6 +6,7 @@
 
 #include <base58.h>
 #include <chainparams.h>
+#include <compat/endian.h>
 #include <consensus/validation.h>
 #include <keystore.h>
 #include <messagesigner.h>
@@ -21,6 +22,7 @@
 #include <evo/specialtx.h>
 #include <evo/providertx.h>
 #include <evo/deterministicmns.h>
+#include <llmq/utils.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -658,4 +660,125 @@ BOOST_FIXTURE_TEST_CASE(dip3_verify_db, TestChainDIP3Setup)
 
 
 
+BOOST_FIXTURE_TEST_CASE(dip3_list_replay_parallel, TestChainDIP3Setup)
+{
+    auto utxos = BuildSimpleUtxoMap(m_coinbase_txns);
+
+    std::vector<uint256> dmnHashes;
+    std::map<uint256, CBLSSecretKey> operatorKeys;
+    for (int i = 0; i < 6; i++) {
+        CKey ownerKey;
+        CBLSSecretKey operatorKey;
+        auto tx = CreateProRegTx(utxos, i + 1, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKey);
+        dmnHashes.emplace_back(tx.GetHash());
+        operatorKeys.emplace(tx.GetHash(), operatorKey);
+        CreateAndProcessBlock({tx}, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    }
+
+    // payments change the list with every block, service updates now and then
+    int DIP0003EnforcementHeightBackup = Params().GetConsensus().DIP0003EnforcementHeight;
+    const_cast<Consensus::Params&>(Params().GetConsensus()).DIP0003EnforcementHeight = ::ChainActive().Height() + 1;
+    for (int i = 0; i < 60; i++) {
+        std::vector<CMutableTransaction> txns;
+        if (i % 10 == 0) {
+            const uint256& proTxHash = dmnHashes[i / 10];
+            txns.emplace_back(CreateProUpServTx(utxos, proTxHash, operatorKeys[proTxHash], 1000 + i, CScript(), coinbaseKey));
+        }
+        CreateAndProcessBlock(txns, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    }
+
+    // managers without any cached lists or diffs replay everything since the last disk snapshot, with enough diffs
+    // (at least 16 blocks past a snapshot) the parallel one deserializes them on its pool
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    for (int i = 0; i < 66; i++, pindex = pindex->pprev) {
+        const auto mnList = deterministicMNManager->GetListForBlock(pindex);
+        const auto mnListSerial = CDeterministicMNManager(*evoDb, 0).GetListForBlock(pindex);
+        const auto mnListParallel = CDeterministicMNManager(*evoDb, 2).GetListForBlock(pindex);
+
+        CDataStream ss(SER_DISK, CLIENT_VERSION), ssSerial(SER_DISK, CLIENT_VERSION), ssParallel(SER_DISK, CLIENT_VERSION);
+        ss << mnList;
+        ssSerial << mnListSerial;
+        ssParallel << mnListParallel;
+        BOOST_CHECK_EQUAL(mnListSerial.GetHeight(), pindex->nHeight);
+        BOOST_CHECK(mnListSerial.GetBlockHash() == pindex->GetBlockHash());
+        BOOST_CHECK(ssSerial.str() == ss.str());
+        BOOST_CHECK(ssParallel.str() == ss.str());
+    }
+
+    const_cast<Consensus::Params&>(Params().GetConsensus()).DIP0003EnforcementHeight = DIP0003EnforcementHeightBackup;
+}
+
+BOOST_FIXTURE_TEST_CASE(dip3_quorum_members_persisted, TestChainDIP3Setup)
+{
+    const auto llmqType = Consensus::LLMQType::LLMQ_TEST;
+    const auto& llmqParams = llmq::GetLLMQParams(llmqType);
+    // same layout as the keys llmq/utils.cpp persists the members under
+    const auto membersKey = [llmqType](const CBlockIndex* pindex) {
+        return std::make_tuple(std::string("q_mem"), llmqType, htobe32(uint32_t(pindex->nHeight)), pindex->GetBlockHash());
+    };
+    const auto proTxHashes = [](const std::vector<CDeterministicMNCPtr>& members) {
+        std::vector<uint256> ret;
+        for (const auto& dmn : members) {
+            ret.emplace_back(dmn->proTxHash);
+        }
+        return ret;
+    };
+    auto& rawDb = evoDb->GetRawDB();
+
+    auto utxos = BuildSimpleUtxoMap(m_coinbase_txns);
+    for (int i = 0; i < 4; i++) {
+        CKey ownerKey;
+        CBLSSecretKey operatorKey;
+        CreateAndProcessBlock({CreateProRegTx(utxos, i + 1, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKey)}, coinbaseKey);
+    }
+    while (WITH_LOCK(cs_main, return ::ChainActive().Height()) % llmqParams.dkgInterval != 0) {
+        CreateAndProcessBlock({}, coinbaseKey);
+    }
+    const CBlockIndex* pQuorumBaseBlockIndex = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    for (int i = 0; i < 5; i++) {
+        CreateAndProcessBlock({}, coinbaseKey);
+    }
+
+    const auto members = llmq::CLLMQUtils::GetAllQuorumMembers(llmqType, pQuorumBaseBlockIndex);
+    BOOST_CHECK_EQUAL(members.size(), size_t(llmqParams.size));
+    std::vector<CDeterministicMNCPtr> stored;
+    BOOST_CHECK(rawDb.Read(membersKey(pQuorumBaseBlockIndex), stored) && proTxHashes(stored) == proTxHashes(members));
+
+    // once the in-memory caches are gone the persisted members are used, whether loaded at startup or read on a miss
+    const std::vector<CDeterministicMNCPtr> persistedMembers{members[0]};
+    rawDb.Write(membersKey(pQuorumBaseBlockIndex), persistedMembers);
+    llmq::CLLMQUtils::ClearQuorumMembersCache();
+    llmq::CLLMQUtils::LoadQuorumMembersCache();
+    BOOST_CHECK(proTxHashes(llmq::CLLMQUtils::GetAllQuorumMembers(llmqType, pQuorumBaseBlockIndex)) == proTxHashes(persistedMembers));
+    llmq::CLLMQUtils::ClearQuorumMembersCache();
+    BOOST_CHECK(proTxHashes(llmq::CLLMQUtils::GetAllQuorumMembers(llmqType, pQuorumBaseBlockIndex)) == proTxHashes(persistedMembers));
+
+    // reset_cache recomputes the members and overwrites the persisted ones
+    BOOST_CHECK(proTxHashes(llmq::CLLMQUtils::GetAllQuorumMembers(llmqType, pQuorumBaseBlockIndex, true)) == proTxHashes(members));
+    BOOST_CHECK(rawDb.Read(membersKey(pQuorumBaseBlockIndex), stored) && proTxHashes(stored) == proTxHashes(members));
+    llmq::CLLMQUtils::ClearQuorumMembersCache();
+    BOOST_CHECK(proTxHashes(llmq::CLLMQUtils::GetAllQuorumMembers(llmqType, pQuorumBaseBlockIndex)) == proTxHashes(members));
+
+    // members of quorums which are too old for the caches or were reorged out are erased at load
+    CBlockIndex* pindexReorged = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    const CBlockIndex* pindexOld = pindexReorged->GetAncestor(pindexReorged->nHeight - llmqParams.dkgInterval * (llmqParams.keepOldConnections + 1) - 1);
+    rawDb.Write(membersKey(pindexOld), members);
+    rawDb.Write(membersKey(pindexReorged), members);
+
+    CValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, Params(), pindexReorged));
+    for (int i = 0; i < 2; i++) {
+        CreateAndProcessBlock({}, GenerateRandomAddress());
+    }
+    BOOST_CHECK(!WITH_LOCK(cs_main, return ::ChainActive().Contains(pindexReorged)));
+
+    llmq::CLLMQUtils::ClearQuorumMembersCache();
+    llmq::CLLMQUtils::LoadQuorumMembersCache();
+    BOOST_CHECK(!rawDb.Exists(membersKey(pindexOld)));
+    BOOST_CHECK(!rawDb.Exists(membersKey(pindexReorged)));
+    BOOST_CHECK(rawDb.Read(membersKey(pQuorumBaseBlockIndex), stored) && proTxHashes(stored) == proTxHashes(members));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,9 +4,13 @@
 
 #include <test/util/setup_common.h>
 
+#include <arith_uint256.h>
 #include <bls/bls.h>
+#include <consensus/merkle.h>
+#include <evo/deterministicmns.h>
 #include <evo/simplifiedmns.h>
 #include <netbase.h>
+#include <random.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -67,4 +71,150 @@ BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
 
     BOOST_CHECK(expectedMerkleRoot == calculatedMerkleRoot);
 }
+
+static CDeterministicMNCPtr MakeDeterministicMN(uint64_t internalId)
+{
+    auto dmn = std::make_shared<CDeterministicMN>(internalId);
+    dmn->proTxHash = InsecureRand256();
+    dmn->collateralOutpoint = COutPoint(InsecureRand256(), 0);
+    auto state = std::make_shared<CDeterministicMNState>();
+    uint160 keyID;
+    GetRandBytes(keyID.begin(), keyID.size());
+    state->keyIDOwner = CKeyID(keyID);
+    state->keyIDVoting = state->keyIDOwner;
+    dmn->pdmnState = state;
+    return dmn;
+}
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkletree)
+{
+    CDeterministicMNList mnList(uint256(), 0, 0);
+    uint64_t nextInternalId = 0;
+    for (size_t i = 0; i < 40; i++) {
+        mnList.AddMN(MakeDeterministicMN(nextInternalId++));
+    }
+
+    CSimplifiedMNListMerkleTree tree(mnList);
+    BOOST_CHECK_EQUAL(tree.size(), 40U);
+    BOOST_CHECK(tree.GetMerkleRoot() == CSimplifiedMNList(mnList).CalcMerkleRoot());
+
+    // random blocks adding, removing and updating masternodes, the later ones mostly removing
+    for (int nBlock = 0; nBlock < 200; nBlock++) {
+        CDeterministicMNList newList = mnList;
+        const int nChanges = InsecureRandRange(5);
+        for (int i = 0; i < nChanges; i++) {
+            const uint32_t nAction = InsecureRandRange(nBlock < 150 ? 4 : 8);
+            std::vector<CDeterministicMNCPtr> vecMNs;
+            newList.ForEachMNShared(false, [&vecMNs](const CDeterministicMNCPtr& dmn) { vecMNs.emplace_back(dmn); });
+            if (nAction == 0 || vecMNs.empty()) {
+                newList.AddMN(MakeDeterministicMN(nextInternalId++));
+                continue;
+            }
+            const auto& dmn = vecMNs[InsecureRandRange(vecMNs.size())];
+            auto newState = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
+            if (nAction == 1) {
+                newState->confirmedHash = InsecureRand256();
+            } else if (nAction == 2) {
+                // doesn't change the simplified entry
+                newState->nPoSePenalty++;
+            } else if (nAction == 3) {
+                newState->BanIfNotBanned(nBlock);
+            } else {
+                newList.RemoveMN(dmn->proTxHash);
+                continue;
+            }
+            newList.UpdateMN(*dmn, newState);
+        }
+
+        const uint256 rootBefore = tree.GetMerkleRoot();
+        tree.ApplyDiff(mnList, newList);
+        BOOST_CHECK_EQUAL(tree.size(), newList.GetAllMNsCount());
+        bool mutated = true;
+        BOOST_CHECK(tree.GetMerkleRoot(&mutated) == CSimplifiedMNList(newList).CalcMerkleRoot());
+        BOOST_CHECK(!mutated);
+
+        // reverting the block restores the previous tree, both with the reverse diff and with the block's diff
+        tree.ApplyDiff(newList, mnList);
+        BOOST_CHECK(tree.GetMerkleRoot() == rootBefore);
+        const CDeterministicMNListDiff diff = mnList.BuildDiff(newList);
+        tree.ApplyDiff(mnList, newList, diff);
+        tree.RevertDiff(mnList, diff);
+        BOOST_CHECK(tree.GetMerkleRoot() == rootBefore);
+        tree.ApplyDiff(mnList, newList, diff);
+
+        mnList = newList;
+    }
+    BOOST_CHECK(tree.GetMerkleRoot() == CSimplifiedMNListMerkleTree(mnList).GetMerkleRoot());
+
+    CDeterministicMNList emptyList = mnList;
+    mnList.ForEachMN(false, [&emptyList](auto& dmn) { emptyList.RemoveMN(dmn.proTxHash); });
+    tree.ApplyDiff(mnList, emptyList);
+    BOOST_CHECK_EQUAL(tree.size(), 0U);
+    BOOST_CHECK(tree.GetMerkleRoot().IsNull());
+}
+
+static void CheckMutatedTree(const CSimplifiedMNListMerkleTree& tree, const std::vector<std::pair<uint256, uint256>>& entries, bool fExpectMutated)
+{
+    std::vector<uint256> leaves;
+    for (const auto& p : entries) {
+        leaves.emplace_back(p.second);
+    }
+    bool mutated = !fExpectMutated;
+    bool mutatedExpected = !fExpectMutated;
+    BOOST_CHECK(tree.GetMerkleRoot(&mutated) == ComputeMerkleRoot(leaves, &mutatedExpected));
+    BOOST_CHECK_EQUAL(mutatedExpected, fExpectMutated);
+    BOOST_CHECK_EQUAL(mutated, fExpectMutated);
+}
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkletree_mutated)
+{
+    // proTxHashes 2, 4, 6, ... leave room for inserting masternodes in between
+    const auto proTxHash = [](uint64_t n) { return ArithToUint256(arith_uint256(n)); };
+    const uint256 a = InsecureRand256(), b = InsecureRand256(), c = InsecureRand256(), x = InsecureRand256();
+
+    // the last leaf of an odd sized level is hashed with itself, that is no mutation
+    std::vector<std::pair<uint256, uint256>> entries{{proTxHash(2), a}, {proTxHash(4), b}, {proTxHash(6), c}};
+    CheckMutatedTree(CSimplifiedMNListMerkleTree(entries), entries, false);
+
+    // duplicate adjacent leaves forming a pair
+    entries = {{proTxHash(2), x}, {proTxHash(4), x}, {proTxHash(6), a}, {proTxHash(8), b}, {proTxHash(10), c}};
+    CSimplifiedMNListMerkleTree tree(entries);
+    CheckMutatedTree(tree, entries, true);
+
+    // updating one of them resolves the mutation
+    entries[1].second = b;
+    tree.ApplyChanges({}, {}, {entries[1]});
+    CheckMutatedTree(tree, entries, false);
+    entries[1].second = x;
+    tree.ApplyChanges({}, {}, {entries[1]});
+    CheckMutatedTree(tree, entries, true);
+
+    // inserting a leaf in front shifts the duplicates into different pairs, removing it aligns them again
+    entries.insert(entries.begin(), {proTxHash(1), c});
+    tree.ApplyChanges({}, {entries[0]}, {});
+    CheckMutatedTree(tree, entries, false);
+    entries.erase(entries.begin());
+    tree.ApplyChanges({proTxHash(1)}, {}, {});
+    CheckMutatedTree(tree, entries, true);
+    entries.erase(entries.begin());
+    tree.ApplyChanges({proTxHash(2)}, {}, {});
+    CheckMutatedTree(tree, entries, false);
+
+    // duplicate inner nodes: A B A B hashes to two identical parents
+    entries = {{proTxHash(2), a}, {proTxHash(4), b}, {proTxHash(6), a}, {proTxHash(8), b}, {proTxHash(10), c}};
+    tree = CSimplifiedMNListMerkleTree(entries);
+    CheckMutatedTree(tree, entries, true);
+    entries.emplace_back(proTxHash(12), x);
+    tree.ApplyChanges({}, {entries.back()}, {});
+    CheckMutatedTree(tree, entries, true);
+    entries[2].second = c;
+    tree.ApplyChanges({}, {}, {entries[2]});
+    CheckMutatedTree(tree, entries, false);
+    entries[2].second = a;
+    tree.ApplyChanges({}, {}, {entries[2]});
+    CheckMutatedTree(tree, entries, true);
+    entries.erase(entries.begin());
+    tree.ApplyChanges({proTxHash(2)}, {}, {});
+    CheckMutatedTree(tree, entries, false);
+}
 BOOST_AUTO_TEST_SUITE_END()
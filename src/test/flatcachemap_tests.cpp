@@ -0,0 +1,264 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cachemap.h>
+#include <cachemultimap.h>
+#include <flatcachemap.h>
+#include <streams.h>
+#include <version.h>
+
+#include <test/util/setup_common.h>
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using FlatMapInt = FlatCacheMap<int, int, std::hash<int>>;
+using FlatMultiMapInt = FlatCacheMultiMap<int, int, std::hash<int>>;
+
+BOOST_FIXTURE_TEST_SUITE(flatcachemap_tests, BasicTestingSetup)
+
+template<typename Map1, typename Map2>
+static bool SameItems(const Map1& map1, const Map2& map2)
+{
+    if (map1.GetMaxSize() != map2.GetMaxSize() || map1.GetSize() != map2.GetSize()) {
+        return false;
+    }
+    auto it2 = map2.begin();
+    for (auto it1 = map1.begin(); it1 != map1.end(); ++it1, ++it2) {
+        if (it2 == map2.end() || it1->key != it2->key || it1->value != it2->value) {
+            return false;
+        }
+    }
+    return it2 == map2.end();
+}
+
+/** Compares with a CacheMap or CacheMultiMap */
+template<typename FlatMap, typename OldMap>
+static bool SameItemsAsOld(const FlatMap& map1, const OldMap& map2)
+{
+    if (map1.GetMaxSize() != map2.GetMaxSize() || map1.GetSize() != map2.GetSize()) {
+        return false;
+    }
+    auto it2 = map2.GetItemList().begin();
+    for (auto it1 = map1.begin(); it1 != map1.end(); ++it1, ++it2) {
+        if (it1->key != it2->key || it1->value != it2->value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(flatcachemap_test)
+{
+    FlatMapInt cmapTest1(10);
+    BOOST_CHECK(cmapTest1.GetMaxSize() == 10);
+    BOOST_CHECK(cmapTest1.GetSize() == 0);
+
+    BOOST_CHECK(cmapTest1.Insert(-1, -1));
+    BOOST_CHECK(cmapTest1.GetSize() == 1);
+    BOOST_CHECK(cmapTest1.HasKey(-1));
+
+    // insert must not update an already existing key
+    BOOST_CHECK(!cmapTest1.Insert(-1, -2));
+    int nValRet = 0;
+    BOOST_CHECK(cmapTest1.Get(-1, nValRet));
+    BOOST_CHECK(nValRet == -1);
+    BOOST_CHECK(cmapTest1.GetSize() == 1);
+
+    for (int i = 0; i < 10; ++i) {
+        cmapTest1.Insert(i, i);
+    }
+    BOOST_CHECK(cmapTest1.GetSize() == 10);
+    for (int i = 0; i < 10; ++i) {
+        int nVal = 0;
+        BOOST_CHECK(cmapTest1.Get(i, nVal));
+        BOOST_CHECK(nVal == i);
+    }
+    // the oldest item was evicted
+    BOOST_CHECK(!cmapTest1.HasKey(-1));
+
+    cmapTest1.Erase(5);
+    BOOST_CHECK(cmapTest1.GetSize() == 9);
+    BOOST_CHECK(!cmapTest1.HasKey(5));
+    for (int i : {0, 1, 2, 3, 4, 6, 7, 8, 9}) {
+        int nVal = 0;
+        BOOST_CHECK(cmapTest1.Get(i, nVal));
+        BOOST_CHECK(nVal == i);
+    }
+
+    // items are iterated from the most recent one
+    std::vector<int> vecKeys;
+    for (const auto& item : cmapTest1) {
+        vecKeys.push_back(item.key);
+    }
+    BOOST_CHECK(vecKeys == std::vector<int>({9, 8, 7, 6, 4, 3, 2, 1, 0}));
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << cmapTest1;
+    FlatMapInt mapTest2;
+    ss >> mapTest2;
+    BOOST_CHECK(SameItems(cmapTest1, mapTest2));
+
+    FlatMapInt mapTest3(cmapTest1);
+    BOOST_CHECK(SameItems(cmapTest1, mapTest3));
+
+    FlatMapInt mapTest4;
+    mapTest4 = cmapTest1;
+    BOOST_CHECK(SameItems(cmapTest1, mapTest4));
+}
+
+BOOST_AUTO_TEST_CASE(flatcachemap_erase_while_iterating)
+{
+    FlatMapInt cmap(100);
+    for (int i = 0; i < 100; ++i) {
+        cmap.Insert(i, i % 3);
+    }
+    auto it = cmap.begin();
+    while (it != cmap.end()) {
+        const int nKey = it->key;
+        const int nValue = it->value;
+        ++it;
+        if (nValue == 0) {
+            cmap.Erase(nKey);
+        }
+    }
+    BOOST_CHECK_EQUAL(cmap.GetSize(), 66U);
+    for (int i = 0; i < 100; ++i) {
+        BOOST_CHECK_EQUAL(cmap.HasKey(i), i % 3 != 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(flatcachemultimap_test)
+{
+    FlatMultiMapInt cmmapTest1(10);
+    cmmapTest1.Insert(-1, -1);
+    for (int i = 0; i < 10; ++i) {
+        cmmapTest1.Insert(i, i);
+    }
+    BOOST_CHECK(cmmapTest1.GetSize() == 10);
+    BOOST_CHECK(!cmmapTest1.HasKey(-1));
+
+    cmmapTest1.Erase(5);
+    BOOST_CHECK(cmmapTest1.GetSize() == 9);
+
+    // add multiple items for the same key, evicting the two oldest keys
+    BOOST_CHECK(cmmapTest1.Insert(5, 2));
+    BOOST_CHECK(cmmapTest1.Insert(5, 1));
+    BOOST_CHECK(cmmapTest1.Insert(5, 4));
+    BOOST_CHECK(!cmmapTest1.Insert(5, 1));
+    BOOST_CHECK(cmmapTest1.GetSize() == 10);
+    BOOST_CHECK(!cmmapTest1.HasKey(0));
+    BOOST_CHECK(!cmmapTest1.HasKey(1));
+    BOOST_CHECK(cmmapTest1.HasKey(2));
+
+    // values are returned in ascending order, and Get returns the smallest one
+    std::vector<int> vecVals;
+    BOOST_CHECK(cmmapTest1.GetAll(5, vecVals));
+    BOOST_CHECK(vecVals == std::vector<int>({1, 2, 4}));
+    int nVal = 0;
+    BOOST_CHECK(cmmapTest1.Get(5, nVal));
+    BOOST_CHECK(nVal == 1);
+
+    cmmapTest1.Erase(5, 2);
+    vecVals.clear();
+    BOOST_CHECK(cmmapTest1.GetAll(5, vecVals));
+    BOOST_CHECK(vecVals == std::vector<int>({1, 4}));
+    cmmapTest1.Erase(5, 1);
+    cmmapTest1.Erase(5, 4);
+    BOOST_CHECK(!cmmapTest1.HasKey(5));
+    BOOST_CHECK(cmmapTest1.GetSize() == 7);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << cmmapTest1;
+    FlatMultiMapInt cmmapTest2;
+    ss >> cmmapTest2;
+    BOOST_CHECK(SameItems(cmmapTest1, cmmapTest2));
+}
+
+BOOST_AUTO_TEST_CASE(flatcachemap_serialization_compatible)
+{
+    // governance.dat written with the old containers must load, and the other way around
+    CacheMap<int, int> cmapOld(50);
+    CacheMultiMap<int, int> cmmapOld(50);
+    for (int i = 0; i < 80; ++i) {
+        cmapOld.Insert(i, i * 7);
+        cmmapOld.Insert(i % 13, i);
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << cmapOld << cmmapOld;
+    FlatMapInt cmapNew;
+    FlatMultiMapInt cmmapNew;
+    ss >> cmapNew >> cmmapNew;
+    BOOST_CHECK(SameItemsAsOld(cmapNew, cmapOld));
+    BOOST_CHECK(SameItemsAsOld(cmmapNew, cmmapOld));
+
+    CDataStream ssNew(SER_DISK, CLIENT_VERSION);
+    ssNew << cmapNew << cmmapNew;
+    CDataStream ssOld(SER_DISK, CLIENT_VERSION);
+    ssOld << cmapOld << cmmapOld;
+    BOOST_CHECK(ssNew.str() == ssOld.str());
+}
+
+BOOST_AUTO_TEST_CASE(flatcachemultimap_matches_model)
+{
+    // Random operations on a small key space exercise eviction, the per key chains and the
+    // backward shift deletion. The model is a plain list of items, most recent first.
+    const size_t nMaxSize = 64;
+    std::list<std::pair<int, int>> listModel;
+    FlatMultiMapInt cmmap(nMaxSize);
+    for (int i = 0; i < 20000; ++i) {
+        const int nKey = InsecureRandRange(40);
+        const int nValue = InsecureRandRange(8);
+        const auto item = std::make_pair(nKey, nValue);
+        switch (InsecureRandRange(4)) {
+        case 0:
+        case 1: {
+            const bool fNew = std::find(listModel.begin(), listModel.end(), item) == listModel.end();
+            if (fNew) {
+                if (listModel.size() == nMaxSize) {
+                    listModel.pop_back();
+                }
+                listModel.push_front(item);
+            }
+            BOOST_CHECK_EQUAL(cmmap.Insert(nKey, nValue), fNew);
+            break;
+        }
+        case 2:
+            listModel.remove(item);
+            cmmap.Erase(nKey, nValue);
+            break;
+        case 3:
+            listModel.remove_if([nKey](const std::pair<int, int>& p) { return p.first == nKey; });
+            cmmap.Erase(nKey);
+            break;
+        }
+
+        std::vector<int> vecModel;
+        for (const auto& p : listModel) {
+            if (p.first == nKey) {
+                vecModel.push_back(p.second);
+            }
+        }
+        std::sort(vecModel.begin(), vecModel.end());
+        std::vector<int> vecValues;
+        BOOST_CHECK_EQUAL(cmmap.HasKey(nKey), !vecModel.empty());
+        BOOST_CHECK_EQUAL(cmmap.GetAll(nKey, vecValues), !vecModel.empty());
+        BOOST_CHECK(vecValues == vecModel);
+    }
+
+    BOOST_CHECK_EQUAL(cmmap.GetSize(), listModel.size());
+    auto it = listModel.begin();
+    for (const auto& item : cmmap) {
+        BOOST_CHECK(item.key == it->first && item.value == it->second);
+        ++it;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
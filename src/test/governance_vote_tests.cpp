@@ -0,0 +1,57 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bls/bls.h>
+#include <governance/governance.h>
+#include <governance/vote.h>
+
+#include <test/util/setup_common.h>
+
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_vote_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(verify_vote_signatures_batched)
+{
+    const uint256 nParentHash = InsecureRand256();
+    std::vector<CGovernanceVote> votes;
+    std::vector<CBLSPublicKey> pubKeys;
+    for (int i = 0; i < 100; ++i) {
+        CBLSSecretKey secKey;
+        secKey.MakeNewKey();
+        CGovernanceVote vote(COutPoint(InsecureRand256(), 0), nParentHash, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_YES);
+        vote.SetTime(1000 + i);
+        BOOST_CHECK(vote.Sign(secKey));
+        votes.push_back(vote);
+        pubKeys.push_back(secKey.GetPublicKey());
+    }
+
+    // every vote comes from one of four peers
+    auto MakeChecks = [&]() {
+        std::vector<CGovernanceManager::vote_sig_check_t> vecChecks;
+        for (size_t i = 0; i < votes.size(); ++i) {
+            vecChecks.push_back({NodeId(i % 4), &votes[i], pubKeys[i]});
+        }
+        return vecChecks;
+    };
+
+    std::set<NodeId> setBadSources;
+    BOOST_CHECK(CGovernanceManager::VerifyVoteSignatures(MakeChecks(), setBadSources).empty());
+    BOOST_CHECK(setBadSources.empty());
+
+    // a vote signed with another key and one with a malformed signature
+    CBLSSecretKey otherKey;
+    otherKey.MakeNewKey();
+    BOOST_CHECK(votes[41].Sign(otherKey));
+    votes[70].SetSignature(std::vector<unsigned char>(3, 0));
+
+    const std::set<uint256> setBadVotes = CGovernanceManager::VerifyVoteSignatures(MakeChecks(), setBadSources);
+    BOOST_CHECK(setBadVotes == std::set<uint256>({votes[41].GetHash(), votes[70].GetHash()}));
+    BOOST_CHECK(setBadSources == std::set<NodeId>({1, 2}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <governance/governancedb.h>
+
+#include <test/util/setup_common.h>
+
+#include <map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governancedb_tests, BasicTestingSetup)
+
+static CGovernanceVote MakeVote(const COutPoint& outpoint, const uint256& nParentHash, vote_signal_enum_t eSignal, int64_t nTime)
+{
+    CGovernanceVote vote(outpoint, nParentHash, eSignal, VOTE_OUTCOME_YES);
+    vote.SetTime(nTime);
+    return vote;
+}
+
+static vote_rec_t MakeRecord(const std::vector<CGovernanceVote>& vecVotes)
+{
+    vote_rec_t voteRecord;
+    for (const auto& vote : vecVotes) {
+        voteRecord.mapInstances[int(vote.GetSignal())] = vote_instance_t(vote.GetOutcome(), vote.GetTimestamp(), vote.GetTimestamp());
+    }
+    return voteRecord;
+}
+
+BOOST_AUTO_TEST_CASE(governancedb_objects)
+{
+    CGovernanceDb db(true, true);
+
+    CGovernanceObject obj1(uint256(), 1, 1000, InsecureRand256(), "");
+    CGovernanceObject obj2(uint256(), 1, 2000, InsecureRand256(), "");
+    obj2.PrepareDeletion(3000);
+    obj2.SetExpired();
+    db.WriteObjects({&obj1, &obj2});
+
+    std::map<uint256, CGovernanceObject> mapObjects;
+    db.LoadObjects(mapObjects);
+    BOOST_CHECK_EQUAL(mapObjects.size(), 2U);
+    BOOST_CHECK(mapObjects.count(obj1.GetHash()));
+    const CGovernanceObject& loaded = mapObjects.at(obj2.GetHash());
+    BOOST_CHECK_EQUAL(loaded.GetCreationTime(), 2000);
+    BOOST_CHECK_EQUAL(loaded.GetCollateralHash(), obj2.GetCollateralHash());
+    BOOST_CHECK_EQUAL(loaded.GetDeletionTime(), 3000);
+    BOOST_CHECK(loaded.IsSetCachedDelete());
+    BOOST_CHECK(loaded.IsSetExpired());
+    BOOST_CHECK(!loaded.IsSetDirtyDb());
+
+    BOOST_CHECK(db.EraseObject(obj1.GetHash()));
+    mapObjects.clear();
+    db.LoadObjects(mapObjects);
+    BOOST_CHECK_EQUAL(mapObjects.size(), 1U);
+    BOOST_CHECK(mapObjects.count(obj2.GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(governancedb_votes)
+{
+    CGovernanceDb db(true, true);
+
+    const uint256 nObj1 = InsecureRand256();
+    const uint256 nObj2 = InsecureRand256();
+    const COutPoint mn1(InsecureRand256(), 0);
+    const COutPoint mn2(InsecureRand256(), 1);
+
+    const std::vector<CGovernanceVote> vecVotes11{MakeVote(mn1, nObj1, VOTE_SIGNAL_FUNDING, 100), MakeVote(mn1, nObj1, VOTE_SIGNAL_DELETE, 101)};
+    const std::vector<CGovernanceVote> vecVotes12{MakeVote(mn2, nObj1, VOTE_SIGNAL_FUNDING, 102)};
+    const std::vector<CGovernanceVote> vecVotes21{MakeVote(mn1, nObj2, VOTE_SIGNAL_FUNDING, 103)};
+    db.WriteMasternodeVotes(nObj1, mn1, MakeRecord(vecVotes11), vecVotes11);
+    db.WriteMasternodeVotes(nObj1, mn2, MakeRecord(vecVotes12), vecVotes12);
+    db.WriteMasternodeVotes(nObj2, mn1, MakeRecord(vecVotes21), vecVotes21);
+
+    CGovernanceObject::vote_m_t mapRecords;
+    std::vector<CGovernanceVote> vecVotes;
+    db.ReadObjectVotes(nObj1, mapRecords, vecVotes);
+    BOOST_CHECK_EQUAL(mapRecords.size(), 2U);
+    BOOST_CHECK_EQUAL(mapRecords[mn1].mapInstances.size(), 2U);
+    BOOST_CHECK_EQUAL(vecVotes.size(), 3U);
+    BOOST_CHECK(db.HasMasternodeVotes(nObj1, mn2));
+    BOOST_CHECK(!db.HasMasternodeVotes(nObj2, mn2));
+
+    uint256 nObjectHash;
+    BOOST_CHECK(db.GetVoteObjectHash(vecVotes11[1].GetHash(), nObjectHash));
+    BOOST_CHECK_EQUAL(nObjectHash, nObj1);
+    BOOST_CHECK(db.GetVoteObjectHash(vecVotes21[0].GetHash(), nObjectHash));
+    BOOST_CHECK_EQUAL(nObjectHash, nObj2);
+
+    // a newer vote replaces the older one of the same signal, the older one must not be found anymore
+    const std::vector<CGovernanceVote> vecVotes11New{MakeVote(mn1, nObj1, VOTE_SIGNAL_FUNDING, 200), vecVotes11[1]};
+    db.WriteMasternodeVotes(nObj1, mn1, MakeRecord(vecVotes11New), vecVotes11New);
+    BOOST_CHECK(!db.GetVoteObjectHash(vecVotes11[0].GetHash(), nObjectHash));
+    BOOST_CHECK(db.GetVoteObjectHash(vecVotes11New[0].GetHash(), nObjectHash));
+    BOOST_CHECK(db.GetVoteObjectHash(vecVotes11[1].GetHash(), nObjectHash));
+
+    // an empty record erases the votes of the masternode
+    db.WriteMasternodeVotes(nObj1, mn2, vote_rec_t(), {});
+    BOOST_CHECK(!db.HasMasternodeVotes(nObj1, mn2));
+    BOOST_CHECK(!db.GetVoteObjectHash(vecVotes12[0].GetHash(), nObjectHash));
+
+    // erasing an object erases all of its votes and nothing else
+    BOOST_CHECK(db.EraseObject(nObj1));
+    mapRecords.clear();
+    vecVotes.clear();
+    db.ReadObjectVotes(nObj1, mapRecords, vecVotes);
+    BOOST_CHECK(mapRecords.empty() && vecVotes.empty());
+    BOOST_CHECK(!db.GetVoteObjectHash(vecVotes11New[0].GetHash(), nObjectHash));
+    mapRecords.clear();
+    vecVotes.clear();
+    db.ReadObjectVotes(nObj2, mapRecords, vecVotes);
+    BOOST_CHECK_EQUAL(mapRecords.size(), 1U);
+    BOOST_CHECK_EQUAL(vecVotes.size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,7 +4,9 @@
 
 #include <addrdb.h>
 #include <addrman.h>
+#include <bloom.h>
 #include <clientversion.h>
+#include <test/util/net.h>
 #include <test/util/setup_common.h>
 #include <string>
 #include <boost/test/unit_test.hpp>
@@ -712,5 +714,68 @@ BOOST_AUTO_TEST_CASE(LocalAddress_BasicLifecycle)
     BOOST_CHECK_EQUAL(IsLocal(addr), false);
 }
 
+static std::vector<uint256> InvHashes(const std::vector<CInv>& vInv)
+{
+    std::vector<uint256> vHashes;
+    for (const CInv& inv : vInv) {
+        vHashes.push_back(inv.hash);
+    }
+    return vHashes;
+}
+
+BOOST_AUTO_TEST_CASE(relay_queue_batches_filtered_invs)
+{
+    CConnmanTest connman(0x1337, 0x1337);
+    CAddress addr(CService(UtilBuildAddress(0x002, 0x001, 0x001, 0x001), 1000), NODE_NONE);
+    // Owned and deleted by connman
+    CNode& nodeFiltered = *new CNode(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", false);
+    CNode& nodePlain = *new CNode(1, NODE_NETWORK, 0, INVALID_SOCKET, addr, 1, 1, CAddress(), "", false);
+    CNode& nodeOld = *new CNode(2, NODE_NETWORK, 0, INVALID_SOCKET, addr, 2, 2, CAddress(), "", false);
+    nodeFiltered.nVersion = PROTOCOL_VERSION + 1;
+    nodePlain.nVersion = PROTOCOL_VERSION + 1;
+    nodeOld.nVersion = PROTOCOL_VERSION;
+
+    const uint256 txidMatching = InsecureRand256();
+    const uint256 txidOther = InsecureRand256();
+    {
+        LOCK(nodeFiltered.cs_filter);
+        nodeFiltered.pfilter = MakeUnique<CBloomFilter>(10, 0.000001, 0, BLOOM_UPDATE_ALL);
+        nodeFiltered.pfilter->insert(txidMatching);
+    }
+    connman.AddNode(nodeFiltered);
+    connman.AddNode(nodePlain);
+    connman.AddNode(nodeOld);
+
+    CInv invAll(MSG_SPORK, InsecureRand256());
+    CInv invMatching(MSG_ISLOCK, InsecureRand256());
+    CInv invOther(MSG_ISLOCK, InsecureRand256());
+    CInv invNew(MSG_ISDLOCK, InsecureRand256());
+    connman.RelayInv(invAll);
+    connman.RelayInvFiltered(invMatching, txidMatching);
+    connman.RelayInvFiltered(invOther, txidOther);
+    connman.RelayInvFiltered(invNew, txidMatching, PROTOCOL_VERSION + 1);
+
+    // Nothing is pushed to the peers before the queue is flushed
+    {
+        LOCK(nodePlain.cs_inventory);
+        BOOST_CHECK(nodePlain.vInventoryOtherToSend.empty());
+    }
+
+    connman.FlushRelayQueue();
+    {
+        LOCK(nodeFiltered.cs_inventory);
+        BOOST_CHECK(InvHashes(nodeFiltered.vInventoryOtherToSend) == InvHashes({invAll, invMatching, invNew}));
+    }
+    {
+        LOCK(nodePlain.cs_inventory);
+        BOOST_CHECK(InvHashes(nodePlain.vInventoryOtherToSend) == InvHashes({invAll, invMatching, invOther, invNew}));
+    }
+    {
+        LOCK(nodeOld.cs_inventory);
+        BOOST_CHECK(InvHashes(nodeOld.vInventoryOtherToSend) == InvHashes({invAll, invMatching, invOther}));
+    }
+
+    connman.ClearNodes();
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <ctpl_stl.h>
+#include <pos_kernel.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pos_kernel_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(stake_hash_batch)
+{
+    // 77 timestamps cover full multi-buffer batches plus a scalar tail
+    const size_t count = 77;
+    const unsigned int nTimeTxStart = 1600000000;
+    const unsigned int nTimeBlockFrom = 1500000000;
+    const uint256 prevoutHash = InsecureRand256();
+    const unsigned int prevoutIndex = InsecureRand32();
+
+    std::vector<uint32_t> vStakeModifier(count);
+    for (auto& modifier : vStakeModifier) {
+        modifier = InsecureRand32();
+    }
+
+    std::vector<uint256> vHash(count);
+    stakeHashBatch(nTimeTxStart, count, vStakeModifier.data(), prevoutIndex, prevoutHash, nTimeBlockFrom, vHash.data());
+
+    for (size_t i = 0; i < count; ++i) {
+        CDataStream ss(SER_GETHASH, 0);
+        ss << vStakeModifier[i];
+        BOOST_CHECK(vHash[i] == stakeHash(nTimeTxStart + i, ss, prevoutIndex, prevoutHash, nTimeBlockFrom));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(search_stake_kernel)
+{
+    StakeKernelCandidate candidate;
+    candidate.prevout = COutPoint(InsecureRand256(), 1);
+    candidate.nValueIn = 1000 * COIN;
+    candidate.nTimeBlockFrom = 1500000000;
+    candidate.nStakeModifier = InsecureRand32();
+
+    StakeKernelWindow window;
+    window.nTimeStart = 1600000000;
+    window.nTimeEnd = window.nTimeStart + 100;
+
+    unsigned int nTimeTx = 0;
+    uint32_t nStakeModifier = 0;
+    uint256 hashProofOfStake;
+    uint64_t nHashes = 0;
+
+    // Unreachable target: the whole window is hashed without a hit
+    window.nBits = 0x01010000;
+    BOOST_CHECK(!SearchStakeKernel(window, candidate, nTimeTx, nStakeModifier, hashProofOfStake, nHashes));
+    BOOST_CHECK_EQUAL(nHashes, 100U);
+
+    // Below one coin the target falls back to ~0 and any hash meets it: the
+    // earliest timestamp wins
+    candidate.nValueIn = 1;
+    BOOST_CHECK(SearchStakeKernel(window, candidate, nTimeTx, nStakeModifier, hashProofOfStake, nHashes));
+    BOOST_CHECK_EQUAL(nTimeTx, window.nTimeStart);
+    BOOST_CHECK_EQUAL(nStakeModifier, candidate.nStakeModifier);
+
+    // An input whose earliest kernel is not after the median time past is skipped,
+    // later timestamps of the same input are not tried
+    window.nTimePastLimit = window.nTimeStart + 70;
+    nTimeTx = 0;
+    BOOST_CHECK(!SearchStakeKernel(window, candidate, nTimeTx, nStakeModifier, hashProofOfStake, nHashes));
+    BOOST_CHECK_EQUAL(nTimeTx, 0U);
+    window.nTimePastLimit = window.nTimeStart - 1;
+    BOOST_CHECK(SearchStakeKernel(window, candidate, nTimeTx, nStakeModifier, hashProofOfStake, nHashes));
+    BOOST_CHECK_EQUAL(nTimeTx, window.nTimeStart);
+
+    CDataStream ss(SER_GETHASH, 0);
+    ss << nStakeModifier;
+    BOOST_CHECK(hashProofOfStake == stakeHash(nTimeTx, ss, candidate.prevout.n, candidate.prevout.hash, candidate.nTimeBlockFrom));
+}
+
+BOOST_AUTO_TEST_CASE(search_stake_kernels_winner)
+{
+    StakeKernelWindow window;
+    window.nBits = 0x01010000;
+    window.nTimeStart = 1600000000;
+    window.nTimeEnd = window.nTimeStart + 50;
+
+    // Most inputs can't reach the target, a few below one coin hit at once
+    std::vector<StakeKernelCandidate> candidates(200);
+    size_t nExpected = candidates.size();
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i].prevout = COutPoint(InsecureRand256(), i);
+        candidates[i].nTimeBlockFrom = 1500000000;
+        candidates[i].nStakeModifier = InsecureRand32();
+        candidates[i].nValueIn = (i >= 120 && i % 23 == 0) ? 1 : 1000 * COIN;
+        if (candidates[i].nValueIn == 1 && nExpected == candidates.size()) {
+            nExpected = i;
+        }
+    }
+
+    // The winner is the earliest input with a kernel, however many threads search
+    StakeKernelSearch sequential;
+    SearchStakeKernels(window, candidates, 1, sequential);
+    BOOST_CHECK_EQUAL(sequential.nFound, nExpected);
+    BOOST_CHECK_EQUAL(sequential.nTimeTx, window.nTimeStart);
+
+    ctpl::thread_pool pool(3);
+    for (int round = 0; round < 10; ++round) {
+        StakeKernelSearch parallel;
+        SearchStakeKernels(window, candidates, pool.size() + 1, parallel, &pool);
+        BOOST_CHECK_EQUAL(parallel.nFound, sequential.nFound);
+        BOOST_CHECK_EQUAL(parallel.nTimeTx, sequential.nTimeTx);
+        BOOST_CHECK(parallel.hashProofOfStake == sequential.hashProofOfStake);
+    }
+
+    // All kernels are at the start of the window, too far in the past: every input is skipped
+    window.nTimePastLimit = window.nTimeStart;
+    StakeKernelSearch skipped;
+    SearchStakeKernels(window, candidates, pool.size() + 1, skipped, &pool);
+    BOOST_CHECK_EQUAL(skipped.nFound, candidates.size());
+}
+
+BOOST_AUTO_TEST_CASE(stake_modifier_cache)
+{
+    // Block times go back and forth, as they do on the real chain
+    const size_t nBlocks = 400;
+    std::vector<uint256> vHashes(nBlocks);
+    std::vector<CBlockIndex> vBlocks(nBlocks);
+    for (size_t i = 0; i < nBlocks; ++i) {
+        vHashes[i] = InsecureRand256();
+        vBlocks[i].phashBlock = &vHashes[i];
+        vBlocks[i].pprev = i > 0 ? &vBlocks[i - 1] : nullptr;
+        vBlocks[i].nHeight = i;
+        vBlocks[i].nTime = 1600000000 + 30 * i + InsecureRandRange(180) - 90;
+        vBlocks[i].posStakeHash = InsecureRand256();
+        vBlocks[i].posStakeN = InsecureRand32();
+        vBlocks[i].nStakeModifier() = InsecureRand32();
+        vBlocks[i].BuildSkip();
+    }
+
+    CStakeModifierCache cache;
+    for (int round = 0; round < 2; ++round) {
+        for (size_t tip = 0; tip < nBlocks; tip += 37) {
+            const CBlockIndex* pindexPrev = &vBlocks[tip];
+            for (uint32_t blockTime = pindexPrev->nTime; blockTime < pindexPrev->nTime + 300; blockTime += 7) {
+                uint32_t nExpected, nCached;
+                BOOST_CHECK(ComputeNextStakeModifierV2(blockTime, pindexPrev, nExpected));
+                BOOST_CHECK(cache.GetV2(blockTime, pindexPrev, nCached));
+                BOOST_CHECK_EQUAL(nCached, nExpected);
+            }
+
+            uint32_t nExpected, nCached;
+            BOOST_CHECK(ComputeNextStakeModifier(pindexPrev, nExpected));
+            BOOST_CHECK(cache.GetV1(pindexPrev, nCached));
+            BOOST_CHECK_EQUAL(nCached, nExpected);
+        }
+        // Results must not depend on what was dropped before
+        cache.BlockDisconnected(&vBlocks[200]);
+    }
+    cache.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/scrypt.h>
+#include <powhashcache.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(powhashcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(legacy_header_hash_cache)
+{
+    CBlockTreeDB db(1 << 20, true, true);
+
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nTime = 1541202300;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = 42;
+
+    uint256 expected;
+    scrypt_1024_1_1_256(BEGIN(header.nVersion), BEGIN(expected));
+
+    uint256 hash;
+    {
+        CPowHashCache cache(db);
+        BOOST_CHECK(!cache.Lookup(BEGIN(header.nVersion), hash));
+
+        SetLegacyHeaderHashCache(&cache);
+        BOOST_CHECK(header.GetHash() == expected);
+        BOOST_CHECK(header.GetPoWHash() == expected);
+        BOOST_CHECK(GetBlockHeaderHashes({&header}) == std::vector<uint256>{expected});
+        SetLegacyHeaderHashCache(nullptr);
+
+        BOOST_CHECK(cache.Lookup(BEGIN(header.nVersion), hash));
+        BOOST_CHECK(hash == expected);
+    }
+
+    // Hashing alone (e.g. headers from a peer) never reaches the DB
+    {
+        CPowHashCache cache(db);
+        BOOST_CHECK(!cache.Lookup(BEGIN(header.nVersion), hash));
+
+        // Accepted into the block index, written on Flush()
+        cache.Persist(header, expected);
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // A fresh cache on the same DB finds the entry on disk
+    CPowHashCache cache(db);
+    BOOST_CHECK(cache.Lookup(BEGIN(header.nVersion), hash));
+    BOOST_CHECK(hash == expected);
+
+    // Any change in the header misses
+    CBlockHeader header2 = header;
+    header2.nNonce++;
+    BOOST_CHECK(!cache.Lookup(BEGIN(header2.nVersion), hash));
+
+    // Headers from v4 on are never stored
+    CBlockHeader header4 = header;
+    header4.nVersion = 4;
+    cache.Persist(header4, header4.GetHash());
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!CPowHashCache(db).Lookup(BEGIN(header4.nVersion), hash));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,51 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TEST_UTIL_NET_H
+#define BITCOIN_TEST_UTIL_NET_H
+
+#include <net.h>
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+struct CConnmanTest : public CConnman {
+    using CConnman::CConnman;
+    void AddNode(CNode& node)
+    {
+        LOCK(cs_vNodes);
+        vNodes.push_back(&node);
+    }
+    /** Add a node with a live socket the way AcceptConnection() does */
+    void AddSocketNode(CNode& node)
+    {
+        LOCK(cs_vNodes);
+        vNodes.push_back(&node);
+        mapSocketToNode.emplace(node.hSocket, &node);
+        RegisterEvents(&node);
+    }
+    void SetSocketEventsMode(SocketEventsMode mode)
+    {
+        socketEventsMode = mode;
+#ifdef USE_EPOLL
+        if (mode == SOCKETEVENTS_EPOLL && epollfd == -1) {
+            epollfd = epoll_create1(0);
+        }
+#endif
+    }
+    using CConnman::MapSocketEvents;
+    using CConnman::SocketEvents;
+    using CConnman::SocketEventsResult;
+    void ClearNodes()
+    {
+        LOCK(cs_vNodes);
+        for (CNode* node : vNodes) {
+            delete node;
+        }
+        vNodes.clear();
+    }
+};
+
+#endif // BITCOIN_TEST_UTIL_NET_H
@@ -9,6 +9,7 @@
 #include <consensus/consensus.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha256.h>
 #include <index/txindex.h>
 #include <init.h>
@@ -84,6 +85,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     InitLogging();
     LogInstance().StartLogging();
     SHA256AutoDetect();
+    ScryptAutoDetect();
     ECC_Start();
     BLSInit();
     SetupEnvironment();
@@ -128,6 +130,7 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     g_banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
     g_connman = MakeUnique<CConnman>(0x1337, 0x1337); // Deterministic randomness for tests.
     pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+    SetBlockSigLoader(ReadBlockSigFromDB);
     g_chainstate = MakeUnique<CChainState>();
     ::ChainstateActive().InitCoinsDB(
         /* cache_size_bytes */ 1 << 23, /* in_memory */ true, /* should_wipe */ false);
@@ -170,6 +173,7 @@ TestingSetup::~TestingSetup()
     UnloadBlockIndex();
     g_chainstate.reset();
     llmq::DestroyLLMQSystem();
+    SetBlockSigLoader(nullptr);
     pblocktree.reset();
 }
 
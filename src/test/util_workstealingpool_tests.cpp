@@ -0,0 +1,143 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/workstealingpool.h>
+#include <test/util/setup_common.h>
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(util_workstealingpool_tests, BasicTestingSetup)
+
+using Priority = WorkStealingPool::Priority;
+
+// Occupies the only worker of a pool until the returned promise is set
+static std::promise<void> BlockWorker(WorkStealingPool& pool)
+{
+    std::promise<void> release;
+    std::promise<void> started;
+    auto fStarted = started.get_future();
+    std::shared_future<void> fRelease = release.get_future().share();
+    pool.push(Priority::HIGH, [&started, fRelease](int) {
+        started.set_value();
+        fRelease.wait();
+    });
+    fStarted.wait();
+    return release;
+}
+
+BOOST_AUTO_TEST_CASE(workstealingpool_results)
+{
+    WorkStealingPool pool;
+    pool.Start(4, "test-pool");
+
+    std::atomic<bool> fBadThreadId{false};
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 1000; i++) {
+        futures.emplace_back(pool.push(i % 2 ? Priority::HIGH : Priority::LOW, [&fBadThreadId](int threadId, int n) {
+            if (threadId < 0 || threadId >= 4) {
+                fBadThreadId = true;
+            }
+            return n * 2;
+        }, i));
+    }
+    for (int i = 0; i < 1000; i++) {
+        BOOST_CHECK_EQUAL(futures[i].get(), i * 2);
+    }
+    BOOST_CHECK(!fBadThreadId);
+    pool.Stop();
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(workstealingpool_nested)
+{
+    // every task below the maximum depth spawns two more from inside the pool, these are stolen by the other workers
+    static const int MAX_DEPTH = 12;
+    static const int TASK_COUNT = (1 << (MAX_DEPTH + 1)) - 1;
+
+    WorkStealingPool pool;
+    pool.Start(4, "test-pool");
+
+    std::atomic<int> nDone{0};
+    std::promise<void> allDone;
+    std::function<void(int, int)> spawn = [&](int, int depth) {
+        if (depth < MAX_DEPTH) {
+            pool.push(Priority::LOW, spawn, depth + 1);
+            pool.push(Priority::LOW, spawn, depth + 1);
+        }
+        if (++nDone == TASK_COUNT) {
+            allDone.set_value();
+        }
+    };
+    pool.push(Priority::LOW, spawn, 0);
+    allDone.get_future().wait();
+    BOOST_CHECK_EQUAL(nDone, TASK_COUNT);
+    pool.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(workstealingpool_priorities)
+{
+    WorkStealingPool pool;
+    pool.Start(1, "test-pool");
+    auto release = BlockWorker(pool);
+
+    std::mutex m;
+    std::vector<Priority> vecOrder;
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 20; i++) {
+        const Priority prio = i < 10 ? Priority::LOW : Priority::HIGH;
+        futures.emplace_back(pool.push(prio, [&m, &vecOrder, prio](int) {
+            std::unique_lock<std::mutex> l(m);
+            vecOrder.emplace_back(prio);
+        }));
+    }
+    release.set_value();
+    for (auto& f : futures) {
+        f.get();
+    }
+
+    // the HIGH priority tasks were queued last but ran first
+    BOOST_CHECK_EQUAL(vecOrder.size(), 20U);
+    for (size_t i = 0; i < vecOrder.size(); i++) {
+        BOOST_CHECK(vecOrder[i] == (i < 10 ? Priority::HIGH : Priority::LOW));
+    }
+    pool.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(workstealingpool_overflow)
+{
+    WorkStealingPool pool;
+    pool.Start(1, "test-pool");
+    auto release = BlockWorker(pool);
+
+    // more tasks than the shared queue holds, the rest spill into the overflow list
+    std::atomic<size_t> nDone{0};
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < WorkStealingPool::INJECT_QUEUE_SIZE + 100; i++) {
+        futures.emplace_back(pool.push(Priority::LOW, [&nDone](int) { nDone++; }));
+    }
+    release.set_value();
+    for (auto& f : futures) {
+        f.get();
+    }
+    BOOST_CHECK_EQUAL(nDone, WorkStealingPool::INJECT_QUEUE_SIZE + 100);
+    pool.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(workstealingpool_drop_queued)
+{
+    std::future<int> f;
+    {
+        // never started, the queued task is dropped without running it
+        WorkStealingPool pool;
+        f = pool.push(Priority::LOW, [](int) { return 1; });
+    }
+    BOOST_CHECK_THROW(f.get(), std::future_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
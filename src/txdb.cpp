@@ -5,27 +5,32 @@
 
 #include <txdb.h>
 
+#include <pos_stakeinput.h>
 #include <pow.h>
 #include <random.h>
 #include <shutdown.h>
 #include <uint256.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <ui_interface.h>
 #include <util/translation.h>
 #include <util/vector.h>
 
 #include <stdint.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
-static const char DB_ADDRESSINDEX = 'a';
-static const char DB_ADDRESSUNSPENTINDEX = 'u';
-static const char DB_TIMESTAMPINDEX = 's';
-static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_LEGACY_POW_HASH = 'P';
+static const char DB_STAKE_PROVENANCE = 'S';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -214,7 +219,8 @@ void CCoinsViewDBCursor::Next()
     }
 }
 
-bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
+bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo,
+                                  const std::map<COutPoint, CStakeProvenance>& stakeProvenance) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_FILES, it->first), *it->second);
@@ -223,135 +229,39 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
     }
-    return WriteBatch(batch, true);
-}
-
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(std::make_pair(DB_SPENTINDEX, key), value);
-}
-
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+    for (const auto& p : stakeProvenance) {
+        if (p.second.nHeight >= 0) {
+            batch.Write(std::make_pair(DB_STAKE_PROVENANCE, p.first), p.second);
         } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+            batch.Erase(std::make_pair(DB_STAKE_PROVENANCE, p.first));
         }
     }
-    return WriteBatch(batch);
+    return WriteBatch(batch, true);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
-            break;
-        }
+bool CBlockTreeDB::ReadBlockSig(const uint256& hash, std::vector<unsigned char>& vchBlockSig) {
+    CDiskBlockIndex diskindex;
+    if (!Read(std::make_pair(DB_BLOCK_INDEX, hash), diskindex)) {
+        return false;
     }
-
+    vchBlockSig = std::move(diskindex.vchBlockSig);
     return true;
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
+bool CBlockTreeDB::ReadLegacyPowHash(const uint256& headerHash, uint256& powHash) {
+    return Read(std::make_pair(DB_LEGACY_POW_HASH, headerHash), powHash);
 }
 
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+bool CBlockTreeDB::WriteLegacyPowHashes(const std::vector<std::pair<uint256, uint256> >& vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    if (start > 0 && end > 0) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
-    } else {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    for (const auto& p : vect) {
+        batch.Write(std::make_pair(DB_LEGACY_POW_HASH, p.first), p.second);
     }
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
-            if (end > 0 && key.second.blockHeight > end) {
-                break;
-            }
-            CAmount nValue;
-            if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address index value");
-            }
-        } else {
-            break;
-        }
-    }
-
-    return true;
-}
-
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, CTimestampIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp <= high) {
-            hashes.push_back(key.second.blockHash);
-            pcursor->Next();
-        } else {
-            break;
-        }
-    }
-
-    return true;
+bool CBlockTreeDB::ReadStakeProvenance(const COutPoint& outpoint, CStakeProvenance& provenance) {
+    return Read(std::make_pair(DB_STAKE_PROVENANCE, outpoint), provenance);
 }
 
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
@@ -366,20 +276,155 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+namespace {
+
+//! Number of block index entries the reader hands on at once
+static const size_t BLOCK_INDEX_LOAD_BATCH = 4096;
+
+struct BlockIndexLoadBatch {
+    //! Raw (still obfuscated) values, filled by the reader
+    std::vector<unsigned char> vData;
+    //! End offset of every value in vData
+    std::vector<size_t> vEnd;
+    //! Decoded entries, filled by a worker
+    std::vector<CDiskBlockIndex> vDecoded;
+    bool fDecoded{false};
+    bool fFailed{false};
+};
+
+} // namespace
+
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nWorkers)
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    if (nWorkers <= 0) {
+        nWorkers = std::max(1, std::min(GetNumCores() - 1, MAX_BLOCK_INDEX_LOAD_THREADS));
+    }
+    const std::vector<unsigned char>& obfuscateKey = dbwrapper_private::GetObfuscateKey(*this);
+    // Bounds the memory held by batches that are read but not linked yet
+    const size_t nMaxInFlight = 4 * nWorkers;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    // Batches waiting for a worker, and all batches not linked yet in key order
+    std::deque<std::shared_ptr<BlockIndexLoadBatch>> queueDecode;
+    std::deque<std::shared_ptr<BlockIndexLoadBatch>> queueLink;
+    bool fReadDone = false;
+    bool fReadFailed = false;
+    bool fAbort = false;
+
+    auto submit = [&](std::shared_ptr<BlockIndexLoadBatch> batch) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return fAbort || queueLink.size() < nMaxInFlight; });
+        if (fAbort) return false;
+        queueDecode.push_back(batch);
+        queueLink.push_back(std::move(batch));
+        cond.notify_all();
+        return true;
+    };
+
+    auto read = [&] {
+        util::ThreadRename("loadblkidx");
+        try {
+            std::unique_ptr<CDBIterator> pcursor(NewIterator());
+            pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+            auto batch = std::make_shared<BlockIndexLoadBatch>();
+            while (pcursor->Valid()) {
+                std::pair<char, uint256> key;
+                if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX) break;
+                pcursor->AppendRawValue(batch->vData);
+                batch->vEnd.push_back(batch->vData.size());
+                if (batch->vEnd.size() == BLOCK_INDEX_LOAD_BATCH) {
+                    if (!submit(std::move(batch))) return;
+                    batch = std::make_shared<BlockIndexLoadBatch>();
+                }
+                pcursor->Next();
+            }
+            if (!batch->vEnd.empty() && !submit(std::move(batch))) return;
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+            std::lock_guard<std::mutex> lock(mutex);
+            fReadFailed = true;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        fReadDone = true;
+        cond.notify_all();
+    };
+
+    auto decode = [&] {
+        util::ThreadRename("loadblkidx");
+        while (true) {
+            std::shared_ptr<BlockIndexLoadBatch> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return fAbort || fReadDone || !queueDecode.empty(); });
+                if (fAbort || queueDecode.empty()) return;
+                batch = std::move(queueDecode.front());
+                queueDecode.pop_front();
+            }
+            batch->vDecoded.resize(batch->vEnd.size());
+            size_t nBegin = 0;
+            for (size_t i = 0; i < batch->vEnd.size(); ++i) {
+                try {
+                    CDataStream ssValue((const char*)batch->vData.data() + nBegin, (const char*)batch->vData.data() + batch->vEnd[i], SER_DISK, CLIENT_VERSION);
+                    ssValue.Xor(obfuscateKey);
+                    ssValue >> batch->vDecoded[i];
+                } catch (const std::exception&) {
+                    batch->fFailed = true;
+                    break;
+                }
+                nBegin = batch->vEnd[i];
+            }
+            std::vector<unsigned char>().swap(batch->vData);
+            std::lock_guard<std::mutex> lock(mutex);
+            batch->fDecoded = true;
+            cond.notify_all();
+        }
+    };
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+    std::vector<std::thread> threads;
+    threads.emplace_back(read);
+    for (int i = 0; i < nWorkers; ++i) {
+        threads.emplace_back(decode);
+    }
+    auto stop = [&] {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            fAbort = true;
+        }
+        cond.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+
+    // Link the decoded batches in key order, on the calling thread which holds cs_main
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+            if (ShutdownRequested()) {
+                stop();
+                return false;
+            }
+            std::shared_ptr<BlockIndexLoadBatch> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!cond.wait_for(lock, std::chrono::milliseconds(100), [&] {
+                        return (!queueLink.empty() && queueLink.front()->fDecoded) || (fReadDone && queueLink.empty());
+                    })) {
+                    continue;
+                }
+                if (queueLink.empty()) break;
+                batch = std::move(queueLink.front());
+                queueLink.pop_front();
+            }
+            // The reader may be waiting for room
+            cond.notify_all();
 
-    // Load m_block_index
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        if (ShutdownRequested()) return false;
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
+            if (batch->fFailed) {
+                stop();
+                return error("%s: failed to read value", __func__);
+            }
+            for (const CDiskBlockIndex& diskindex : batch->vDecoded) {
                 // Construct block index object
                 CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
@@ -394,22 +439,23 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->posStakeHash   = diskindex.posStakeHash;
                 pindexNew->posStakeN      = diskindex.posStakeN;
-                pindexNew->vchBlockSig    = diskindex.vchBlockSig;
+                // The signature stays on disk, see CBlockIndex::GetBlockSig()
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
 
                 // PirateCash related block index fields
                 pindexNew->nFlags         = diskindex.nFlags;
-
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
             }
-        } else {
-            break;
         }
+    } catch (...) {
+        stop();
+        throw;
     }
+    stop();
 
+    if (fReadFailed) {
+        return error("%s: failed to iterate the block index", __func__);
+    }
     return true;
 }
 
@@ -9,9 +9,10 @@
 #include <coins.h>
 #include <dbwrapper.h>
 #include <chain.h>
+#include <pos_stakeinput.h>
 #include <primitives/block.h>
-#include <spentindex.h>
 
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -37,8 +38,12 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
+//! Max memory allocated to the address, spent and timestamp index caches combined in MiB.
+static const int64_t max_chain_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Max. threads deserializing block index entries at startup
+static const int MAX_BLOCK_INDEX_LOAD_THREADS = 8;
 
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB final : public CCoinsView
@@ -92,26 +97,27 @@ class CBlockTreeDB : public CDBWrapper
 public:
     explicit CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
-    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    //! stakeProvenance entries with a negative height are erased
+    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo,
+                        const std::map<COutPoint, CStakeProvenance>& stakeProvenance = {});
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &info);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindexing);
     void ReadReindexing(bool &fReindexing);
-    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
-    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type,
-                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool ReadAddressIndex(uint160 addressHash, int type,
-                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
-    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
-    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
+    bool ReadBlockSig(const uint256& hash, std::vector<unsigned char>& vchBlockSig);
+    bool ReadLegacyPowHash(const uint256& headerHash, uint256& powHash);
+    bool WriteLegacyPowHashes(const std::vector<std::pair<uint256, uint256> >& vect);
+    bool ReadStakeProvenance(const COutPoint& outpoint, CStakeProvenance& provenance);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /**
+     * Load all block index entries. A reader thread streams the raw entries in
+     * batches, worker threads deserialize them and the calling thread links the
+     * decoded batches in key order through insertBlockIndex.
+     *
+     * @param[in] nWorkers  Number of deserializing threads, 0 picks one per spare core.
+     */
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nWorkers = 0);
 };
 
 #endif // BITCOIN_TXDB_H
@@ -0,0 +1,323 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/workstealingpool.h>
+
+#include <tinyformat.h>
+#include <util/threadnames.h>
+
+#include <cassert>
+#include <cstdint>
+
+namespace workstealing {
+
+static const int64_t INITIAL_DEQUE_CAPACITY = 256;
+
+TaskDeque::TaskDeque()
+{
+    buffers.emplace_back(std::make_unique<Buffer>(INITIAL_DEQUE_CAPACITY));
+    buffer.store(buffers.back().get(), std::memory_order_relaxed);
+}
+
+TaskDeque::~TaskDeque() = default;
+
+TaskDeque::Buffer* TaskDeque::Grow(Buffer* oldBuffer, int64_t b, int64_t t)
+{
+    buffers.emplace_back(std::make_unique<Buffer>(oldBuffer->nCapacity * 2));
+    Buffer* newBuffer = buffers.back().get();
+    for (int64_t i = t; i < b; i++) {
+        newBuffer->Put(i, oldBuffer->Get(i));
+    }
+    buffer.store(newBuffer, std::memory_order_release);
+    return newBuffer;
+}
+
+void TaskDeque::Push(Task* task)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    Buffer* buf = buffer.load(std::memory_order_relaxed);
+    if (b - t > buf->nCapacity - 1) {
+        buf = Grow(buf, b, t);
+    }
+    buf->Put(b, task);
+    // publishes the task to thieves, which load bottom with acquire
+    bottom.store(b + 1, std::memory_order_release);
+}
+
+Task* TaskDeque::Take()
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    Buffer* buf = buffer.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+    if (t > b) {
+        // empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Task* task = buf->Get(b);
+    if (t == b) {
+        // last item, race against thieves for it
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            task = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+Task* TaskDeque::Steal()
+{
+    while (true) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        Buffer* buf = buffer.load(std::memory_order_acquire);
+        Task* task = buf->Get(t);
+        if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return task;
+        }
+        // lost the race against the owner or another thief, try again
+    }
+}
+
+TaskRing::TaskRing(size_t nCapacity) :
+    nMask(nCapacity - 1),
+    cells(new Cell[nCapacity])
+{
+    assert(nCapacity >= 2 && (nCapacity & nMask) == 0);
+    for (size_t i = 0; i < nCapacity; i++) {
+        cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool TaskRing::TryPush(Task* task)
+{
+    Cell* cell;
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        cell = &cells[pos & nMask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (dif < 0) {
+            // full
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->task = task;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+Task* TaskRing::TryPop()
+{
+    Cell* cell;
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+        cell = &cells[pos & nMask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (dif < 0) {
+            // empty
+            return nullptr;
+        } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    Task* task = cell->task;
+    cell->seq.store(pos + nMask + 1, std::memory_order_release);
+    return task;
+}
+
+} // namespace workstealing
+
+using workstealing::Task;
+
+// the pool and index of the worker running on the current thread, if any
+static thread_local const WorkStealingPool* g_current_pool = nullptr;
+static thread_local int g_current_worker = -1;
+
+WorkStealingPool::WorkStealingPool() :
+    injected{workstealing::TaskRing(INJECT_QUEUE_SIZE), workstealing::TaskRing(INJECT_QUEUE_SIZE)}
+{
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    Stop();
+    ClearQueues();
+}
+
+void WorkStealingPool::Start(int nThreads, const std::string& strThreadName)
+{
+    assert(workers.empty());
+    fStop = false;
+    // all workers must exist before the first one starts stealing
+    for (int i = 0; i < nThreads; i++) {
+        workers.emplace_back(std::make_unique<Worker>());
+        workers.back()->nRand = static_cast<uint32_t>(i) * 2654435761U + 1;
+    }
+    for (int i = 0; i < nThreads; i++) {
+        workers[i]->thread = std::thread(&WorkStealingPool::WorkerThread, this, i, strThreadName);
+    }
+}
+
+void WorkStealingPool::Stop()
+{
+    if (workers.empty()) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> l(sleepMutex);
+        fStop = true;
+        sleepCv.notify_all();
+    }
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    ClearQueues();
+    workers.clear();
+}
+
+void WorkStealingPool::ClearQueues()
+{
+    for (int prio = 0; prio < NUM_PRIORITIES; prio++) {
+        for (auto& worker : workers) {
+            while (Task* task = worker->deques[prio].Take()) {
+                delete task;
+            }
+        }
+        while (Task* task = injected[prio].TryPop()) {
+            delete task;
+        }
+        std::unique_lock<std::mutex> l(overflowMutex);
+        for (Task* task : overflow[prio]) {
+            delete task;
+        }
+        overflow[prio].clear();
+    }
+    nOverflow = 0;
+}
+
+void WorkStealingPool::Push(Priority prio, Task* task)
+{
+    const int p = static_cast<int>(prio);
+    if (g_current_pool == this) {
+        workers[g_current_worker]->deques[p].Push(task);
+    } else if (!injected[p].TryPush(task)) {
+        std::unique_lock<std::mutex> l(overflowMutex);
+        overflow[p].emplace_back(task);
+        nOverflow++;
+    }
+    WakeOne();
+}
+
+void WorkStealingPool::WakeOne()
+{
+    // pairs with the fence in WorkerThread, either we see the sleeping worker or it sees the new task
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (nSleeping.load(std::memory_order_relaxed) > 0) {
+        std::unique_lock<std::mutex> l(sleepMutex);
+        sleepCv.notify_one();
+    }
+}
+
+Task* WorkStealingPool::StealFromOthers(int nWorker, int prio)
+{
+    const int nWorkers = size();
+    // start at a random victim so thieves spread over the workers
+    uint32_t& r = workers[nWorker]->nRand;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    const int nStart = static_cast<int>(r % static_cast<uint32_t>(nWorkers));
+    for (int i = 0; i < nWorkers; i++) {
+        const int nVictim = (nStart + i) % nWorkers;
+        if (nVictim == nWorker) {
+            continue;
+        }
+        if (Task* task = workers[nVictim]->deques[prio].Steal()) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+Task* WorkStealingPool::Pop(int nWorker)
+{
+    for (int prio = 0; prio < NUM_PRIORITIES; prio++) {
+        if (Task* task = workers[nWorker]->deques[prio].Take()) {
+            return task;
+        }
+        if (Task* task = injected[prio].TryPop()) {
+            return task;
+        }
+        if (nOverflow.load(std::memory_order_relaxed) > 0) {
+            std::unique_lock<std::mutex> l(overflowMutex);
+            if (!overflow[prio].empty()) {
+                Task* task = overflow[prio].front();
+                overflow[prio].pop_front();
+                nOverflow--;
+                return task;
+            }
+        }
+        if (Task* task = StealFromOthers(nWorker, prio)) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void WorkStealingPool::WorkerThread(int nWorker, const std::string& strThreadName)
+{
+    util::ThreadRename(strprintf("%s-%d", strThreadName, nWorker));
+    g_current_pool = this;
+    g_current_worker = nWorker;
+
+    while (!fStop) {
+        Task* task = nullptr;
+        for (int i = 0; i < SPIN_ROUNDS && !fStop; i++) {
+            task = Pop(nWorker);
+            if (task) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+        if (!task) {
+            std::unique_lock<std::mutex> l(sleepMutex);
+            nSleeping++;
+            // pairs with the fence in WakeOne
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!fStop && !(task = Pop(nWorker))) {
+                sleepCv.wait(l);
+            }
+            nSleeping--;
+        }
+        if (task) {
+            // delete the task at return, even if an exception occurred
+            std::unique_ptr<Task> func(task);
+            (*func)(nWorker);
+        }
+    }
+
+    g_current_pool = nullptr;
+    g_current_worker = -1;
+}
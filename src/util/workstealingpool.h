@@ -0,0 +1,163 @@
+// Copyright (c) 2024 The PirateCash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_WORKSTEALINGPOOL_H
+#define BITCOIN_UTIL_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace workstealing {
+
+using Task = std::function<void(int)>;
+
+/**
+ * Chase-Lev work-stealing deque ("Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013).
+ * Only the owning thread may call Push and Take, which work on the bottom end. Any thread may call Steal,
+ * which takes from the top end. Replaced buffers are kept until destruction as thieves may still read them.
+ */
+class TaskDeque
+{
+private:
+    struct Buffer {
+        const int64_t nCapacity;
+        std::unique_ptr<std::atomic<Task*>[]> tasks;
+
+        explicit Buffer(int64_t _nCapacity) : nCapacity(_nCapacity), tasks(new std::atomic<Task*>[_nCapacity]) {}
+
+        Task* Get(int64_t i) const { return tasks[i & (nCapacity - 1)].load(std::memory_order_relaxed); }
+        void Put(int64_t i, Task* task) { tasks[i & (nCapacity - 1)].store(task, std::memory_order_relaxed); }
+    };
+
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::atomic<Buffer*> buffer;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+    Buffer* Grow(Buffer* oldBuffer, int64_t b, int64_t t);
+
+public:
+    TaskDeque();
+    ~TaskDeque();
+
+    void Push(Task* task);
+    Task* Take();
+    Task* Steal();
+};
+
+/**
+ * Bounded lock-free multi-producer multi-consumer queue (D. Vyukov). Used for tasks pushed from
+ * threads outside of the pool. TryPush fails when the queue is full.
+ */
+class TaskRing
+{
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        Task* task;
+    };
+
+    const size_t nMask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+
+public:
+    explicit TaskRing(size_t nCapacity);
+
+    bool TryPush(Task* task);
+    Task* TryPop();
+};
+
+} // namespace workstealing
+
+/**
+ * Thread pool running functors with the signature ret func(int id, other_params), where id is the index
+ * of the thread running the functor, same as ctpl::thread_pool.
+ *
+ * Every worker has its own lock-free deque per priority. Tasks pushed from a worker (e.g. the follow-up
+ * batches of a parallel aggregation) go to the worker's own deque, tasks pushed from other threads go to
+ * a shared lock-free queue. Idle workers steal from the other workers, so there is no single queue all
+ * threads contend on. Workers always run HIGH priority tasks before LOW priority ones.
+ */
+class WorkStealingPool
+{
+public:
+    enum class Priority {
+        HIGH,
+        LOW,
+    };
+
+    // size of the shared queue per priority, pushes beyond that spill into a locked list
+    static const size_t INJECT_QUEUE_SIZE = 1024;
+
+private:
+    static const int NUM_PRIORITIES = 2;
+    static const int SPIN_ROUNDS = 64;
+
+    struct Worker {
+        workstealing::TaskDeque deques[NUM_PRIORITIES];
+        std::thread thread;
+        uint32_t nRand;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    workstealing::TaskRing injected[NUM_PRIORITIES];
+
+    std::mutex overflowMutex;
+    std::deque<workstealing::Task*> overflow[NUM_PRIORITIES];
+    std::atomic<size_t> nOverflow{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+    std::atomic<int> nSleeping{0};
+    std::atomic<bool> fStop{false};
+
+    void Push(Priority prio, workstealing::Task* task);
+    workstealing::Task* Pop(int nWorker);
+    workstealing::Task* StealFromOthers(int nWorker, int prio);
+    void WakeOne();
+    void WorkerThread(int nWorker, const std::string& strThreadName);
+    void ClearQueues();
+
+public:
+    WorkStealingPool();
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // starts nThreads workers named "<strThreadName>-<n>"
+    void Start(int nThreads, const std::string& strThreadName);
+    // waits for running tasks to finish and stops all workers, queued tasks are dropped without running them
+    void Stop();
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    template<typename F, typename... Rest>
+    auto push(Priority prio, F&& f, Rest&&... rest) -> std::future<decltype(f(0, rest...))>
+    {
+        auto pck = std::make_shared<std::packaged_task<decltype(f(0, rest...))(int)>>(
+                std::bind(std::forward<F>(f), std::placeholders::_1, std::forward<Rest>(rest)...)
+        );
+        auto fut = pck->get_future();
+        auto task = std::make_unique<workstealing::Task>([pck](int id) {
+            (*pck)(id);
+        });
+        Push(prio, task.get());
+        task.release();
+        return fut;
+    }
+};
+
+#endif // BITCOIN_UTIL_WORKSTEALINGPOOL_H
@@ -37,6 +37,7 @@
 #include <wallet/walletdb.h>
 #include <wallet/walletutil.h>
 #include <key_io.h>
+#include <miner.h>
 
 #include <coinjoin/client.h>
 #include <coinjoin/options.h>
@@ -2549,6 +2550,31 @@ static UniValue getstakingstatus(const JSONRPCRequest& request)
                     "  \"stakesplitthreshold\": d                  (numeric) value of the current threshold for stake split\n"
                     "  \"stakemaxsplit\": d                        (numeric) Sets the number of max inputs & outputs of a stake\n"
                     "  \"stakeautocombine\": d                     (numeric) autocombine feature: 0 - disable, 1 - same account, 2 - any account\n"
+                    "  \"stakethreads\": d                         (numeric) number of threads searching for stake kernels\n"
+                    "  \"lastsearch\": {                           (json object) the last stake kernel search, shared by all staking wallets\n"
+                    "    \"time\": xxx,                            (numeric) the time of the search in seconds since epoch (Jan 1 1970 GMT)\n"
+                    "    \"threads\": d,                           (numeric) number of threads used\n"
+                    "    \"candidates_scanned\": d,                (numeric) number of stake inputs of this wallet searched\n"
+                    "    \"kernels\": d,                           (numeric) number of kernel hashes computed for this wallet\n"
+                    "    \"kernels_per_sec\": x.xxx                (numeric) kernel hashes per second for this wallet\n"
+                    "  },\n"
+                    "  \"lasthit\": {                              (json object) blocks staked by this wallet since startup\n"
+                    "    \"count\": d,                             (numeric) number of blocks staked\n"
+                    "    \"time\": xxx,                            (numeric) the time of the last block staked in seconds since epoch (Jan 1 1970 GMT)\n"
+                    "    \"height\": d,                            (numeric) the height of the last block staked\n"
+                    "    \"blockhash\": \"hash\"                   (string) the hash of the last block staked\n"
+                    "  },\n"
+                    "  \"phases\": {                               (json object) time spent by the staker in each phase\n"
+                    "    \"kernel_scan\": {                        (json object) searching the stakeable coins for a kernel\n"
+                    "      \"last_ms\": x.xxx,                     (numeric) duration of the last run in milliseconds\n"
+                    "      \"avg_ms\": x.xxx,                      (numeric) average duration in milliseconds\n"
+                    "      \"count\": d                            (numeric) number of runs\n"
+                    "    },\n"
+                    "    \"template_build\": {...},                (json object) assembling the block template, same fields\n"
+                    "    \"sign\": {...},                          (json object) creating the coinstake and signing the block, same fields\n"
+                    "    \"submit\": {...},                        (json object) validating and connecting the block, same fields\n"
+                    "    \"speculative_hits\": d                   (numeric) kernels spent in a template assembled before they were found\n"
+                    "  }\n"
                     "}\n"
 
                     "\nExamples:\n" +
@@ -2563,7 +2589,7 @@ static UniValue getstakingstatus(const JSONRPCRequest& request)
     LOCK(pwallet->cs_wallet);
 
     bool fMintableCoins = pwallet->MintableCoins();
-    bool fLessReserveBalance = nReserveBalance >= pwallet->GetBalance().m_mine_trusted;
+    bool fLessReserveBalance = nReserveBalance >= pwallet->GetTrustedBalance();
     bool fStatus = !(pwallet->IsLocked(true) || !fMintableCoins || fLessReserveBalance || !masternodeSync.IsSynced() || g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0);
 
     UniValue obj(UniValue::VOBJ);
@@ -2577,6 +2603,40 @@ static UniValue getstakingstatus(const JSONRPCRequest& request)
     obj.pushKV("stakesplitthreshold", gArgs.GetArg("-stakesplitthreshold", DEFAULT_STAKE_SPLIT_THRESHOLD));
     obj.pushKV("stakemaxsplit", gArgs.GetArg("-stakemaxsplit", DEFAULT_STAKE_MAX_SPLIT));
     obj.pushKV("stakeautocombine", gArgs.GetArg("-stakeautocombine", DEFAULT_STAKE_AUTOCOMBINE));
+    obj.pushKV("stakethreads", pwallet->nStakeThreads);
+
+    const auto& stats = pwallet->m_last_stake_search;
+    UniValue search(UniValue::VOBJ);
+    search.pushKV("time", stats.nTime);
+    search.pushKV("threads", stats.nThreads);
+    search.pushKV("candidates_scanned", stats.nCandidates);
+    search.pushKV("kernels", stats.nKernels);
+    search.pushKV("kernels_per_sec", stats.nDurationMicros > 0 ? stats.nKernels * 1000000.0 / stats.nDurationMicros : 0.0);
+    obj.pushKV("lastsearch", search);
+
+    const auto& hits = pwallet->m_stake_hits;
+    UniValue lasthit(UniValue::VOBJ);
+    lasthit.pushKV("count", hits.nCount);
+    lasthit.pushKV("time", hits.nLastTime);
+    lasthit.pushKV("height", hits.nLastHeight);
+    lasthit.pushKV("blockhash", hits.hashLastBlock.GetHex());
+    obj.pushKV("lasthit", lasthit);
+
+    const StakingPhaseTimes times = GetStakingPhaseTimes();
+    auto phaseToJSON = [](const StakingPhaseTimes::Phase& phase) {
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("last_ms", phase.nLastMicros * 0.001);
+        ret.pushKV("avg_ms", phase.nCount > 0 ? phase.nTotalMicros * 0.001 / phase.nCount : 0.0);
+        ret.pushKV("count", phase.nCount);
+        return ret;
+    };
+    UniValue phases(UniValue::VOBJ);
+    phases.pushKV("kernel_scan", phaseToJSON(times.kernelScan));
+    phases.pushKV("template_build", phaseToJSON(times.templateBuild));
+    phases.pushKV("sign", phaseToJSON(times.sign));
+    phases.pushKV("submit", phaseToJSON(times.submit));
+    phases.pushKV("speculative_hits", times.nSpeculativeHits);
+    obj.pushKV("phases", phases);
     return obj;
 }
 
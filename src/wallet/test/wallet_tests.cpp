@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <vector>
 
+#include <chainparams.h>
 #include <interfaces/chain.h>
 #include <key_io.h>
 #include <policy/policy.h>
@@ -956,6 +957,79 @@ BOOST_FIXTURE_TEST_CASE(select_coins_grouped_by_addresses, ListCoinsTestingSetup
     BOOST_CHECK_EQUAL(wallet->GetAvailableBalance(), (500 + 499) * COIN);
 }
 
+// Check that the trusted balance kept from CWalletTx::MarkDirty()
+// notifications matches a full wallet walk.
+BOOST_FIXTURE_TEST_CASE(trusted_balance_follows_wallet_changes, ListCoinsTestingSetup)
+{
+    BOOST_CHECK_EQUAL(wallet->GetTrustedBalance(), wallet->GetBalance().m_mine_trusted);
+
+    // Spending a coin drops it, the unconfirmed change is trusted
+    CTransactionRef tx;
+    CAmount fee;
+    int changePos = -1;
+    bilingual_str error;
+    CCoinControl dummy;
+    {
+        auto locked_chain = m_chain->lock();
+        BOOST_CHECK(wallet->CreateTransaction(*locked_chain, {CRecipient{GetScriptForRawPubKey({}), 1 * COIN, false /* subtract fee */}},
+                                              tx, fee, changePos, error, dummy));
+    }
+    wallet->CommitTransaction(tx, {}, {});
+    BOOST_CHECK_EQUAL(wallet->GetTrustedBalance(), wallet->GetBalance().m_mine_trusted);
+
+    // Abandoning it brings the coin back
+    {
+        auto locked_chain = m_chain->lock();
+        LOCK(wallet->cs_wallet);
+        wallet->mapWallet.at(tx->GetHash()).fInMempool = false;
+        BOOST_CHECK(wallet->AbandonTransaction(*locked_chain, tx->GetHash()));
+    }
+    BOOST_CHECK_EQUAL(wallet->GetTrustedBalance(), wallet->GetBalance().m_mine_trusted);
+}
+
+// Check that the stakeable outputs follow coin maturity, stake age and coin locks.
+BOOST_FIXTURE_TEST_CASE(stake_outputs_follow_maturity_and_locks, ListCoinsTestingSetup)
+{
+    CWallet::StakeCandidates candidates;
+
+    // None of the coinbase outputs is old enough to stake yet
+    BOOST_CHECK(!wallet->SelectStakeCoins(candidates, MAX_MONEY));
+    BOOST_CHECK(!wallet->MintableCoins());
+
+    // Coinbase outputs enter the stake set once they mature, but still need the minimum age
+    while (::ChainActive().Height() <= COINBASE_MATURITY + 1) {
+        CreateAndProcessBlock({}, GetScriptForRawPubKey({}));
+    }
+    BOOST_CHECK_EQUAL(wallet->GetTrustedBalance(), wallet->GetBalance().m_mine_trusted);
+    BOOST_CHECK(!wallet->SelectStakeCoins(candidates, MAX_MONEY));
+
+    SetMockTime(GetTime() + Params().MinStakeAge() + 60 * 60);
+    BOOST_CHECK(wallet->SelectStakeCoins(candidates, MAX_MONEY));
+    BOOST_CHECK(wallet->MintableCoins());
+
+    // Locked coins are neither staked nor counted as mintable
+    {
+        LOCK(wallet->cs_wallet);
+        for (const auto& candidate : candidates) {
+            wallet->LockCoin(COutPoint(std::get<1>(candidate)->GetHash(), std::get<2>(candidate)));
+        }
+    }
+    CWallet::StakeCandidates locked_candidates;
+    BOOST_CHECK(!wallet->SelectStakeCoins(locked_candidates, MAX_MONEY));
+    BOOST_CHECK(!wallet->MintableCoins());
+
+    // Unlocking one of them makes the wallet mintable again
+    {
+        LOCK(wallet->cs_wallet);
+        wallet->UnlockCoin(COutPoint(std::get<1>(candidates.front())->GetHash(), std::get<2>(candidates.front())));
+    }
+    BOOST_CHECK(wallet->SelectStakeCoins(locked_candidates, MAX_MONEY));
+    BOOST_CHECK_EQUAL(locked_candidates.size(), 1U);
+    BOOST_CHECK(wallet->MintableCoins());
+
+    SetMockTime(0);
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     auto chain = interfaces::MakeChain();
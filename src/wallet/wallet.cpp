@@ -58,6 +58,9 @@
 
 #include <assert.h>
 #include <future>
+#include <limits>
+#include <numeric>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -1553,7 +1556,9 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx, int64_t nAcc
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = true;
+        MarkStakeDirty(it->first);
     }
+    UpdateStakeOutputs(*locked_chain);
 }
 
 void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx, MemPoolRemovalReason reason) {
@@ -1562,6 +1567,7 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx, MemPoolR
         auto it = mapWallet.find(ptx->GetHash());
         if (it != mapWallet.end()) {
             it->second.fInMempool = false;
+            MarkStakeDirty(it->first);
         }
     }
 }
@@ -1591,6 +1597,8 @@ void CWallet::BlockConnected(const CBlock& block, const std::vector<CTransaction
 
     m_last_block_processed = block_hash;
 
+    UpdateStakeOutputs(*locked_chain);
+
     // reset cache to make sure no longer immature coins are included
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
@@ -1623,6 +1631,8 @@ void CWallet::BlockDisconnected(const CBlock& block) {
         }
     }
 
+    UpdateStakeOutputs(*locked_chain);
+
     // reset cache to make sure no longer mature coins are excluded
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
@@ -2994,6 +3004,95 @@ CWallet::Balance CWallet::GetBalance(const int min_depth, const bool fAddLocked,
     return ret;
 }
 
+CAmount CWallet::GetTrustedBalance()
+{
+    auto locked_chain = chain().lock();
+    LOCK(cs_wallet);
+    UpdateStakeOutputs(*locked_chain);
+    return m_trusted_balance;
+}
+
+void CWallet::MarkStakeDirty(const uint256& hash) const
+{
+    LOCK(cs_stake_dirty);
+    m_stake_dirty.insert(hash);
+}
+
+void CWallet::UpdateStakeOutputs(interfaces::Chain::Lock& locked_chain)
+{
+    AssertLockHeld(cs_wallet);
+
+    std::set<uint256> dirty;
+    {
+        LOCK(cs_stake_dirty);
+        dirty.swap(m_stake_dirty);
+    }
+    // Coinbase and coinstake credit becomes available without any notification
+    const int nHeight = locked_chain.getHeight().get_value_or(-1);
+    for (auto it = m_stake_maturing.begin(); it != m_stake_maturing.end() && it->first <= nHeight; it = m_stake_maturing.erase(it)) {
+        dirty.insert(it->second);
+    }
+
+    const int64_t min_age = Params().MinStakeAge();
+    for (const uint256& hash : dirty) {
+        // Forget what was known of the transaction, then add it back
+        auto credit_it = m_trusted_credit.find(hash);
+        if (credit_it != m_trusted_credit.end()) {
+            m_trusted_balance -= credit_it->second;
+            m_trusted_credit.erase(credit_it);
+        }
+        for (auto it = m_stake_output_index.lower_bound(COutPoint(hash, 0)); it != m_stake_output_index.end() && it->first.hash == hash; ) {
+            m_stake_outputs.erase(it->second);
+            it = m_stake_output_index.erase(it);
+        }
+
+        const CWalletTx* wtx = GetWalletTx(hash);
+        if (wtx == nullptr) {
+            continue;
+        }
+
+        const int nBlocksToMaturity = wtx->GetBlocksToMaturity(locked_chain);
+        if (nBlocksToMaturity > 0) {
+            if (wtx->IsInMainChain(locked_chain)) {
+                m_stake_maturing.emplace(nHeight + nBlocksToMaturity, hash);
+            }
+            continue;
+        }
+
+        if (wtx->IsTrusted(locked_chain)) {
+            const CAmount credit = wtx->GetAvailableCredit(locked_chain, true, ISMINE_SPENDABLE);
+            if (credit != 0) {
+                m_trusted_credit.emplace(hash, credit);
+                m_trusted_balance += credit;
+            }
+        }
+
+        const int nDepth = wtx->GetDepthInMainChain(locked_chain);
+        if (nDepth < 1) {
+            continue;
+        }
+        const int nMatureHeight = nHeight - nDepth + (wtx->IsCoinBase() ? COINBASE_MATURITY : 10);
+        const int64_t nMatureTime = wtx->GetTxTime() + min_age;
+
+        for (unsigned int i = 0; i < wtx->tx->vout.size(); ++i) {
+            const CTxOut& txout = wtx->tx->vout[i];
+            if (txout.nValue < MIN_STAKE_AMOUNT) {
+                continue;
+            }
+            // Do not touch collaterals
+            if (inputStakeProtect && txout.nValue == MASTERNODE_COLLATERAL_AMOUNT) {
+                continue;
+            }
+            if ((IsMine(txout) & ISMINE_SPENDABLE) == ISMINE_NO || IsSpent(locked_chain, hash, i)) {
+                continue;
+            }
+            const COutPoint outpoint(hash, i);
+            auto inserted = m_stake_outputs.insert(StakeOutput{txout.nValue, nMatureHeight, nMatureTime, outpoint});
+            m_stake_output_index.emplace(outpoint, inserted.first);
+        }
+    }
+}
+
 CAmount CWallet::GetAnonymizableBalance(bool fSkipDenominated, bool fSkipUnconfirmed) const
 {
     if (!CCoinJoinClientOptions::IsEnabled()) return 0;
@@ -3674,56 +3773,36 @@ std::vector<CompactTallyItem> CWallet::SelectCoinsGroupedByAddresses(bool fSkipD
     return vecTallyRet;
 }
 
-bool CWallet::SelectStakeCoins(StakeCandidates& setCoins, CAmount nTargetAmount) const
+bool CWallet::SelectStakeCoins(StakeCandidates& setCoins, CAmount nTargetAmount)
 {
+    auto locked_chain = chain().lock();
     LOCK2(cs_main, cs_wallet);
-    std::vector<COutput> vCoins;
-    CCoinControl coin_control;
-    coin_control.nCoinType = CoinType::ALL_COINS;
-    AvailableCoins(*chain().lock(), vCoins, true, &coin_control, MIN_STAKE_AMOUNT);
+    UpdateStakeOutputs(*locked_chain);
+    const int nHeight = locked_chain->getHeight().get_value_or(-1);
     auto curr_time = GetTime();
-    auto min_age = Params().MinStakeAge();
-
-    for (const COutput& out : vCoins) {
-        CAmount out_value = out.tx->tx->vout[out.i].nValue;
-
-        //make sure not to outrun target amount
-        if (out_value > nTargetAmount) {
-            continue;
-        }
 
-        if (out_value < MIN_STAKE_AMOUNT) {
-            continue;
-        }
-
-        // Do not touch collaterals
-        if (inputStakeProtect && out_value == MASTERNODE_COLLATERAL_AMOUNT) {
-            continue;
-        }
+    //make sure not to outrun target amount, outputs are sorted by value
+    const StakeOutput first{nTargetAmount, std::numeric_limits<int>::min(), 0, COutPoint()};
+    for (auto it = m_stake_outputs.lower_bound(first); it != m_stake_outputs.end(); ++it) {
+        const StakeOutput& output = *it;
 
-        //check for min age
-        if (curr_time - out.tx->GetTxTime() < min_age) {
+        //check that it is matured and for min age
+        if (output.nMatureHeight > nHeight || output.nMatureTime > curr_time) {
             continue;
         }
 
-        //check that it is matured
-        if (out.nDepth < (out.tx->IsCoinBase() ? COINBASE_MATURITY : 10)) {
-            continue;
-        }
-
-        // Ignore already staked, locked or spent
-        auto tx_hash = out.tx->tx->GetHash();
-        if (IsSpent(*chain().lock(), tx_hash, out.i) || IsLockedCoin(tx_hash, out.i)) {
+        // Ignore locked
+        if (IsLockedCoin(output.outpoint.hash, output.outpoint.n)) {
             continue;
         }
 
         // Check another way if spent
-        if (!ChainstateActive().CoinsTip().HaveCoin(COutPoint(tx_hash, out.i))) {
+        if (!ChainstateActive().CoinsTip().HaveCoin(output.outpoint)) {
             continue;
         }
 
         //add to our stake set
-        setCoins.emplace_back(out_value, out.tx, out.i);
+        setCoins.emplace_back(output.nValue, GetWalletTx(output.outpoint.hash), output.outpoint.n);
     }
 
     return !setCoins.empty();
@@ -3731,32 +3810,25 @@ bool CWallet::SelectStakeCoins(StakeCandidates& setCoins, CAmount nTargetAmount)
 
 bool CWallet::MintableCoins()
 {
-    LOCK2(cs_main, cs_wallet);
-    CAmount nBalance = GetBalance().m_mine_trusted;
+    auto locked_chain = chain().lock();
+    LOCK(cs_wallet);
+    UpdateStakeOutputs(*locked_chain);
+    CAmount nBalance = m_trusted_balance;
     if (gArgs.IsArgSet("-reservebalance") && !ParseMoney(gArgs.GetArg("-reservebalance", ""), nReserveBalance))
         return error("MintableCoins() : invalid reserve balance amount");
     if (nBalance <= nReserveBalance)
         return false;
 
-    std::vector<COutput> vCoins;
-    AvailableCoins(*chain().lock(), vCoins, true);
-    auto min_age = Params().MinStakeAge();
+    const int nHeight = locked_chain->getHeight().get_value_or(-1);
+    const int64_t curr_time = GetTime();
 
-    for (const COutput& out : vCoins) {
-        if (out.nDepth < (out.tx->IsCoinBase() ? COINBASE_MATURITY : 10))
+    for (const StakeOutput& output : m_stake_outputs) {
+        // Some more filters are possible, but excessive
+        if (output.nMatureHeight > nHeight || output.nMatureTime > curr_time)
             continue;
-
-        CAmount out_value = out.tx->tx->vout[out.i].nValue;
-
-        if (inputStakeProtect && out_value == MASTERNODE_COLLATERAL_AMOUNT) continue;
-
-        if (out_value < MIN_STAKE_AMOUNT)
+        if (IsLockedCoin(output.outpoint.hash, output.outpoint.n))
             continue;
-
-        // Some more filters are possible, but excessive
-
-        if (GetTime() - out.tx->GetTxTime() >= min_age)
-            return true;
+        return true;
     }
 
     return false;
@@ -4291,245 +4363,280 @@ bool CWallet::CreateTransaction(interfaces::Chain::Lock& locked_chain, const std
 
 // ppcoin: create coin stake transaction
 bool CWallet::CreateCoinStake(const CBlockIndex *pindex_prev, CBlock &curr_block, CMutableTransaction& coinbaseTx)
+{
+    StakeKernel kernel;
+    return FindStakeKernel(pindex_prev, curr_block, kernel) && CreateCoinStake(kernel, curr_block, coinbaseTx);
+}
+
+bool CWallet::GetStakeKernelCandidates(const CBlockIndex* pindex_prev, const CBlockHeader& header,
+                                       std::vector<StakeKernelCandidate>& candidates, std::vector<CPubKey>& keys)
 {
     // Choose coins to use
-    CAmount nBalance = GetBalance().m_mine_trusted;
+    CAmount nBalance = GetTrustedBalance();
 
     if (gArgs.IsArgSet("-reservebalance") && !ParseMoney(gArgs.GetArg("-reservebalance", ""), nReserveBalance))
-        return error("CreateCoinStake : invalid reserve balance amount");
+        return error("GetStakeKernelCandidates : invalid reserve balance amount");
 
     if (nBalance <= nReserveBalance)
-        return error("CreateCoinStake : balance is less than required to reserve");
+        return error("GetStakeKernelCandidates : balance is less than required to reserve");
 
-    // presstab HyperStake - Initialize as static and don't update the set on every run of CreateCoinStake() in order to lighten resource use
     CAmount nTargetAmount = nBalance - nReserveBalance;
 
-    if (setStakeCoins.empty() ||GetTime() - nLastStakeSetUpdate > nStakeSetUpdateTime) {
-        setStakeCoins.clear();
-
-        if (!SelectStakeCoins(setStakeCoins, nTargetAmount)) {
-            LogPrint(BCLog::STAKING, "%s : no inputs eligable for staking\n", __func__);
-            return false;
-        }
-        std::sort(setStakeCoins.begin(), setStakeCoins.end(),[](const auto& lhs, const auto& rhs) {
-            return std::get<0>(lhs) > std::get<0>(rhs);
-        });
-
-        nLastStakeSetUpdate = GetTime();
+    // The stakeable outputs are kept up to date by UpdateStakeOutputs(), so the set is cheap to refresh every time
+    setStakeCoins.clear();
+    if (!SelectStakeCoins(setStakeCoins, nTargetAmount)) {
+        LogPrint(BCLog::STAKING, "%s : no inputs eligable for staking\n", __func__);
+        return false;
     }
 
     LogPrint(BCLog::STAKING, "%s : found %u possible stake inputs\n", __func__, setStakeCoins.size());
 
-    // NOTE: go from smaller amounts to bigger to increase chance, unlike it was before
-    for (auto iter = setStakeCoins.begin(); iter != setStakeCoins.end(); ++iter) {
-        if (ShutdownRequested()) {
-            break;
-        }
-
-        CBlockIndex* pcoin_index = NULL;
-        auto pWalletTxIn = std::get<1>(*iter);
+    // Snapshot everything the kernel search needs while holding the locks,
+    // the search itself then runs without them.
+    LOCK2(cs_main, cs_wallet);
 
-        COutPoint prevoutStake = COutPoint(pWalletTxIn->GetHash(), std::get<2>(*iter));
-        LogPrint(BCLog::STAKING, "%s : trying tx=%s n=%u\n", __func__,
-                 __func__, pWalletTxIn->hashBlock.ToString().c_str());
+    candidates.reserve(candidates.size() + setStakeCoins.size());
+    keys.reserve(keys.size() + setStakeCoins.size());
 
-        // Read block header
-        BlockMap::iterator it = ::BlockIndex().find(pWalletTxIn->hashBlock);
-        if (it != ::BlockIndex().end())
-            pcoin_index = it->second;
-        else {
-            LogPrintf("%s : failed to find block index for %s \n",
-                        pWalletTxIn->hashBlock.ToString().c_str());
+    // NOTE: go from smaller amounts to bigger to increase chance, unlike it was before
+    for (const auto& stake_coin : setStakeCoins) {
+        auto pWalletTxIn = std::get<1>(stake_coin);
+        COutPoint prevoutStake = COutPoint(pWalletTxIn->GetHash(), std::get<2>(stake_coin));
+
+        const CBlockIndex* pcoin_index = LookupBlockIndex(pWalletTxIn->hashBlock);
+        if (pcoin_index == nullptr) {
+            LogPrintf("%s : failed to find block index for %s \n", __func__,
+                      pWalletTxIn->hashBlock.ToString().c_str());
             continue;
         }
 
-        uint256 hashProofOfStake = uint256();
-
-        //iterates each utxo inside of CheckStakeKernelHash()
-        bool fKernelFound = CheckStakeKernelHash(
-                curr_block,
-                *pindex_prev,
-                *pcoin_index,
-                *pWalletTxIn->tx,
-                prevoutStake,
-                nHashDrift,
-                false,
-                hashProofOfStake,
-                true);
-
-        if (fKernelFound) {
-            //Double check that this will pass time requirements
-            if (curr_block.nTime <= ::ChainActive().Tip()->GetMedianTimePast()) {
-                LogPrint(BCLog::STAKING, "%s kernel found, but it is too far in the past \n", __func__);
+        // Resolve the key signing the block now, so that a found kernel is always usable
+        std::vector<std::vector<unsigned char>> vSolutions;
+        const auto &scriptPubKeyKernel = pWalletTxIn->tx->vout[prevoutStake.n].scriptPubKey;
+        txnouttype whichType = Solver(scriptPubKeyKernel, vSolutions);
+        CPubKey posPubKey;
+
+        if (whichType == TX_PUBKEYHASH) // pay to address type
+        {
+            // convert to pay to address type
+            if (!GetPubKey(CKeyID(uint160(vSolutions[0])), posPubKey)) {
+                LogPrint(BCLog::STAKING, "%s : failed to get key for kernel type=%d\n", __func__, whichType);
                 continue;
             }
+        }
+        else if (whichType == TX_PUBKEY) // pay to public key
+        {
+            posPubKey = CPubKey(vSolutions[0]);
+        }
+        else
+        {
+            LogPrint(BCLog::STAKING, "%s : no support for kernel type=%d\n", __func__, whichType);
+            continue;
+        }
 
-            // Found a kernel
-            LogPrint(BCLog::STAKING, "%s  : kernel found\n", __func__ );
+        StakeKernelCandidate candidate;
+        if (!PrepareStakeKernelCandidate(header, *pcoin_index, std::get<0>(stake_coin), prevoutStake, candidate)) {
+            continue;
+        }
+        candidates.push_back(candidate);
+        keys.push_back(posPubKey);
+    }
+    return true;
+}
 
-            std::vector<std::vector<unsigned char>> vSolutions;
-            txnouttype whichType;
-            CScript scriptPubKeyOut;
-            const auto &tx_in = pWalletTxIn->tx->vout[prevoutStake.n];
-            const auto &scriptPubKeyKernel = tx_in.scriptPubKey;
+bool CWallet::FindStakeKernel(const CBlockIndex* pindex_prev, const CBlockHeader& header, StakeKernel& kernel)
+{
+    std::vector<StakeKernelCandidate> vKernelCandidates;
+    std::vector<CPubKey> vKernelKeys;
+    if (!GetStakeKernelCandidates(pindex_prev, header, vKernelCandidates, vKernelKeys)) {
+        return false;
+    }
 
-            whichType = Solver(scriptPubKeyKernel, vSolutions);
+    StakeKernelWindow window;
+    {
+        LOCK(cs_main);
+        if (!PrepareStakeKernelWindow(header, *pindex_prev, nHashDrift, window)) {
+            return false;
+        }
+        // Kernels not newer than the median time past would be rejected
+        window.nTimePastLimit = ::ChainActive().Tip()->GetMedianTimePast();
+    }
 
-            if (whichType == TX_NONSTANDARD) {
-                LogPrint(BCLog::STAKING, "%s : failed to parse kernel\n", __func__);
-                continue;
-            }
+    StakeKernelSearch search;
+    {
+        LOCK(cs_stake_pool);
+        if (m_stake_pool.size() != nStakeThreads - 1) {
+            m_stake_pool.resize(nStakeThreads - 1);
+            RenameThreadPool(m_stake_pool, "piratecash-stake");
+        }
+        SearchStakeKernels(window, vKernelCandidates, nStakeThreads, search, &m_stake_pool);
+    }
+    const uint64_t nKernels = std::accumulate(search.vHashes.begin(), search.vHashes.end(), uint64_t{0});
 
-            LogPrint(BCLog::STAKING, "%s  : parsed kernel type=%d\n", __func__, whichType);
+    {
+        LOCK(cs_wallet);
+        m_last_stake_search.nTime = GetTime();
+        m_last_stake_search.nDurationMicros = search.nDurationMicros;
+        m_last_stake_search.nThreads = search.nThreads;
+        m_last_stake_search.nCandidates = search.nScanned;
+        m_last_stake_search.nKernels = nKernels;
+    }
+    LogPrint(BCLog::STAKING, "%s : scanned %u of %u inputs, %u kernels in %.2fms using %d threads\n", __func__,
+             search.nScanned, vKernelCandidates.size(), nKernels, search.nDurationMicros * 0.001, search.nThreads);
 
-            if (whichType == TX_PUBKEYHASH) // pay to address type
-            {
-                // convert to pay to address type
-                if (!GetPubKey(CKeyID(uint160(vSolutions[0])), curr_block.posPubKey)) {
-                    LogPrint(BCLog::STAKING, "%s : failed to get key for kernel type=%d\n", __func__, whichType);
-                    continue;
-                }
-            }
-            else if (whichType == TX_PUBKEY) // pay to public key
-            {
-                curr_block.posPubKey = CPubKey(vSolutions[0]);
-            }
-            else
-            {
-                LogPrint(BCLog::STAKING, "%s : no support for kernel type=%d\n", __func__, whichType);
-                continue;
-            }
+    if (search.nFound == vKernelCandidates.size() || ShutdownRequested()) {
+        LogPrint(BCLog::STAKING, "%s : no stakes found\n", __func__);
+        return false;
+    }
 
-            assert(curr_block.posPubKey.IsValid());
-            scriptPubKeyOut = GetScriptForDestination(curr_block.posPubKey.GetID());
+    // Found a kernel
+    kernel.header = header;
+    kernel.header.nTime = search.nTimeTx;
+    kernel.header.nStakeModifier() = search.nStakeModifier;
+    kernel.header.posPubKey = vKernelKeys[search.nFound];
+    kernel.prevout = vKernelCandidates[search.nFound].prevout;
 
-            // Require the same miner's output in CoinBase
-            coinbaseTx.vout[0].scriptPubKey = scriptPubKeyOut;
+    LogPrint(BCLog::STAKING, "%s  : kernel found tx=%s n=%u time=%u hashProof=%s\n", __func__,
+             kernel.prevout.hash.ToString(), kernel.prevout.n, kernel.header.nTime, search.hashProofOfStake.ToString());
+    return true;
+}
 
-            CMutableTransaction stakeTx;
-            stakeTx.vin.emplace_back(prevoutStake);
-            // Mark coin stake transaction
-            CScript scriptEmpty;
-            scriptEmpty.clear();
-            stakeTx.vout.push_back(CTxOut(0, scriptEmpty));
-            stakeTx.vout.emplace_back(tx_in.nValue, scriptPubKeyOut);
+bool CWallet::CreateCoinStake(const StakeKernel& kernel, CBlock& curr_block, CMutableTransaction& coinbaseTx)
+{
+    const COutPoint& prevoutStake = kernel.prevout;
+    const CWalletTx* pWalletTxIn = WITH_LOCK(cs_wallet, return GetWalletTx(prevoutStake.hash));
+    if (pWalletTxIn == nullptr || prevoutStake.n >= pWalletTxIn->tx->vout.size()) {
+        return error("CreateCoinStake : kernel tx=%s n=%u is not in the wallet", prevoutStake.hash.ToString(), prevoutStake.n);
+    }
+    curr_block.nTime = kernel.header.nTime;
+    curr_block.nStakeModifier() = kernel.header.nStakeModifier();
+    curr_block.posPubKey = kernel.header.posPubKey;
 
-            CAmount reward = stakeTx.vout[1].nValue;
-            const CAmount split_threshold = nStakeSplitThreshold * COIN;
-            const CAmount autocombine_target = split_threshold * 2 - 1;
+    const auto &tx_in = pWalletTxIn->tx->vout[prevoutStake.n];
+    const auto &scriptPubKeyKernel = tx_in.scriptPubKey;
 
-            std::vector<CScript> vin_scripts;
-            vin_scripts.emplace_back(scriptPubKeyKernel);
+    assert(curr_block.posPubKey.IsValid());
+    CScript scriptPubKeyOut = GetScriptForDestination(curr_block.posPubKey.GetID());
 
-            if (fAutocombine != AUTOCOMBINE_DISABLE) {
-                CKeyID scriptPubKeyID = curr_block.posPubKey.GetID();
-                std::vector<CInputCoin> ac_candidates;
-                // find candidates
-                {
-                    std::vector<CompactTallyItem> vecTallyRet = SelectCoinsGroupedByAddresses();
-                    if (fAutocombine == AUTOCOMBINE_SAME) {
-                        // Autocombine same
-                        CTxDestination reqdest{scriptPubKeyID};
-                        for (auto titer = vecTallyRet.begin(); titer != vecTallyRet.end(); ++titer) {
-                            if (titer->txdest == reqdest) {
-                                 ac_candidates.swap(titer->vecInputCoins);
-                                 break;
-                            }
-                        }
-                    } else if (fAutocombine == AUTOCOMBINE_ANY) {
-                        for (auto titer = vecTallyRet.begin(); titer != vecTallyRet.end(); ++titer) {
-                            ac_candidates.insert(
-                                        ac_candidates.end(),
-                                        titer->vecInputCoins.begin(), titer->vecInputCoins.end());
-                        }
-                    }
-                }
+    // Require the same miner's output in CoinBase
+    coinbaseTx.vout[0].scriptPubKey = scriptPubKeyOut;
 
-                // Automatically combine
-                auto ac_iter = ac_candidates.begin();
-                auto min_age = Params().MinStakeAge();
-                auto ac_len = ac_candidates.size();
-                int inputs_included = 0;
-                for (auto i = 0;
-                     (i < ac_len) && (inputs_included < nStakeMaxSplit);
-                     //(i < 500) && (reward < autocombine_target);
-                     ++i
-                ){
-                     const CTxOut *ac_in = nullptr;
-                     CAmount ac_amt = 0;
-                     for (; ac_iter != ac_candidates.end(); ++ac_iter) {
-                        if (ac_iter->outpoint == prevoutStake) {
-                                continue;
-                            }
-                        const CWalletTx* wtx = GetWalletTx(ac_iter->outpoint.hash);
-                        if (wtx == nullptr){
-                            continue;
-                        }
+    CMutableTransaction stakeTx;
+    stakeTx.vin.emplace_back(prevoutStake);
+    // Mark coin stake transaction
+    CScript scriptEmpty;
+    scriptEmpty.clear();
+    stakeTx.vout.push_back(CTxOut(0, scriptEmpty));
+    stakeTx.vout.emplace_back(tx_in.nValue, scriptPubKeyOut);
 
-                        ac_in = &(wtx->tx->vout[ac_iter->outpoint.n]);
-                        ac_amt = ac_in->nValue;
+    CAmount reward = stakeTx.vout[1].nValue;
+    const CAmount split_threshold = nStakeSplitThreshold * COIN;
+    const CAmount autocombine_target = split_threshold * 2 - 1;
 
-                        int64_t nTimeInput = (int64_t)wtx->GetTxTime() + (int64_t)min_age;
-                        int64_t nCurrentTime = (int64_t)GetTime();
-                        if (nTimeInput > nCurrentTime )
-                        {
-                            continue;
-                        }
-                        if (ac_amt < MIN_STAKE_AMOUNT){
-                            break;
-                        }
-                        if ((reward + ac_amt) < autocombine_target)
-                        {
-                            break;
-                        }
-                     }
+    std::vector<CScript> vin_scripts;
+    vin_scripts.emplace_back(scriptPubKeyKernel);
 
-                    if (ac_iter == ac_candidates.end()) {
-                        break;
+    if (fAutocombine != AUTOCOMBINE_DISABLE) {
+        CKeyID scriptPubKeyID = curr_block.posPubKey.GetID();
+        std::vector<CInputCoin> ac_candidates;
+        // find candidates
+        {
+            std::vector<CompactTallyItem> vecTallyRet = SelectCoinsGroupedByAddresses();
+            if (fAutocombine == AUTOCOMBINE_SAME) {
+                // Autocombine same
+                CTxDestination reqdest{scriptPubKeyID};
+                for (auto titer = vecTallyRet.begin(); titer != vecTallyRet.end(); ++titer) {
+                    if (titer->txdest == reqdest) {
+                         ac_candidates.swap(titer->vecInputCoins);
+                         break;
                     }
-
-                     inputs_included++;
-                     stakeTx.vin.emplace_back(ac_iter->outpoint);
-                     vin_scripts.emplace_back(ac_in->scriptPubKey);
-                     reward += ac_amt;
-                     LogPrint(BCLog::STAKING, "%s : auto-combining tx=%s n=%u amount=%llu total=%llu\n", __func__,
-                              ac_iter->outpoint.hash.ToString().c_str(), ac_iter->outpoint.n, ac_amt, reward);
-                     ++ac_iter;
+                }
+            } else if (fAutocombine == AUTOCOMBINE_ANY) {
+                for (auto titer = vecTallyRet.begin(); titer != vecTallyRet.end(); ++titer) {
+                    ac_candidates.insert(
+                                ac_candidates.end(),
+                                titer->vecInputCoins.begin(), titer->vecInputCoins.end());
                 }
             }
+        }
 
-            // Automatically split
-            for (int i = 0; (i < nStakeMaxSplit) && (reward > split_threshold * 2); ++i) {
-                stakeTx.vout.emplace_back(split_threshold, scriptPubKeyOut);
-                reward -= split_threshold;
-            }
-
-            stakeTx.vout[1].nValue = reward;
+        // Automatically combine
+        auto ac_iter = ac_candidates.begin();
+        auto min_age = Params().MinStakeAge();
+        auto ac_len = ac_candidates.size();
+        int inputs_included = 0;
+        for (auto i = 0;
+             (i < ac_len) && (inputs_included < nStakeMaxSplit);
+             //(i < 500) && (reward < autocombine_target);
+             ++i
+        ){
+             const CTxOut *ac_in = nullptr;
+             CAmount ac_amt = 0;
+             for (; ac_iter != ac_candidates.end(); ++ac_iter) {
+                if (ac_iter->outpoint == prevoutStake) {
+                        continue;
+                    }
+                const CWalletTx* wtx = GetWalletTx(ac_iter->outpoint.hash);
+                if (wtx == nullptr){
+                    continue;
+                }
 
-            LogPrint(BCLog::STAKING, "%s : split stake vout into %llu pieces\n", __func__,
-                     stakeTx.vout.size());
+                ac_in = &(wtx->tx->vout[ac_iter->outpoint.n]);
+                ac_amt = ac_in->nValue;
 
-            for (size_t i = 0; i < vin_scripts.size(); ++i) {
-                if (!SignSignature(*this, vin_scripts[i], stakeTx, i, reward, SIGHASH_ALL)) {
-                    return error("CreateCoinStake : failed to sign coinstake");
+                int64_t nTimeInput = (int64_t)wtx->GetTxTime() + (int64_t)min_age;
+                int64_t nCurrentTime = (int64_t)GetTime();
+                if (nTimeInput > nCurrentTime )
+                {
+                    continue;
+                }
+                if (ac_amt < MIN_STAKE_AMOUNT){
+                    break;
                 }
+                if ((reward + ac_amt) < autocombine_target)
+                {
+                    break;
+                }
+             }
+
+            if (ac_iter == ac_candidates.end()) {
+                break;
             }
 
-            curr_block.posStakeHash = prevoutStake.hash;
-            curr_block.posStakeN = prevoutStake.n;
-            curr_block.Stake() = MakeTransactionRef(std::move(stakeTx));
+             inputs_included++;
+             stakeTx.vin.emplace_back(ac_iter->outpoint);
+             vin_scripts.emplace_back(ac_in->scriptPubKey);
+             reward += ac_amt;
+             LogPrint(BCLog::STAKING, "%s : auto-combining tx=%s n=%u amount=%llu total=%llu\n", __func__,
+                      ac_iter->outpoint.hash.ToString().c_str(), ac_iter->outpoint.n, ac_amt, reward);
+             ++ac_iter;
+        }
+    }
+
+    // Automatically split
+    for (int i = 0; (i < nStakeMaxSplit) && (reward > split_threshold * 2); ++i) {
+        stakeTx.vout.emplace_back(split_threshold, scriptPubKeyOut);
+        reward -= split_threshold;
+    }
 
-            LogPrint(BCLog::STAKING, "%s : added kernel type=%d\n", __func__, whichType);
+    stakeTx.vout[1].nValue = reward;
 
-            // Force update
-            nLastStakeSetUpdate = 0;
-            return true;
+    LogPrint(BCLog::STAKING, "%s : split stake vout into %llu pieces\n", __func__,
+             stakeTx.vout.size());
+
+    for (size_t i = 0; i < vin_scripts.size(); ++i) {
+        if (!SignSignature(*this, vin_scripts[i], stakeTx, i, reward, SIGHASH_ALL)) {
+            return error("CreateCoinStake : failed to sign coinstake");
         }
     }
 
-    LogPrint(BCLog::STAKING, "%s : no stakes found\n", __func__);
+    curr_block.posStakeHash = prevoutStake.hash;
+    curr_block.posStakeN = prevoutStake.n;
+    curr_block.Stake() = MakeTransactionRef(std::move(stakeTx));
 
-    return false;
+    LogPrint(BCLog::STAKING, "%s : added kernel tx=%s n=%u\n", __func__, prevoutStake.hash.ToString(), prevoutStake.n);
+
+    return true;
 }
 
 void CWallet::CommitTransaction(CTransactionRef tx, mapValue_t mapValue, std::vector<std::pair<std::string, std::string>> orderForm)
@@ -6066,6 +6173,8 @@ void CWallet::NotifyTransactionLock(const CTransactionRef &tx, const std::shared
     uint256 txHash = tx->GetHash();
     std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(txHash);
     if (mi != mapWallet.end()){
+        // An islock makes the transaction trusted before it confirms
+        MarkStakeDirty(txHash);
         NotifyTransactionChanged(this, txHash, CT_UPDATED);
         NotifyISLockReceived();
         // notify an external script
@@ -6159,6 +6268,21 @@ bool CWalletTx::IsChainLocked() const
     return fIsChainlocked;
 }
 
+void CWalletTx::MarkDirty()
+{
+    m_amounts[DEBIT].Reset();
+    m_amounts[CREDIT].Reset();
+    m_amounts[ANON_CREDIT].Reset();
+    m_amounts[DENOM_CREDIT].Reset();
+    m_amounts[DENOM_UCREDIT].Reset();
+    m_amounts[IMMATURE_CREDIT].Reset();
+    m_amounts[AVAILABLE_CREDIT].Reset();
+    fChangeCached = false;
+    if (pwallet) {
+        pwallet->MarkStakeDirty(GetHash());
+    }
+}
+
 int CWalletTx::GetBlocksToMaturity(interfaces::Chain::Lock& locked_chain) const
 {
     if (!(IsCoinBase() || IsCoinStake()))
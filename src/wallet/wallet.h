@@ -11,6 +11,7 @@
 #include <interfaces/chain.h>
 #include <interfaces/handler.h>
 #include <policy/feerate.h>
+#include <primitives/block.h>
 #include <saltedhasher.h>
 #include <tinyformat.h>
 #include <ui_interface.h>
@@ -26,6 +27,8 @@
 
 #include <governance/object.h>
 
+#include <ctpl_stl.h>
+
 #include <algorithm>
 #include <atomic>
 #include <deque>
@@ -35,6 +38,7 @@
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -105,6 +109,9 @@ enum {
     AUTOCOMBINE_ANY = 2,
  };
 static const int DEFAULT_STAKE_AUTOCOMBINE = AUTOCOMBINE_SAME;
+//! -stakethreads default, 0 = one thread per core up to MAX_STAKE_THREADS
+static const int DEFAULT_STAKE_THREADS = 0;
+static const int MAX_STAKE_THREADS = 16;
 
 class CCoinControl;
 class CKey;
@@ -114,6 +121,7 @@ class CScript;
 class CTxDSIn;
 class CWalletTx;
 struct FeeCalculation;
+struct StakeKernelCandidate;
 enum class FeeEstimateMode;
 
 extern CCriticalSection cs_main;
@@ -420,17 +428,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        m_amounts[DEBIT].Reset();
-        m_amounts[CREDIT].Reset();
-        m_amounts[ANON_CREDIT].Reset();
-        m_amounts[DENOM_CREDIT].Reset();
-        m_amounts[DENOM_UCREDIT].Reset();
-        m_amounts[IMMATURE_CREDIT].Reset();
-        m_amounts[AVAILABLE_CREDIT].Reset();
-        fChangeCached = false;
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -702,6 +700,42 @@ private:
     // A helper function which loops through wallet UTXOs
     std::unordered_set<const CWalletTx*, WalletTxHasher> GetSpendableTXs() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /**
+     * Output of the wallet that can stake once it is deep and old enough.
+     * Ordered by value, larger first, then by the height it matures at.
+     */
+    struct StakeOutput {
+        CAmount nValue;
+        int nMatureHeight;
+        int64_t nMatureTime;
+        COutPoint outpoint;
+
+        bool operator<(const StakeOutput& other) const
+        {
+            return std::tie(other.nValue, nMatureHeight, outpoint) < std::tie(nValue, other.nMatureHeight, other.outpoint);
+        }
+    };
+    using StakeOutputs = std::set<StakeOutput>;
+
+    /**
+     * The stakeable outputs and the trusted balance are updated from the
+     * transactions whose amounts were invalidated by CWalletTx::MarkDirty(),
+     * so staking does not rescan mapWallet.
+     */
+    StakeOutputs m_stake_outputs GUARDED_BY(cs_wallet);
+    std::map<COutPoint, StakeOutputs::const_iterator> m_stake_output_index GUARDED_BY(cs_wallet);
+    //! Trusted available credit of each transaction, summed in m_trusted_balance
+    std::map<uint256, CAmount> m_trusted_credit GUARDED_BY(cs_wallet);
+    CAmount m_trusted_balance GUARDED_BY(cs_wallet){0};
+    //! Coinbase and coinstake transactions to update when they mature, by height
+    std::multimap<int, uint256> m_stake_maturing GUARDED_BY(cs_wallet);
+    //! Transactions queued by MarkStakeDirty()
+    mutable Mutex cs_stake_dirty;
+    mutable std::set<uint256> m_stake_dirty GUARDED_BY(cs_stake_dirty);
+
+    //! Apply the transactions queued by MarkStakeDirty() and the ones maturing at the tip
+    void UpdateStakeOutputs(interfaces::Chain::Lock& locked_chain) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /**
      * The following is used to keep track of how far behind the wallet is
      * from the chain sync, and to allow clients to block on us being caught up.
@@ -775,12 +809,41 @@ public:
     uint64_t nStakeSplitThreshold;
     int nStakeMaxSplit;
     int fAutocombine;
-    int nStakeSetUpdateTime;
     using StakeCandidate = std::tuple<CAmount, const CWalletTx*, unsigned int>;
     using StakeCandidates = std::vector<StakeCandidate>;
     StakeCandidates setStakeCoins;
-    int nLastStakeSetUpdate;
     bool inputStakeProtect;
+    int nStakeThreads;
+
+    //! Outcome of the last kernel search over the coins of this wallet
+    struct StakeSearchStats {
+        int64_t nTime{0};
+        int64_t nDurationMicros{0};
+        int nThreads{0};
+        uint64_t nCandidates{0};
+        uint64_t nKernels{0};
+    };
+    StakeSearchStats m_last_stake_search GUARDED_BY(cs_wallet);
+
+    //! Runs the kernel search of FindStakeKernel() next to the calling thread, kept across searches
+    Mutex cs_stake_pool;
+    ctpl::thread_pool m_stake_pool GUARDED_BY(cs_stake_pool);
+
+    //! Blocks staked with the coins of this wallet since startup
+    struct StakeHitStats {
+        uint64_t nCount{0};
+        int64_t nLastTime{0};
+        int nLastHeight{0};
+        uint256 hashLastBlock;
+    };
+    StakeHitStats m_stake_hits GUARDED_BY(cs_wallet);
+
+    //! A kernel found by FindStakeKernel(), spent by CreateCoinStake()
+    struct StakeKernel {
+        //! The header searched, with the time, stake modifier and key of the kernel
+        CBlockHeader header;
+        COutPoint prevout;
+    };
 
     /** Construct wallet with specified name and database implementation. */
     CWallet(interfaces::Chain& chain, const WalletLocation& location, std::unique_ptr<WalletDatabase> database)
@@ -808,9 +871,12 @@ public:
         fAutocombine = gArgs.GetArg("-stakeautocombine", DEFAULT_STAKE_AUTOCOMBINE);
         nHashInterval = gArgs.GetArg("-poshashinterval", 16);
         inputStakeProtect = gArgs.GetBoolArg("-inputstakeprotect", true);
-        nStakeSetUpdateTime = 300; // 5 minutes
+        nStakeThreads = gArgs.GetArg("-stakethreads", DEFAULT_STAKE_THREADS);
+        if (nStakeThreads <= 0) {
+            nStakeThreads = GetNumCores();
+        }
+        nStakeThreads = std::max(1, std::min(nStakeThreads, MAX_STAKE_THREADS));
         setStakeCoins.clear();
-        nLastStakeSetUpdate = 0;
     }
 
     std::map<uint256, CWalletTx> mapWallet GUARDED_BY(cs_wallet);
@@ -873,7 +939,10 @@ public:
     std::vector<CompactTallyItem> SelectCoinsGroupedByAddresses(bool fSkipDenominated = true, bool fAnonymizable = true, bool fSkipUnconfirmed = true, int nMaxOupointsPerAddress = -1) const;
 
     bool MintableCoins();
-    bool SelectStakeCoins(StakeCandidates& setCoins, CAmount nTargetAmount) const;
+    /** Fill setCoins with the stakeable outputs worth at most nTargetAmount, larger first */
+    bool SelectStakeCoins(StakeCandidates& setCoins, CAmount nTargetAmount);
+    /** Queue a transaction whose outputs or credit changed for UpdateStakeOutputs() */
+    void MarkStakeDirty(const uint256& hash) const;
 
     /// Get 1000PIRATECASH output and keys which can be used for the Masternode
     bool GetMasternodeOutpointAndKeys(COutPoint& outpointRet, CPubKey& pubKeyRet, CKey& keyRet, const std::string& strTxHash = "", const std::string& strOutputIndex = "");
@@ -1032,6 +1101,8 @@ public:
         CAmount m_denominated_untrusted_pending{0};
     };
     Balance GetBalance(int min_depth = 0, const bool fAddLocked = false, const CCoinControl* coinControl = nullptr) const;
+    /** Same as GetBalance().m_mine_trusted, without walking the wallet */
+    CAmount GetTrustedBalance();
 
     CAmount GetAnonymizableBalance(bool fSkipDenominated = false, bool fSkipUnconfirmed = true) const;
     float GetAverageAnonymizedRounds() const;
@@ -1066,6 +1137,19 @@ public:
     void CommitTransaction(CTransactionRef tx, mapValue_t mapValue, std::vector<std::pair<std::string, std::string>> orderForm);
 
     bool CreateCoinStake(const CBlockIndex *pindex_prev, CBlock& curr_block, CMutableTransaction& coinbaseTx);
+    /**
+     * Search the stakeable coins for a kernel on top of pindex_prev. Only the
+     * version, bits and time of header are used, so no block template is needed.
+     */
+    bool FindStakeKernel(const CBlockIndex* pindex_prev, const CBlockHeader& header, StakeKernel& kernel);
+    /**
+     * Append the stakeable coins of this wallet to candidates, and the key that
+     * would sign a block staked with each of them to keys.
+     */
+    bool GetStakeKernelCandidates(const CBlockIndex* pindex_prev, const CBlockHeader& header,
+                                  std::vector<StakeKernelCandidate>& candidates, std::vector<CPubKey>& keys);
+    /** Build and sign the coinstake spending a kernel, and pay coinbaseTx to its key. */
+    bool CreateCoinStake(const StakeKernel& kernel, CBlock& curr_block, CMutableTransaction& coinbaseTx);
 
     bool DummySignTx(CMutableTransaction &txNew, const std::set<CTxOut> &txouts, bool use_max_sig = false) const
     {
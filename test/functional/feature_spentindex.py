@@ -13,9 +13,8 @@ from decimal import Decimal
 
 from test_framework.messages import COIN, COutPoint, CTransaction, CTxIn, CTxOut
 from test_framework.script import CScript, OP_CHECKSIG, OP_DUP, OP_EQUALVERIFY, OP_HASH160
-from test_framework.test_node import ErrorMatch
 from test_framework.test_framework import BitcoinTestFramework
-from test_framework.util import assert_equal, connect_nodes
+from test_framework.util import assert_equal, connect_nodes, wait_until
 
 
 class SpentIndexTest(BitcoinTestFramework):
@@ -42,17 +41,17 @@ class SpentIndexTest(BitcoinTestFramework):
         self.sync_all()
 
     def run_test(self):
-        self.log.info("Test that settings can't be changed without -reindex...")
+        self.log.info("Test that the index can be toggled without -reindex...")
         self.stop_node(1)
-        self.nodes[1].assert_start_raises_init_error(["-spentindex=0"], "You need to rebuild the database using -reindex to change -spentindex", match=ErrorMatch.PARTIAL_REGEX)
-        self.start_node(1, ["-spentindex=0", "-reindex"])
+        self.start_node(1, ["-spentindex=0"])
+        assert "spentindex" not in self.nodes[1].getindexinfo()
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
         self.stop_node(1)
-        self.nodes[1].assert_start_raises_init_error(["-spentindex"], "You need to rebuild the database using -reindex to change -spentindex", match=ErrorMatch.PARTIAL_REGEX)
-        self.start_node(1, ["-spentindex", "-reindex"])
+        self.start_node(1, ["-spentindex"])
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
+        wait_until(lambda: self.nodes[1].getindexinfo("spentindex") == {"spentindex": {"synced": True, "best_block_height": self.nodes[1].getblockcount()}})
 
         self.log.info("Mining blocks...")
         self.nodes[0].generate(105)